@@ -3,9 +3,10 @@ package morse
 /*
  * External CW Decoder Extension
  *
- * Spawns /usr/local/bin/cw-decoder as a subprocess.
- * The binary reads mono int16 little-endian PCM from stdin (at the session
- * sample rate) and writes newline-delimited JSON to stdout:
+ * Decodes with /usr/local/bin/cw-decoder. All sessions share one
+ * `cw-decoder --server` subprocess (see server.go), which takes each
+ * session's mono int16 PCM (at the session sample rate) and writes
+ * newline-delimited JSON tagged with the session ID:
  *
  *   decode event:
  *     {"type":"decode","text":"CQ DE W1AW","cost":0.12,"confidence":"high","pitch":600,"speed":20}
@@ -27,31 +28,26 @@ package morse
  *         [type:1=0x12][msg_len:4 uint32 BE][msg: UTF-8]
  *
  * Multiple instances may run concurrently (one per user session).
- * All shared state is protected by e.mu or atomic operations.
+ * Per-instance state is protected by e.mu or atomic operations; the shared
+ * subprocess has its own locking.
  */
 
 import (
-	"bufio"
-	"bytes"
 	"encoding/binary"
-	"encoding/json"
 	"fmt"
-	"io"
 	"log"
 	"math"
 	"os"
-	"os/exec"
-	"strconv"
 	"sync"
 	"sync/atomic"
 	"time"
-	"unsafe"
 )
 
 const cwDecoderBinary = "/usr/local/bin/cw-decoder"
 
-// stopTimeout is how long Stop() waits for the subprocess to exit cleanly
-// after stdin is closed before sending SIGKILL.
+// stopTimeout is how long the shared subprocess is given to exit cleanly
+// after stdin is closed before it is sent SIGKILL, and how long Stop() waits
+// for its writer before detaching the session without it.
 const stopTimeout = 2 * time.Second
 
 // Message type bytes
@@ -79,6 +75,7 @@ type AudioSample struct {
 // cwEvent is the JSON structure emitted by cw-decoder on stdout
 type cwEvent struct {
 	Type       string  `json:"type"`
+	Session    uint32  `json:"session"`
 	Text       string  `json:"text"`
 	Cost       float32 `json:"cost"`
 	Confidence string  `json:"confidence"`
@@ -86,23 +83,22 @@ type cwEvent struct {
 	Speed      float32 `json:"speed"`
 }
 
-// ExternalMorseExtension wraps the cw-decoder subprocess.
-// Multiple instances may be created and run concurrently.
+// ExternalMorseExtension is one decoder session on the shared cw-decoder
+// subprocess. Multiple instances may be created and run concurrently.
 type ExternalMorseExtension struct {
 	sampleRate int
-	pitchHz    float64 // CW tone frequency passed to --pitch; 0 means use binary default
+	pitchHz    float64 // CW tone frequency to lock to; 0 means auto-detect
 
-	mu     sync.Mutex
-	cmd    *exec.Cmd
-	stdin  io.WriteCloser
-	stdout io.ReadCloser
+	mu      sync.Mutex
+	server  *decoderServer
+	session uint32
 
-	// running is accessed atomically so readLoop/writeLoop can check it
+	// running is accessed atomically so Stop() can check it
 	// without holding mu (avoids lock contention on the hot audio path).
 	running atomic.Bool
 
-	stopChan chan struct{}
-	wg       sync.WaitGroup
+	stopChan   chan struct{}
+	writerDone chan struct{} // closed when this run's writeLoop returns
 }
 
 // defaultPitchHz is the CW tone frequency passed to cw-decoder when no
@@ -157,7 +153,8 @@ func NewMorseExtension(sampleRate int, extensionParams map[string]interface{}) (
 // GetName returns the extension name
 func (e *ExternalMorseExtension) GetName() string { return "morse" }
 
-// Start launches the subprocess and begins the read/write goroutines.
+// Start opens a session on the shared subprocess (starting it if this is the
+// first) and begins the audio writer goroutine.
 // Safe to call after a previous Stop().
 func (e *ExternalMorseExtension) Start(audioChan <-chan AudioSample, resultChan chan<- []byte) error {
 	e.mu.Lock()
@@ -167,42 +164,31 @@ func (e *ExternalMorseExtension) Start(audioChan <-chan AudioSample, resultChan
 		return fmt.Errorf("morse decoder already running")
 	}
 
-	args := []string{"--sample-rate", strconv.Itoa(e.sampleRate)}
-	if e.pitchHz > 0 {
-		args = append(args, "--pitch", strconv.FormatFloat(e.pitchHz, 'f', 0, 64))
-	}
-	cmd := exec.Command(cwDecoderBinary, args...)
-	cmd.Stderr = io.Discard // suppress cw-decoder stderr (ggmorse character trace)
-
-	stdin, err := cmd.StdinPipe()
-	if err != nil {
-		return fmt.Errorf("failed to create stdin pipe: %w", err)
-	}
-	stdout, err := cmd.StdoutPipe()
+	server, session, err := acquireServer()
 	if err != nil {
-		return fmt.Errorf("failed to create stdout pipe: %w", err)
+		return err
 	}
-
-	if err := cmd.Start(); err != nil {
-		return fmt.Errorf("failed to start cw-decoder: %w", err)
+	if err := server.openSession(session, e.sampleRate, e.pitchHz, resultChan); err != nil {
+		releaseServer(server)
+		return err
 	}
 
-	e.cmd = cmd
-	e.stdin = stdin
-	e.stdout = stdout
+	e.server = server
+	e.session = session
 	e.stopChan = make(chan struct{})
+	e.writerDone = make(chan struct{})
 	e.running.Store(true)
 
-	log.Printf("[Morse pid=%d] Started cw-decoder (%d Hz)", cmd.Process.Pid, e.sampleRate)
+	log.Printf("[Morse session=%d] Started (%d Hz)", session, e.sampleRate)
 
-	e.wg.Add(2)
-	go e.writeLoop(audioChan)
-	go e.readLoop(resultChan)
+	// The writer gets its own copy of the run state: after a timed-out
+	// Stop() it may still be running when a later Start() replaces it.
+	go writeLoop(server, session, e.stopChan, e.writerDone, audioChan)
 
 	return nil
 }
 
-// Stop signals the subprocess to exit and waits for goroutines to finish.
+// Stop closes the session and waits for the writer goroutine to finish.
 // Idempotent — safe to call multiple times.
 func (e *ExternalMorseExtension) Stop() error {
 	e.mu.Lock()
@@ -212,53 +198,47 @@ func (e *ExternalMorseExtension) Stop() error {
 	}
 	e.running.Store(false)
 	stopChan := e.stopChan
-	stdin := e.stdin
-	cmd := e.cmd
+	writerDone := e.writerDone
+	server := e.server
+	session := e.session
 	e.mu.Unlock()
 
 	// Unblock writeLoop
 	close(stopChan)
 
-	// Close stdin → subprocess sees EOF → exits → stdout closes → readLoop exits
-	if stdin != nil {
-		_ = stdin.Close()
-	}
-
-	// Wait for goroutines with a timeout, then force-kill
-	done := make(chan struct{})
-	go func() {
-		e.wg.Wait()
-		close(done)
-	}()
-
 	select {
-	case <-done:
+	case <-writerDone:
 		// Clean exit
+		server.closeSession(session)
+		releaseServer(server)
 	case <-time.After(stopTimeout):
-		log.Printf("[Morse] subprocess did not exit within %s — killing", stopTimeout)
-		if cmd != nil && cmd.Process != nil {
-			_ = cmd.Process.Kill()
-		}
-		<-done // still wait for goroutines after kill
-	}
-
-	if cmd != nil {
-		_ = cmd.Wait() // reap zombie
+		// writeLoop can only be stuck in a write to a wedged subprocess.
+		// Other sessions may still be using it, so only this one is torn
+		// down: it stops receiving events now, and its reference is
+		// dropped so the last session out shuts the process down (which
+		// also fails the stuck write). The Close frame follows once the
+		// writer has returned.
+		log.Printf("[Morse session=%d] writer did not exit within %s — detaching session", session, stopTimeout)
+		server.detachSession(session)
+		releaseServer(server)
+		go func() {
+			<-writerDone
+			server.closeSession(session)
+		}()
 	}
 
-	log.Printf("[Morse] cw-decoder stopped")
+	log.Printf("[Morse session=%d] Stopped", session)
 	return nil
 }
 
-// writeLoop reads AudioSamples from audioChan and writes raw int16 LE PCM to
-// the subprocess stdin. Uses a direct memory cast on LE platforms (x86/ARM)
-// to avoid the reflection overhead of binary.Write.
-func (e *ExternalMorseExtension) writeLoop(audioChan <-chan AudioSample) {
-	defer e.wg.Done()
+// writeLoop forwards AudioSamples from audioChan to this session on the
+// shared subprocess.
+func writeLoop(server *decoderServer, session uint32, stopChan <-chan struct{}, done chan<- struct{}, audioChan <-chan AudioSample) {
+	defer close(done)
 
 	for {
 		select {
-		case <-e.stopChan:
+		case <-stopChan:
 			return
 		case sample, ok := <-audioChan:
 			if !ok {
@@ -267,13 +247,11 @@ func (e *ExternalMorseExtension) writeLoop(audioChan <-chan AudioSample) {
 			if len(sample.PCMData) == 0 {
 				continue
 			}
-			// Cast []int16 → []byte in-place (safe on little-endian platforms).
-			// This avoids the reflection loop inside binary.Write.
-			n := len(sample.PCMData) * 2
-			byteSlice := unsafe.Slice((*byte)(unsafe.Pointer(&sample.PCMData[0])), n)
-			if _, err := e.stdin.Write(byteSlice); err != nil {
-				if e.running.Load() {
-					log.Printf("[Morse] stdin write error: %v", err)
+			if err := server.writeAudio(session, sample.PCMData); err != nil {
+				select {
+				case <-stopChan:
+				default:
+					log.Printf("[Morse session=%d] stdin write error: %v", session, err)
 				}
 				return
 			}
@@ -281,62 +259,6 @@ func (e *ExternalMorseExtension) writeLoop(audioChan <-chan AudioSample) {
 	}
 }
 
-// readLoop reads newline-delimited JSON from the subprocess stdout and converts
-// each event into a binary frame sent on resultChan.
-// If the subprocess exits unexpectedly while still running, a 0x12 error frame
-// is sent so the frontend can display a meaningful message.
-func (e *ExternalMorseExtension) readLoop(resultChan chan<- []byte) {
-	defer e.wg.Done()
-
-	scanner := bufio.NewScanner(e.stdout)
-	for scanner.Scan() {
-		line := scanner.Bytes()
-
-		// ggmorse writes decoded characters directly to stdout before our JSON
-		// callback fires (e.g. "E HA{...}"). Strip everything before the first '{'.
-		if idx := bytes.IndexByte(line, '{'); idx > 0 {
-			line = line[idx:]
-		}
-
-		var ev cwEvent
-		if err := json.Unmarshal(line, &ev); err != nil {
-			log.Printf("[Morse] JSON parse error: %v (line: %s)", err, line)
-			continue
-		}
-
-		var msg []byte
-		switch ev.Type {
-		case "decode":
-			msg = encodeDecodeMsg(ev)
-		case "stats":
-			msg = encodeStatsMsg(ev)
-		default:
-			log.Printf("[Morse] unknown event type: %q", ev.Type)
-			continue
-		}
-
-		select {
-		case resultChan <- msg:
-		default:
-			// resultChan full — drop this frame rather than block
-		}
-	}
-
-	if err := scanner.Err(); err != nil {
-		log.Printf("[Morse] stdout read error: %v", err)
-	}
-
-	// If we exited the scan loop while still supposed to be running, the
-	// subprocess crashed. Notify the frontend.
-	if e.running.Load() {
-		log.Printf("[Morse] subprocess exited unexpectedly")
-		select {
-		case resultChan <- encodeErrorMsg("cw-decoder subprocess exited unexpectedly"):
-		default:
-		}
-	}
-}
-
 // encodeDecodeMsg builds a 0x10 binary frame.
 //
 //	[type:1=0x10][confidence:1][cost:4 float32 BE][pitch:4 float32 BE][speed:4 float32 BE]
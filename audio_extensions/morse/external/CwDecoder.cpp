@@ -5,10 +5,8 @@
 #include <cstring>
 #include <thread>
 
-void CwDecoder::start(TextCallback onText, StatsCallback onStats)
+void CwDecoder::init(TextCallback onText, StatsCallback onStats)
 {
-    if (m_running.load()) return;
-
     m_onText  = std::move(onText);
     m_onStats = std::move(onStats);
 
@@ -20,24 +18,50 @@ void CwDecoder::start(TextCallback onText, StatsCallback onStats)
     params.sampleFormatOut = GGMORSE_SAMPLE_FORMAT_I16;
 
     m_ggmorse = std::make_unique<GGMorse>(params);
+    m_ggmorse->setAnalysisThreads(m_analysisThreads);
     applyDecodeParams();
 
+    // resampleFactor = sampleRateInp / kBaseSampleRate (e.g. 12000/4000 = 3, or 24000/4000 = 6)
+    // bytesPerFrame  = samplesPerFrame * resampleFactor * sizeof(int16_t)
+    const int resampleFactor = static_cast<int>(m_ggmorse->getSampleRateInp() / GGMorse::kBaseSampleRate);
+    m_samplesPerFrame = m_ggmorse->getSamplesPerFrame() * resampleFactor;
+
     // Ring capacity: 4 seconds of mono int16 at the configured sample rate
     m_ringCapacity = m_sampleRate * 4;
 
-    {
-        std::lock_guard<std::mutex> lock(m_bufMutex);
-        m_ringBuf.clear();
-    }
+    m_ringBuf.assign(m_ringCapacity, 0);
+    m_ringHead.store(0, std::memory_order_relaxed);
+    m_ringTail.store(0, std::memory_order_relaxed);
+    m_overruns.store(0, std::memory_order_relaxed);
+}
+
+void CwDecoder::start(TextCallback onText, StatsCallback onStats)
+{
+    if (m_running.load()) return;
+
+    init(std::move(onText), std::move(onStats));
 
     m_running = true;
     m_worker  = std::thread([this] { decodeLoop(); });
 }
 
+void CwDecoder::startPooled(TextCallback onText, StatsCallback onStats)
+{
+    if (m_running.load()) return;
+
+    init(std::move(onText), std::move(onStats));
+
+    m_running = true;
+}
+
 void CwDecoder::stop()
 {
     if (!m_running.load()) return;
     m_running = false;
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wakeCv.notify_all();
+    }
     if (m_worker.joinable()) {
         m_worker.join();
     }
@@ -46,17 +70,49 @@ void CwDecoder::stop()
 
 void CwDecoder::feedAudio(const int16_t* samples, int frames)
 {
-    if (!m_running.load()) return;
-
-    std::lock_guard<std::mutex> lock(m_bufMutex);
-    m_ringBuf.insert(m_ringBuf.end(), samples, samples + frames);
+    if (!m_running.load() || frames <= 0) return;
+
+    const size_t   cap  = m_ringBuf.size();
+    const uint64_t head = m_ringHead.load(std::memory_order_relaxed);
+    const uint64_t tail = m_ringTail.load(std::memory_order_acquire);
+
+    // Full ring: drop what does not fit from this block (drop-newest). The
+    // oldest samples cannot be evicted here without moving m_ringTail,
+    // which belongs to the decode thread.
+    const size_t space   = cap - static_cast<size_t>(head - tail);
+    const size_t toWrite = std::min(static_cast<size_t>(frames), space);
+    if (toWrite < static_cast<size_t>(frames)) {
+        m_overruns.fetch_add(frames - toWrite, std::memory_order_relaxed);
+    }
+    if (toWrite == 0) return;
+
+    // At most two contiguous spans (up to the end, then wrapped to the start)
+    const size_t pos   = static_cast<size_t>(head % cap);
+    const size_t first = std::min(toWrite, cap - pos);
+    std::memcpy(&m_ringBuf[pos], samples, first * sizeof(int16_t));
+    if (toWrite > first) {
+        std::memcpy(&m_ringBuf[0], samples + first, (toWrite - first) * sizeof(int16_t));
+    }
 
-    if (static_cast<int>(m_ringBuf.size()) > m_ringCapacity) {
-        int excess = static_cast<int>(m_ringBuf.size()) - m_ringCapacity;
-        m_ringBuf.erase(m_ringBuf.begin(), m_ringBuf.begin() + excess);
+    // seq_cst store/load pair with decodeLoop(): either it sees the new head
+    // before it parks, or we see m_waiting and wake it
+    m_ringHead.store(head + toWrite);
+    if (m_waiting.load() && head + toWrite - tail >= static_cast<uint64_t>(m_samplesPerFrame)) {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wakeCv.notify_one();
     }
 }
 
+size_t CwDecoder::ringAvailable() const
+{
+    // seq_cst, not just acquire: decodeLoop() stores m_waiting and then reads
+    // the head here, while feedAudio() stores the head and then reads
+    // m_waiting. Only with both sides seq_cst is one of them sure to see the
+    // other's store, so a wakeup cannot be lost.
+    const uint64_t tail = m_ringTail.load(std::memory_order_relaxed);
+    return static_cast<size_t>(m_ringHead.load() - tail);
+}
+
 void CwDecoder::lockPitch(bool lock)
 {
     m_pitchLocked = lock;
@@ -110,46 +166,61 @@ void CwDecoder::applyDecodeParams()
 
 void CwDecoder::decodeLoop()
 {
-    // resampleFactor = sampleRateInp / kBaseSampleRate (e.g. 12000/4000 = 3, or 24000/4000 = 6)
-    // bytesPerFrame  = samplesPerFrame * resampleFactor * sizeof(int16_t)
-    const int resampleFactor = static_cast<int>(m_ggmorse->getSampleRateInp() / GGMorse::kBaseSampleRate);
-    const int samplesPerFrame = m_ggmorse->getSamplesPerFrame() * resampleFactor;
+    const size_t frame = static_cast<size_t>(m_samplesPerFrame);
 
     while (m_running.load()) {
-        {
-            std::lock_guard<std::mutex> lock(m_bufMutex);
-            if (static_cast<int>(m_ringBuf.size()) < samplesPerFrame) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(20));
-                continue;
-            }
-        }
+        if (decodePending()) continue;
+
+        // Park until feedAudio() has buffered a full frame. The timeout is
+        // only a backstop; stop() and feedAudio() both notify.
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_waiting.store(true);
+        m_wakeCv.wait_for(lock, std::chrono::milliseconds(200), [this, frame] {
+            return !m_running.load() || ringAvailable() >= frame;
+        });
+        m_waiting.store(false);
+    }
+}
 
-        m_ggmorse->decode([this, samplesPerFrame](void* data, uint32_t nMaxBytes) -> uint32_t {
-            if (!m_running.load()) return 0;
+bool CwDecoder::decodePending()
+{
+    if (!m_running.load()) return false;
+    if (ringAvailable() < static_cast<size_t>(m_samplesPerFrame)) return false;
+
+    m_ggmorse->decode([this](void* data, uint32_t nMaxBytes) -> uint32_t {
+        if (!m_running.load()) return 0;
+
+        const size_t   needed = nMaxBytes / sizeof(int16_t);
+        const uint64_t tail   = m_ringTail.load(std::memory_order_relaxed);
+        const uint64_t head   = m_ringHead.load(std::memory_order_acquire);
+        if (head - tail < needed) return 0;
+
+        const size_t cap   = m_ringBuf.size();
+        const size_t pos   = static_cast<size_t>(tail % cap);
+        const size_t first = std::min(needed, cap - pos);
+        auto* out = static_cast<int16_t*>(data);
+        std::memcpy(out, &m_ringBuf[pos], first * sizeof(int16_t));
+        if (needed > first) {
+            std::memcpy(out + first, &m_ringBuf[0], (needed - first) * sizeof(int16_t));
+        }
 
-            std::lock_guard<std::mutex> lock(m_bufMutex);
-            const uint32_t needed = nMaxBytes;
-            const uint32_t avail  = static_cast<uint32_t>(m_ringBuf.size()) * sizeof(int16_t);
-            if (avail < needed) return 0;
+        m_ringTail.store(tail + needed, std::memory_order_release);
+        return static_cast<uint32_t>(needed * sizeof(int16_t));
+    });
 
-            const int samples = static_cast<int>(needed / sizeof(int16_t));
-            std::memcpy(data, m_ringBuf.data(), needed);
-            m_ringBuf.erase(m_ringBuf.begin(), m_ringBuf.begin() + samples);
-            return needed;
-        });
+    const auto& stats = m_ggmorse->getStatistics();
 
-        const auto& stats = m_ggmorse->getStatistics();
-
-        GGMorse::TxRx rxData;
-        if (m_ggmorse->takeRxData(rxData) > 0 && stats.costFunction < 1.0f) {
-            std::string text(reinterpret_cast<const char*>(rxData.data()), rxData.size());
-            if (m_onText) m_onText(text, stats.costFunction);
-        }
+    GGMorse::TxRx rxData;
+    if (m_ggmorse->takeRxData(rxData) > 0 && stats.costFunction < 1.0f) {
+        std::string text(reinterpret_cast<const char*>(rxData.data()), rxData.size());
+        if (m_onText) m_onText(text, stats.costFunction);
+    }
 
-        if (stats.estimatedPitch_Hz > 0.0f) {
-            m_pitch = stats.estimatedPitch_Hz;
-            m_speed = stats.estimatedSpeed_wpm;
-            if (m_onStats) m_onStats({stats.estimatedPitch_Hz, stats.estimatedSpeed_wpm, stats.costFunction});
-        }
+    if (stats.estimatedPitch_Hz > 0.0f) {
+        m_pitch = stats.estimatedPitch_Hz;
+        m_speed = stats.estimatedSpeed_wpm;
+        if (m_onStats) m_onStats({stats.estimatedPitch_Hz, stats.estimatedSpeed_wpm, stats.costFunction});
     }
+
+    return true;
 }
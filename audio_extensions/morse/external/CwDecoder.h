@@ -3,6 +3,8 @@
 #include "ggmorse/include/ggmorse/ggmorse.h"
 
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -13,6 +15,10 @@
 // Standalone CW decoder wrapping ggmorse. No Qt.
 // Feed mono int16 PCM at the sample rate passed to the constructor via feedAudio();
 // decoded text arrives via the callback supplied to start().
+//
+// start() runs the decoder on a thread of its own. startPooled() prepares it
+// without one; the owner then calls decodePending() from any single thread at
+// a time (e.g. a shared worker pool) after feeding audio.
 class CwDecoder {
 public:
     struct Stats {
@@ -33,31 +39,62 @@ public:
     CwDecoder& operator=(const CwDecoder&) = delete;
 
     void start(TextCallback onText, StatsCallback onStats = {});
+    void startPooled(TextCallback onText, StatsCallback onStats = {});
     void stop();
+
+    // Decode every complete frame buffered so far and fire the callbacks.
+    // Returns false if there was not a full frame to decode.
+    // Only for decoders started with startPooled().
+    bool decodePending();
     bool isRunning() const { return m_running.load(); }
 
     // Feed mono int16 PCM at the sample rate given to the constructor.
+    // Call from one thread at a time. Samples that do not fit in the
+    // 4 s ring are dropped and counted in overruns(): the newest ones, not
+    // the oldest as the vector buffer did, since only the decode thread may
+    // move the tail. Either way the decoder stays up to 4 s behind until it
+    // drains the ring; what is lost is the newest audio, not the oldest.
     void feedAudio(const int16_t* samples, int frames);
+    uint64_t overruns() const { return m_overruns.load(std::memory_order_relaxed); }
 
     void lockPitch(bool lock);
     void lockSpeed(bool lock);
     void setPitchRange(float minHz, float maxHz);
     void setKnownParameters(float pitchHz, float speedWpm);
 
+    // Threads for ggmorse's per-frame speed/level search (default 1).
+    // Call before start()/startPooled().
+    void setAnalysisThreads(int threads) { m_analysisThreads = threads > 0 ? threads : 1; }
+
     float estimatedPitch() const { return m_pitch.load(); }
     float estimatedSpeed() const { return m_speed.load(); }
 
 private:
+    void init(TextCallback onText, StatsCallback onStats);
     void decodeLoop();
     void applyDecodeParams();
+    size_t ringAvailable() const;
 
-    int m_sampleRate; // input PCM sample rate in Hz
+    int m_sampleRate;          // input PCM sample rate in Hz
+    int m_analysisThreads = 1; // see setAnalysisThreads()
 
     std::unique_ptr<GGMorse> m_ggmorse;
 
-    std::mutex            m_bufMutex;
+    // Single-producer/single-consumer ring: feedAudio() is the only writer and
+    // the ggmorse input callback reads straight out of it. Head and tail count
+    // samples and only ever grow; each side stores only its own index.
     std::vector<int16_t>  m_ringBuf;
     int                   m_ringCapacity{12000 * 4}; // 4 s of mono int16, updated in start()
+    int                   m_samplesPerFrame{0};      // input samples per ggmorse frame, set in start()
+    alignas(64) std::atomic<uint64_t> m_ringHead{0}; // producer index
+    alignas(64) std::atomic<uint64_t> m_ringTail{0}; // consumer index
+    alignas(64) std::atomic<uint64_t> m_overruns{0}; // samples dropped by feedAudio()
+
+    // Wakes decodeLoop() once a full frame is buffered. feedAudio() only takes
+    // the mutex when the loop is actually parked (m_waiting).
+    std::mutex              m_wakeMutex;
+    std::condition_variable m_wakeCv;
+    std::atomic<bool>       m_waiting{false};
 
     std::atomic<bool>  m_running{false};
     std::atomic<float> m_pitch{0.0f};
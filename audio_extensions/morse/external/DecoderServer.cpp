@@ -0,0 +1,202 @@
+#include "DecoderServer.h"
+#include "JsonEvents.h"
+
+#include <cstring>
+
+static uint32_t readLE32(const uint8_t* p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+         | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static float readLEFloat(const uint8_t* p)
+{
+    const uint32_t bits = readLE32(p);
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+DecoderServer::DecoderServer(int workers, int analysisThreads)
+    : m_analysisThreads(analysisThreads > 0 ? analysisThreads : 1)
+{
+    if (workers < 1) workers = 1;
+    m_workers.reserve(workers);
+    for (int i = 0; i < workers; ++i) {
+        m_workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+DecoderServer::~DecoderServer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_workers) {
+        if (t.joinable()) t.join();
+    }
+}
+
+int DecoderServer::run(FILE* in)
+{
+    uint8_t header[9];
+    std::vector<uint8_t> payload;
+    int result = 0;
+
+    while (fread(header, 1, sizeof(header), in) == sizeof(header)) {
+        const uint8_t  type = header[0];
+        const uint32_t id   = readLE32(header + 1);
+        const uint32_t len  = readLE32(header + 5);
+
+        if (len > kMaxPayload) {
+            fprintf(stderr, "cw-decoder: frame payload too large (%u bytes)\n", len);
+            result = 1;
+            break;
+        }
+        payload.resize(len);
+        if (len > 0 && fread(payload.data(), 1, len, in) != len) break;
+
+        switch (type) {
+        case kFrameOpen:
+            if (!openSession(id, payload.data(), len)) {
+                fprintf(stderr, "cw-decoder: bad open frame for session %u\n", id);
+            }
+            break;
+        case kFrameAudio:
+            feedSession(id, payload.data(), len);
+            break;
+        case kFrameClose:
+            closeSession(id);
+            break;
+        default:
+            fprintf(stderr, "cw-decoder: unknown frame type 0x%02x\n", type);
+            result = 1;
+            break;
+        }
+        if (result != 0) break;
+    }
+
+    // Let the workers finish whatever audio is already queued, then stop them
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_workers) {
+        if (t.joinable()) t.join();
+    }
+
+    for (auto& entry : m_sessions) {
+        entry.second->decoder.stop();
+    }
+    m_sessions.clear();
+    return result;
+}
+
+bool DecoderServer::openSession(uint32_t id, const uint8_t* payload, uint32_t len)
+{
+    if (len < 12) return false;
+
+    const int   sampleRate = static_cast<int>(readLE32(payload));
+    const float pitch      = readLEFloat(payload + 4);
+    const float speed      = readLEFloat(payload + 8);
+    if (sampleRate <= 0) return false;
+
+    closeSession(id);
+
+    auto session = std::make_shared<Session>(id, sampleRate);
+    Session* s = session.get();
+    s->decoder.setAnalysisThreads(m_analysisThreads);
+
+    // Callbacks run on whichever worker is decoding the session; the raw
+    // pointer is safe because the decoder that holds them lives in *s.
+    s->decoder.startPooled(
+        [this, s](const std::string& text, float cost) {
+            emit(decodeEventJson(text, cost, s->decoder.estimatedPitch(),
+                                 s->decoder.estimatedSpeed(), s->id));
+        },
+        [this, s](CwDecoder::Stats st) {
+            emit(statsEventJson(st.pitchHz, st.speedWpm, s->id));
+        }
+    );
+
+    if (pitch > 0.0f || speed > 0.0f) {
+        s->decoder.setKnownParameters(pitch > 0.0f ? pitch : 600.0f,
+                                      speed > 0.0f ? speed : 20.0f);
+    }
+
+    m_sessions[id] = std::move(session);
+    return true;
+}
+
+void DecoderServer::closeSession(uint32_t id)
+{
+    auto it = m_sessions.find(id);
+    if (it == m_sessions.end()) return;
+
+    // A worker may still hold the session; it sees closed and drops its
+    // reference, and the decoder is freed with the last one.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        it->second->closed = true;
+    }
+    m_sessions.erase(it);
+}
+
+void DecoderServer::feedSession(uint32_t id, const uint8_t* payload, uint32_t len)
+{
+    auto it = m_sessions.find(id);
+    if (it == m_sessions.end()) return; // closed or never opened
+
+    const SessionPtr& s = it->second;
+    s->decoder.feedAudio(reinterpret_cast<const int16_t*>(payload),
+                         static_cast<int>(len / sizeof(int16_t)));
+
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        s->dirty = true;
+        if (!s->queued) {
+            s->queued = true;
+            m_runQueue.push_back(s);
+            wake = true;
+        }
+    }
+    if (wake) m_cv.notify_one();
+}
+
+void DecoderServer::workerLoop()
+{
+    for (;;) {
+        SessionPtr s;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stopping || !m_runQueue.empty(); });
+            if (m_runQueue.empty()) return; // stopping and fully drained
+            s = std::move(m_runQueue.front());
+            m_runQueue.pop_front();
+            if (s->closed) continue;
+            s->dirty = false;
+        }
+
+        // queued stays set while we decode, so no other worker can pick
+        // this session up and enter its ggmorse instance concurrently
+        s->decoder.decodePending();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (s->dirty && !s->closed) {
+            m_runQueue.push_back(std::move(s));
+        } else {
+            s->queued = false;
+        }
+    }
+}
+
+void DecoderServer::emit(const std::string& line)
+{
+    std::lock_guard<std::mutex> lock(m_outMutex);
+    fwrite(line.data(), 1, line.size(), stdout);
+    fflush(stdout);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "CwDecoder.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Multi-session server mode (cw-decoder --server).
+//
+// One process serves many independent CW decoders. Sessions are opened,
+// fed and closed with framed messages on stdin; decoded events go to stdout
+// as the usual JSON lines plus a "session" field (see JsonEvents.h).
+// Every session's CwDecoder runs on one fixed-size worker pool, so each
+// extra session costs only its decoder state, not a process and a thread.
+//
+// Input frame layout (little-endian, the pipe is host-local):
+//
+//   [type:1][session:4 uint32][len:4 uint32][payload:len]
+//
+//   0x01  Open   [sample_rate:4 uint32][pitch:4 float32][speed:4 float32]
+//                pitch/speed 0 = auto-detect. Re-opening an ID replaces it.
+//   0x02  Audio  mono int16 PCM at the session's sample rate
+//   0x03  Close  no payload
+class DecoderServer {
+public:
+    static constexpr uint8_t kFrameOpen  = 0x01;
+    static constexpr uint8_t kFrameAudio = 0x02;
+    static constexpr uint8_t kFrameClose = 0x03;
+
+    static constexpr uint32_t kMaxPayload = 1 << 20;
+
+    // analysisThreads is applied to every session's decoder, as
+    // CwDecoder::setAnalysisThreads().
+    explicit DecoderServer(int workers, int analysisThreads = 1);
+    ~DecoderServer();
+
+    DecoderServer(const DecoderServer&)            = delete;
+    DecoderServer& operator=(const DecoderServer&) = delete;
+
+    // Serve frames from in until EOF, then drain queued work and return.
+    // Returns 0 on EOF, 1 on a malformed frame.
+    int run(FILE* in);
+
+private:
+    struct Session {
+        const uint32_t id;
+        CwDecoder      decoder;
+
+        // Guarded by DecoderServer::m_mutex
+        bool queued = false; // on the run queue or being decoded by a worker
+        bool dirty  = false; // audio fed since a worker last picked it up
+        bool closed = false;
+
+        Session(uint32_t id, int sampleRate) : id(id), decoder(sampleRate) {}
+    };
+    using SessionPtr = std::shared_ptr<Session>;
+
+    bool openSession(uint32_t id, const uint8_t* payload, uint32_t len);
+    void closeSession(uint32_t id);
+    void feedSession(uint32_t id, const uint8_t* payload, uint32_t len);
+
+    void workerLoop();
+    void emit(const std::string& line);
+
+    // Reader thread only
+    std::unordered_map<uint32_t, SessionPtr> m_sessions;
+
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    std::deque<SessionPtr>  m_runQueue;
+    bool                    m_stopping = false;
+
+    std::vector<std::thread> m_workers;
+    int                      m_analysisThreads;
+
+    std::mutex m_outMutex; // one JSON line at a time on stdout
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// JSON output format (one object per line):
+//
+//   decode event:
+//     {"type":"decode","text":"CQ CQ DE W1AW","cost":0.12,"pitch":600,"speed":20}
+//
+//   stats update (pitch/speed changed without new text):
+//     {"type":"stats","pitch":600,"speed":20}
+//
+// In --server mode every object also carries the session it belongs to,
+// e.g. {"type":"stats","session":7,"pitch":600,"speed":20}.
+//
+// In --skimmer mode decodes carry the channel and carrier frequency instead
+// of the pitch, and channels opening/closing are reported as signal events:
+//     {"type":"decode","channel":3,"freq":14025310,"text":"CQ","cost":0.12,"confidence":"high","snr":18,"speed":22}
+//     {"type":"signal","channel":3,"state":"up","freq":14025310,"snr":18}
+//
+// cost thresholds match AetherSDR's colour scheme:
+//   < 0.15  -> "high"   (#00ff88 green)
+//   < 0.35  -> "medium" (#e0e040 yellow)
+//   < 0.60  -> "low"    (#ff9020 orange)
+//   >= 0.60 -> "poor"   (filtered in AetherSDR by default)
+
+inline const char* confidenceLabel(float cost)
+{
+    if (cost < 0.15f) return "high";
+    if (cost < 0.35f) return "medium";
+    if (cost < 0.60f) return "low";
+    return "poor";
+}
+
+// Minimal JSON string escape (printable ASCII only from ggmorse output).
+inline std::string jsonEscape(const std::string& s)
+{
+    std::string out;
+    out.reserve(s.size());
+    for (unsigned char c : s) {
+        if (c == '"')       out += "\\\"";
+        else if (c == '\\') out += "\\\\";
+        else if (c < 0x20)  out += ' ';
+        else                out += static_cast<char>(c);
+    }
+    return out;
+}
+
+// session < 0 omits the "session" field (single-session mode).
+inline std::string sessionField(int64_t session)
+{
+    if (session < 0) return {};
+    char buf[32];
+    snprintf(buf, sizeof(buf), ",\"session\":%lld", static_cast<long long>(session));
+    return buf;
+}
+
+inline std::string decodeEventJson(const std::string& text, float cost, float pitch, float speed,
+                                   int64_t session = -1)
+{
+    const std::string escaped = jsonEscape(text);
+    const std::string sess    = sessionField(session);
+    auto format = [&](char* buf, size_t size) {
+        return snprintf(buf, size,
+            "{\"type\":\"decode\"%s,\"text\":\"%s\",\"cost\":%.3f,\"confidence\":\"%s\",\"pitch\":%.0f,\"speed\":%.0f}\n",
+            sess.c_str(), escaped.c_str(), cost, confidenceLabel(cost), pitch, speed);
+    };
+
+    std::string line(escaped.size() + 160, '\0');
+    int n = format(&line[0], line.size());
+    if (n >= static_cast<int>(line.size())) {
+        line.resize(n + 1);
+        n = format(&line[0], line.size());
+    }
+    line.resize(n > 0 ? static_cast<size_t>(n) : 0);
+    return line;
+}
+
+inline std::string skimmerDecodeJson(int channel, double freqHz, const std::string& text, float cost,
+                                     float snrDb, float speed)
+{
+    const std::string escaped = jsonEscape(text);
+    auto format = [&](char* buf, size_t size) {
+        return snprintf(buf, size,
+            "{\"type\":\"decode\",\"channel\":%d,\"freq\":%.0f,\"text\":\"%s\",\"cost\":%.3f,\"confidence\":\"%s\",\"snr\":%.0f,\"speed\":%.0f}\n",
+            channel, freqHz, escaped.c_str(), cost, confidenceLabel(cost), snrDb, speed);
+    };
+
+    std::string line(escaped.size() + 192, '\0');
+    int n = format(&line[0], line.size());
+    if (n >= static_cast<int>(line.size())) {
+        line.resize(n + 1);
+        n = format(&line[0], line.size());
+    }
+    line.resize(n > 0 ? static_cast<size_t>(n) : 0);
+    return line;
+}
+
+inline std::string signalEventJson(int channel, double freqHz, float snrDb, bool up)
+{
+    char buf[128];
+    snprintf(buf, sizeof(buf),
+        "{\"type\":\"signal\",\"channel\":%d,\"state\":\"%s\",\"freq\":%.0f,\"snr\":%.0f}\n",
+        channel, up ? "up" : "down", freqHz, snrDb);
+    return buf;
+}
+
+inline std::string statsEventJson(float pitch, float speed, int64_t session = -1)
+{
+    char buf[128];
+    snprintf(buf, sizeof(buf),
+        "{\"type\":\"stats\"%s,\"pitch\":%.0f,\"speed\":%.0f}\n",
+        sessionField(session).c_str(),
+        pitch, speed);
+    return buf;
+}
@@ -0,0 +1,409 @@
+#include "Skimmer.h"
+
+#include "fft.h"
+#include "taskpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Detection pass period: 64 hops of kOutputFrame/4 output samples = 256 ms
+constexpr int   kDetectHops     = 64;
+constexpr float kAvgTime_s      = 1.0f;    // carrier power averaging
+constexpr float kHoldDb         = 3.0f;    // an open channel stays up this far below snrDb
+constexpr float kSidelobeDb     = 30.0f;   // weaker peaks this close to a stronger one are its skirts
+constexpr int   kSidelobeBins   = 8;
+constexpr int   kMinSpacingBins = 2;       // closest two channels may sit
+constexpr float kPitchSpanHz    = 100.0f;  // ggmorse search range around the locked pitch
+constexpr float kEdgeHz         = 200.0f;  // default search range margin at the band edges
+
+} // namespace
+
+// Forward FFT of N = P*2^q points: P interleaved 2^q-point radix-2
+// transforms of the decimated sub-sequences, combined with one P-point DFT
+// per output bin. P is 1, 3 or a small odd factor for the usual rates
+// (1 at 8/16/32 kHz, 3 at 12/24/48 kHz, 5 at 20 kHz).
+struct Skimmer::FFT {
+    void init(int N) {
+        m_N = N;
+        m_P = N;
+        while (m_P % 2 == 0) m_P /= 2;
+        m_Q = N / m_P;
+        m_plan.init(m_Q);
+
+        m_sub.assign(2 * N, 0.0f);
+        m_twiddle.resize(2 * static_cast<size_t>(m_P) * N);
+        for (int p = 0; p < m_P; ++p) {
+            for (int k = 0; k < N; ++k) {
+                const double a = -2.0 * M_PI * (static_cast<int64_t>(p) * k % N) / N;
+                m_twiddle[2 * (static_cast<size_t>(p) * N + k) + 0] = static_cast<float>(std::cos(a));
+                m_twiddle[2 * (static_cast<size_t>(p) * N + k) + 1] = static_cast<float>(std::sin(a));
+            }
+        }
+    }
+
+    // in and out are N interleaved complex values
+    void transform(const float* in, float* out) {
+        if (m_P == 1) {
+            std::memcpy(out, in, 2 * m_N * sizeof(float));
+            m_plan.transform(out);
+            return;
+        }
+
+        for (int p = 0; p < m_P; ++p) {
+            float* sub = &m_sub[2 * p * m_Q];
+            for (int n = 0; n < m_Q; ++n) {
+                sub[2 * n + 0] = in[2 * (p + m_P * n) + 0];
+                sub[2 * n + 1] = in[2 * (p + m_P * n) + 1];
+            }
+            m_plan.transform(sub);
+        }
+
+        for (int k = 0; k < m_N; ++k) {
+            const int kq = k % m_Q;
+            float re = 0.0f;
+            float im = 0.0f;
+            for (int p = 0; p < m_P; ++p) {
+                const float* s = &m_sub[2 * (p * m_Q + kq)];
+                const float* w = &m_twiddle[2 * (static_cast<size_t>(p) * m_N + k)];
+                re += s[0] * w[0] - s[1] * w[1];
+                im += s[0] * w[1] + s[1] * w[0];
+            }
+            out[2 * k + 0] = re;
+            out[2 * k + 1] = im;
+        }
+    }
+
+    int m_N = 0;
+    int m_P = 1;
+    int m_Q = 0;
+    FFTPlan m_plan;
+    std::vector<float> m_sub;      // [P][Q] interleaved complex
+    std::vector<float> m_twiddle;  // [P][N] W_N^(p*k)
+};
+
+struct Skimmer::Channel {
+    int    id      = 0;
+    int    bin     = 0;    // filterbank bin of the carrier (signed with iq)
+    double freqHz  = 0.0;  // carrier offset in the input passband
+    float  snrDb   = 0.0f;
+    int    idle    = 0;    // detection passes since the carrier was last above the hold level
+
+    std::unique_ptr<GGMorse> ggmorse;
+
+    std::vector<float> overlap = std::vector<float>(Skimmer::kOutputFrame, 0.0f);
+    std::vector<float> audio;  // synthesised 4 kHz audio not yet taken by ggmorse
+    size_t audioRead = 0;
+
+    // Result of the last decode, emitted on the feed() thread
+    std::string text;
+    float cost  = 0.0f;
+    float speed = 0.0f;
+};
+
+Skimmer::Skimmer(const Config& config)
+    : m_config(config)
+{
+    const int R = m_config.sampleRate / kOutputRate;
+    m_N   = R * kOutputFrame;
+    m_hop = m_N / 4;
+
+    m_fft = std::make_unique<FFT>();
+    m_fft->init(m_N);
+
+    m_window.resize(m_N);
+    for (int n = 0; n < m_N; ++n) {
+        m_window[n] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * M_PI * n / m_N));
+    }
+    m_frame.assign(2 * m_N, 0.0f);
+    m_spectrum.assign(2 * m_N, 0.0f);
+    m_avgPower.assign(m_N, 0.0f);
+
+    m_synthCos.resize(3 * kOutputFrame);
+    m_synthSin.resize(3 * kOutputFrame);
+    for (int j = 0; j < 3; ++j) {
+        for (int n = 0; n < kOutputFrame; ++n) {
+            const double a = 2.0 * M_PI * (kPitchBin + j - 1) * n / kOutputFrame;
+            m_synthCos[j * kOutputFrame + n] = static_cast<float>(std::cos(a));
+            m_synthSin[j * kOutputFrame + n] = static_cast<float>(std::sin(a));
+        }
+    }
+
+    // Search range; channels need a bin either side of the carrier, and
+    // with real input nothing at or beyond Nyquist
+    const double binHz  = static_cast<double>(m_config.sampleRate) / m_N;
+    const double edgeHz = m_config.sampleRate / 2.0 - kEdgeHz;
+    double minHz = m_config.minHz;
+    double maxHz = m_config.maxHz;
+    if (minHz == 0.0 && maxHz == 0.0) {
+        minHz = m_config.iq ? -edgeHz : kEdgeHz;
+        maxHz = edgeHz;
+    }
+    const int limitLo = m_config.iq ? -m_N / 2 + 1 : 2;
+    const int limitHi = m_N / 2 - 2;
+    m_binLo = std::max(limitLo, static_cast<int>(std::ceil(minHz / binHz)));
+    m_binHi = std::min(limitHi, static_cast<int>(std::floor(maxHz / binHz)));
+
+    if (m_config.workers > 1) {
+        m_pool = std::make_unique<TaskPool>(m_config.workers);
+    }
+}
+
+Skimmer::~Skimmer() = default;
+
+void Skimmer::setCallbacks(TextCallback onText, SignalCallback onSignal)
+{
+    m_onText   = std::move(onText);
+    m_onSignal = std::move(onSignal);
+}
+
+double Skimmer::binOffsetHz(double bin) const
+{
+    return bin * m_config.sampleRate / m_N;
+}
+
+void Skimmer::feed(const int16_t* samples, int frames)
+{
+    if (frames <= 0) return;
+
+    constexpr float kScale = 1.0f / 32768.0f;
+    const size_t base = m_input.size();
+    m_input.resize(base + 2 * static_cast<size_t>(frames));
+    float* dst = &m_input[base];
+    for (int i = 0; i < frames; ++i) {
+        if (m_config.iq) {
+            dst[2 * i + 0] = samples[2 * i + 0] * kScale;
+            dst[2 * i + 1] = samples[2 * i + 1] * kScale;
+        } else {
+            dst[2 * i + 0] = samples[i] * kScale;
+            dst[2 * i + 1] = 0.0f;
+        }
+    }
+
+    while (m_input.size() / 2 - m_inputRead >= static_cast<size_t>(m_N)) {
+        analyse();
+        m_inputRead += m_hop;
+        if (++m_hops % kDetectHops == 0) detect();
+    }
+    m_input.erase(m_input.begin(), m_input.begin() + 2 * m_inputRead);
+    m_inputRead = 0;
+
+    decodeChannels();
+}
+
+void Skimmer::analyse()
+{
+    const float* in = &m_input[2 * m_inputRead];
+    for (int n = 0; n < m_N; ++n) {
+        m_frame[2 * n + 0] = in[2 * n + 0] * m_window[n];
+        m_frame[2 * n + 1] = in[2 * n + 1] * m_window[n];
+    }
+    m_fft->transform(m_frame.data(), m_spectrum.data());
+
+    const float alpha = static_cast<float>(m_hop) / (kAvgTime_s * m_config.sampleRate);
+    for (int k = 0; k < m_N; ++k) {
+        const float re = m_spectrum[2 * k + 0];
+        const float im = m_spectrum[2 * k + 1];
+        m_avgPower[k] += alpha * (re * re + im * im - m_avgPower[k]);
+    }
+
+    // Per channel: move bins bin-1..bin+1 to kPitchBin-1..kPitchBin+1 of a
+    // kOutputFrame-point inverse transform and overlap-add it. The input hop
+    // advances a bin's phase by a quarter turn per bin more than the output
+    // hop does, hence the (-j)^((bin - kPitchBin)*hop) correction. The
+    // frames already carry the analysis window, and Hann at 75% overlap
+    // sums to 2; with the conjugate half of a real signal left out, the
+    // gain is 1/N.
+    const float gain = 1.0f / m_N;
+    constexpr int kOutHop = kOutputFrame / 4;
+    for (auto& ch : m_channels) {
+        const int rot = static_cast<int>((static_cast<int64_t>(ch->bin - kPitchBin) * static_cast<int64_t>(m_hops % 4)) & 3);
+
+        float yr[3];
+        float yi[3];
+        for (int j = 0; j < 3; ++j) {
+            const int k = ((ch->bin + j - 1) % m_N + m_N) % m_N;
+            const float a = m_spectrum[2 * k + 0];
+            const float b = m_spectrum[2 * k + 1];
+            switch (rot) {
+                case 0:  yr[j] =  a; yi[j] =  b; break;
+                case 1:  yr[j] =  b; yi[j] = -a; break;
+                case 2:  yr[j] = -a; yi[j] = -b; break;
+                default: yr[j] = -b; yi[j] =  a; break;
+            }
+        }
+
+        float* ola = ch->overlap.data();
+        for (int n = 0; n < kOutputFrame; ++n) {
+            float s = 0.0f;
+            for (int j = 0; j < 3; ++j) {
+                s += yr[j] * m_synthCos[j * kOutputFrame + n] - yi[j] * m_synthSin[j * kOutputFrame + n];
+            }
+            ola[n] += gain * s;
+        }
+
+        ch->audio.insert(ch->audio.end(), ola, ola + kOutHop);
+        std::memmove(ola, ola + kOutHop, (kOutputFrame - kOutHop) * sizeof(float));
+        std::fill(ola + kOutputFrame - kOutHop, ola + kOutputFrame, 0.0f);
+    }
+}
+
+void Skimmer::detect()
+{
+    auto power = [this](int bin) { return m_avgPower[(bin % m_N + m_N) % m_N]; };
+
+    if (m_binHi - m_binLo < 2) return;
+
+    // Noise floor: median of the averaged power over the search range
+    m_scratch.clear();
+    for (int b = m_binLo; b <= m_binHi; ++b) {
+        m_scratch.push_back(power(b));
+    }
+    auto mid = m_scratch.begin() + m_scratch.size() / 2;
+    std::nth_element(m_scratch.begin(), mid, m_scratch.end());
+    const float floor = *mid;
+    if (floor <= 0.0f) return;
+
+    const float open = floor * std::pow(10.0f, m_config.snrDb / 10.0f);
+    const float hold = floor * std::pow(10.0f, (m_config.snrDb - kHoldDb) / 10.0f);
+    const int   idleLimit = static_cast<int>(std::ceil(kIdleTimeout_s * m_config.sampleRate / (kDetectHops * m_hop)));
+
+    // Open channels: still there (within a bin of where they started)?
+    for (auto it = m_channels.begin(); it != m_channels.end(); ) {
+        Channel& ch = **it;
+        const float p = std::max({ power(ch.bin - 1), power(ch.bin), power(ch.bin + 1) });
+        if (p > hold) {
+            ch.idle  = 0;
+            ch.snrDb = 10.0f * std::log10(p / floor);
+        } else if (++ch.idle >= idleLimit) {
+            if (m_onSignal) m_onSignal(ch.id, m_config.centerHz + ch.freqHz, ch.snrDb, false);
+            it = m_channels.erase(it);
+            continue;
+        }
+        ++it;
+    }
+
+    if (static_cast<int>(m_channels.size()) >= m_config.maxSignals) return;
+
+    // New carriers: local maxima above the threshold, strongest first
+    std::vector<int> peaks;
+    for (int b = m_binLo; b <= m_binHi; ++b) {
+        const float p = power(b);
+        if (p > open && p > power(b - 1) && p >= power(b + 1)) {
+            peaks.push_back(b);
+        }
+    }
+    std::sort(peaks.begin(), peaks.end(), [&](int a, int b) { return power(a) > power(b); });
+
+    std::vector<int> taken;
+    for (const auto& ch : m_channels) {
+        taken.push_back(ch->bin);
+    }
+
+    const float sidelobe = std::pow(10.0f, -kSidelobeDb / 10.0f);
+    for (int b : peaks) {
+        if (static_cast<int>(m_channels.size()) >= m_config.maxSignals) break;
+
+        bool skip = false;
+        for (int t : taken) {
+            const int d = std::abs(b - t);
+            if (d <= kMinSpacingBins || (d <= kSidelobeBins && power(b) < power(t) * sidelobe)) {
+                skip = true;
+                break;
+            }
+        }
+        if (skip) continue;
+
+        openChannel(b, 10.0f * std::log10(power(b) / floor));
+        taken.push_back(b);
+    }
+}
+
+void Skimmer::openChannel(int bin, float snrDb)
+{
+    auto power = [this](int b) { return m_avgPower[(b % m_N + m_N) % m_N]; };
+
+    // Carrier position within the bin: parabola through the log powers
+    double delta = 0.0;
+    const double a = std::log(std::max(power(bin - 1), 1e-30f));
+    const double b = std::log(std::max(power(bin),     1e-30f));
+    const double c = std::log(std::max(power(bin + 1), 1e-30f));
+    const double den = a - 2.0 * b + c;
+    if (den < 0.0) {
+        delta = std::clamp(0.5 * (a - c) / den, -0.5, 0.5);
+    }
+
+    auto ch = std::make_unique<Channel>();
+    ch->id     = m_nextChannelId++;
+    ch->bin    = bin;
+    ch->freqHz = binOffsetHz(bin + delta);
+    ch->snrDb  = snrDb;
+
+    GGMorse::Parameters params;
+    params.sampleRateInp   = static_cast<float>(kOutputRate);
+    params.sampleRateOut   = static_cast<float>(kOutputRate);
+    params.samplesPerFrame = GGMorse::kDefaultSamplesPerFrame;
+    params.sampleFormatInp = GGMORSE_SAMPLE_FORMAT_F32;
+    params.sampleFormatOut = GGMORSE_SAMPLE_FORMAT_F32;
+    ch->ggmorse = std::make_unique<GGMorse>(params);
+
+    const float pitch = static_cast<float>((kPitchBin + delta) * binHz());
+    GGMorse::ParametersDecode dp = GGMorse::getDefaultParametersDecode();
+    dp.frequency_hz         = pitch;
+    dp.speed_wpm            = -1.0f;
+    dp.frequencyRangeMin_hz = pitch - kPitchSpanHz;
+    dp.frequencyRangeMax_hz = pitch + kPitchSpanHz;
+    ch->ggmorse->setParametersDecode(dp);
+
+    if (m_onSignal) m_onSignal(ch->id, m_config.centerHz + ch->freqHz, ch->snrDb, true);
+    m_channels.push_back(std::move(ch));
+}
+
+void Skimmer::decodeChannels()
+{
+    const size_t frame = GGMorse::kDefaultSamplesPerFrame;
+
+    auto decodeOne = [frame](Channel& ch) {
+        while (ch.audio.size() - ch.audioRead >= frame) {
+            ch.ggmorse->decode([&ch](void* data, uint32_t nMaxBytes) -> uint32_t {
+                const size_t needed = nMaxBytes / sizeof(float);
+                if (ch.audio.size() - ch.audioRead < needed) return 0;
+                std::memcpy(data, &ch.audio[ch.audioRead], needed * sizeof(float));
+                ch.audioRead += needed;
+                return static_cast<uint32_t>(needed * sizeof(float));
+            });
+
+            const auto& stats = ch.ggmorse->getStatistics();
+            GGMorse::TxRx rxData;
+            if (ch.ggmorse->takeRxData(rxData) > 0 && stats.costFunction < 1.0f) {
+                ch.text.append(reinterpret_cast<const char*>(rxData.data()), rxData.size());
+                ch.cost  = stats.costFunction;
+                ch.speed = stats.estimatedSpeed_wpm;
+            }
+        }
+        ch.audio.erase(ch.audio.begin(), ch.audio.begin() + ch.audioRead);
+        ch.audioRead = 0;
+    };
+
+    const int count = static_cast<int>(m_channels.size());
+    if (m_pool && count > 1) {
+        const int nThreads = std::min(m_pool->size(), count);
+        m_pool->run(nThreads, [&](int k) {
+            for (int i = k; i < count; i += nThreads) {
+                decodeOne(*m_channels[i]);
+            }
+        });
+    } else {
+        for (auto& ch : m_channels) {
+            decodeOne(*ch);
+        }
+    }
+
+    for (auto& ch : m_channels) {
+        if (ch->text.empty()) continue;
+        if (m_onText) m_onText(ch->id, m_config.centerHz + ch->freqHz, ch->text, ch->cost, ch->snrDb, ch->speed);
+        ch->text.clear();
+    }
+}
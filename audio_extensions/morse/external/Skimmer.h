@@ -0,0 +1,112 @@
+#pragma once
+
+#include "ggmorse/include/ggmorse/ggmorse.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class TaskPool;
+
+// Wideband multi-signal CW skimmer (cw-decoder --skimmer).
+//
+// One FFT filterbank channelizes the whole input passband (mono audio, or
+// complex I/Q for a passband centred on 0 Hz). Its bins are also the
+// detector: carriers that stand out of the noise floor for long enough get a
+// channel, and channels whose carrier has been gone for kIdleTimeout_s are
+// dropped again.
+//
+// Each channel re-synthesises its three filterbank bins as 4 kHz audio, with
+// the carrier moved to kPitchBin (~625 Hz), and feeds that straight into a
+// ggmorse instance with the pitch locked, so ggmorse neither resamples nor
+// searches for the pitch; only its envelope and interval analysis run per
+// signal. The filterbank is computed once per hop for the whole band,
+// however many channels are open.
+//
+// Frequencies are reported as centreHz plus the carrier's offset in the
+// input passband.
+class Skimmer {
+public:
+    struct Config {
+        int    sampleRate   = 12000;  // input rate, a multiple of 4000 Hz
+        bool   iq           = false;  // interleaved I/Q int16 instead of mono audio
+        double centerHz     = 0.0;    // added to every reported frequency
+        float  minHz        = 0.0f;   // search range as passband offsets (negative with iq);
+        float  maxHz        = 0.0f;   // both 0 = the whole band, less 200 Hz at each edge
+        int    maxSignals   = 32;     // channels decoded at once
+        float  snrDb        = 10.0f;  // carrier detection threshold over the noise floor
+        int    workers      = 1;      // threads decoding channels
+    };
+
+    using TextCallback   = std::function<void(int channel, double freqHz, const std::string& text,
+                                              float cost, float snrDb, float speedWpm)>;
+    using SignalCallback = std::function<void(int channel, double freqHz, float snrDb, bool up)>;
+
+    static constexpr int   kOutputRate    = 4000;  // per-channel audio, = GGMorse::kBaseSampleRate
+    static constexpr int   kOutputFrame   = 64;    // synthesis frame; bins are 62.5 Hz wide
+    static constexpr int   kPitchBin      = 10;    // output bin the carrier is moved to
+    static constexpr float kIdleTimeout_s = 15.0f;
+
+    static bool validSampleRate(int sampleRate) { return sampleRate >= kOutputRate && sampleRate % kOutputRate == 0; }
+
+    explicit Skimmer(const Config& config);
+    ~Skimmer();
+
+    Skimmer(const Skimmer&)            = delete;
+    Skimmer& operator=(const Skimmer&) = delete;
+
+    // Callbacks fire on the thread calling feed()
+    void setCallbacks(TextCallback onText, SignalCallback onSignal);
+
+    // Feed frames of int16 input: mono samples, or I/Q pairs with Config::iq
+    void feed(const int16_t* samples, int frames);
+
+    int channelCount() const { return static_cast<int>(m_channels.size()); }
+    double binHz() const { return static_cast<double>(kOutputRate) / kOutputFrame; }
+
+private:
+    struct Channel;
+
+    void analyse();        // one filterbank hop over m_input
+    void detect();         // update the channel set from the averaged spectrum
+    void decodeChannels(); // run ggmorse on every channel with a full frame
+    void openChannel(int bin, float snrDb);
+    double binOffsetHz(double bin) const;
+
+    const Config m_config;
+
+    // Filterbank: N = R*kOutputFrame point FFT with R = sampleRate/4000, hop
+    // N/4, Hann window; the per-channel synthesis runs at kOutputFrame, hop
+    // kOutputFrame/4, so every bin is kOutputRate/kOutputFrame wide.
+    struct FFT;
+    std::unique_ptr<FFT> m_fft;
+    int m_N    = 0;
+    int m_hop  = 0;
+    int m_binLo = 0;  // search range, bins (signed with iq)
+    int m_binHi = 0;
+    std::vector<float> m_window;
+    std::vector<float> m_frame;     // windowed frame, interleaved complex
+    std::vector<float> m_spectrum;  // its transform
+    std::vector<float> m_input;     // unconsumed input, interleaved complex
+    size_t             m_inputRead = 0;
+    uint64_t           m_hops = 0;  // filterbank hops since start
+
+    // Carrier detection: per-bin power averaged over ~1 s, evaluated every
+    // kDetectHops hops
+    std::vector<float> m_avgPower;
+    std::vector<float> m_scratch;
+
+    // Synthesis tables for the three output bins around kPitchBin
+    std::vector<float> m_synthCos;  // [3][kOutputFrame]
+    std::vector<float> m_synthSin;
+
+    std::vector<std::unique_ptr<Channel>> m_channels;
+    int m_nextChannelId = 0;
+
+    std::unique_ptr<TaskPool> m_pool;
+
+    TextCallback   m_onText;
+    SignalCallback m_onSignal;
+};
@@ -0,0 +1,437 @@
+// cw-decoder-bench: ggmorse stage timings and CwDecoder session capacity.
+//
+//   stages    Replays a corpus through GGMorse::decode one frame at a time and
+//             reports percentiles of ggmorse_Statistics' per-stage timings
+//             (resample, pitch detection, Goertzel, frame analysis) and the
+//             real-time factor.
+//   sessions  Runs N pooled CwDecoder instances on the calling thread, the way
+//             a DecoderServer worker does, and measures the CPU time they take
+//             per second of audio. Ramps N until one core is saturated and
+//             reports how many sessions a core sustains.
+//
+// The corpus is WAV files (16-bit PCM, first channel), raw mono int16 files
+// at --sample-rate, or, with no files, CW synthesised with ggmorse's encoder
+// plus noise at each of 12, 24 and 48 kHz.
+
+#include "CwDecoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <time.h>
+
+namespace {
+
+struct Corpus {
+    std::string     name;
+    int             sampleRate = 0;
+    std::vector<int16_t> samples;
+};
+
+void printUsage(const char* prog)
+{
+    fprintf(stderr,
+        "Usage: %s stages|sessions [options] [FILE...]\n"
+        "\n"
+        "FILE is a 16-bit PCM WAV file, or raw mono int16 at --sample-rate.\n"
+        "With no files, 60 s of synthesised CW is used at 12, 24 and 48 kHz\n"
+        "(or only at --sample-rate if given).\n"
+        "\n"
+        "Options:\n"
+        "  --sample-rate HZ  Rate of raw files / synthesised corpus: 12000, 24000 or 48000\n"
+        "  --seconds S       Audio per measurement (default: 60 for stages, 20 for sessions)\n"
+        "  --pitch HZ        Lock pitch to HZ (default: auto-detect)\n"
+        "  --speed WPM       Lock speed to WPM (default: auto-detect)\n"
+        "  --snr DB          SNR of the synthesised corpus in a 500 Hz bandwidth (default: 10)\n"
+        "  --max-sessions N  Upper bound for the sessions ramp (default: 1024)\n"
+        "  --help            Show this message\n",
+        prog);
+}
+
+bool validRate(int rate)
+{
+    return rate == 12000 || rate == 24000 || rate == 48000;
+}
+
+double threadCpuSeconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double wallSeconds()
+{
+    using clock = std::chrono::steady_clock;
+    return std::chrono::duration<double>(clock::now().time_since_epoch()).count();
+}
+
+// Nearest-rank percentile of an already sorted vector
+float percentile(const std::vector<float>& sorted, double p)
+{
+    if (sorted.empty()) return 0.0f;
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+uint32_t readLe(const uint8_t* p, int bytes)
+{
+    uint32_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+// Loads a WAV (16-bit PCM, first channel kept) or, failing the RIFF check,
+// raw mono int16 at rawRate
+bool loadCorpus(const char* path, int rawRate, Corpus& out)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buf[65536];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + got);
+    fclose(f);
+
+    out.name = path;
+    out.samples.clear();
+
+    if (data.size() >= 12 && memcmp(data.data(), "RIFF", 4) == 0 && memcmp(data.data() + 8, "WAVE", 4) == 0) {
+        int channels = 0, bits = 0;
+        size_t pos = 12;
+        while (pos + 8 <= data.size()) {
+            const uint8_t* chunk = data.data() + pos;
+            const size_t len = readLe(chunk + 4, 4);
+            const size_t body = pos + 8;
+            if (memcmp(chunk, "fmt ", 4) == 0 && len >= 16 && body + 16 <= data.size()) {
+                const int format = readLe(chunk + 8, 2);
+                channels       = readLe(chunk + 10, 2);
+                out.sampleRate = readLe(chunk + 12, 4);
+                bits           = readLe(chunk + 22, 2);
+                if (format != 1 || bits != 16 || channels < 1) {
+                    fprintf(stderr, "%s: only 16-bit PCM WAV is supported\n", path);
+                    return false;
+                }
+            } else if (memcmp(chunk, "data", 4) == 0 && channels > 0) {
+                const size_t end = std::min(data.size(), body + len);
+                for (size_t i = body; i + 2 * channels <= end; i += 2 * channels) {
+                    out.samples.push_back(static_cast<int16_t>(readLe(data.data() + i, 2)));
+                }
+                break;
+            }
+            pos = body + len + (len & 1);
+        }
+    } else {
+        out.sampleRate = rawRate;
+        for (size_t i = 0; i + 2 <= data.size(); i += 2) {
+            out.samples.push_back(static_cast<int16_t>(readLe(data.data() + i, 2)));
+        }
+    }
+
+    if (!validRate(out.sampleRate)) {
+        fprintf(stderr, "%s: sample rate %d Hz is not 12000, 24000 or 48000\n", path, out.sampleRate);
+        return false;
+    }
+    if (out.samples.empty()) {
+        fprintf(stderr, "%s: no samples\n", path);
+        return false;
+    }
+    return true;
+}
+
+// CW from ggmorse's own encoder, repeated to the requested length, with white
+// noise for the given SNR in a 500 Hz bandwidth
+bool synthesiseCorpus(int sampleRate, double seconds, float snrDb, Corpus& out)
+{
+    GGMorse::Parameters params = GGMorse::getDefaultParameters();
+    params.sampleRateInp   = static_cast<float>(sampleRate);
+    params.sampleRateOut   = static_cast<float>(sampleRate);
+    params.sampleFormatInp = GGMORSE_SAMPLE_FORMAT_I16;
+    params.sampleFormatOut = GGMORSE_SAMPLE_FORMAT_I16;
+    GGMorse encoder(params);
+
+    GGMorse::ParametersEncode pe = GGMorse::getDefaultParametersEncode();
+    pe.volume              = 0.25f;
+    pe.frequency_hz        = 600.0f;
+    pe.speedCharacters_wpm = 22.0f;
+    pe.speedFarnsworth_wpm = 22.0f;
+    encoder.setParametersEncode(pe);
+
+    const char* text = "CQ CQ CQ DE W1AW W1AW K  TNX FER CALL UR RST 599 599 BK  ";
+    encoder.init(static_cast<int>(strlen(text)), text);
+
+    std::vector<int16_t> message;
+    encoder.encode([&message](const void* data, uint32_t nBytes) {
+        const auto* p = static_cast<const int16_t*>(data);
+        message.insert(message.end(), p, p + nBytes / sizeof(int16_t));
+    });
+    if (message.empty()) return false;
+
+    out.name       = "synthetic";
+    out.sampleRate = sampleRate;
+    out.samples.resize(static_cast<size_t>(seconds * sampleRate));
+
+    // Tone power is (0.25 * 32767)^2 / 2 while keyed; noise is spread
+    // over sampleRate/2, so scale it up to put the wanted power in 500 Hz
+    const double tonePower  = std::pow(0.25 * 32767.0, 2) / 2.0;
+    const double noisePower = tonePower / std::pow(10.0, snrDb / 10.0) * (sampleRate / 2.0) / 500.0;
+    std::mt19937 rng(static_cast<uint32_t>(sampleRate));
+    std::normal_distribution<double> noise(0.0, std::sqrt(noisePower));
+
+    for (size_t i = 0; i < out.samples.size(); ++i) {
+        const double v = message[i % message.size()] + noise(rng);
+        out.samples[i] = static_cast<int16_t>(std::clamp(v, -32768.0, 32767.0));
+    }
+    return true;
+}
+
+GGMorse::ParametersDecode decodeParams(float pitchHz, float speedWpm)
+{
+    GGMorse::ParametersDecode dp = GGMorse::getDefaultParametersDecode();
+    dp.frequency_hz = pitchHz > 0.0f ? pitchHz : -1.0f;
+    dp.speed_wpm    = speedWpm > 0.0f ? speedWpm : -1.0f;
+    if (pitchHz > 0.0f) {
+        dp.frequencyRangeMin_hz = std::max(100.0f, pitchHz - 150.0f);
+        dp.frequencyRangeMax_hz = pitchHz + 150.0f;
+    } else {
+        dp.frequencyRangeMin_hz = 400.0f;
+        dp.frequencyRangeMax_hz = 700.0f;
+    }
+    return dp;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// stages
+
+void runStages(const Corpus& corpus, double seconds, float pitchHz, float speedWpm)
+{
+    // Same parameters as CwDecoder::init()
+    GGMorse::Parameters params;
+    params.sampleRateInp   = static_cast<float>(corpus.sampleRate);
+    params.sampleRateOut   = static_cast<float>(corpus.sampleRate);
+    params.samplesPerFrame = GGMorse::kDefaultSamplesPerFrame;
+    params.sampleFormatInp = GGMORSE_SAMPLE_FORMAT_I16;
+    params.sampleFormatOut = GGMORSE_SAMPLE_FORMAT_I16;
+    GGMorse ggmorse(params);
+    ggmorse.setParametersDecode(decodeParams(pitchHz, speedWpm));
+
+    const size_t total = static_cast<size_t>(seconds * corpus.sampleRate);
+    size_t pos = 0;
+
+    std::vector<float> resample, pitch, goertzel, analysis, frame;
+    std::string text;
+
+    const double wallStart = wallSeconds();
+    const double cpuStart  = threadCpuSeconds();
+
+    // One callback fill per decode() call, so every call decodes exactly one
+    // frame and the statistics afterwards are that frame's
+    while (pos < total) {
+        bool filled = false;
+        bool decoded = ggmorse.decode([&](void* data, uint32_t nMaxBytes) -> uint32_t {
+            if (filled) return 0;
+            const size_t needed = nMaxBytes / sizeof(int16_t);
+            if (pos + needed > total) return 0;
+            auto* out = static_cast<int16_t*>(data);
+            for (size_t i = 0; i < needed; ++i) {
+                out[i] = corpus.samples[(pos + i) % corpus.samples.size()];
+            }
+            pos += needed;
+            filled = true;
+            return static_cast<uint32_t>(nMaxBytes);
+        });
+        if (!filled) break;
+        if (!decoded) continue;
+
+        const auto& s = ggmorse.getStatistics();
+        resample.push_back(s.timeResample_ms);
+        pitch.push_back(s.timePitchDetection_ms);
+        goertzel.push_back(s.timeGoertzel_ms);
+        analysis.push_back(s.timeFrameAnalysis_ms);
+        frame.push_back(s.timeResample_ms + s.timePitchDetection_ms + s.timeGoertzel_ms + s.timeFrameAnalysis_ms);
+
+        GGMorse::TxRx rx;
+        if (ggmorse.takeRxData(rx) > 0) text.append(rx.begin(), rx.end());
+    }
+
+    const double wall  = wallSeconds() - wallStart;
+    const double cpu   = threadCpuSeconds() - cpuStart;
+    const double audio = static_cast<double>(pos) / corpus.sampleRate;
+
+    printf("%s @ %d Hz: %.1f s of audio, %zu frames (%.0f ms each)\n",
+           corpus.name.c_str(), corpus.sampleRate, audio, frame.size(),
+           1000.0 * GGMorse::kDefaultSamplesPerFrame / GGMorse::kBaseSampleRate);
+    printf("  %-16s %8s %8s %8s %8s %8s\n", "stage (ms)", "p50", "p90", "p99", "p99.9", "max");
+
+    auto row = [](const char* name, std::vector<float>& v) {
+        std::sort(v.begin(), v.end());
+        printf("  %-16s %8.3f %8.3f %8.3f %8.3f %8.3f\n", name,
+               percentile(v, 50), percentile(v, 90), percentile(v, 99), percentile(v, 99.9),
+               v.empty() ? 0.0f : v.back());
+    };
+    row("resample", resample);
+    row("pitch detection", pitch);
+    row("goertzel", goertzel);
+    row("frame analysis", analysis);
+    row("frame total", frame);
+
+    printf("  real-time factor %.1fx (wall %.2f s, CPU %.2f s)\n",
+           wall > 0.0 ? audio / wall : 0.0, wall, cpu);
+
+    // Enough of the decode to tell a working run from a broken one
+    for (char& c : text) if (c == '\n') c = ' ';
+    if (text.size() > 60) text.resize(60);
+    printf("  decoded: \"%s\"\n\n", text.c_str());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sessions
+
+// CPU seconds per audio second for n sessions fed from the corpus, each
+// starting at a different offset so their frames do not line up
+double measureSessions(const Corpus& corpus, int n, double seconds, float pitchHz, float speedWpm)
+{
+    std::vector<std::unique_ptr<CwDecoder>> decoders;
+    decoders.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        auto d = std::make_unique<CwDecoder>(corpus.sampleRate);
+        d->startPooled([](const std::string&, float) {});
+        if (pitchHz > 0.0f || speedWpm > 0.0f) {
+            d->setKnownParameters(pitchHz > 0.0f ? pitchHz : 600.0f, speedWpm > 0.0f ? speedWpm : 20.0f);
+        }
+        decoders.push_back(std::move(d));
+    }
+
+    // 20 ms chunks, about what a session's Audio frames carry
+    const size_t chunk = static_cast<size_t>(corpus.sampleRate / 50);
+    const size_t total = static_cast<size_t>(seconds * corpus.sampleRate);
+    const size_t len   = corpus.samples.size();
+    std::vector<int16_t> buf(chunk);
+
+    const double cpuStart = threadCpuSeconds();
+
+    for (size_t pos = 0; pos + chunk <= total; pos += chunk) {
+        for (int i = 0; i < n; ++i) {
+            const size_t start = pos + static_cast<size_t>(i) * len / n;
+            for (size_t k = 0; k < chunk; ++k) {
+                buf[k] = corpus.samples[(start + k) % len];
+            }
+            decoders[i]->feedAudio(buf.data(), static_cast<int>(chunk));
+            while (decoders[i]->decodePending()) {}
+        }
+    }
+
+    const double cpu = threadCpuSeconds() - cpuStart;
+
+    for (auto& d : decoders) d->stop();
+    return cpu / seconds;
+}
+
+void runSessions(const Corpus& corpus, double seconds, float pitchHz, float speedWpm, int maxSessions)
+{
+    printf("%s @ %d Hz: %.0f s of audio per session, one thread\n",
+           corpus.name.c_str(), corpus.sampleRate, seconds);
+    printf("  %8s %10s %12s\n", "sessions", "core load", "ms/s each");
+
+    // Double N until a core is saturated; the last unsaturated N and the
+    // per-session cost there bound the capacity
+    int    sustained   = 0;
+    double perSession  = 0.0;
+    for (int n = 1; n <= maxSessions; n *= 2) {
+        const double load = measureSessions(corpus, n, seconds, pitchHz, speedWpm);
+        printf("  %8d %9.1f%% %12.2f\n", n, 100.0 * load, 1000.0 * load / n);
+        fflush(stdout);
+        if (load >= 1.0) break;
+        sustained  = n;
+        perSession = load / n;
+    }
+
+    if (sustained == 0) {
+        printf("  one session does not run in real time on one core\n\n");
+    } else {
+        printf("  capacity: about %d sessions per core (sustained %d measured)\n\n",
+               static_cast<int>(1.0 / perSession), sustained);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || strcmp(argv[1], "--help") == 0) {
+        printUsage(argv[0]);
+        return argc < 2 ? 1 : 0;
+    }
+
+    const std::string mode = argv[1];
+    if (mode != "stages" && mode != "sessions") {
+        fprintf(stderr, "Unknown mode: %s\n", argv[1]);
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    int    sampleRate  = 0;
+    double seconds     = mode == "stages" ? 60.0 : 20.0;
+    float  pitchHz     = 0.0f;
+    float  speedWpm    = 0.0f;
+    float  snrDb       = 10.0f;
+    int    maxSessions = 1024;
+    std::vector<const char*> files;
+
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--help") == 0) { printUsage(argv[0]); return 0; }
+        else if (strcmp(argv[i], "--sample-rate") == 0 && i + 1 < argc) { sampleRate = std::stoi(argv[++i]); }
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) { seconds = std::stod(argv[++i]); }
+        else if (strcmp(argv[i], "--pitch") == 0 && i + 1 < argc) { pitchHz = std::stof(argv[++i]); }
+        else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) { speedWpm = std::stof(argv[++i]); }
+        else if (strcmp(argv[i], "--snr") == 0 && i + 1 < argc) { snrDb = std::stof(argv[++i]); }
+        else if (strcmp(argv[i], "--max-sessions") == 0 && i + 1 < argc) { maxSessions = std::stoi(argv[++i]); }
+        else if (argv[i][0] == '-') { fprintf(stderr, "Unknown option: %s\n", argv[i]); return 1; }
+        else { files.push_back(argv[i]); }
+    }
+
+    if (sampleRate != 0 && !validRate(sampleRate)) {
+        fprintf(stderr, "--sample-rate must be 12000, 24000 or 48000\n");
+        return 1;
+    }
+    if (seconds <= 0.0) {
+        fprintf(stderr, "--seconds must be positive\n");
+        return 1;
+    }
+
+    std::vector<Corpus> corpora;
+    if (files.empty()) {
+        const std::vector<int> rates = sampleRate ? std::vector<int>{sampleRate}
+                                                  : std::vector<int>{12000, 24000, 48000};
+        for (int rate : rates) {
+            Corpus c;
+            if (!synthesiseCorpus(rate, 60.0, snrDb, c)) {
+                fprintf(stderr, "Failed to synthesise corpus at %d Hz\n", rate);
+                return 1;
+            }
+            corpora.push_back(std::move(c));
+        }
+    } else {
+        for (const char* path : files) {
+            Corpus c;
+            if (!loadCorpus(path, sampleRate ? sampleRate : 12000, c)) return 1;
+            corpora.push_back(std::move(c));
+        }
+    }
+
+    for (const Corpus& c : corpora) {
+        if (mode == "stages") runStages(c, seconds, pitchHz, speedWpm);
+        else                  runSessions(c, seconds, pitchHz, speedWpm, maxSessions);
+    }
+    return 0;
+}
@@ -118,6 +118,11 @@ public:
     bool setParametersDecode(const ParametersDecode & parameters);
     bool setParametersEncode(const ParametersEncode & parameters);
 
+    // Split the per-frame speed/level search across nThreads threads (the
+    // calling thread included). The default of 1 keeps it on the calling
+    // thread; the result does not depend on the thread count.
+    bool setAnalysisThreads(int nThreads);
+
     uint32_t encodeSize_bytes() const;
     uint32_t encodeSize_samples() const;
 
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+#if defined(_WIN32) && !defined(M_PI)
+#define M_PI 3.14159265358979323846
+#endif
+
+// FIR decimator for integer rate ratios (12/24/48 kHz -> 4 kHz and the like).
+//
+// The filter is a Kaiser-windowed sinc low-pass of kTapsPerPhase*factor taps
+// with its cutoff fixed relative to the output rate: flat up to ~0.38*fsOut,
+// at least ~70 dB down from ~0.57*fsOut, so nothing aliases below ~0.43*fsOut
+// (1.7 kHz at 4 kHz out, well above the CW search range). It is only
+// evaluated at the retained output samples, i.e. factor times less work than
+// filtering at the full rate and then dropping samples, and each output is a
+// dot product of the taps with a contiguous stretch of input, split over
+// independent partial sums so the compiler can vectorise it.
+struct Decimator {
+    static constexpr int kTapsPerPhase = 24;     // multiple of kLanes
+    static constexpr int kLanes = 8;             // partial sums per dot product
+    static constexpr double kCutoff = 0.475;     // -6 dB point, fraction of fsOut
+    static constexpr double kKaiserBeta = 6.8;   // ~70 dB stopband
+
+    void init(int factor) {
+        m_factor = factor;
+        m_nTaps = kTapsPerPhase*factor;
+
+        // symmetric, so the taps need no reversal for the dot product
+        const double fc = kCutoff/factor;  // cycles per input sample
+        const double mid = 0.5*(m_nTaps - 1);
+        const double i0Beta = besselI0(kKaiserBeta);
+
+        m_taps.resize(m_nTaps);
+        double sum = 0.0;
+        for (int n = 0; n < m_nTaps; ++n) {
+            double t = n - mid;
+            double r = t/mid;
+            double h = (t == 0.0) ? 2.0*fc : std::sin(2.0*M_PI*fc*t)/(M_PI*t);
+            h *= besselI0(kKaiserBeta*std::sqrt(std::max(0.0, 1.0 - r*r)))/i0Beta;
+            m_taps[n] = h;
+            sum += h;
+        }
+        for (auto & h : m_taps) {
+            h /= sum;  // unity gain at DC
+        }
+
+        reset();
+    }
+
+    void reset() {
+        m_phase = 0;
+        m_buffer.assign(m_nTaps - 1, 0.0f);
+    }
+
+    int factor() const { return m_factor; }
+
+    // Decimate nSamples input samples into samplesOut; returns the number of
+    // output samples written (nSamples/factor when nSamples is a multiple)
+    int process(const float * samplesInp, int nSamples, float * samplesOut) {
+        const int nKeep = m_nTaps - 1;
+
+        // the last nTaps - 1 inputs of the previous block, then this block
+        m_buffer.resize(nKeep + nSamples);
+        std::copy(samplesInp, samplesInp + nSamples, m_buffer.begin() + nKeep);
+
+        const int nBuffer = (int) m_buffer.size();
+        int nOut = 0;
+        int i = m_phase;
+        for (; i + m_nTaps <= nBuffer; i += m_factor) {
+            samplesOut[nOut++] = dot(m_buffer.data() + i, m_taps.data(), m_nTaps);
+        }
+
+        m_phase = i - (nBuffer - nKeep);
+        std::copy(m_buffer.end() - nKeep, m_buffer.end(), m_buffer.begin());
+        m_buffer.resize(nKeep);
+
+        return nOut;
+    }
+
+private:
+    static float dot(const float * x, const float * h, int n) {
+        float acc[kLanes] = {};
+        for (int k = 0; k < n; k += kLanes) {
+            for (int j = 0; j < kLanes; ++j) {
+                acc[j] += x[k + j]*h[k + j];
+            }
+        }
+        return ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+    }
+
+    // modified Bessel function of the first kind, order 0
+    static double besselI0(double x) {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 50; ++k) {
+            term *= (x/(2.0*k))*(x/(2.0*k));
+            sum += term;
+            if (term < 1e-12*sum) break;
+        }
+        return sum;
+    }
+
+    int m_factor = 1;
+    int m_nTaps = 0;
+    int m_phase = 0;  // start of the next output's window in m_buffer
+
+    std::vector<float> m_taps;
+    std::vector<float> m_buffer;
+};
@@ -1,92 +1,186 @@
 #pragma once
 
 #include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
 
 #if defined(_WIN32) && !defined(M_PI)
 #define M_PI 3.14159265358979323846
 #endif
 
-// FFT routines taken from https://stackoverflow.com/a/37729648/4039976
+// Iterative radix-2 FFT (originally from https://stackoverflow.com/a/37729648/4039976)
+//
+// FFTPlan precomputes everything that depends only on N - the bit-reverse
+// permutation and the twiddle factors - so transform() does no allocation
+// and no trigonometry. Data is interleaved complex: f[2*i] re, f[2*i + 1] im.
 
 constexpr auto kMaxSamplesPerFrame = 1024;
 
-int log2(int N) {
-    int k = N, i = 0;
-    while(k) {
-        k >>= 1;
-        i++;
-    }
-    return i - 1;
-}
+struct FFTPlan {
+    // N must be a power of two
+    void init(int N) {
+        m_N = N;
+
+        int bits = 0;
+        while ((1 << bits) < N) ++bits;
+
+        m_reverse.resize(N);
+        for (int i = 0; i < N; ++i) {
+            int r = 0;
+            for (int b = 0; b < bits; ++b) {
+                if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+            }
+            m_reverse[i] = r;
+        }
+
+        // W^k = exp(-2*pi*i*k/N) for k < N/2; stage with half-size h uses
+        // every (N/2h)-th entry
+        m_twiddle.resize(N > 1 ? N : 2);
+        for (int k = 0; k < N/2; ++k) {
+            m_twiddle[2*k + 0] = std::cos(-2.0*M_PI*k/N);
+            m_twiddle[2*k + 1] = std::sin(-2.0*M_PI*k/N);
+        }
 
-int reverse(int N, int n) {
-    int j, p = 0;
-    for(j = 1; j <= log2(N); j++) {
-        if(n & (1 << (log2(N) - j)))
-            p |= 1 << (j - 1);
+        // For powerReal(): the N/2-point complex plan, the split twiddles
+        // exp(-2*pi*i*k/N) are the same table
+        if (N >= 4) {
+            m_half.reset(new FFTPlan());
+            m_half->init(N/2);
+            m_work.resize(N);
+        } else {
+            m_half.reset();
+            m_work.clear();
+        }
     }
-    return p;
-}
 
-void ordina(float * f1, int N) {
-    float f2[2*kMaxSamplesPerFrame];
-    for (int i = 0; i < N; i++) {
-        int ir = reverse(N, i);
-        f2[2*i + 0] = f1[2*ir + 0];
-        f2[2*i + 1] = f1[2*ir + 1];
+    int size() const { return m_N; }
+
+    // In-place forward transform of N interleaved complex values
+    void transform(float * f) const {
+        const int N = m_N;
+
+        for (int i = 0; i < N; ++i) {
+            const int j = m_reverse[i];
+            if (j > i) {
+                std::swap(f[2*i + 0], f[2*j + 0]);
+                std::swap(f[2*i + 1], f[2*j + 1]);
+            }
+        }
+
+        for (int h = 1, stride = N/2; h < N; h *= 2, stride /= 2) {
+            for (int k = 0; k < N; k += 2*h) {
+                float * lo = f + 2*k;
+                float * hi = f + 2*(k + h);
+                for (int j = 0; j < h; ++j) {
+                    const float a = m_twiddle[2*j*stride + 0];
+                    const float b = m_twiddle[2*j*stride + 1];
+                    const float c = hi[2*j + 0];
+                    const float d = hi[2*j + 1];
+                    const float tr = a*c - b*d;
+                    const float ti = b*c + a*d;
+                    hi[2*j + 0] = lo[2*j + 0] - tr;
+                    hi[2*j + 1] = lo[2*j + 1] - ti;
+                    lo[2*j + 0] += tr;
+                    lo[2*j + 1] += ti;
+                }
+            }
+        }
     }
-    for (int j = 0; j < N; j++) {
-        f1[2*j + 0] = f2[2*j + 0];
-        f1[2*j + 1] = f2[2*j + 1];
+
+    void FFT(float * f, float d) const {
+        transform(f);
+        if (d != 1.0f) {
+            for (int i = 0; i < 2*m_N; ++i) f[i] *= d;
+        }
     }
-}
 
-void transform(float * f, int N) {
-    ordina(f, N);    //first: reverse order
-    float * W;
-    W = (float *)malloc(N*sizeof(float));
-    W[2*1 + 0] = cos(-2.*M_PI/N);
-    W[2*1 + 1] = sin(-2.*M_PI/N);
-    W[2*0 + 0] = 1;
-    W[2*0 + 1] = 0;
-    for (int i = 2; i < N / 2; i++) {
-        W[2*i + 0] = cos(-2.*i*M_PI/N);
-        W[2*i + 1] = sin(-2.*i*M_PI/N);
+    void FFT(const float * src, float * dst, float d) const {
+        for (int i = 0; i < m_N; ++i) {
+            dst[2*i + 0] = src[i];
+            dst[2*i + 1] = 0.0f;
+        }
+        FFT(dst, d);
     }
-    int n = 1;
-    int a = N / 2;
-    for(int j = 0; j < log2(N); j++) {
-        for(int i = 0; i < N; i++) {
-            if(!(i & n)) {
-                int wi = (i * a) % (n * a);
-                int fi = i + n;
-                float a = W[2*wi + 0];
-                float b = W[2*wi + 1];
-                float c = f[2*fi + 0];
-                float d = f[2*fi + 1];
-                float temp[2] = { f[2*i + 0], f[2*i + 1] };
-                float Temp[2] = { a*c - b*d, b*c + a*d };
-                f[2*i + 0]  = temp[0] + Temp[0];
-                f[2*i + 1]  = temp[1] + Temp[1];
-                f[2*fi + 0] = temp[0] - Temp[0];
-                f[2*fi + 1] = temp[1] - Temp[1];
+
+    // |X[k]|^2 for all N bins of the transform of N real samples, computed
+    // with one N/2-point complex FFT. Not reentrant: uses the plan's scratch.
+    void powerReal(const float * x, float * power) {
+        const int N = m_N;
+        if (!m_half) {
+            m_work.resize(2*N);
+            for (int i = 0; i < N; ++i) {
+                m_work[2*i + 0] = x[i];
+                m_work[2*i + 1] = 0.0f;
             }
+            transform(m_work.data());
+            for (int i = 0; i < N; ++i) {
+                power[i] = m_work[2*i]*m_work[2*i] + m_work[2*i + 1]*m_work[2*i + 1];
+            }
+            return;
         }
-        n *= 2;
-        a = a / 2;
-    }
-    free(W);
-}
 
-void FFT(float * f, int N, float d) {
-    transform(f, N);
-    for (int i = 0; i < N; i++) {
-        f[2*i + 0] *= d;
-        f[2*i + 1] *= d;
+        // Pack even/odd samples as re/im of an N/2-point signal
+        const int M = N/2;
+        float * z = m_work.data();
+        for (int i = 0; i < N; ++i) z[i] = x[i];
+        m_half->transform(z);
+
+        // X[k] = E[k] + W^k O[k], E/O recovered from Z[k] and conj(Z[M - k])
+        for (int k = 0; k <= M/2; ++k) {
+            const int mk = (M - k) & (M - 1);
+            const float zr = z[2*k + 0],  zi = z[2*k + 1];
+            const float cr = z[2*mk + 0], ci = z[2*mk + 1];
+
+            const float er = 0.5f*(zr + cr), ei = 0.5f*(zi - ci);
+            const float or_ = 0.5f*(zi + ci), oi = -0.5f*(zr - cr);
+
+            const float wr = m_twiddle[2*k + 0], wi = m_twiddle[2*k + 1];
+            const float tr = wr*or_ - wi*oi;
+            const float ti = wr*oi + wi*or_;
+
+            // bin k and, by the same pair, bin M - k
+            const float xr = er + tr, xi = ei + ti;
+            power[k] = xr*xr + xi*xi;
+
+            if (k == 0) {
+                const float xm = er - tr; // X[M], real-valued
+                power[M] = xm*xm + (ei - ti)*(ei - ti);
+            } else if (mk != k) {
+                const float wr2 = m_twiddle[2*mk + 0], wi2 = m_twiddle[2*mk + 1];
+                const float er2 = er, ei2 = -ei;
+                const float or2 = or_, oi2 = -oi;
+                const float tr2 = wr2*or2 - wi2*oi2;
+                const float ti2 = wr2*oi2 + wi2*or2;
+                const float yr = er2 + tr2, yi = ei2 + ti2;
+                power[mk] = yr*yr + yi*yi;
+            }
+        }
+
+        // Real input: the upper half mirrors the lower half
+        for (int k = 1; k < M; ++k) {
+            power[N - k] = power[k];
+        }
     }
+
+private:
+    int m_N = 0;
+    std::vector<int> m_reverse;
+    std::vector<float> m_twiddle;
+
+    std::unique_ptr<FFTPlan> m_half;
+    std::vector<float> m_work;
+};
+
+// Plain function interface, kept for existing callers. Each thread reuses one
+// plan, rebuilt only when N changes, so steady-state calls do not allocate.
+inline void FFT(float * f, int N, float d) {
+    thread_local FFTPlan plan;
+    if (plan.size() != N) plan.init(N);
+    plan.FFT(f, d);
 }
 
-void FFT(float * src, float * dst, int N, float d) {
+inline void FFT(float * src, float * dst, int N, float d) {
     for (int i = 0; i < N; ++i) {
         dst[2*i + 0] = src[i];
         dst[2*i + 1] = 0.0f;
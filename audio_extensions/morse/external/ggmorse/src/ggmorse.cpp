@@ -1,11 +1,14 @@
 #include "ggmorse/ggmorse.h"
 
 #include "stfft.h"
+#include "decimator.h"
 #include "filter.h"
 #include "goertzel.h"
 #include "resampler.h"
+#include "taskpool.h"
 
 #include <chrono>
+#include <limits>
 #include <string>
 #include <unordered_map>
 
@@ -120,6 +123,187 @@ struct Interval {
     int type = 0; // 0 - dot, 1 - dah
 };
 
+// Cost of a (speed, level) cell that scoreCell() gave up on
+constexpr float kCellPruned = std::numeric_limits<float>::infinity();
+
+// Split the signal into on/off intervals at the given level. This does not
+// depend on the speed, so the search does it once per level and frame; len
+// is left in samples (and, as always, the last interval carries over the
+// length of the one before it).
+void findEdges(const float * filteredF, int nSamples, float level, std::vector<Interval> & edges) {
+    edges.clear();
+
+    int lastSignal = filteredF[0] > level ? 1 : 0;
+
+    Interval curInterval;
+    curInterval.signal = lastSignal;
+    curInterval.start = 0;
+    curInterval.avg = filteredF[0];
+
+    for (int i = 1; i < nSamples; ++i) {
+        int curSignal = filteredF[i] > level ? 1 : 0;
+        if (curSignal != lastSignal) {
+            curInterval.end = i;
+            curInterval.avg /= (i - curInterval.start);
+            curInterval.len = float(curInterval.end - curInterval.start);
+            edges.push_back(curInterval);
+
+            curInterval.signal = curSignal;
+            curInterval.start = i;
+            curInterval.avg = filteredF[i];
+            lastSignal = curSignal;
+        } else {
+            curInterval.avg += filteredF[i];
+        }
+    }
+
+    curInterval.end = nSamples;
+    edges.push_back(curInterval);
+}
+
+// Fit dot/dah/space lengths to the edges of one level at one speed and
+// return the cost, leaving the adjusted intervals in `intervals`.
+//
+// Every term of the cost is non-negative, so as soon as the part already
+// known exceeds bound the cell cannot win and kCellPruned is returned.
+float scoreCell(const std::vector<Interval> & edges, float lendot_samples, float bound, std::vector<Interval> & intervals) {
+    intervals = edges;
+
+    int nIntervals = (int) intervals.size();
+
+    int nDots = 0;
+    float avgDotLength = 0.0f;
+
+    int nDahs = 0;
+    float avgDahLength = 0.0f;
+
+    for (int i = 0; i < nIntervals; ++i) {
+        auto & curInterval = intervals[i];
+        curInterval.len = curInterval.len/lendot_samples;
+
+        if (curInterval.signal == 0) {
+            curInterval.type = 0;
+            continue;
+        }
+
+        curInterval.type = curInterval.len > 2 ? 1 : 0;
+
+        if (i == 0 || i == nIntervals - 1) continue;
+
+        if (curInterval.type == 0) {
+            nDots++;
+            avgDotLength += curInterval.len;
+        } else {
+            nDahs++;
+            avgDahLength += curInterval.len;
+        }
+    }
+
+    // The dot and dah counts do not change from here on; a missing kind
+    // costs 100, and so does a dah/dot ratio far from 3
+    const float missingCost = (nDots > 0 ? 0.0f : 100.0f) + (nDahs > 0 ? 0.0f : 100.0f);
+
+    if (nDots > 0) avgDotLength /= nDots; else avgDotLength = 1.0f;
+    if (nDahs > 0) avgDahLength /= nDahs; else avgDahLength = 3.0f;
+
+    const float ratioCost = (avgDahLength/avgDotLength < 2.5 || avgDahLength/avgDotLength > 3.5) ? 100.0f : 0.0f;
+
+    if (missingCost + ratioCost > bound) return kCellPruned;
+
+    for (int i = 1; i < nIntervals - 1; ++i) {
+        auto & curInterval = intervals[i];
+        if (curInterval.signal == 0) {
+            continue;
+        }
+
+        float mid = 0.5f*(curInterval.start + curInterval.end);
+        if (curInterval.type == 0) {
+            curInterval.len *= 1.0f/avgDotLength;
+        } else {
+            curInterval.len *= 3.0f/avgDahLength;
+        }
+
+        intervals[i - 1].end = curInterval.start = mid - 0.5f*curInterval.len*lendot_samples;
+        intervals[i - 1].len = float(intervals[i - 1].end - intervals[i - 1].start)/lendot_samples;
+        intervals[i + 1].start = curInterval.end = mid + 0.5f*curInterval.len*lendot_samples;
+        intervals[i + 1].len = float(intervals[i + 1].end - intervals[i + 1].start)/lendot_samples;
+    }
+
+    const int nDotsTotal = nDots > 0 ? nDots : 1;
+    const int nDahsTotal = nDahs > 0 ? nDahs : 1;
+
+    nDots = 0;
+    float costDots = 0.0f;
+    nDahs = 0;
+    float costDahs = 0.0f;
+
+    int nSpaces = 0;
+    float costSpaces = 0.0f;
+
+    for (int i = 1; i < nIntervals - 1; ++i) {
+        auto & curInterval = intervals[i];
+        if (curInterval.signal == 0) {
+            curInterval.type = 0;
+
+            if (curInterval.len < 8.0) {
+                float c1 = std::pow(curInterval.len - 1.0, 2);
+                float c3 = std::pow(curInterval.len - 3.0, 2);
+                float c7 = std::pow(curInterval.len - 7.0, 2);
+
+                if (c1 < c3 && c1 < c7) {
+                    curInterval.type = 1;
+                    costSpaces += std::min(std::min(c1, c3), c7);
+                    ++nSpaces;
+                } else if (c3 < c1 && c3 < c7) {
+                    curInterval.type = 2;
+                } else if (c7 < c1 && c7 < c3) {
+                    curInterval.type = 3;
+                }
+            }
+
+            continue;
+        }
+
+        if (curInterval.type == 0) {
+            nDots++;
+            costDots += std::pow(curInterval.len - 1.0, 2);
+        }
+
+        if (curInterval.type == 1) {
+            nDahs++;
+            costDahs += std::pow(curInterval.len - 3.0, 2);
+        }
+
+        // The rest of the total below only adds non-negative terms
+        if (costDots/nDotsTotal + costDahs/nDahsTotal + ratioCost > bound) return kCellPruned;
+    }
+
+    if (nSpaces == 0) { nSpaces = 1; costSpaces = 100.0f; }
+    if (nDots < 1) { nDots = 1; costDots = 100.0f; }
+    if (nDahs < 1) { nDahs = 1; costDahs = 100.0f; }
+
+    float curCost = costDots/nDots + costDahs/nDahs + costSpaces/nSpaces;
+    curCost += ratioCost;
+
+    return curCost;
+}
+
+// One (speed, level) candidate of the frame analysis
+struct SearchCell {
+    int speedIdx;
+    int levelIdx;
+};
+
+// Per-thread state of the frame analysis
+struct SearchSlot {
+    std::vector<Interval> intervals; // cell being scored
+    std::vector<Interval> best;      // intervals of the best cell so far
+    float bestCost = 0.0f;
+    int bestSpeedIdx = 0;
+    int bestLevelIdx = 0;
+    bool found = false;
+};
+
 }
 
 struct GGMorse::Impl {
@@ -165,12 +349,19 @@ struct GGMorse::Impl {
     WaveformF outputBlockF = {};
     WaveformI16 outputBlockI16 = {};
 
-    // todo : refactor
-    std::vector<std::vector<std::vector<Interval>>> intervalsAll = {};
+    // Frame analysis: the edges of each level (built for the frame in
+    // levelEdgesFrame), the cells to score, one slot per analysis thread
+    // and the intervals of the winning cell
+    std::vector<std::vector<Interval>> levelEdges = std::vector<std::vector<Interval>>(100);
+    std::vector<int> levelEdgesFrame = std::vector<int>(100, -1);
+    std::vector<SearchCell> searchCells = {};
+    std::vector<SearchSlot> searchSlots = std::vector<SearchSlot>(1);
+    std::vector<Interval> bestIntervals = {};
+    std::unique_ptr<TaskPool> analysisPool = {};
 
     STFFT stfft = {};
     Filter filterHighPass = {};
-    Filter filterLowPass = {};
+    Decimator decimator = {};
     Resampler resampler = {};
     GoertzelRunningFIR goertzelFilter = {};
 
@@ -225,14 +416,6 @@ GGMorse::GGMorse(const Parameters & parameters)
         parameters.samplesPerFrame,
     })) {
 
-    m_impl->intervalsAll.resize(100);
-    for (auto & intervals : m_impl->intervalsAll) {
-        intervals.resize(100);
-        for (auto & x : intervals) {
-            x.reserve(100);
-        }
-    }
-
     m_impl->rxData.reserve(1024);
 
     int pow2For10Hz = 1;
@@ -243,8 +426,13 @@ GGMorse::GGMorse(const Parameters & parameters)
 
     m_impl->stfft.init(kBaseSampleRate, pow2For10Hz, parameters.samplesPerFrame, kMaxWindowToAnalyze_s);
     m_impl->filterHighPass.init(Filter::FirstOrderHighPass, m_impl->parametersDecode.frequencyRangeMin_hz, kBaseSampleRate);
-    m_impl->filterLowPass.init(Filter::FirstOrderLowPass, m_impl->parametersDecode.frequencyRangeMax_hz, m_impl->sampleRateInp);
     m_impl->goertzelFilter.init(kBaseSampleRate, pow2For50Hz, kMaxWindowToAnalyze_s);
+    m_impl->goertzelFilter.setSearchRange(m_impl->parametersDecode.frequencyRangeMin_hz, m_impl->parametersDecode.frequencyRangeMax_hz);
+
+    // integer rate ratios are decimated directly, anything else resampled
+    if (m_impl->sampleRateInp != kBaseSampleRate && int(m_impl->sampleRateInp) % int(kBaseSampleRate) == 0) {
+        m_impl->decimator.init(int(m_impl->sampleRateInp/kBaseSampleRate));
+    }
 }
 
 GGMorse::~GGMorse() {
@@ -256,11 +444,21 @@ bool GGMorse::setParametersDecode(const ParametersDecode & parameters) {
     if (m_impl->parametersDecode.frequencyRangeMin_hz != parameters.frequencyRangeMin_hz) {
         m_impl->filterHighPass.init(Filter::FirstOrderHighPass, m_impl->parametersDecode.frequencyRangeMin_hz, kBaseSampleRate);
     }
-    if (m_impl->parametersDecode.frequencyRangeMax_hz != parameters.frequencyRangeMax_hz) {
-        m_impl->filterLowPass.init(Filter::FirstOrderLowPass, m_impl->parametersDecode.frequencyRangeMax_hz, m_impl->sampleRateInp);
-    }
 
     m_impl->parametersDecode = parameters;
+    m_impl->goertzelFilter.setSearchRange(parameters.frequencyRangeMin_hz, parameters.frequencyRangeMax_hz);
+
+    return true;
+}
+
+bool GGMorse::setAnalysisThreads(int nThreads) {
+    if (nThreads < 1) {
+        fprintf(stderr, "Invalid number of analysis threads: %d\n", nThreads);
+        return false;
+    }
+
+    m_impl->analysisPool.reset(nThreads > 1 ? new TaskPool(nThreads) : nullptr);
+    m_impl->searchSlots.resize(nThreads);
 
     return true;
 }
@@ -618,16 +816,9 @@ bool GGMorse::decode(const CBWaveformInp & cbWaveformInp) {
 
         if (m_impl->sampleRateInp != kBaseSampleRate) {
             if (resampleSimple) {
-                if (m_impl->parametersDecode.applyFilterLowPass) {
-                    m_impl->filterLowPass.process(m_impl->waveformResampled.data(), nSamplesRecorded);
-                }
-
-                int ds = int(factor);
-                int nSamplesResampled = 0;
-                for (int i = 0; i < nSamplesRecorded; i += ds) {
-                    m_impl->waveform[offset + nSamplesResampled] = m_impl->waveformResampled[i];
-                    ++nSamplesResampled;
-                }
+                // the decimator's FIR is the low-pass here, so it runs
+                // regardless of applyFilterLowPass
+                int nSamplesResampled = m_impl->decimator.process(m_impl->waveformResampled.data(), nSamplesRecorded, m_impl->waveform.data() + offset);
                 nSamplesRecorded = offset + nSamplesResampled;
             } else {
                 if (nSamplesRecorded <= 2*Resampler::kWidth) {
@@ -762,177 +953,101 @@ void GGMorse::decode_float() {
 
     m_impl->thresholdF.push_back(m_impl->statistics.signalThreshold);
 
+    // Search the (speed, level) cells coarse to fine: mode 0 covers the whole
+    // grid sparsely, mode 1 refines around the previous frame's estimate.
+    // The cell cost is the only thing that depends on the speed, so each
+    // level is thresholded once and all of its speeds reuse the edges.
+    auto edgesForLevel = [&](int l) -> const std::vector<Interval> & {
+        if (m_impl->levelEdgesFrame[l] != m_impl->framesProcessed) {
+            findEdges(filteredF.data(), nSamples, (0.01*mean)*l, m_impl->levelEdges[l]);
+            m_impl->levelEdgesFrame[l] = m_impl->framesProcessed;
+        }
+        return m_impl->levelEdges[l];
+    };
+
+    auto lendotForSpeed = [&](int s) -> float {
+        return kBaseSampleRate*(1e-3*lendot_ms(5 + s))/nDownsample;
+    };
+
+    const int sFine0 = std::min(std::max(0.0f, std::round(m_impl->statistics.estimatedSpeed_wpm - 5.0f - 2.0f)), 50.0f);
+    const int sFine1 = std::min(std::max(0.0f, std::round(m_impl->statistics.estimatedSpeed_wpm - 5.0f + 2.0f)), 50.0f);
+    const int lOld = std::min(std::max(20.0f, 100.0f*m_impl->statistics.signalThreshold), 80.0f);
+
+    // Scoring the previous frame's cell first, which is part of the mode 1
+    // grid, gives a tight bound to prune against from the very first cell.
+    // Cells are only pruned when strictly worse than it, so the winner is
+    // still the first cell with the lowest cost, as in a full scan.
+    float bound = bestCost;
+    if (nModes == 2 && m_impl->framesProcessed > 0) {
+        const int sSeed = (sFine0 + sFine1)/2;
+        bound = std::min(bound, scoreCell(edgesForLevel(lOld), lendotForSpeed(sSeed), kCellPruned, m_impl->searchSlots[0].intervals));
+    }
+
+    m_impl->bestIntervals.clear();
+
     for (int mode = 0; mode < nModes; ++mode) {
         if (mode == 1) {
-            s0 = std::min(std::max(0.0f, std::round(m_impl->statistics.estimatedSpeed_wpm - 5.0f - 2.0f)), 50.0f);
-            s1 = std::min(std::max(0.0f, std::round(m_impl->statistics.estimatedSpeed_wpm - 5.0f + 2.0f)), 50.0f);
+            s0 = sFine0;
+            s1 = sFine1;
             ds = 1;
         }
 
-        int lOld = std::min(std::max(20.0f, 100.0f*m_impl->statistics.signalThreshold), 80.0f);
         int l0 = (mode == 0) ? 10 : lOld - 10;
         int l1 = (mode == 0) ? 90 : lOld + 10;
         int dl = (mode == 0) ? 20 : 2;
 
+        auto & cells = m_impl->searchCells;
+        cells.clear();
         for (int s = s0; s <= s1 && s < 55; s += ds) {
-            float lendot_samples = kBaseSampleRate*(1e-3*lendot_ms(5 + s))/nDownsample;
-
             for (int l = l0; l <= l1; l += dl) {
-                float level = (0.01*mean)*l;
-                int lastSignal = filteredF[0] > level ? 1 : 0;
-
-                Interval curInterval;
-                curInterval.signal = lastSignal;
-                curInterval.start = 0;
-                curInterval.avg = filteredF[0];
-
-                auto & intervals = m_impl->intervalsAll[s][l];
-                intervals.clear();
-
-                int nOnIntervals = 0;
-                [[maybe_unused]] float avgOnLength = 0.0f;
-
-                for (int i = 1; i < nSamples; ++i) {
-                    int curSignal = filteredF[i] > level ? 1 : 0;
-                    if (curSignal != lastSignal) {
-                        curInterval.end = i;
-                        curInterval.avg /= (i - curInterval.start);
-                        curInterval.len = float(curInterval.end - curInterval.start)/lendot_samples;
-                        intervals.push_back(curInterval);
-
-                        if (curInterval.signal == 1) {
-                            nOnIntervals++;
-                            avgOnLength += curInterval.len;
-                        }
-
-                        curInterval.signal = curSignal;
-                        curInterval.start = i;
-                        curInterval.avg = filteredF[i];
-                        lastSignal = curSignal;
-                    } else {
-                        curInterval.avg += filteredF[i];
-                    }
-                }
-
-                avgOnLength /= nOnIntervals;
-
-                curInterval.end = nSamples;
-                intervals.push_back(curInterval);
-
-                int nIntervals = (int) intervals.size();
-
-                for (int i = 0; i < nIntervals; ++i) {
-                    if (intervals[i].signal == 0) {
-                        intervals[i].type = 0;
-                        continue;
-                    }
-
-                    intervals[i].type = intervals[i].len > 2 ? 1 : 0;
-                }
-
-                float curCost = 0.0f;
-
-                int nDots = 0;
-                float avgDotLength = 0.0f;
-
-                int nDahs = 0;
-                float avgDahLength = 0.0f;
-
-                for (int i = 1; i < nIntervals - 1; ++i) {
-                    const auto & curInterval = intervals[i];
-                    if (curInterval.signal == 0) continue;
-
-                    if (curInterval.type == 0) {
-                        nDots++;
-                        avgDotLength += curInterval.len;
-                    }
-
-                    if (curInterval.type == 1) {
-                        nDahs++;
-                        avgDahLength += curInterval.len;
-                    }
-                }
-
-                if (nDots > 0) avgDotLength /= nDots; else avgDotLength = 1.0f;
-                if (nDahs > 0) avgDahLength /= nDahs; else avgDahLength = 3.0f;
-
-                for (int i = 1; i < nIntervals - 1; ++i) {
-                    auto & curInterval = intervals[i];
-                    if (curInterval.signal == 0) {
-                        continue;
-                    }
-
-                    float mid = 0.5f*(curInterval.start + curInterval.end);
-                    if (curInterval.type == 0) {
-                        curInterval.len *= 1.0f/avgDotLength;
-                    } else {
-                        curInterval.len *= 3.0f/avgDahLength;
-                    }
-
-                    intervals[i - 1].end = curInterval.start = mid - 0.5f*curInterval.len*lendot_samples;
-                    intervals[i - 1].len = float(intervals[i - 1].end - intervals[i - 1].start)/lendot_samples;
-                    intervals[i + 1].start = curInterval.end = mid + 0.5f*curInterval.len*lendot_samples;
-                    intervals[i + 1].len = float(intervals[i + 1].end - intervals[i + 1].start)/lendot_samples;
-                }
-
-                nDots = 0;
-                float costDots = 0.0f;
-                nDahs = 0;
-                float costDahs = 0.0f;
-
-                int nSpaces = 0;
-                float costSpaces = 0.0f;
-
-                for (int i = 1; i < nIntervals - 1; ++i) {
-                    auto & curInterval = intervals[i];
-                    if (curInterval.signal == 0) {
-                        curInterval.type = 0;
-
-                        if (curInterval.len < 8.0) {
-                            float c1 = std::pow(curInterval.len - 1.0, 2);
-                            float c3 = std::pow(curInterval.len - 3.0, 2);
-                            float c7 = std::pow(curInterval.len - 7.0, 2);
-
-                            if (c1 < c3 && c1 < c7) {
-                                curInterval.type = 1;
-                                costSpaces += std::min(std::min(c1, c3), c7);
-                                ++nSpaces;
-                            } else if (c3 < c1 && c3 < c7) {
-                                curInterval.type = 2;
-                            } else if (c7 < c1 && c7 < c3) {
-                                curInterval.type = 3;
-                            }
-                        }
-
-                        continue;
-                    }
-
-                    if (curInterval.type == 0) {
-                        nDots++;
-                        costDots += std::pow(curInterval.len - 1.0, 2);
-                    }
+                edgesForLevel(l);
+                cells.push_back({ s, l });
+            }
+        }
 
-                    if (curInterval.type == 1) {
-                        nDahs++;
-                        costDahs += std::pow(curInterval.len - 3.0, 2);
-                    }
+        // Each slot scans a contiguous run of cells and keeps the first one
+        // that beats everything before it; merging the slots in order then
+        // gives the same winner as one scan
+        const int nCells = (int) cells.size();
+        const int nSlots = m_impl->analysisPool ? std::min(m_impl->analysisPool->size(), nCells) : 1;
+
+        auto scanSlot = [&, bestCostMode = bestCost, boundMode = bound](int k) {
+            auto & slot = m_impl->searchSlots[k];
+            slot.found = false;
+            slot.bestCost = bestCostMode;
+
+            float boundSlot = boundMode;
+            for (int i = (k*nCells)/nSlots; i < ((k + 1)*nCells)/nSlots; ++i) {
+                const auto & cell = cells[i];
+                float curCost = scoreCell(m_impl->levelEdges[cell.levelIdx], lendotForSpeed(cell.speedIdx), boundSlot, slot.intervals);
+
+                if (curCost < slot.bestCost) {
+                    slot.bestCost = curCost;
+                    slot.bestSpeedIdx = cell.speedIdx;
+                    slot.bestLevelIdx = cell.levelIdx;
+                    slot.found = true;
+                    std::swap(slot.intervals, slot.best);
+                    boundSlot = std::min(boundSlot, curCost);
                 }
+            }
+        };
 
-                if (nSpaces == 0) { nSpaces = 1; costSpaces = 100.0f; }
-                if (nDots < 1) { nDots = 1; costDots = 100.0f; }
-                if (nDahs < 1) { nDahs = 1; costDahs = 100.0f; }
-
-                curCost = costDots/nDots + costDahs/nDahs + costSpaces/nSpaces;
-
-                if (avgDahLength/avgDotLength < 2.5 || avgDahLength/avgDotLength > 3.5) curCost += 100.0f;
+        if (nSlots > 1) {
+            m_impl->analysisPool->run(nSlots, scanSlot);
+        } else if (nCells > 0) {
+            scanSlot(0);
+        }
 
-                if (curCost < bestCost) {
-                    bestCost = curCost;
-                    bestLevelIdx = l;
-                    bestSpeedIdx = s;
-                }
+        for (int k = 0; k < nSlots; ++k) {
+            auto & slot = m_impl->searchSlots[k];
+            if (slot.found && slot.bestCost < bestCost) {
+                bestCost = slot.bestCost;
+                bestLevelIdx = slot.bestLevelIdx;
+                bestSpeedIdx = slot.bestSpeedIdx;
+                std::swap(m_impl->bestIntervals, slot.best);
             }
         }
+        bound = std::min(bound, bestCost);
     }
 
     m_impl->statistics.timeFrameAnalysis_ms = dt_ms(tStart_us);
@@ -940,7 +1055,7 @@ void GGMorse::decode_float() {
 
     {
         const bool isDecoding = bestCost < 1.0f;
-        const auto & intervals = m_impl->intervalsAll[bestSpeedIdx][bestLevelIdx];
+        const auto & intervals = m_impl->bestIntervals;
 
         const float estimatedSpeed_wpm = 5 + bestSpeedIdx;
         if (std::fabs(m_impl->statistics.estimatedSpeed_wpm - estimatedSpeed_wpm) > 2.0f) {
@@ -964,8 +1079,9 @@ void GGMorse::decode_float() {
             }
         }
 
+        // No intervals if no cell scored below the initial cost
         int j = 0;
-        for (int w = w0; w <= w1; ++w) {
+        for (int w = w0; w <= w1 && intervals.size() > 0; ++w) {
             for (int i = 0; i < m_impl->samplesPerFrame/nDownsample; ++i) {
                 int s = w*m_impl->samplesPerFrame/nDownsample + i;
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <cmath>
 
@@ -7,102 +8,102 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+// Running Hamming-windowed Goertzel power at the CW pitch, one output per input
+// sample, over the last history_s seconds.
+//
+// Rather than a single Goertzel at one frequency, a bank of kBankBins bins
+// spaced sampleRate/(2*window) apart is kept around the candidate pitch, each
+// with its own output history. The bins are rectangular sliding DFTs: each new
+// sample adds one term to a running sum and the sample leaving the window
+// removes its stored term, so a bin costs O(1) per sample instead of O(window).
+// The Hamming window is 0.54 - 0.23*(e^{+jD m} + e^{-jD m}) with D = 2*pi/window,
+// i.e. the windowed value at bin i is a combination of the rectangular bins
+// i, i - 2 and i + 2, which is why kGuardBins extra sums sit at each end.
+//
+// A pitch change inside the bank is then just a switch of the active bin;
+// only moving outside it re-centres the bank and replays the history.
+//
+// The filter therefore runs at the bin nearest the requested pitch, up to half
+// a spacing (7.8 Hz at 4 kHz / 128 taps) away from it. That is well inside the
+// window's main lobe: the tone loses under 0.5 dB there. The pitch the decoder
+// reports is STFFT::pitch(), not activeFrequency().
 struct GoertzelRunningFIR {
+    static constexpr int kBankBins  = 21; // windowed output bins
+    static constexpr int kGuardBins = 2;  // rectangular sums beyond each end
+    static constexpr int kSums      = kBankBins + 2*kGuardBins;
+
     void init(
             float sampleRate,
             int window_samples,
             float history_s) {
         m_sampleRate = sampleRate;
-        m_hamming.resize(window_samples);
-        for (int i = 0; i < window_samples; i++) {
-            m_hamming[i] = 0.54 - 0.46*std::cos((2.0*M_PI*i)/window_samples);
-        }
+        m_window = window_samples;
+        m_binSpacing_hz = sampleRate/(2.0f*window_samples);
 
         int history_samples = history_s*sampleRate;
 
         m_historyHead = 0;
-        m_history.resize(history_samples, 0);
+        m_history.assign(history_samples, 0);
 
+        int nf = history_samples - window_samples;
         m_filteredHead = 0;
-        m_filtered.resize(history_samples - window_samples, 0);
-        m_filteredOut.resize(history_samples - window_samples, 0);
+        m_filtered.assign(kBankBins*nf, 0);
+        m_filteredOut.assign(nf, 0);
+
+        // e^{-j D k0} for the window start k0 (mod window)
+        m_hamRe.resize(window_samples);
+        m_hamIm.resize(window_samples);
+        for (int m = 0; m < window_samples; ++m) {
+            m_hamRe[m] = std::cos(2.0*M_PI*m/window_samples);
+            m_hamIm[m] = -std::sin(2.0*M_PI*m/window_samples);
+        }
+
+        m_termRe.assign(window_samples*kSums, 0.0);
+        m_termIm.assign(window_samples*kSums, 0.0);
+
+        m_bankLo_hz = 0.0f;
+        m_bankValid = false;
+        m_active = kBankBins/2;
 
         m_processed_samples = 0;
     }
 
     void process(float * samples, int n, float frequency_hz) {
-        int nw = (int) m_hamming.size();
-        int nh = (int) m_history.size();
-        int nf = (int) m_filtered.size();
-
-        float normalizedfreq = frequency_hz/m_sampleRate;
-
-        float w = 2*M_PI*normalizedfreq;
-        float wr = std::cos(w);
-        float wi = std::sin(w);
-
-        m_coeff = 2.0*wr;
-        m_cos = wr;
-        m_sin = wi;
+        select(frequency_hz);
 
         for (int i = 0; i < n; ++i) {
-            m_history[m_historyHead] = samples[i];
-            m_historyHead++;
-            if (m_historyHead >= nh) {
-                m_historyHead = 0;
-            }
-
-            m_processed_samples++;
-            if (m_processed_samples >= nw) {
-                m_filtered[m_filteredHead] = filter(m_historyHead - nw);
-                m_filteredHead++;
-                if (m_filteredHead >= nf) {
-                    m_filteredHead = 0;
-                }
-            }
+            push(samples[i]);
         }
+
+        renormalize();
     }
 
+    // Called on a large pitch jump. Within the bank this is only an index
+    // switch; outside it the bank is re-centred and the history replayed.
     void recompute(float frequency_hz) {
-        int nw = (int) m_hamming.size();
-        int nh = (int) m_history.size();
-        int nf = (int) m_filtered.size();
-
-        float normalizedfreq = frequency_hz/m_sampleRate;
-
-        float w = 2*M_PI*normalizedfreq;
-        float wr = std::cos(w);
-        float wi = std::sin(w);
-
-        m_coeff = 2.0*wr;
-        m_cos = wr;
-        m_sin = wi;
-
-        m_processed_samples = 0;
+        select(frequency_hz);
+    }
 
-        for (int i = 0; i < nh; ++i) {
-            m_historyHead++;
-            if (m_historyHead >= nh) {
-                m_historyHead = 0;
-            }
+    // Pitch search range of the decoder. When it fits in the bank, re-centring
+    // places the bank over the whole range so any later jump inside it is an
+    // index switch.
+    void setSearchRange(float fMin_hz, float fMax_hz) {
+        m_rangeMin_hz = fMin_hz;
+        m_rangeMax_hz = fMax_hz;
+    }
 
-            m_processed_samples++;
-            if (m_processed_samples >= nw) {
-                m_filtered[m_filteredHead] = filter(m_historyHead - nw);
-                m_filteredHead++;
-                if (m_filteredHead >= nf) {
-                    m_filteredHead = 0;
-                }
-            }
-        }
+    // Centre frequency of the bin process() is currently reporting
+    float activeFrequency() const {
+        return m_bankLo_hz + m_active*m_binSpacing_hz;
     }
 
     const std::vector<float> & filtered() {
-        int nf = (int) m_filtered.size();
+        int nf = (int) m_filteredOut.size();
+        const float * src = activeFiltered();
 
         int j = m_filteredHead;
         for (int i = 0; i < nf; ++i) {
-            m_filteredOut[i] = m_filtered[j];
+            m_filteredOut[i] = src[j];
             j++;
             if (j >= nf) {
                 j = 0;
@@ -113,16 +114,17 @@ struct GoertzelRunningFIR {
     }
 
     const std::vector<float> & filtered_min(int w) {
-        int nf = (int) m_filtered.size();
+        int nf = (int) m_filteredOut.size();
+        const float * src = activeFiltered();
 
         int j = m_filteredHead;
         for (int i = 0; i < nf; ++i) {
             int j2 = j - std::min(i, w);                  // !!!! Need to double-check these computations
             int l = std::min(i, w) + std::min(nf - i, w); // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
             if (j2 < 0) j2 += nf;
-            float f = m_filtered[j2];
+            float f = src[j2];
             for (int k = 0; k < l; ++k) {
-                f = std::min(f, m_filtered[j2]);
+                f = std::min(f, src[j2]);
                 if (++j2 >= nf) j2 = 0;
             }
             m_filteredOut[i] = f;
@@ -140,43 +142,168 @@ struct GoertzelRunningFIR {
         m_processed_samples = 0;
         std::fill(m_history.begin(), m_history.end(), 0.0f);
         std::fill(m_filtered.begin(), m_filtered.end(), 0.0f);
+        resetSums();
     }
 
 private:
-    float filter(int idx) {
-        if (idx < 0) idx += m_history.size();
-
-        double sprev = 0.0;
-        double sprev2 = 0.0;
-        double s, imag, real;
-
-        int n = (int) m_hamming.size();
-        for (int i = 0; i < n; i++) {
-            s = m_hamming[i]*m_history[idx++] + m_coeff*sprev - sprev2;
-            if (idx >= (int) m_history.size()) idx = 0;
-            sprev2 = sprev;
-            sprev = s;
+    const float * activeFiltered() const {
+        return m_filtered.data() + m_active*m_filteredOut.size();
+    }
+
+    // Make the bin nearest frequency_hz active, re-centring the bank on it
+    // first if it falls outside
+    void select(float frequency_hz) {
+        const float pos = (frequency_hz - m_bankLo_hz)/m_binSpacing_hz;
+        if (!m_bankValid || pos < -0.5f || pos > kBankBins - 0.5f) {
+            float centre_hz = frequency_hz;
+            const bool rangeFits = m_rangeMax_hz > m_rangeMin_hz &&
+                m_rangeMax_hz - m_rangeMin_hz <= (kBankBins - 1)*m_binSpacing_hz;
+            if (rangeFits && frequency_hz >= m_rangeMin_hz && frequency_hz <= m_rangeMax_hz) {
+                centre_hz = 0.5f*(m_rangeMin_hz + m_rangeMax_hz);
+            }
+            m_bankLo_hz = centre_hz - (kBankBins/2)*m_binSpacing_hz;
+            m_bankValid = true;
+            rebuild();
+        }
+        const float newPos = (frequency_hz - m_bankLo_hz)/m_binSpacing_hz;
+        m_active = std::min(std::max(0, (int) std::lround(newPos)), kBankBins - 1);
+    }
+
+    void resetSums() {
+        for (int s = 0; s < kSums; ++s) {
+            const double w = 2.0*M_PI*(m_bankLo_hz + (s - kGuardBins)*m_binSpacing_hz)/m_sampleRate;
+            m_rotRe[s] = std::cos(w);
+            m_rotIm[s] = -std::sin(w);
+            m_phRe[s] = 1.0;
+            m_phIm[s] = 0.0;
+            m_sumRe[s] = 0.0;
+            m_sumIm[s] = 0.0;
+        }
+        std::fill(m_termRe.begin(), m_termRe.end(), 0.0);
+        std::fill(m_termIm.begin(), m_termIm.end(), 0.0);
+        m_k0 = 0;
+    }
+
+    // Replay the whole sample history through the bank at its new frequencies
+    void rebuild() {
+        int nh = (int) m_history.size();
+
+        resetSums();
+        if (m_processed_samples == 0) return; // nothing to replay yet
+        m_processed_samples = 0;
+
+        for (int i = 0; i < nh; ++i) {
+            step(m_history[m_historyHead]);
+            m_historyHead++;
+            if (m_historyHead >= nh) {
+                m_historyHead = 0;
+            }
+            if ((i & 1023) == 1023) renormalize();
+        }
+        renormalize();
+    }
+
+    void push(float x) {
+        m_history[m_historyHead] = x;
+        m_historyHead++;
+        if (m_historyHead >= (int) m_history.size()) {
+            m_historyHead = 0;
+        }
+        step(x);
+    }
+
+    // Advance every sum by one sample and, once the window is full, append
+    // each bin's windowed power to its history
+    void step(float x) {
+        const int nw = m_window;
+        double * termRe = &m_termRe[m_k0*kSums];
+        double * termIm = &m_termIm[m_k0*kSums];
+
+        // The slot for this sample held the term of the one leaving the window
+        for (int s = 0; s < kSums; ++s) {
+            const double tr = x*m_phRe[s];
+            const double ti = x*m_phIm[s];
+            m_sumRe[s] += tr - termRe[s];
+            m_sumIm[s] += ti - termIm[s];
+            termRe[s] = tr;
+            termIm[s] = ti;
+
+            const double phRe = m_phRe[s]*m_rotRe[s] - m_phIm[s]*m_rotIm[s];
+            const double phIm = m_phRe[s]*m_rotIm[s] + m_phIm[s]*m_rotRe[s];
+            m_phRe[s] = phRe;
+            m_phIm[s] = phIm;
+        }
+
+        m_k0++;
+        if (m_k0 >= nw) m_k0 = 0;
+
+        m_processed_samples++;
+        if (m_processed_samples < nw) return;
+
+        // The window now starts at the sample after this one in the term
+        // ring, i.e. k0 = m_k0 (mod nw)
+        const double hr = m_hamRe[m_k0];
+        const double hi = m_hamIm[m_k0];
+
+        const int nf = (int) m_filteredOut.size();
+        float * out = m_filtered.data() + m_filteredHead;
+        for (int b = 0; b < kBankBins; ++b) {
+            const int s = b + kGuardBins;
+            // 0.54*S[s] - 0.23*e^{-jD k0}*S[s - 2] - 0.23*e^{+jD k0}*S[s + 2]
+            const double lr = hr*m_sumRe[s - 2] - hi*m_sumIm[s - 2];
+            const double li = hr*m_sumIm[s - 2] + hi*m_sumRe[s - 2];
+            const double ur = hr*m_sumRe[s + 2] + hi*m_sumIm[s + 2];
+            const double ui = hr*m_sumIm[s + 2] - hi*m_sumRe[s + 2];
+            const double re = 0.54*m_sumRe[s] - 0.23*(lr + ur);
+            const double im = 0.54*m_sumIm[s] - 0.23*(li + ui);
+            out[b*nf] = re*re + im*im;
         }
 
-        real = sprev*m_cos - sprev2;
-        imag = -sprev*m_sin;
+        m_filteredHead++;
+        if (m_filteredHead >= nf) {
+            m_filteredHead = 0;
+        }
+    }
 
-        return real*real + imag*imag;
+    // Keep the phasors on the unit circle (rounding drifts their magnitude)
+    void renormalize() {
+        for (int s = 0; s < kSums; ++s) {
+            const double mag = std::sqrt(m_phRe[s]*m_phRe[s] + m_phIm[s]*m_phIm[s]);
+            m_phRe[s] /= mag;
+            m_phIm[s] /= mag;
+        }
     }
 
     int m_processed_samples = 0;
 
     float m_sampleRate = 0.0f;
-    float m_coeff = 0.0f;
-    float m_sin = 0.0f;
-    float m_cos = 0.0f;
+    int m_window = 0;
+    float m_binSpacing_hz = 0.0f;
+
+    float m_rangeMin_hz = 0.0f;
+    float m_rangeMax_hz = 0.0f;
+
+    float m_bankLo_hz = 0.0f; // frequency of output bin 0
+    bool m_bankValid = false;
+    int m_active = 0;
+
+    // Per rectangular sum: e^{-j w} step, current phasor e^{-j w k}, running sum
+    double m_rotRe[kSums] = {}, m_rotIm[kSums] = {};
+    double m_phRe[kSums] = {}, m_phIm[kSums] = {};
+    double m_sumRe[kSums] = {}, m_sumIm[kSums] = {};
+
+    // Terms of the last window samples, [window][kSums], slot m_k0 is the oldest
+    int m_k0 = 0;
+    std::vector<double> m_termRe;
+    std::vector<double> m_termIm;
 
-    std::vector<float> m_hamming;
+    std::vector<double> m_hamRe; // e^{-j D m}
+    std::vector<double> m_hamIm;
 
     int m_historyHead = 0;
     std::vector<float> m_history;
 
     int m_filteredHead = 0;
-    std::vector<float> m_filtered;
-    std::vector<float> m_filteredOut;
+    std::vector<float> m_filtered;    // [kBankBins][nf] power histories
+    std::vector<float> m_filteredOut; // active bin, oldest first
 };
@@ -2,6 +2,7 @@
 
 #include "fft.h"
 
+#include <algorithm>
 #include <vector>
 #include <cmath>
 
@@ -34,9 +35,13 @@ struct STFFT {
         }
         m_spectrogramOrdered = m_spectrogram;
 
+        m_pitchSum.assign(fft_size/2, 0.0);
+        m_pitchRowsSinceResync = 0;
+
         m_needed_samples = fft_step;
         m_fft_step = fft_step;
-        m_fft_buffer.resize(2*fft_size);
+        m_fft_plan.init(fft_size);
+        m_fft_buffer.resize(fft_size);
 
         m_processed_samples = 0;
     }
@@ -58,6 +63,7 @@ struct STFFT {
             m_needed_samples--;
             if (m_needed_samples == 0) {
                 filter(m_historyHead - nw);
+                updatePitchSum();
                 m_spectrogramHead++;
                 if (m_spectrogramHead >= ns) {
                     m_spectrogramHead = 0;
@@ -67,38 +73,41 @@ struct STFFT {
         }
     }
 
+    // Frequency of the strongest bin in [fMin_hz, fMax_hz] over the newest
+    // half of the spectrogram, refined between bins by fitting a parabola to
+    // the log power of the peak and its neighbours (Hamming-windowed peaks are
+    // close to Gaussian, so this is good to a small fraction of a bin)
     float pitch(float fMin_hz, float fMax_hz) {
         int n = (int) m_hamming.size();
-        int ns = (int) m_spectrogram.size();
-        float maxSignal = 0.0f;
-        float bestPitch = 0.0f;
+        double maxSignal = 0.0;
+        int best = -1;
         float df = float(m_sampleRate)/n;
 
         for (int j = 0; j < n/2; ++j) {
             float f = j*df;
             if (f < fMin_hz || f > fMax_hz) continue;
 
-            float curSignal = 0.0;
-
-            int ih = m_spectrogramHead + ns/2;
-            if (ih >= ns) {
-                ih = 0;
-            }
-            for (int i = 0; i < ns/2; ++i) {
-                curSignal += m_spectrogram[ih][j];
-                ++ih;
-                if (ih >= ns) {
-                    ih = 0;
-                }
-            }
-
+            double curSignal = m_pitchSum[j];
             if (curSignal > maxSignal) {
                 maxSignal = curSignal;
-                bestPitch = f;
+                best = j;
+            }
+        }
+
+        if (best < 0) return 0.0f;
+
+        float offset = 0.0f;
+        if (best > 0 && best + 1 < n/2 && m_pitchSum[best - 1] > 0.0 && m_pitchSum[best + 1] > 0.0) {
+            const double a = std::log(m_pitchSum[best - 1]);
+            const double b = std::log(m_pitchSum[best]);
+            const double c = std::log(m_pitchSum[best + 1]);
+            const double den = a - 2.0*b + c;
+            if (den < 0.0) {
+                offset = std::min(0.5, std::max(-0.5, 0.5*(a - c)/den));
             }
         }
 
-        return bestPitch;
+        return std::min(fMax_hz, std::max(fMin_hz, (best + offset)*df));
     }
 
     const std::vector<std::vector<float>> & spectrogram() {
@@ -119,22 +128,47 @@ struct STFFT {
     }
 
 private:
+    // Keep m_pitchSum equal to the per-bin sum of the newest ns/2 rows: add the
+    // row just written at m_spectrogramHead and drop the one now ns/2 rows old.
+    // Re-summed from scratch once per spectrogram length to shed rounding.
+    void updatePitchSum() {
+        int nb = (int) m_pitchSum.size();
+        int ns = (int) m_spectrogram.size();
+        int half = ns/2;
+
+        if (++m_pitchRowsSinceResync >= ns) {
+            m_pitchRowsSinceResync = 0;
+            std::fill(m_pitchSum.begin(), m_pitchSum.end(), 0.0);
+            int ih = m_spectrogramHead;
+            for (int i = 0; i < half; ++i) {
+                const auto & row = m_spectrogram[ih];
+                for (int j = 0; j < nb; ++j) m_pitchSum[j] += row[j];
+                if (--ih < 0) ih = ns - 1;
+            }
+            return;
+        }
+
+        int old = m_spectrogramHead - half;
+        if (old < 0) old += ns;
+
+        const auto & add = m_spectrogram[m_spectrogramHead];
+        const auto & sub = m_spectrogram[old];
+        for (int j = 0; j < nb; ++j) {
+            m_pitchSum[j] += add[j] - sub[j];
+        }
+    }
+
     void filter(int idx) {
         if (idx < 0) idx += m_history.size();
 
         int n = (int) m_hamming.size();
         for (int i = 0; i < n; i++) {
-            m_fft_buffer[2*i + 0] = m_hamming[i]*m_history[idx++];
-            m_fft_buffer[2*i + 1] = 0.0f;
+            m_fft_buffer[i] = m_hamming[i]*m_history[idx++];
             if (idx >= (int) m_history.size()) idx = 0;
         }
 
-        FFT(m_fft_buffer.data(), n, 1.0);
-
-        auto & dst = m_spectrogram[m_spectrogramHead];
-        for (int i = 0; i < n; i++) {
-            dst[i] = (m_fft_buffer[2*i + 0]*m_fft_buffer[2*i + 0] + m_fft_buffer[2*i + 1]*m_fft_buffer[2*i + 1]);
-        }
+        // Real input, so a half-size complex FFT gives the whole power row
+        m_fft_plan.powerReal(m_fft_buffer.data(), m_spectrogram[m_spectrogramHead].data());
     }
 
     int m_sampleRate = 0;
@@ -151,5 +185,9 @@ private:
     std::vector<std::vector<float>> m_spectrogram;
     std::vector<std::vector<float>> m_spectrogramOrdered;
 
-    std::vector<float> m_fft_buffer;
+    std::vector<double> m_pitchSum; // per bin (lower half), newest ns/2 rows
+    int m_pitchRowsSinceResync = 0;
+
+    FFTPlan m_fft_plan;
+    std::vector<float> m_fft_buffer; // windowed real samples
 };
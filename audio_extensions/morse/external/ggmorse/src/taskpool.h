@@ -0,0 +1,92 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Minimal fork/join pool for splitting one frame's work across threads.
+//
+// run(n, f) calls f(0) .. f(n - 1) and returns once all of them have
+// finished: f(0) runs on the calling thread, f(k) on pool thread k. n must
+// not exceed size(). One run() at a time.
+class TaskPool {
+public:
+    // nThreads counts the calling thread, so nThreads - 1 threads are started
+    explicit TaskPool(int nThreads) {
+        for (int k = 1; k < nThreads; ++k) {
+            m_threads.emplace_back([this, k] { workerLoop(k); });
+        }
+    }
+
+    ~TaskPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_cvStart.notify_all();
+        for (auto & t : m_threads) {
+            t.join();
+        }
+    }
+
+    TaskPool(const TaskPool &) = delete;
+    TaskPool & operator=(const TaskPool &) = delete;
+
+    int size() const { return (int) m_threads.size() + 1; }
+
+    void run(int n, const std::function<void(int)> & f) {
+        if (n <= 0) return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task = &f;
+            m_nTasks = n;
+            m_pending = n - 1;
+            ++m_generation;
+        }
+        if (n > 1) m_cvStart.notify_all();
+
+        f(0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cvDone.wait(lock, [this] { return m_pending == 0; });
+        m_task = nullptr;
+    }
+
+private:
+    void workerLoop(int k) {
+        uint64_t seen = 0;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_cvStart.wait(lock, [&] { return m_stopping || m_generation != seen; });
+            if (m_stopping) return;
+            seen = m_generation;
+
+            // Threads beyond n sit this run out
+            if (k >= m_nTasks) continue;
+
+            const auto * task = m_task;
+            lock.unlock();
+            (*task)(k);
+            lock.lock();
+
+            if (--m_pending == 0) m_cvDone.notify_one();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_cvStart;
+    std::condition_variable m_cvDone;
+
+    const std::function<void(int)> * m_task = nullptr;
+    int m_nTasks = 0;
+    int m_pending = 0;
+    uint64_t m_generation = 0;
+    bool m_stopping = false;
+
+    std::vector<std::thread> m_threads;
+};
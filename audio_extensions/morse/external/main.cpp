@@ -1,46 +1,14 @@
 #include "CwDecoder.h"
+#include "DecoderServer.h"
+#include "JsonEvents.h"
+#include "Skimmer.h"
 
 #include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <string>
 #include <thread>
-
-// JSON output format (one object per line):
-//
-//   decode event:
-//     {"type":"decode","text":"CQ CQ DE W1AW","cost":0.12,"pitch":600,"speed":20}
-//
-//   stats update (pitch/speed changed without new text):
-//     {"type":"stats","pitch":600,"speed":20}
-//
-// cost thresholds match AetherSDR's colour scheme:
-//   < 0.15  -> "high"   (#00ff88 green)
-//   < 0.35  -> "medium" (#e0e040 yellow)
-//   < 0.60  -> "low"    (#ff9020 orange)
-//   >= 0.60 -> "poor"   (filtered in AetherSDR by default)
-
-static const char* confidenceLabel(float cost)
-{
-    if (cost < 0.15f) return "high";
-    if (cost < 0.35f) return "medium";
-    if (cost < 0.60f) return "low";
-    return "poor";
-}
-
-// Minimal JSON string escape (printable ASCII only from ggmorse output).
-static std::string jsonEscape(const std::string& s)
-{
-    std::string out;
-    out.reserve(s.size());
-    for (unsigned char c : s) {
-        if (c == '"')       out += "\\\"";
-        else if (c == '\\') out += "\\\\";
-        else if (c < 0x20)  out += ' ';
-        else                out += static_cast<char>(c);
-    }
-    return out;
-}
+#include <vector>
 
 static void printUsage(const char* prog)
 {
@@ -56,6 +24,16 @@ static void printUsage(const char* prog)
         "  --sample-rate HZ  Input PCM sample rate in Hz (default: 12000)\n"
         "  --pitch HZ        Lock pitch to HZ (default: auto-detect)\n"
         "  --speed WPM       Lock speed to WPM (default: auto-detect)\n"
+        "  --server          Serve many sessions over framed stdin (see DecoderServer.h)\n"
+        "  --workers N       Decoder threads in --server mode (default: CPU count)\n"
+        "  --analysis-threads N  Threads for each frame's speed search (default: 1)\n"
+        "  --skimmer         Decode every CW signal in the passband (see README)\n"
+        "  --iq              Skimmer input is interleaved I/Q int16 centred on 0 Hz\n"
+        "  --center HZ       Skimmer: add HZ to reported frequencies (default: 0)\n"
+        "  --min-hz HZ       Skimmer: lowest carrier offset searched\n"
+        "  --max-hz HZ       Skimmer: highest carrier offset searched\n"
+        "  --max-signals N   Skimmer: channels decoded at once (default: 32)\n"
+        "  --snr DB          Skimmer: carrier detection threshold (default: 10)\n"
         "  --help            Show this message\n"
         "\n"
         "Example:\n"
@@ -68,32 +46,81 @@ int main(int argc, char** argv)
     int   sampleRate = 12000;
     float lockPitch  = 0.0f;
     float lockSpeed  = 0.0f;
+    bool  serverMode = false;
+    int   workers    = static_cast<int>(std::thread::hardware_concurrency());
+    int   analysisThreads = 1;
+    bool  skimmerMode = false;
+    Skimmer::Config skimmer;
 
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--help") == 0) { printUsage(argv[0]); return 0; }
         else if (strcmp(argv[i], "--sample-rate") == 0 && i + 1 < argc) { sampleRate = std::stoi(argv[++i]); }
         else if (strcmp(argv[i], "--pitch") == 0 && i + 1 < argc) { lockPitch = std::stof(argv[++i]); }
         else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) { lockSpeed = std::stof(argv[++i]); }
+        else if (strcmp(argv[i], "--server") == 0) { serverMode = true; }
+        else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) { workers = std::stoi(argv[++i]); }
+        else if (strcmp(argv[i], "--analysis-threads") == 0 && i + 1 < argc) { analysisThreads = std::stoi(argv[++i]); }
+        else if (strcmp(argv[i], "--skimmer") == 0) { skimmerMode = true; }
+        else if (strcmp(argv[i], "--iq") == 0) { skimmer.iq = true; }
+        else if (strcmp(argv[i], "--center") == 0 && i + 1 < argc) { skimmer.centerHz = std::stod(argv[++i]); }
+        else if (strcmp(argv[i], "--min-hz") == 0 && i + 1 < argc) { skimmer.minHz = std::stof(argv[++i]); }
+        else if (strcmp(argv[i], "--max-hz") == 0 && i + 1 < argc) { skimmer.maxHz = std::stof(argv[++i]); }
+        else if (strcmp(argv[i], "--max-signals") == 0 && i + 1 < argc) { skimmer.maxSignals = std::stoi(argv[++i]); }
+        else if (strcmp(argv[i], "--snr") == 0 && i + 1 < argc) { skimmer.snrDb = std::stof(argv[++i]); }
         else { fprintf(stderr, "Unknown option: %s\n", argv[i]); return 1; }
     }
 
+    if (serverMode) {
+        DecoderServer server(workers > 0 ? workers : 1, analysisThreads);
+        return server.run(stdin);
+    }
+
+    if (skimmerMode) {
+        if (!Skimmer::validSampleRate(sampleRate)) {
+            fprintf(stderr, "--skimmer needs a sample rate that is a multiple of %d Hz\n", Skimmer::kOutputRate);
+            return 1;
+        }
+        skimmer.sampleRate = sampleRate;
+        skimmer.workers    = workers > 0 ? workers : 1;
+
+        Skimmer sk(skimmer);
+        sk.setCallbacks(
+            [](int channel, double freqHz, const std::string& text, float cost, float snrDb, float speed) {
+                fputs(skimmerDecodeJson(channel, freqHz, text, cost, snrDb, speed).c_str(), stdout);
+                fflush(stdout);
+            },
+            [](int channel, double freqHz, float snrDb, bool up) {
+                fputs(signalEventJson(channel, freqHz, snrDb, up).c_str(), stdout);
+                fflush(stdout);
+            }
+        );
+
+        const int channels = skimmer.iq ? 2 : 1;
+        constexpr int kBufFrames = 1024;
+        std::vector<int16_t> buf(kBufFrames * channels);
+
+        while (!feof(stdin)) {
+            size_t got = fread(buf.data(), sizeof(int16_t) * channels, kBufFrames, stdin);
+            if (got > 0) {
+                sk.feed(buf.data(), static_cast<int>(got));
+            }
+        }
+        return 0;
+    }
+
     CwDecoder decoder(sampleRate);
+    decoder.setAnalysisThreads(analysisThreads);
 
     decoder.start(
         [&decoder](const std::string& text, float cost) {
-            fprintf(stdout,
-                "{\"type\":\"decode\",\"text\":\"%s\",\"cost\":%.3f,\"confidence\":\"%s\",\"pitch\":%.0f,\"speed\":%.0f}\n",
-                jsonEscape(text).c_str(),
-                cost,
-                confidenceLabel(cost),
-                decoder.estimatedPitch(),
-                decoder.estimatedSpeed());
+            const std::string line = decodeEventJson(text, cost,
+                                                     decoder.estimatedPitch(),
+                                                     decoder.estimatedSpeed());
+            fputs(line.c_str(), stdout);
             fflush(stdout);
         },
         [](CwDecoder::Stats s) {
-            fprintf(stdout,
-                "{\"type\":\"stats\",\"pitch\":%.0f,\"speed\":%.0f}\n",
-                s.pitchHz, s.speedWpm);
+            fputs(statsEventJson(s.pitchHz, s.speedWpm).c_str(), stdout);
             fflush(stdout);
         }
     );
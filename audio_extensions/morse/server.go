@@ -0,0 +1,297 @@
+package morse
+
+/*
+ * Shared cw-decoder process
+ *
+ * Every morse session on this instance is multiplexed over one
+ * `cw-decoder --server` process instead of spawning a process per listener.
+ * The binary runs all sessions' decoders on a fixed worker pool.
+ *
+ * Frames on its stdin (little-endian, the pipe is host-local):
+ *
+ *   [type:1][session:4 uint32][len:4 uint32][payload:len]
+ *
+ *   0x01  Open   [sample_rate:4 uint32][pitch:4 float32][speed:4 float32]
+ *                pitch/speed 0 = auto-detect
+ *   0x02  Audio  mono int16 PCM at the session's sample rate
+ *   0x03  Close  no payload
+ *
+ * stdout carries the usual JSON events plus a "session" field, which
+ * readLoop uses to route each event to that session's resultChan.
+ *
+ * The process is started by the first session and shut down when the last
+ * one closes. If it dies, every attached session receives a 0x12 error frame
+ * and the next Start() spawns a fresh process.
+ */
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/binary"
+	"encoding/json"
+	"fmt"
+	"io"
+	"log"
+	"math"
+	"os/exec"
+	"sync"
+	"time"
+	"unsafe"
+)
+
+// Frame type bytes on the cw-decoder --server stdin
+const (
+	frameOpen  = 0x01
+	frameAudio = 0x02
+	frameClose = 0x03
+)
+
+const frameHeaderSize = 9
+
+// decoderServer is one running cw-decoder --server process.
+type decoderServer struct {
+	cmd    *exec.Cmd
+	stdout io.ReadCloser
+
+	// writeMu serialises frames from all sessions onto stdin.
+	writeMu sync.Mutex
+	stdin   io.WriteCloser
+	hdr     [frameHeaderSize]byte
+
+	// mu guards sessions. readLoop sends on a resultChan only while holding
+	// it, so once closeSession returns nothing more is sent for that session.
+	mu       sync.Mutex
+	sessions map[uint32]chan<- []byte
+
+	refs int           // attached sessions, guarded by serverMu
+	done chan struct{} // closed when readLoop exits
+}
+
+var (
+	serverMu      sync.Mutex
+	sharedServer  *decoderServer
+	nextSessionID uint32 // guarded by serverMu
+)
+
+// acquireServer returns the shared decoder process, starting it if needed,
+// together with a fresh session ID. Pair with releaseServer.
+func acquireServer() (*decoderServer, uint32, error) {
+	serverMu.Lock()
+	defer serverMu.Unlock()
+
+	if sharedServer != nil {
+		select {
+		case <-sharedServer.done:
+			// Process died; the sessions still attached hold their own
+			// reference and release it as they stop.
+			sharedServer = nil
+		default:
+		}
+	}
+
+	if sharedServer == nil {
+		s, err := startDecoderServer()
+		if err != nil {
+			return nil, 0, err
+		}
+		sharedServer = s
+	}
+
+	nextSessionID++
+	sharedServer.refs++
+	return sharedServer, nextSessionID, nil
+}
+
+// releaseServer drops a session's reference and shuts the process down once
+// no session is using it.
+func releaseServer(s *decoderServer) {
+	serverMu.Lock()
+	s.refs--
+	last := s.refs == 0
+	if last && sharedServer == s {
+		sharedServer = nil
+	}
+	serverMu.Unlock()
+
+	if last {
+		s.shutdown()
+	}
+}
+
+func startDecoderServer() (*decoderServer, error) {
+	cmd := exec.Command(cwDecoderBinary, "--server")
+	cmd.Stderr = io.Discard // suppress cw-decoder stderr (ggmorse character trace)
+
+	stdin, err := cmd.StdinPipe()
+	if err != nil {
+		return nil, fmt.Errorf("failed to create stdin pipe: %w", err)
+	}
+	stdout, err := cmd.StdoutPipe()
+	if err != nil {
+		return nil, fmt.Errorf("failed to create stdout pipe: %w", err)
+	}
+
+	if err := cmd.Start(); err != nil {
+		return nil, fmt.Errorf("failed to start cw-decoder: %w", err)
+	}
+
+	s := &decoderServer{
+		cmd:      cmd,
+		stdin:    stdin,
+		stdout:   stdout,
+		sessions: make(map[uint32]chan<- []byte),
+		done:     make(chan struct{}),
+	}
+	go s.readLoop()
+
+	log.Printf("[Morse pid=%d] Started shared cw-decoder server", cmd.Process.Pid)
+	return s, nil
+}
+
+// shutdown closes stdin so the process exits, killing it if it has not done
+// so within stopTimeout, and reaps it.
+func (s *decoderServer) shutdown() {
+	// Not under writeMu: a writer detached by a timed-out Stop() may still
+	// hold it, blocked in Write. Closing the pipe fails that write.
+	_ = s.stdin.Close()
+
+	select {
+	case <-s.done:
+	case <-time.After(stopTimeout):
+		log.Printf("[Morse] cw-decoder server did not exit within %s — killing", stopTimeout)
+		s.kill()
+		<-s.done
+	}
+	_ = s.cmd.Wait() // reap zombie
+
+	log.Printf("[Morse] cw-decoder server stopped")
+}
+
+func (s *decoderServer) kill() {
+	if s.cmd.Process != nil {
+		_ = s.cmd.Process.Kill()
+	}
+}
+
+// writeFrame sends one frame. payload may be nil.
+func (s *decoderServer) writeFrame(frameType byte, session uint32, payload []byte) error {
+	s.writeMu.Lock()
+	defer s.writeMu.Unlock()
+
+	s.hdr[0] = frameType
+	binary.LittleEndian.PutUint32(s.hdr[1:5], session)
+	binary.LittleEndian.PutUint32(s.hdr[5:9], uint32(len(payload)))
+	if _, err := s.stdin.Write(s.hdr[:]); err != nil {
+		return err
+	}
+	if len(payload) > 0 {
+		if _, err := s.stdin.Write(payload); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// openSession registers resultChan for session and starts its decoder.
+func (s *decoderServer) openSession(session uint32, sampleRate int, pitchHz float64, resultChan chan<- []byte) error {
+	s.mu.Lock()
+	s.sessions[session] = resultChan
+	s.mu.Unlock()
+
+	var payload [12]byte
+	binary.LittleEndian.PutUint32(payload[0:4], uint32(sampleRate))
+	binary.LittleEndian.PutUint32(payload[4:8], math.Float32bits(float32(pitchHz)))
+	binary.LittleEndian.PutUint32(payload[8:12], math.Float32bits(0))
+
+	if err := s.writeFrame(frameOpen, session, payload[:]); err != nil {
+		s.mu.Lock()
+		delete(s.sessions, session)
+		s.mu.Unlock()
+		return fmt.Errorf("failed to open cw-decoder session: %w", err)
+	}
+	return nil
+}
+
+// writeAudio sends PCM for session. Uses a direct memory cast on LE
+// platforms (x86/ARM) to avoid the reflection overhead of binary.Write.
+func (s *decoderServer) writeAudio(session uint32, pcm []int16) error {
+	byteSlice := unsafe.Slice((*byte)(unsafe.Pointer(&pcm[0])), len(pcm)*2)
+	return s.writeFrame(frameAudio, session, byteSlice)
+}
+
+// detachSession stops event delivery for session without telling the
+// process; no event is delivered for it afterwards.
+func (s *decoderServer) detachSession(session uint32) {
+	s.mu.Lock()
+	delete(s.sessions, session)
+	s.mu.Unlock()
+}
+
+// closeSession detaches session and closes its decoder in the process.
+func (s *decoderServer) closeSession(session uint32) {
+	s.detachSession(session)
+
+	_ = s.writeFrame(frameClose, session, nil) // fails harmlessly if the process is gone
+}
+
+// readLoop reads newline-delimited JSON from the process stdout and routes
+// each event, as a binary frame, to the resultChan of the session it names.
+// If the process exits while sessions are still attached, each of them gets
+// a 0x12 error frame so the frontend can display a meaningful message.
+func (s *decoderServer) readLoop() {
+	defer close(s.done)
+
+	scanner := bufio.NewScanner(s.stdout)
+	for scanner.Scan() {
+		line := scanner.Bytes()
+
+		// ggmorse writes decoded characters directly to stdout before our JSON
+		// callback fires (e.g. "E HA{...}"). Strip everything before the first '{'.
+		if idx := bytes.IndexByte(line, '{'); idx > 0 {
+			line = line[idx:]
+		}
+
+		var ev cwEvent
+		if err := json.Unmarshal(line, &ev); err != nil {
+			log.Printf("[Morse] JSON parse error: %v (line: %s)", err, line)
+			continue
+		}
+
+		var msg []byte
+		switch ev.Type {
+		case "decode":
+			msg = encodeDecodeMsg(ev)
+		case "stats":
+			msg = encodeStatsMsg(ev)
+		default:
+			log.Printf("[Morse] unknown event type: %q", ev.Type)
+			continue
+		}
+
+		s.mu.Lock()
+		if resultChan, ok := s.sessions[ev.Session]; ok {
+			select {
+			case resultChan <- msg:
+			default:
+				// resultChan full — drop this frame rather than block
+			}
+		}
+		s.mu.Unlock()
+	}
+
+	if err := scanner.Err(); err != nil {
+		log.Printf("[Morse] stdout read error: %v", err)
+	}
+
+	s.mu.Lock()
+	if len(s.sessions) > 0 {
+		log.Printf("[Morse] cw-decoder server exited unexpectedly (%d sessions)", len(s.sessions))
+		for _, resultChan := range s.sessions {
+			select {
+			case resultChan <- encodeErrorMsg("cw-decoder subprocess exited unexpectedly"):
+			default:
+			}
+		}
+	}
+	s.mu.Unlock()
+}
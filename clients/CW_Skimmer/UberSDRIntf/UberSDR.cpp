@@ -11,6 +11,7 @@
 #include <ws2tcpip.h>
 #include <rpc.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -24,6 +25,9 @@
 // For zstd decompression
 #include <zstd.h>
 
+// Size limit for a debug_capture file
+#define CAPTURE_MAX_BYTES (64 * 1024 * 1024)
+
 namespace UberSDRIntf
 {
     ///////////////////////////////////////////////////////////////////////////////
@@ -35,6 +39,7 @@ namespace UberSDRIntf
         configPort = 8080;
         configFromFilename = false;
         debugRec = false;  // Disable WAV recording by default
+        debugCapture = false;
         useSSL = false;
         maxReceivers = 8;
         activeReceivers = 0;
@@ -42,6 +47,22 @@ namespace UberSDRIntf
         iqMode = "iq192";
         frequencyOffset = 0;  // Default to no frequency correction
         swapIQ = true;  // Default to true for backward compatibility
+        ringBufferMs = 2000;
+        adaptiveRate = false;  // Default to fixed-rate consumption
+        for (int i = 0; i < MAX_RX_COUNT; i++) {
+            targetDepthMs[i] = 200;
+        }
+        startTuneWaitMs = 250;
+        fastResume = true;
+        mmcss = true;
+        consumerAffinity = 0;
+        networkAffinity = 0;
+        timerResolutionMs = 1;
+        InitializeCriticalSection(&httpLock);
+        reconnectWorker = NULL;
+        reconnectEvent = NULL;
+        reconnectStop = false;
+        InitializeCriticalSection(&reconnectLock);
         
         // Initialize WinSock
         wsaInitialized = false;
@@ -99,6 +120,17 @@ namespace UberSDRIntf
             
             write_text_to_log_file("WebSocket clients cleaned up");
             
+            // Free per-receiver zstd contexts (callback threads are gone by now)
+            for (int i = 0; i < MAX_RX_COUNT; i++)
+            {
+                if (receivers[i].zstdDCtx != nullptr) {
+                    ZSTD_freeDCtx(receivers[i].zstdDCtx);
+                    receivers[i].zstdDCtx = nullptr;
+                }
+            }
+            
+            HttpCloseIdle();
+            
             if (wsaInitialized) {
                 WSACleanup();
             }
@@ -111,6 +143,8 @@ namespace UberSDRIntf
         catch (...) {
             // Silent catch - destructor must not throw
         }
+        DeleteCriticalSection(&httpLock);
+        DeleteCriticalSection(&reconnectLock);
     }
     
     ///////////////////////////////////////////////////////////////////////////////
@@ -167,6 +201,37 @@ namespace UberSDRIntf
         int debugRecInt = GetPrivateProfileIntA("Server", "debug_rec", 0, iniPath);
         debugRec = (debugRecInt != 0);
         
+        // Read debug_capture from INI file (0 = false, non-zero = true)
+        int debugCaptureInt = GetPrivateProfileIntA("Server", "debug_capture", 0, iniPath);
+        debugCapture = (debugCaptureInt != 0);
+        
+        // Read StartTuneWaitMs: how long StartRx lets each receiver wait for
+        // its first SetRxFrequency before connecting on the default frequency
+        startTuneWaitMs = GetPrivateProfileIntA("Server", "StartTuneWaitMs", 250, iniPath);
+        if (startTuneWaitMs < 0) startTuneWaitMs = 0;
+        if (startTuneWaitMs > 5000) startTuneWaitMs = 5000;
+        
+        // Read FastResume (default: 1): reconnect a dropped receiver at once,
+        // keeping its session ID and WebSocket object
+        int fastResumeInt = GetPrivateProfileIntA("Server", "FastResume", 1, iniPath);
+        fastResume = (fastResumeInt != 0);
+        
+        // Read thread scheduling: MMCSS for the ring buffer consumer, core
+        // masks (decimal or 0x hex, 0 = any core) to keep the network threads
+        // off the consumer's cores, and the timer resolution fallback
+        int mmcssInt = GetPrivateProfileIntA("Scheduling", "MMCSS", 1, iniPath);
+        mmcss = (mmcssInt != 0);
+        
+        char mask[64];
+        GetPrivateProfileStringA("Scheduling", "ConsumerAffinity", "0", mask, sizeof(mask), iniPath);
+        consumerAffinity = (DWORD_PTR)strtoull(mask, NULL, 0);
+        GetPrivateProfileStringA("Scheduling", "NetworkAffinity", "0", mask, sizeof(mask), iniPath);
+        networkAffinity = (DWORD_PTR)strtoull(mask, NULL, 0);
+        
+        timerResolutionMs = GetPrivateProfileIntA("Scheduling", "TimerResolutionMs", 1, iniPath);
+        if (timerResolutionMs < 0) timerResolutionMs = 0;
+        if (timerResolutionMs > 15) timerResolutionMs = 15;
+        
         // Read frequency offset from INI file (can be positive or negative)
         frequencyOffset = GetPrivateProfileIntA("Calibration", "FrequencyOffset", 0, iniPath);
         
@@ -174,6 +239,25 @@ namespace UberSDRIntf
         int swapIQInt = GetPrivateProfileIntA("Calibration", "swap_iq", 1, iniPath);
         swapIQ = (swapIQInt != 0);
         
+        // Read ring buffer settings: capacity, adaptive rate and target depth
+        // (TargetDepthMs for all receivers, TargetDepthMs0..7 per receiver)
+        ringBufferMs = GetPrivateProfileIntA("Buffer", "RingBufferMs", 2000, iniPath);
+        if (ringBufferMs < 100) ringBufferMs = 100;
+        if (ringBufferMs > 10000) ringBufferMs = 10000;
+        
+        int adaptiveRateInt = GetPrivateProfileIntA("Buffer", "AdaptiveRate", 0, iniPath);
+        adaptiveRate = (adaptiveRateInt != 0);
+        
+        int targetDepthAll = GetPrivateProfileIntA("Buffer", "TargetDepthMs", 200, iniPath);
+        for (int i = 0; i < MAX_RX_COUNT; i++) {
+            char key[32];
+            sprintf_s(key, sizeof(key), "TargetDepthMs%d", i);
+            int depth = GetPrivateProfileIntA("Buffer", key, targetDepthAll, iniPath);
+            if (depth < 20) depth = 20;
+            if (depth > 5000) depth = 5000;
+            targetDepthMs[i] = depth;
+        }
+        
         // Validate and apply configuration
         if (isValidHostname(host) && isValidPort(port)) {
             configHost = host;
@@ -182,8 +266,23 @@ namespace UberSDRIntf
             ss.str("");
             ss << "Configuration loaded from INI: " << configHost << ":" << configPort
                << ", debug_rec=" << (debugRec ? "true" : "false")
+               << ", debug_capture=" << (debugCapture ? "true" : "false")
+               << ", StartTuneWaitMs=" << startTuneWaitMs
+               << ", FastResume=" << (fastResume ? "true" : "false")
+               << ", MMCSS=" << (mmcss ? "true" : "false")
+               << ", ConsumerAffinity=0x" << std::hex << consumerAffinity
+               << ", NetworkAffinity=0x" << networkAffinity << std::dec
+               << ", TimerResolutionMs=" << timerResolutionMs
                << ", frequencyOffset=" << frequencyOffset << " Hz"
-               << ", swap_iq=" << (swapIQ ? "true" : "false");
+               << ", swap_iq=" << (swapIQ ? "true" : "false")
+               << ", RingBufferMs=" << ringBufferMs
+               << ", AdaptiveRate=" << (adaptiveRate ? "true" : "false");
+            if (adaptiveRate) {
+                ss << ", TargetDepthMs=";
+                for (int i = 0; i < MAX_RX_COUNT; i++) {
+                    ss << (i ? "/" : "") << targetDepthMs[i];
+                }
+            }
             write_text_to_log_file(ss.str());
             return 0;
         } else {
@@ -284,6 +383,7 @@ namespace UberSDRIntf
             }
         }
         
+        StopReconnectWorker();
         return 0;
     }
     
@@ -344,12 +444,85 @@ namespace UberSDRIntf
     }
     
     ///////////////////////////////////////////////////////////////////////////////
-    // HTTP POST request
+    // HTTP POST request. Connections are kept alive and reused: every receiver
+    // start and reconnect posts to /connection, and with parallel startup only
+    // the first requests of a burst pay for a TCP connect.
     bool UberSDR::HttpPost(const std::string& path, const std::string& body, std::string& response)
+    {
+        // Build HTTP request
+        std::stringstream request;
+        request << "POST " << path << " HTTP/1.1\r\n";
+        request << "Host: " << serverHost << ":" << serverPort << "\r\n";
+        request << "Content-Type: application/json\r\n";
+        request << "User-Agent: UberSDR Client 1.0 (dll)\r\n";
+        request << "Content-Length: " << body.length() << "\r\n";
+        request << "Connection: keep-alive\r\n";
+        request << "\r\n";
+        request << body;
+        
+        std::string reqStr = request.str();
+        
+        // An idle connection may have been closed by the server since it was
+        // last used; drop it and try the next, then a fresh one
+        for (;;) {
+            SOCKET sock = INVALID_SOCKET;
+            EnterCriticalSection(&httpLock);
+            if (!httpIdle.empty()) {
+                sock = httpIdle.back();
+                httpIdle.pop_back();
+            }
+            LeaveCriticalSection(&httpLock);
+            
+            bool pooled = (sock != INVALID_SOCKET);
+            if (!pooled) {
+                sock = HttpOpen();
+                if (sock == INVALID_SOCKET) {
+                    return false;
+                }
+            }
+            
+            bool keepAlive = false;
+            if (HttpExchange(sock, reqStr, response, keepAlive)) {
+                if (keepAlive) {
+                    EnterCriticalSection(&httpLock);
+                    if (httpIdle.size() < MAX_RX_COUNT) {
+                        httpIdle.push_back(sock);
+                        sock = INVALID_SOCKET;
+                    }
+                    LeaveCriticalSection(&httpLock);
+                }
+                if (sock != INVALID_SOCKET) {
+                    closesocket(sock);
+                }
+                return true;
+            }
+            
+            closesocket(sock);
+            if (!pooled) {
+                return false;
+            }
+        }
+    }
+    
+    ///////////////////////////////////////////////////////////////////////////////
+    // Close the idle keep-alive connections
+    void UberSDR::HttpCloseIdle(void)
+    {
+        EnterCriticalSection(&httpLock);
+        for (size_t i = 0; i < httpIdle.size(); i++) {
+            closesocket(httpIdle[i]);
+        }
+        httpIdle.clear();
+        LeaveCriticalSection(&httpLock);
+    }
+    
+    ///////////////////////////////////////////////////////////////////////////////
+    // Open a new connection to the server's HTTP API
+    SOCKET UberSDR::HttpOpen(void)
     {
         SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
         if (sock == INVALID_SOCKET) {
-            return false;
+            return INVALID_SOCKET;
         }
         
         // Resolve server address
@@ -364,49 +537,78 @@ namespace UberSDRIntf
         
         if (getaddrinfo(serverHost.c_str(), portStr, &hints, &result) != 0) {
             closesocket(sock);
-            return false;
+            return INVALID_SOCKET;
         }
         
         // Connect
         if (connect(sock, result->ai_addr, (int)result->ai_addrlen) == SOCKET_ERROR) {
             freeaddrinfo(result);
             closesocket(sock);
-            return false;
+            return INVALID_SOCKET;
         }
         
         freeaddrinfo(result);
         
-        // Build HTTP request
-        std::stringstream request;
-        request << "POST " << path << " HTTP/1.1\r\n";
-        request << "Host: " << serverHost << ":" << serverPort << "\r\n";
-        request << "Content-Type: application/json\r\n";
-        request << "User-Agent: UberSDR Client 1.0 (dll)\r\n";
-        request << "Content-Length: " << body.length() << "\r\n";
-        request << "Connection: close\r\n";
-        request << "\r\n";
-        request << body;
+        // A request on a kept-alive connection must not hang forever
+        DWORD timeoutMs = 5000;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutMs, sizeof(timeoutMs));
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeoutMs, sizeof(timeoutMs));
         
-        std::string reqStr = request.str();
+        BOOL noDelay = TRUE;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
         
-        // Send request
-        if (send(sock, reqStr.c_str(), (int)reqStr.length(), 0) == SOCKET_ERROR) {
-            closesocket(sock);
+        return sock;
+    }
+    
+    ///////////////////////////////////////////////////////////////////////////////
+    // Send one request and read its response (headers and body) on sock.
+    // keepAlive is set if the connection can carry another request: the server
+    // did not ask to close it and the body length was known.
+    bool UberSDR::HttpExchange(SOCKET sock, const std::string& request, std::string& response, bool& keepAlive)
+    {
+        keepAlive = false;
+        response.clear();
+        
+        if (send(sock, request.c_str(), (int)request.length(), 0) == SOCKET_ERROR) {
             return false;
         }
         
-        // Receive response
         char buffer[4096];
         int bytesReceived;
-        response.clear();
+        size_t headerEnd = std::string::npos;
+        long long contentLength = -1;
+        bool closeRequested = false;
         
-        while ((bytesReceived = recv(sock, buffer, sizeof(buffer) - 1, 0)) > 0) {
-            buffer[bytesReceived] = '\0';
-            response += buffer;
+        while ((bytesReceived = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
+            response.append(buffer, bytesReceived);
+            
+            if (headerEnd == std::string::npos) {
+                headerEnd = response.find("\r\n\r\n");
+                if (headerEnd == std::string::npos) {
+                    continue;
+                }
+                headerEnd += 4;
+                
+                std::string headers = response.substr(0, headerEnd);
+                std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+                size_t pos = headers.find("\r\ncontent-length:");
+                if (pos != std::string::npos) {
+                    contentLength = _atoi64(headers.c_str() + pos + 17);
+                }
+                closeRequested = headers.find("\r\nconnection: close") != std::string::npos ||
+                                 headers.compare(0, 8, "http/1.0") == 0;
+            }
+            
+            if (contentLength >= 0 && response.size() >= headerEnd + (size_t)contentLength) {
+                keepAlive = !closeRequested;
+                return true;
+            }
         }
         
-        closesocket(sock);
-        return true;
+        // Closed by the server (or timed out): a complete response without a
+        // length is still a response, a connection that died before any
+        // reply is a failure
+        return bytesReceived == 0 && !response.empty();
     }
     
     ///////////////////////////////////////////////////////////////////////////////
@@ -476,16 +678,54 @@ namespace UberSDRIntf
         ss << "Starting receiver " << receiverID << " at " << frequency << " Hz, mode " << mode;
         write_text_to_log_file(ss.str());
         
-        // Initialize ring buffer (2000ms at current sample rate for better jitter absorption)
-        size_t bufferCapacity = (sampleRate * 2000) / 1000;  // 2000ms worth of samples
+        // Initialize ring buffer (RingBufferMs at current sample rate, default
+        // 2000ms for jitter absorption). In adaptive mode the consumer holds it
+        // at the target depth, so it only needs room above that for bursts.
+        int capacityMs = ringBufferMs;
+        size_t targetDepth = 0;
+        if (adaptiveRate) {
+            if (capacityMs < 2 * targetDepthMs[receiverID]) {
+                capacityMs = 2 * targetDepthMs[receiverID];
+            }
+            targetDepth = ((size_t)sampleRate * targetDepthMs[receiverID]) / 1000;
+        }
+        size_t bufferCapacity = ((size_t)sampleRate * capacityMs) / 1000;
         receivers[receiverID].ringBuffer.init(bufferCapacity);
+        receivers[receiverID].targetDepth = targetDepth;
         
         ss.str("");
         ss << "Initialized ring buffer for receiver " << receiverID
            << ": " << bufferCapacity << " samples ("
            << (bufferCapacity * 8 / 1024) << " KB)";
+        if (targetDepth > 0) {
+            ss << ", adaptive rate, target depth " << targetDepthMs[receiverID] << " ms";
+        }
         write_text_to_log_file(ss.str());
         
+        // Frame capture for offline replay (see replay_bench.cpp)
+        if (debugCapture && receivers[receiverID].captureFile == NULL) {
+            char filename[64];
+            sprintf_s(filename, sizeof(filename), "capture_rx%d.bin", receiverID);
+            if (fopen_s(&receivers[receiverID].captureFile, filename, "wb") == 0) {
+                receivers[receiverID].captureBytes = 0;
+                write_text_to_log_file(std::string("Capturing frames to ") + filename);
+            } else {
+                receivers[receiverID].captureFile = NULL;
+            }
+        }
+        
+#ifdef UBERSDR_REPLAY
+        // Replay build (replay_bench): no server - frames are fed straight into
+        // HandleWebSocketMessage by the benchmark
+        receivers[receiverID].frequency = frequency;
+        receivers[receiverID].mode = mode;
+        receivers[receiverID].sessionId = "replay";
+        receivers[receiverID].active = true;
+        receivers[receiverID].state = CONNECTED;
+        InterlockedIncrement(&activeReceivers);
+        return 0;
+#endif
+        
         // Check if connection is allowed (HTTP POST to /connection)
         if (!CheckConnectionAllowed(receiverID)) {
             std::stringstream ss;
@@ -493,6 +733,7 @@ namespace UberSDRIntf
             write_text_to_log_file(ss.str());
             receivers[receiverID].active = false;
             receivers[receiverID].state = ERROR_STATE;
+            CloseCapture(receiverID);
             return 1;
         }
         
@@ -512,17 +753,32 @@ namespace UberSDRIntf
         int result = ConnectWebSocket(receiverID, url);
         if (result == 0) {
             receivers[receiverID].state = CONNECTED;
-            activeReceivers++;
+            InterlockedIncrement(&activeReceivers);
             write_text_to_log_file("Receiver " + std::to_string(receiverID) + " connected");
         } else {
             receivers[receiverID].state = ERROR_STATE;
             receivers[receiverID].active = false;
+            // A handshake that timed out may still complete and deliver
+            // frames: stop the socket before closing the capture it writes
+            DisconnectWebSocket(receiverID);
+            CloseCapture(receiverID);
             write_text_to_log_file("Failed to connect receiver " + std::to_string(receiverID));
         }
         
         return result;
     }
     
+    ///////////////////////////////////////////////////////////////////////////////
+    // Close a receiver's debug_capture file, if open. Only once its WebSocket
+    // thread is stopped (or never started), since that thread writes to it.
+    void UberSDR::CloseCapture(int receiverID)
+    {
+        if (receivers[receiverID].captureFile != NULL) {
+            fclose(receivers[receiverID].captureFile);
+            receivers[receiverID].captureFile = NULL;
+        }
+    }
+    
     ///////////////////////////////////////////////////////////////////////////////
     // Stop receiver
     int UberSDR::StopReceiver(int receiverID)
@@ -549,24 +805,26 @@ namespace UberSDRIntf
             receivers[receiverID].active = false;
             receivers[receiverID].needsReconnect = false;
             receivers[receiverID].state = DISCONNECTED;
-            HANDLE threadHandle = receivers[receiverID].reconnectThread;
+            bool reconnecting = receivers[receiverID].reconnecting;
             LeaveCriticalSection(&receivers[receiverID].lock);
             
-            // Wait for reconnection thread to exit if it's running
-            if (threadHandle != NULL) {
-                write_text_to_log_file("Waiting for reconnection thread to exit...");
-                WaitForSingleObject(threadHandle, 5000);  // Wait up to 5 seconds
-                CloseHandle(threadHandle);
-                
-                EnterCriticalSection(&receivers[receiverID].lock);
-                receivers[receiverID].reconnectThread = NULL;
-                LeaveCriticalSection(&receivers[receiverID].lock);
+            // Let the reconnect worker finish with wsClient if it is mid-attempt.
+            // No timeout: tearing the socket down under the worker is worse
+            // than waiting, and an attempt is bounded anyway (the connection
+            // check's HTTP timeout plus the 5 s handshake wait). active is
+            // false now, so the worker starts no further attempt for it.
+            if (reconnecting) {
+                write_text_to_log_file("Waiting for reconnect attempt to finish...");
+                WaitForSingleObject(receivers[receiverID].reconnectIdle, INFINITE);
             }
             
             DisconnectWebSocket(receiverID);
             
-            if (activeReceivers > 0) {
-                activeReceivers--;
+            // The WebSocket thread is gone - safe to close the capture
+            CloseCapture(receiverID);
+            
+            if (InterlockedDecrement(&activeReceivers) < 0) {
+                InterlockedIncrement(&activeReceivers);
             }
             
             write_text_to_log_file("Receiver stopped successfully");
@@ -681,141 +939,266 @@ namespace UberSDRIntf
     }
     
     ///////////////////////////////////////////////////////////////////////////////
-    // Reconnection thread entry point
-    DWORD WINAPI UberSDR::ReconnectionThreadProc(LPVOID param)
+    // Queue a dropped receiver for the reconnect worker (WebSocket close
+    // callback; needsReconnect and the retry schedule are already set)
+    void UberSDR::RequestReconnect(int receiverID)
     {
-        struct ThreadParam {
-            UberSDR* instance;
-            int receiverID;
-        };
+        EnterCriticalSection(&reconnectLock);
+        if (reconnectWorker == NULL) {
+            reconnectStop = false;
+            if (reconnectEvent == NULL) {
+                reconnectEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+            }
+            reconnectWorker = CreateThread(NULL, 0, ReconnectWorkerProc, this, 0, NULL);
+            if (reconnectWorker == NULL) {
+                write_text_to_log_file("Failed to create reconnect worker");
+            }
+        }
+        if (reconnectEvent != NULL) {
+            SetEvent(reconnectEvent);
+        }
+        LeaveCriticalSection(&reconnectLock);
         
-        ThreadParam* tp = (ThreadParam*)param;
-        UberSDR* instance = tp->instance;
-        int receiverID = tp->receiverID;
-        delete tp;
+        std::stringstream ss;
+        ss << "Receiver " << receiverID << " queued for reconnection";
+        write_text_to_log_file(ss.str());
+    }
+    
+    ///////////////////////////////////////////////////////////////////////////////
+    // Stop the reconnect worker (receivers are stopped first)
+    void UberSDR::StopReconnectWorker(void)
+    {
+        EnterCriticalSection(&reconnectLock);
+        HANDLE worker = reconnectWorker;
+        reconnectWorker = NULL;
+        reconnectStop = true;
+        if (reconnectEvent != NULL) {
+            SetEvent(reconnectEvent);
+        }
+        LeaveCriticalSection(&reconnectLock);
         
-        instance->HandleReconnection(receiverID);
+        if (worker != NULL) {
+            WaitForSingleObject(worker, 10000);
+            CloseHandle(worker);
+        }
+    }
+    
+    ///////////////////////////////////////////////////////////////////////////////
+    // Reconnect worker entry point
+    DWORD WINAPI UberSDR::ReconnectWorkerProc(LPVOID param)
+    {
+        UberSDR* instance = (UberSDR*)param;
+        instance->HandleReconnection();
         return 0;
     }
     
     ///////////////////////////////////////////////////////////////////////////////
-    // Handle reconnection in dedicated thread
-    void UberSDR::HandleReconnection(int receiverID)
+    // Pin the calling network thread to NetworkAffinity, once per thread.
+    // Called from the IXWebSocket callbacks (IXWebSocket starts its own
+    // thread per connection), the startup threads and the reconnect worker.
+    void UberSDR::ApplyNetworkAffinity(void)
     {
-        std::stringstream ss;
-        ss << "Reconnection thread started for receiver " << receiverID;
-        write_text_to_log_file(ss.str());
+        static thread_local bool applied = false;
+        if (applied || networkAffinity == 0) {
+            return;
+        }
+        applied = true;
+        
+        if (SetThreadAffinityMask(GetCurrentThread(), networkAffinity) == 0) {
+            std::stringstream ss;
+            ss << "Failed to set network thread affinity 0x" << std::hex << networkAffinity
+               << std::dec << " (error " << GetLastError() << ")";
+            write_text_to_log_file(ss.str());
+        }
+    }
+    
+    ///////////////////////////////////////////////////////////////////////////////
+    // Reconnect worker: one thread for all receivers. Each pass starts every
+    // receiver whose retry is due, then waits for their handshakes together,
+    // so receivers dropped by the same network blip resume in parallel.
+    // Retries back off exponentially per receiver, capped at 60 seconds.
+    void UberSDR::HandleReconnection(void)
+    {
+        const int maxDelay = 60000;
+        write_text_to_log_file("Reconnect worker started");
+        ApplyNetworkAffinity();
+        
+        while (!reconnectStop) {
+            ULONGLONG now = GetTickCount64();
+            ULONGLONG nextDue = 0;
+            bool started[MAX_RX_COUNT] = { false };
+            bool any = false;
+        
+            for (int i = 0; i < MAX_RX_COUNT && !reconnectStop; i++) {
+                EnterCriticalSection(&receivers[i].lock);
+                bool pending = receivers[i].needsReconnect;
+                if (pending && !receivers[i].active) {
+                    receivers[i].needsReconnect = false;  // Stopped meanwhile
+                    pending = false;
+                }
+                bool due = pending && now >= receivers[i].nextRetryMs;
+                if (pending && !due && (nextDue == 0 || receivers[i].nextRetryMs < nextDue)) {
+                    nextDue = receivers[i].nextRetryMs;
+                }
+                if (due) {
+                    receivers[i].reconnecting = true;
+                    ResetEvent(receivers[i].reconnectIdle);
+                    receivers[i].reconnectAttempts++;
+                }
+                LeaveCriticalSection(&receivers[i].lock);
         
-        // Retry forever with exponential backoff capped at 60 seconds
-        int retryDelay = 1000; // Start with 1 second
-        const int maxDelay = 60000; // Cap at 60 seconds
-        bool reconnected = false;
-        int attempt = 0;
+                if (!due) {
+                    continue;
+                }
         
-        while (!reconnected) {
-            attempt++;
-            
-            // Check if still active (might have been stopped)
-            EnterCriticalSection(&receivers[receiverID].lock);
-            bool stillActive = receivers[receiverID].active;
-            bool stillNeedsReconnect = receivers[receiverID].needsReconnect;
-            LeaveCriticalSection(&receivers[receiverID].lock);
-            
-            if (!stillActive || !stillNeedsReconnect) {
-                ss.str("");
-                ss << "Receiver " << receiverID << " no longer needs reconnection, thread exiting";
-                write_text_to_log_file(ss.str());
-                
-                EnterCriticalSection(&receivers[receiverID].lock);
-                receivers[receiverID].needsReconnect = false;
-                receivers[receiverID].reconnectThread = NULL;
-                LeaveCriticalSection(&receivers[receiverID].lock);
-                return;
+                started[i] = BeginReconnect(i);
+                any = any || started[i];
+                if (!started[i]) {
+                    // Failed before the handshake (check refused, no server)
+                    EnterCriticalSection(&receivers[i].lock);
+                    receivers[i].reconnecting = false;
+                    SetEvent(receivers[i].reconnectIdle);
+                    receivers[i].nextRetryMs = GetTickCount64() + receivers[i].retryDelayMs;
+                    receivers[i].retryDelayMs = (receivers[i].retryDelayMs * 2 > maxDelay)
+                        ? maxDelay : receivers[i].retryDelayMs * 2;
+                    if (nextDue == 0 || receivers[i].nextRetryMs < nextDue) {
+                        nextDue = receivers[i].nextRetryMs;
+                    }
+                    LeaveCriticalSection(&receivers[i].lock);
+                }
             }
-            
-            ss.str("");
-            ss << "Reconnection attempt " << attempt
-               << " for receiver " << receiverID << " (waiting " << (retryDelay/1000) << "s)";
-            write_text_to_log_file(ss.str());
-            
-            Sleep(retryDelay);
-            
-            // Do HTTP connection check before reconnecting
-            if (!CheckConnectionAllowed(receiverID)) {
-                ss.str("");
-                ss << "Connection check failed for receiver " << receiverID
-                   << " on attempt " << attempt << ", will retry";
-                write_text_to_log_file(ss.str());
-                
-                // Double the delay for next attempt (exponential backoff), cap at 60s
-                retryDelay = (retryDelay * 2 > maxDelay) ? maxDelay : retryDelay * 2;
-                continue;
+        
+            // Wait for the handshakes started above together
+            if (any) {
+                ULONGLONG deadline = GetTickCount64() + 5000;
+                for (int i = 0; i < MAX_RX_COUNT; i++) {
+                    if (!started[i]) {
+                        continue;
+                    }
+                    ULONGLONG t = GetTickCount64();
+                    int remaining = (deadline > t) ? (int)(deadline - t) : 0;
+                    bool ok = (WaitWebSocket(i, remaining) == 0);
+        
+                    std::stringstream ss;
+                    EnterCriticalSection(&receivers[i].lock);
+                    receivers[i].reconnecting = false;
+                    SetEvent(receivers[i].reconnectIdle);
+                    int attempts = receivers[i].reconnectAttempts;
+                    if (ok) {
+                        int outageMs = (int)(GetTickCount64() - receivers[i].outageStartMs);
+                        receivers[i].needsReconnect = false;
+                        receivers[i].lastReconnectMs.store(outageMs);
+                        receivers[i].lastReconnectAttempts.store(attempts);
+                        receivers[i].reconnects.store(receivers[i].disconnects.load());
+                        ss << "Automatic reconnection successful for receiver " << i
+                           << " on attempt " << attempts << " (" << outageMs << " ms after the drop)";
+                    } else {
+                        receivers[i].nextRetryMs = GetTickCount64() + receivers[i].retryDelayMs;
+                        receivers[i].retryDelayMs = (receivers[i].retryDelayMs * 2 > maxDelay)
+                            ? maxDelay : receivers[i].retryDelayMs * 2;
+                        ss << "WebSocket connection failed for receiver " << i
+                           << " on attempt " << attempts << ", will retry";
+                    }
+                    LeaveCriticalSection(&receivers[i].lock);
+                    write_text_to_log_file(ss.str());
+                }
+                continue;  // Re-scan: another drop may have arrived meanwhile
             }
-            
-            // HTTP check succeeded - proceed with WebSocket reconnection
-            EnterCriticalSection(&receivers[receiverID].lock);
-            receivers[receiverID].generation++;
-            int currentFreq = receivers[receiverID].frequency;
-            std::string currentMode = receivers[receiverID].mode;
-            LeaveCriticalSection(&receivers[receiverID].lock);
-            
-            // Build new WebSocket URL with current frequency
-            std::string reconnectUrl = BuildWebSocketURL(receiverID, currentFreq, currentMode);
-            
+        
+            // Sleep until the next retry is due or another receiver drops
+            DWORD waitMs = INFINITE;
+            if (nextDue != 0) {
+                now = GetTickCount64();
+                waitMs = (nextDue > now) ? (DWORD)(nextDue - now) : 0;
+            }
+            WaitForSingleObject(reconnectEvent, waitMs);
+        }
+        
+        write_text_to_log_file("Reconnect worker stopped");
+    }
+    
+    ///////////////////////////////////////////////////////////////////////////////
+    // Start one reconnection attempt without waiting for the handshake.
+    // With FastResume the first attempt goes straight back to the server with
+    // the same session ID and WebSocket object; later attempts (and every
+    // attempt without FastResume) run the connection check for a new session.
+    bool UberSDR::BeginReconnect(int receiverID)
+    {
+        EnterCriticalSection(&receivers[receiverID].lock);
+        int attempt = receivers[receiverID].reconnectAttempts;
+        LeaveCriticalSection(&receivers[receiverID].lock);
+        
+        bool resume = fastResume && attempt == 1;
+        
+        std::stringstream ss;
+        ss << "Reconnection attempt " << attempt << " for receiver " << receiverID
+           << (resume ? " (fast resume)" : "");
+        write_text_to_log_file(ss.str());
+        
+        // Do HTTP connection check before reconnecting
+        if (!resume && !CheckConnectionAllowed(receiverID)) {
             ss.str("");
-            ss << "Reconnecting to: " << reconnectUrl << " (gen " << receivers[receiverID].generation << ")";
+            ss << "Connection check failed for receiver " << receiverID
+               << " on attempt " << attempt << ", will retry";
             write_text_to_log_file(ss.str());
-            
-            // Disconnect old WebSocket properly
-            EnterCriticalSection(&receivers[receiverID].lock);
-            if (receivers[receiverID].wsClient != nullptr) {
-                receivers[receiverID].wsClient->setOnMessageCallback(nullptr);
-                receivers[receiverID].wsClient->stop();
-                LeaveCriticalSection(&receivers[receiverID].lock);
-                
-                Sleep(100);
-                
-                EnterCriticalSection(&receivers[receiverID].lock);
-                delete receivers[receiverID].wsClient;
-                receivers[receiverID].wsClient = nullptr;
-                LeaveCriticalSection(&receivers[receiverID].lock);
-            } else {
-                LeaveCriticalSection(&receivers[receiverID].lock);
-            }
-            
-            // Reconnect with new WebSocket
+            return false;
+        }
+        
+        EnterCriticalSection(&receivers[receiverID].lock);
+        if (!receivers[receiverID].active) {
+            LeaveCriticalSection(&receivers[receiverID].lock);
+            return false;  // Stopped while the check ran
+        }
+        receivers[receiverID].generation++;
+        int currentFreq = receivers[receiverID].frequency;
+        std::string currentMode = receivers[receiverID].mode;
+        int generation = receivers[receiverID].generation;
+        LeaveCriticalSection(&receivers[receiverID].lock);
+        
+        // Build new WebSocket URL with current frequency
+        std::string reconnectUrl = BuildWebSocketURL(receiverID, currentFreq, currentMode);
+        
+        ss.str("");
+        ss << "Reconnecting to: " << reconnectUrl << " (gen " << generation << ")";
+        write_text_to_log_file(ss.str());
+        
+        // Without FastResume the old WebSocket is deleted and a new one created
+        if (!fastResume) {
             EnterCriticalSection(&receivers[receiverID].lock);
-            receivers[receiverID].state = CONNECTING;
+            ix::WebSocket* old = receivers[receiverID].wsClient;
+            receivers[receiverID].wsClient = nullptr;
             LeaveCriticalSection(&receivers[receiverID].lock);
-            
-            int result = ConnectWebSocket(receiverID, reconnectUrl);
-            if (result == 0) {
-                EnterCriticalSection(&receivers[receiverID].lock);
-                receivers[receiverID].state = CONNECTED;
-                receivers[receiverID].needsReconnect = false;
-                receivers[receiverID].reconnectThread = NULL;
-                LeaveCriticalSection(&receivers[receiverID].lock);
-                
-                ss.str("");
-                ss << "Automatic reconnection successful for receiver " << receiverID
-                   << " on attempt " << attempt;
-                write_text_to_log_file(ss.str());
-                reconnected = true;
-            } else {
-                ss.str("");
-                ss << "WebSocket connection failed for receiver " << receiverID
-                   << " on attempt " << attempt << ", will retry";
-                write_text_to_log_file(ss.str());
-                
-                // Double the delay for next attempt (exponential backoff), cap at 60s
-                retryDelay = (retryDelay * 2 > maxDelay) ? maxDelay : retryDelay * 2;
+        
+            if (old != nullptr) {
+                old->setOnMessageCallback(nullptr);
+                old->stop();
+                delete old;
             }
         }
+        
+        EnterCriticalSection(&receivers[receiverID].lock);
+        receivers[receiverID].state = CONNECTING;
+        LeaveCriticalSection(&receivers[receiverID].lock);
+        
+        return StartWebSocket(receiverID, reconnectUrl) == 0;
     }
-    
+        
     ///////////////////////////////////////////////////////////////////////////////
-    // Connect WebSocket using IXWebSocket
+    // Connect WebSocket using IXWebSocket and wait for it to open
     int UberSDR::ConnectWebSocket(int receiverID, const std::string& url)
+    {
+        int result = StartWebSocket(receiverID, url);
+        if (result != 0) {
+            return result;
+        }
+        return WaitWebSocket(receiverID, 5000);
+    }
+    
+    ///////////////////////////////////////////////////////////////////////////////
+    // Point the receiver's WebSocket at url and start connecting. An existing
+    // client (a dropped connection) is stopped and reused rather than
+    // recreated; the callback is installed afresh with the current generation.
+    int UberSDR::StartWebSocket(int receiverID, const std::string& url)
     {
         if (receiverID < 0 || receiverID >= MAX_RX_COUNT) {
             return 1;
@@ -826,10 +1209,17 @@ namespace UberSDRIntf
         write_text_to_log_file(ss.str());
         
         try {
-            // Create WebSocket client
-            write_text_to_log_file("Creating WebSocket client object...");
-            receivers[receiverID].wsClient = new ix::WebSocket();
-            write_text_to_log_file("WebSocket client object created");
+            if (receivers[receiverID].wsClient != nullptr) {
+                // stop() joins the client's thread, and callbacks of the old
+                // generation are ignored, so nothing stale runs after this
+                receivers[receiverID].wsClient->stop();
+                write_text_to_log_file("Reusing WebSocket client object");
+            } else {
+                // Create WebSocket client
+                write_text_to_log_file("Creating WebSocket client object...");
+                receivers[receiverID].wsClient = new ix::WebSocket();
+                write_text_to_log_file("WebSocket client object created");
+            }
         }
         catch (const std::exception& e) {
             ss.str("");
@@ -860,6 +1250,8 @@ namespace UberSDRIntf
         receivers[receiverID].wsClient->setOnMessageCallback(
             [this, receiverID, currentGeneration](const ix::WebSocketMessagePtr& msg)
             {
+                ApplyNetworkAffinity();
+                
                 // Check if this callback is still valid with lock protection
                 EnterCriticalSection(&receivers[receiverID].lock);
                 bool isStale = (receivers[receiverID].generation != currentGeneration);
@@ -908,34 +1300,18 @@ namespace UberSDRIntf
                         receivers[receiverID].generation == currentGeneration &&
                         !receivers[receiverID].needsReconnect) {
                         
-                        // Set flag and spawn reconnection thread
-                        receivers[receiverID].needsReconnect = true;
-                        LeaveCriticalSection(&receivers[receiverID].lock);
-                        
-                        write_text_to_log_file("Spawning reconnection thread...");
-                        
-                        // Create thread parameter
-                        struct ThreadParam {
-                            UberSDR* instance;
-                            int receiverID;
-                        };
-                        ThreadParam* tp = new ThreadParam;
-                        tp->instance = this;
-                        tp->receiverID = receiverID;
-                        
-                        // Spawn reconnection thread
-                        EnterCriticalSection(&receivers[receiverID].lock);
-                        receivers[receiverID].reconnectThread = CreateThread(
-                            NULL, 0, ReconnectionThreadProc, tp, 0, NULL);
+                        // Flag it and hand it to the reconnect worker; with
+                        // FastResume the first retry is immediate
+                        ReceiverInfo& rx = receivers[receiverID];
+                        rx.needsReconnect = true;
+                        rx.outageStartMs = GetTickCount64();
+                        rx.reconnectAttempts = 0;
+                        rx.nextRetryMs = rx.outageStartMs + (fastResume ? 0 : 1000);
+                        rx.retryDelayMs = fastResume ? 250 : 1000;
+                        rx.disconnects++;
                         LeaveCriticalSection(&receivers[receiverID].lock);
                         
-                        if (receivers[receiverID].reconnectThread == NULL) {
-                            write_text_to_log_file("Failed to create reconnection thread");
-                            delete tp;
-                            EnterCriticalSection(&receivers[receiverID].lock);
-                            receivers[receiverID].needsReconnect = false;
-                            LeaveCriticalSection(&receivers[receiverID].lock);
-                        }
+                        RequestReconnect(receiverID);
                     } else {
                         LeaveCriticalSection(&receivers[receiverID].lock);
                     }
@@ -976,12 +1352,18 @@ namespace UberSDRIntf
             return 1;
         }
         
-        // Wait for connection (with timeout)
-        int timeout = 5000; // 5 seconds
+        return 0;
+    }
+    
+    ///////////////////////////////////////////////////////////////////////////////
+    // Wait up to timeoutMs for a started WebSocket to open
+    int UberSDR::WaitWebSocket(int receiverID, int timeoutMs)
+    {
+        std::stringstream ss;
         int elapsed = 0;
-        while (receivers[receiverID].state == CONNECTING && elapsed < timeout) {
-            Sleep(100);
-            elapsed += 100;
+        while (receivers[receiverID].state == CONNECTING && elapsed < timeoutMs) {
+            Sleep(10);
+            elapsed += 10;
         }
         
         if (receivers[receiverID].state != CONNECTED) {
@@ -1112,6 +1494,13 @@ namespace UberSDRIntf
     // Handle WebSocket message - binary pcm-zstd format only
     void UberSDR::HandleWebSocketMessage(int receiverID, const std::string& message)
     {
+        if (receiverID < 0 || receiverID >= MAX_RX_COUNT) {
+            return;
+        }
+        
+        // Arrival time for the frame inter-arrival histogram
+        int64_t arrivalUs = GetTimeUs();
+        
         try {
             // Check minimum message size
             if (message.size() < 4) {
@@ -1122,6 +1511,20 @@ namespace UberSDRIntf
             const uint8_t* compressedData = reinterpret_cast<const uint8_t*>(message.data());
             size_t compressedSize = message.size();
             
+            // debug_capture: length-prefixed frames, up to CAPTURE_MAX_BYTES
+            ReceiverInfo& capture = receivers[receiverID];
+            if (capture.captureFile != NULL) {
+                uint32_t length = (uint32_t)compressedSize;
+                fwrite(&length, sizeof(length), 1, capture.captureFile);
+                fwrite(compressedData, 1, compressedSize, capture.captureFile);
+                capture.captureBytes += sizeof(length) + compressedSize;
+                if (capture.captureBytes >= CAPTURE_MAX_BYTES) {
+                    fclose(capture.captureFile);
+                    capture.captureFile = NULL;
+                    write_text_to_log_file("Frame capture complete for receiver " + std::to_string(receiverID));
+                }
+            }
+            
             // Track compressed bytes received for accurate network bandwidth measurement
             // This is called from ProcessIQData which tracks decompressed bytes
             extern void TrackCompressedBytes(int receiverID, size_t compressedBytes);
@@ -1153,16 +1556,33 @@ namespace UberSDRIntf
                 return;
             }
 
-            // Decompress
-            std::vector<uint8_t> decompressed(decompressedSize);
-            size_t actualSize = ZSTD_decompress(decompressed.data(), decompressedSize,
-                                               compressedData, compressedSize);
+            // Decompress into the receiver's reusable buffer with its own context
+            // (created on first use) - no allocation once the buffer has grown
+            ReceiverInfo& rx = receivers[receiverID];
+            if (rx.zstdDCtx == nullptr) {
+                rx.zstdDCtx = ZSTD_createDCtx();
+                if (rx.zstdDCtx == nullptr) {
+                    write_text_to_log_file("ZSTD_createDCtx failed");
+                    return;
+                }
+            }
+            if (rx.decodeBuffer.size() < decompressedSize) {
+                rx.decodeBuffer.resize(decompressedSize);
+            }
+            int64_t decodeStartUs = GetTimeUs();
+            size_t actualSize = ZSTD_decompressDCtx(rx.zstdDCtx,
+                                                    rx.decodeBuffer.data(), decompressedSize,
+                                                    compressedData, compressedSize);
             if (ZSTD_isError(actualSize)) {
                 std::stringstream ss;
                 ss << "Zstd decompression error: " << ZSTD_getErrorName(actualSize);
                 write_text_to_log_file(ss.str());
                 return;
             }
+            
+            // Publish frame timing to shared memory (defined in UberSDRIntf.cpp)
+            extern void TrackFrameTiming(int receiverID, int64_t arrivalUs, int64_t decodeUs);
+            TrackFrameTiming(receiverID, arrivalUs, GetTimeUs() - decodeStartUs);
 
             // Parse binary header (little-endian)
             if (actualSize < 13) {
@@ -1170,7 +1590,7 @@ namespace UberSDRIntf
                 return;
             }
 
-            const uint8_t* data = decompressed.data();
+            const uint8_t* data = rx.decodeBuffer.data();
             uint16_t headerMagic = data[0] | (data[1] << 8);
 
             size_t dataOffset;
@@ -1202,12 +1622,10 @@ namespace UberSDRIntf
                 return;
             }
 
-            // Convert to vector and process
-            std::vector<uint8_t> iqBytes(pcmData, pcmData + pcmSize);
-
             // Call the ProcessIQData function (defined in UberSDRIntf.cpp)
-            extern void ProcessIQData(int receiverID, const std::vector<uint8_t>& iqBytes);
-            ProcessIQData(receiverID, iqBytes);
+            // The PCM payload is passed in place, straight out of decodeBuffer
+            extern void ProcessIQData(int receiverID, const uint8_t* iqBytes, size_t numBytes);
+            ProcessIQData(receiverID, pcmData, pcmSize);
         }
         catch (const std::exception& e) {
             std::stringstream ss;
@@ -1233,7 +1651,7 @@ namespace UberSDRIntf
     
     ///////////////////////////////////////////////////////////////////////////////
     // Process commands from monitor (via shared memory)
-    void UberSDR::ProcessCommands(UberSDRSharedStatus* pSharedStatus)
+    void UberSDR::ProcessCommands(UberSDRSharedStatusV2* pSharedStatus)
     {
         // This function is called periodically from the DLL to check for commands
         // from the monitor application via shared memory
@@ -1242,10 +1660,12 @@ namespace UberSDRIntf
             return;  // Shared memory not initialized
         }
         
+        UberSDRCommandQueue& queue = pSharedStatus->commands.queue;
+        
         // Check if there are any pending commands
-        while (pSharedStatus->commandReadPos != pSharedStatus->commandWritePos) {
-            int readPos = pSharedStatus->commandReadPos;
-            UberSDRCommand& cmd = pSharedStatus->commandQueue[readPos % 16];
+        while (queue.commandReadPos != queue.commandWritePos) {
+            int readPos = queue.commandReadPos;
+            UberSDRCommand& cmd = queue.commandQueue[readPos % 16];
             
             // Process command based on type
             if (cmd.commandType == CMD_SET_FREQUENCY_OFFSET) {
@@ -1261,15 +1681,14 @@ namespace UberSDRIntf
                     
                     EnterCriticalSection(&receivers[rxID].lock);
                     receivers[rxID].perReceiverOffset = cmd.frequencyOffset;
-                    receivers[rxID].phaseIncrement = phaseInc;
-                    receivers[rxID].phaseAccumulator = 0.0;  // Reset phase accumulator
                     LeaveCriticalSection(&receivers[rxID].lock);
+                    receivers[rxID].phaseIncrement.store(phaseInc, std::memory_order_release);
                     
                     // Update shared memory status
-                    pSharedStatus->receivers[rxID].frequencyOffset = cmd.frequencyOffset;
-                    pSharedStatus->receivers[rxID].totalFrequencyOffset = totalOffset;
-                    pSharedStatus->receivers[rxID].requestedOffset = cmd.frequencyOffset;
-                    pSharedStatus->receivers[rxID].offsetApplied = 0;  // Not yet applied
+                    pSharedStatus->receivers[rxID].offsets.frequencyOffset = cmd.frequencyOffset;
+                    pSharedStatus->receivers[rxID].offsets.totalFrequencyOffset = totalOffset;
+                    pSharedStatus->receivers[rxID].offsets.requestedOffset = cmd.frequencyOffset;
+                    pSharedStatus->receivers[rxID].offsets.offsetApplied = 0;  // Not yet applied
                     
                     std::stringstream ss;
                     ss << "Set frequency offset for receiver " << rxID << " to " << cmd.frequencyOffset
@@ -1295,14 +1714,13 @@ namespace UberSDRIntf
                     // Set the offset and phase increment
                     EnterCriticalSection(&receivers[rxID].lock);
                     receivers[rxID].perReceiverOffset = cmd.frequencyOffset;
-                    receivers[rxID].phaseIncrement = phaseInc;
-                    receivers[rxID].phaseAccumulator = 0.0;  // Reset phase accumulator
                     LeaveCriticalSection(&receivers[rxID].lock);
+                    receivers[rxID].phaseIncrement.store(phaseInc, std::memory_order_release);
                     
                     // Update shared memory status
-                    pSharedStatus->receivers[rxID].frequencyOffset = cmd.frequencyOffset;
-                    pSharedStatus->receivers[rxID].totalFrequencyOffset = totalOffset;
-                    pSharedStatus->receivers[rxID].requestedOffset = cmd.frequencyOffset;
+                    pSharedStatus->receivers[rxID].offsets.frequencyOffset = cmd.frequencyOffset;
+                    pSharedStatus->receivers[rxID].offsets.totalFrequencyOffset = totalOffset;
+                    pSharedStatus->receivers[rxID].offsets.requestedOffset = cmd.frequencyOffset;
                     
                     std::stringstream ss;
                     ss << "CMD_APPLY_OFFSET: Rx" << rxID << " offset=" << cmd.frequencyOffset
@@ -1314,7 +1732,7 @@ namespace UberSDRIntf
                     // The IQ data will be frequency-shifted in the processing path
                     
                     // Mark as applied
-                    pSharedStatus->receivers[rxID].offsetApplied = 1;
+                    pSharedStatus->receivers[rxID].offsets.offsetApplied = 1;
                     
                     // Acknowledge command
                     cmd.acknowledged = cmd.sequenceNumber;
@@ -1322,7 +1740,7 @@ namespace UberSDRIntf
             }
             
             // Move to next command
-            pSharedStatus->commandReadPos = (readPos + 1) % 16;
+            queue.commandReadPos = (readPos + 1) % 16;
         }
     }
 }
\ No newline at end of file
@@ -2,6 +2,9 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
+#include <string.h>
+#include <stdio.h>
 #include <windows.h>
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -9,8 +12,9 @@
 // IXWebSocket library
 #include "IXWebSocket/ixwebsocket/IXWebSocket.h"
 
-// Forward declaration
-struct UberSDRSharedStatus;
+// Forward declarations
+struct UberSDRSharedStatusV2;
+typedef struct ZSTD_DCtx_s ZSTD_DCtx;
 
 #pragma comment(lib, "ws2_32.lib")
 
@@ -27,82 +31,123 @@ namespace UberSDRIntf
     };
 
     // Ring buffer for smoothing WebSocket data arrival
+    // Single-producer/single-consumer and lock-free: the IXWebSocket callback
+    // thread is the only writer and ConsumeRingBuffers() is the only reader.
+    // writePos is published by the producer, readPos by the consumer; each side
+    // only ever stores its own index, so acquire/release ordering is enough.
     struct RingBuffer {
         std::vector<float> buffer;  // Interleaved I/Q samples (float)
-        size_t writePos;
-        size_t readPos;
-        size_t capacity;            // Total capacity in samples (I/Q pairs)
-        CRITICAL_SECTION lock;
-        int underrunCount;
-        int overrunCount;
+        alignas(64) std::atomic<size_t> writePos;  // Producer index (samples)
+        alignas(64) std::atomic<size_t> readPos;   // Consumer index (samples)
+        alignas(64) size_t capacity;            // Total capacity in samples (I/Q pairs)
+        std::atomic<int> underrunCount;  // Written by consumer only
+        std::atomic<int> overrunCount;   // Written by producer only
         
         RingBuffer() : writePos(0), readPos(0), capacity(0), underrunCount(0), overrunCount(0) {
-            InitializeCriticalSection(&lock);
-        }
-        
-        ~RingBuffer() {
-            DeleteCriticalSection(&lock);
         }
         
+        // Must not be called while a producer or consumer is running on this ring
         void init(size_t capacityInSamples) {
-            EnterCriticalSection(&lock);
             capacity = capacityInSamples;
-            buffer.resize(capacity * 2);  // *2 for I and Q
-            writePos = 0;
-            readPos = 0;
-            underrunCount = 0;
-            overrunCount = 0;
-            LeaveCriticalSection(&lock);
+            buffer.assign(capacity * 2, 0.0f);  // *2 for I and Q
+            writePos.store(0, std::memory_order_relaxed);
+            readPos.store(0, std::memory_order_relaxed);
+            underrunCount.store(0, std::memory_order_relaxed);
+            overrunCount.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
         }
         
-        size_t available() {
+        size_t available() const {
             // Returns number of samples available to read
-            return (writePos - readPos + capacity) % capacity;
+            if (capacity == 0) return 0;
+            size_t w = writePos.load(std::memory_order_acquire);
+            size_t r = readPos.load(std::memory_order_acquire);
+            return (w - r + capacity) % capacity;
         }
         
-        size_t space() {
+        size_t space() const {
             // Returns number of samples that can be written
+            if (capacity == 0) return 0;
             return capacity - available() - 1;
         }
         
-        bool write(float I, float Q) {
-            EnterCriticalSection(&lock);
+        // Producer side: write up to 'count' interleaved I/Q pairs from 'iq'.
+        // Samples that do not fit are dropped and counted as overruns.
+        // Returns the number of samples actually written.
+        size_t writeBlock(const float* iq, size_t count) {
+            if (capacity == 0 || count == 0) return 0;
+            
+            size_t w = writePos.load(std::memory_order_relaxed);
+            size_t r = readPos.load(std::memory_order_acquire);
+            size_t freeSamples = capacity - ((w - r + capacity) % capacity) - 1;
             
-            if (space() < 1) {
-                overrunCount++;
-                LeaveCriticalSection(&lock);
-                return false;  // Buffer full
+            size_t toWrite = count < freeSamples ? count : freeSamples;
+            if (toWrite < count) {
+                overrunCount.fetch_add((int)(count - toWrite), std::memory_order_relaxed);
             }
+            if (toWrite == 0) return 0;
             
-            size_t idx = writePos * 2;
-            buffer[idx] = I;
-            buffer[idx + 1] = Q;
-            writePos = (writePos + 1) % capacity;
+            // At most two contiguous spans (up to the end, then wrapped to the start)
+            size_t first = capacity - w;
+            if (first > toWrite) first = toWrite;
+            memcpy(&buffer[w * 2], iq, first * 2 * sizeof(float));
+            if (toWrite > first) {
+                memcpy(&buffer[0], iq + first * 2, (toWrite - first) * 2 * sizeof(float));
+            }
             
-            LeaveCriticalSection(&lock);
-            return true;
+            writePos.store((w + toWrite) % capacity, std::memory_order_release);
+            return toWrite;
         }
         
-        bool read(float& I, float& Q) {
-            EnterCriticalSection(&lock);
+        // Consumer side: read up to 'count' interleaved I/Q pairs into 'iq'.
+        // Missing samples are counted as underruns and left for the caller to fill.
+        // Returns the number of samples actually read.
+        size_t readBlock(float* iq, size_t count) {
+            if (count == 0) return 0;
+            if (capacity == 0) {
+                underrunCount.fetch_add((int)count, std::memory_order_relaxed);
+                return 0;
+            }
             
-            if (available() < 1) {
-                underrunCount++;
-                LeaveCriticalSection(&lock);
-                return false;  // Buffer empty
+            size_t r = readPos.load(std::memory_order_relaxed);
+            size_t w = writePos.load(std::memory_order_acquire);
+            size_t avail = (w - r + capacity) % capacity;
+            
+            size_t toRead = count < avail ? count : avail;
+            if (toRead < count) {
+                underrunCount.fetch_add((int)(count - toRead), std::memory_order_relaxed);
             }
+            if (toRead == 0) return 0;
             
-            size_t idx = readPos * 2;
-            I = buffer[idx];
-            Q = buffer[idx + 1];
-            readPos = (readPos + 1) % capacity;
+            size_t first = capacity - r;
+            if (first > toRead) first = toRead;
+            memcpy(iq, &buffer[r * 2], first * 2 * sizeof(float));
+            if (toRead > first) {
+                memcpy(iq + first * 2, &buffer[0], (toRead - first) * 2 * sizeof(float));
+            }
             
-            LeaveCriticalSection(&lock);
+            readPos.store((r + toRead) % capacity, std::memory_order_release);
+            return toRead;
+        }
+        
+        bool write(float I, float Q) {
+            float iq[2] = { I, Q };
+            return writeBlock(iq, 1) == 1;
+        }
+        
+        bool read(float& I, float& Q) {
+            float iq[2];
+            if (readBlock(iq, 1) != 1) {
+                return false;  // Buffer empty
+            }
+            I = iq[0];
+            Q = iq[1];
             return true;
         }
         
-        float fillLevel() {
+        float fillLevel() const {
             // Returns fill level as percentage (0.0 to 1.0)
+            if (capacity == 0) return 0.0f;
             return (float)available() / (float)capacity;
         }
     };
@@ -115,25 +160,61 @@ namespace UberSDRIntf
         ConnectionState state;
         std::string sessionId;
         ix::WebSocket* wsClient;
-        RingBuffer ringBuffer;  // 500ms buffer for smoothing WebSocket data
+        RingBuffer ringBuffer;  // RingBufferMs (INI) of samples for smoothing WebSocket data
+        size_t targetDepth;     // Adaptive rate: ring fill to hold, in samples (0 = fixed rate)
         int generation;  // Incremented on each reconnection to detect stale callbacks
         CRITICAL_SECTION lock;  // Mutex for thread-safe access
-        bool needsReconnect;    // Flag set by close callback
-        HANDLE reconnectThread; // Handle to reconnection thread
+        bool needsReconnect;    // Flag set by close callback, cleared once reconnected
+        bool reconnecting;      // The reconnect worker is using wsClient right now
+        HANDLE reconnectIdle;   // Manual-reset event, set while reconnecting is false
+        ULONGLONG outageStartMs;  // GetTickCount64() when the drop was seen
+        ULONGLONG nextRetryMs;    // When the reconnect worker tries next
+        int retryDelayMs;         // Backoff after the next failed attempt
+        int reconnectAttempts;    // Attempts in the current outage
+        
+        // Outage accounting, read by ConsumeRingBuffers: drops seen and
+        // reconnections completed (equal when connected), and figures for the
+        // last completed reconnection
+        std::atomic<LONG> disconnects;
+        std::atomic<LONG> reconnects;
+        std::atomic<int> lastReconnectMs;
+        std::atomic<int> lastReconnectAttempts;
         int perReceiverOffset;  // Per-receiver frequency offset in Hz (dynamic)
         
+        // Last frequency the Skimmer asked for via SetRxFrequency (0 = none
+        // since StopRx). Recorded even before the receiver is started, so
+        // the startup thread can connect on it instead of a default
+        std::atomic<int> requestedFrequency;
+        
         // Software frequency shifting (applied in IQ processing, not at tune)
-        double phaseAccumulator;  // Current phase for frequency shift
-        double phaseIncrement;    // Phase increment per sample (2*PI*offset/sampleRate)
+        // Published by ProcessCommands/StartRx and read once per block by
+        // ConsumeRingBuffers, which owns the NCO phase for each receiver
+        std::atomic<double> phaseIncrement;  // Phase increment per sample (2*PI*offset/sampleRate)
+        
+        // Frame decode state, only touched by this receiver's WebSocket callback
+        // thread: one zstd context and a decompression buffer that only ever grows
+        ZSTD_DCtx* zstdDCtx;
+        std::vector<uint8_t> decodeBuffer;
+        
+        // debug_capture: raw frames as received, for replay_bench (opened by
+        // StartReceiver, written by the WebSocket thread, closed by StopReceiver)
+        FILE* captureFile;
+        size_t captureBytes;
         
         ReceiverInfo() : frequency(14074000), mode("iq192"), active(false),
-                        state(DISCONNECTED), wsClient(nullptr), generation(0),
-                        needsReconnect(false), reconnectThread(NULL), perReceiverOffset(0),
-                        phaseAccumulator(0.0), phaseIncrement(0.0) {
+                        state(DISCONNECTED), wsClient(nullptr), targetDepth(0), generation(0),
+                        needsReconnect(false), reconnecting(false), outageStartMs(0), nextRetryMs(0),
+                        retryDelayMs(0), reconnectAttempts(0), disconnects(0), reconnects(0),
+                        lastReconnectMs(0), lastReconnectAttempts(0), perReceiverOffset(0),
+                        requestedFrequency(0), phaseIncrement(0.0), zstdDCtx(nullptr), captureFile(NULL), captureBytes(0) {
             InitializeCriticalSection(&lock);
+            reconnectIdle = CreateEvent(NULL, TRUE, TRUE, NULL);
         }
         
         ~ReceiverInfo() {
+            if (reconnectIdle != NULL) {
+                CloseHandle(reconnectIdle);
+            }
             DeleteCriticalSection(&lock);
         }
     };
@@ -146,8 +227,18 @@ namespace UberSDRIntf
         int configPort;
         bool configFromFilename;
         bool debugRec;  // Enable 10-second WAV recording on start
+        bool debugCapture;  // Capture raw WebSocket frames to capture_rx<N>.bin
         int frequencyOffset;  // Frequency correction in Hz (can be positive or negative)
         bool swapIQ;  // Swap I and Q channels (default: true for backward compatibility)
+        int ringBufferMs;  // Ring buffer capacity per receiver in ms
+        bool adaptiveRate;  // Hold each ring at its target depth with a drift-correcting resampler
+        int targetDepthMs[MAX_RX_COUNT];  // Adaptive rate: target ring depth per receiver in ms
+        int startTuneWaitMs;  // How long a starting receiver waits for its first frequency
+        bool fastResume;  // Reconnect at once, reusing the session and WebSocket object
+        bool mmcss;  // Register the ring buffer consumer with MMCSS "Pro Audio"
+        DWORD_PTR consumerAffinity;  // Core mask for the ring buffer consumer (0 = any core)
+        DWORD_PTR networkAffinity;  // Core mask for WebSocket, startup and reconnect threads (0 = any core)
+        int timerResolutionMs;  // timeBeginPeriod while pacing without a high-resolution timer (0 = leave)
         
         // Server connection
         std::string serverHost;
@@ -157,7 +248,7 @@ namespace UberSDRIntf
         // Receiver management
         ReceiverInfo receivers[MAX_RX_COUNT];
         int maxReceivers;
-        int activeReceivers;
+        volatile LONG activeReceivers;  // Receivers start and stop on their own threads
         
         // Sample rate mapping
         int sampleRate;
@@ -175,29 +266,52 @@ namespace UberSDRIntf
         int StartReceiver(int receiverID, int frequency, const std::string& mode);
         int StopReceiver(int receiverID);
         int SetFrequency(int receiverID, int frequency);
+        void CloseCapture(int receiverID);
         
         // WebSocket operations
         std::string BuildWebSocketURL(int receiverID, int frequency, const std::string& mode);
         int ConnectWebSocket(int receiverID, const std::string& url);
+        int StartWebSocket(int receiverID, const std::string& url);
+        int WaitWebSocket(int receiverID, int timeoutMs);
         void DisconnectWebSocket(int receiverID);
         void HandleWebSocketMessage(int receiverID, const std::string& message);
         void SendKeepalive(int receiverID);
         
-        // Reconnection thread
-        static DWORD WINAPI ReconnectionThreadProc(LPVOID param);
-        void HandleReconnection(int receiverID);
+        // Reconnection: one worker thread serves every dropped receiver
+        static DWORD WINAPI ReconnectWorkerProc(LPVOID param);
+        void RequestReconnect(int receiverID);
+        void HandleReconnection(void);
+        bool BeginReconnect(int receiverID);
+        void StopReconnectWorker(void);
+        
+        // Thread scheduling ([Scheduling] in the INI)
+        void ApplyNetworkAffinity(void);
         
         // HTTP operations
         bool HttpPost(const std::string& path, const std::string& body, std::string& response);
+        void HttpCloseIdle(void);
         
         // Command processing
-        void ProcessCommands(struct UberSDRSharedStatus* pSharedStatus);
+        void ProcessCommands(struct UberSDRSharedStatusV2* pSharedStatus);
         int GetTotalFrequencyOffset(int receiverID);
         
     private:
         WSADATA wsaData;
         bool wsaInitialized;
         
+        // Keep-alive connections to the server's HTTP API, idle between
+        // requests (HttpPost takes one out, puts it back if still usable)
+        std::vector<SOCKET> httpIdle;
+        CRITICAL_SECTION httpLock;
+        
+        // Reconnect worker, started on the first drop
+        HANDLE reconnectWorker;
+        HANDLE reconnectEvent;  // Auto-reset: a receiver dropped (or stop)
+        volatile bool reconnectStop;
+        CRITICAL_SECTION reconnectLock;
+        SOCKET HttpOpen(void);
+        bool HttpExchange(SOCKET sock, const std::string& request, std::string& response, bool& keepAlive);
+        
         // INI file configuration
         int loadConfigFromIni(void);
         bool isValidHostname(const std::string& host);
@@ -10,18 +10,26 @@
 #include <windows.h>
 #include <winsock2.h>
 #include <ws2tcpip.h>
+#include <mmsystem.h>
+#include <avrt.h>
 #include <stdio.h>
 #include <string>
 #include <sstream>
 #include <time.h>
+#include <math.h>
 #include <vector>
 
 // Now include our headers
 #include "UberSDRIntf.h"
 #include "UberSDR.h"
 #include "UberSDRShared.h"
+#include "../../common/iq_convert.h"
+#include "../../common/iq_nco.h"
+#include "../../common/iq_resample.h"
 
 #pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "winmm.lib")
+#pragma comment(lib, "avrt.lib")
 
 namespace UberSDRIntf
 {
@@ -58,6 +66,16 @@ namespace UberSDRIntf
     CRITICAL_SECTION gDataCriticalSection;
     bool gCriticalSectionInitialized = false;
     
+    // Serialises writers of the shared config group (StartRx, the startup
+    // threads, SetRxFrequency), so its seqlock sees one writer at a time
+    CRITICAL_SECTION gConfigLock;
+    
+    // Per receiver: held to tune and publish the tuning group, by its startup
+    // thread and by SetRxFrequency. Not the receiver's own lock, which the
+    // WebSocket callbacks take: SetFrequency can end in DisconnectWebSocket,
+    // which must not hold that one while it stops the socket.
+    CRITICAL_SECTION gTuneLock[MAX_RX_COUNT];
+    
     // Instance of UberSDR
     UberSDR myUberSDR;
     
@@ -65,6 +83,11 @@ namespace UberSDRIntf
     DWORD gidWrk[MAX_RX_COUNT] = { 0 };
     HANDLE ghWrk[MAX_RX_COUNT] = { NULL };
     
+    // Handles of the per-receiver startup threads (StartRx -> StartupThread),
+    // and how many are still running: the last one publishes the status
+    HANDLE ghStart[MAX_RX_COUNT] = { NULL };
+    volatile LONG gStartupPending = 0;
+    
     // Stop flag
     volatile bool gStopFlag = false;
     
@@ -79,7 +102,7 @@ namespace UberSDRIntf
     
     // Shared memory for status monitoring
     HANDLE ghSharedMemory = NULL;
-    UberSDRSharedStatus* gpSharedStatus = NULL;
+    UberSDRSharedStatusV2* gpSharedStatus = NULL;
     
     // Multi-instance support
     DWORD gProcessID = 0;
@@ -120,6 +143,10 @@ namespace UberSDRIntf
         // Initialize critical section first
         if (!gCriticalSectionInitialized) {
             InitializeCriticalSection(&gDataCriticalSection);
+            InitializeCriticalSection(&gConfigLock);
+            for (int i = 0; i < MAX_RX_COUNT; i++) {
+                InitializeCriticalSection(&gTuneLock[i]);
+            }
             gCriticalSectionInitialized = true;
             write_text_to_log_file("Critical section initialized");
         }
@@ -144,7 +171,7 @@ namespace UberSDRIntf
             NULL,
             PAGE_READWRITE,
             0,
-            sizeof(UberSDRSharedStatus),
+            sizeof(UberSDRSharedStatusV2),
             gSharedMemoryName);
         
         if (ghSharedMemory == NULL) {
@@ -152,11 +179,11 @@ namespace UberSDRIntf
             return FALSE;
         }
         
-        gpSharedStatus = (UberSDRSharedStatus*)MapViewOfFile(
+        gpSharedStatus = (UberSDRSharedStatusV2*)MapViewOfFile(
             ghSharedMemory,
             FILE_MAP_ALL_ACCESS,
             0, 0,
-            sizeof(UberSDRSharedStatus));
+            sizeof(UberSDRSharedStatusV2));
         
         if (gpSharedStatus == NULL) {
             write_text_to_log_file("Failed to map shared memory");
@@ -165,28 +192,37 @@ namespace UberSDRIntf
             return FALSE;
         }
         
-        // Initialize structure
-        ZeroMemory(gpSharedStatus, sizeof(UberSDRSharedStatus));
-        gpSharedStatus->structVersion = 1;
-        gpSharedStatus->dllLoaded = true;
-        gpSharedStatus->startTime = ::GetCurrentTimeMs();
-        gpSharedStatus->lastUpdateTime = ::GetCurrentTimeMs();
-        gpSharedStatus->processID = gProcessID;
+        // Initialize structure (the magic goes in last, once the rest is valid)
+        ZeroMemory(gpSharedStatus, sizeof(UberSDRSharedStatusV2));
+        gpSharedStatus->header.structVersion = UBERSDR_STATUS_VERSION;
+        gpSharedStatus->header.structSize = sizeof(UberSDRSharedStatusV2);
+        gpSharedStatus->header.receiverCount = MAX_RX_COUNT;
+        gpSharedStatus->header.iqBufferSize = IQ_BUFFER_SIZE;
+        gpSharedStatus->header.processID = gProcessID;
+        gpSharedStatus->header.startTime = ::GetCurrentTimeMs();
         
         // Initialize command queue
-        gpSharedStatus->commandWritePos = 0;
-        gpSharedStatus->commandReadPos = 0;
+        gpSharedStatus->commands.queue.commandWritePos = 0;
+        gpSharedStatus->commands.queue.commandReadPos = 0;
         
         // Copy server info
-        strncpy_s(gpSharedStatus->serverHost, sizeof(gpSharedStatus->serverHost),
+        UberSDRSharedStatusV2::Config& config = gpSharedStatus->config;
+        UberSDRSeqWriteBegin(&config.seq);
+        config.dllLoaded = true;
+        config.lastUpdateTime = ::GetCurrentTimeMs();
+        strncpy_s(config.serverHost, sizeof(config.serverHost),
                   myUberSDR.serverHost.c_str(), _TRUNCATE);
-        gpSharedStatus->serverPort = myUberSDR.serverPort;
+        config.serverPort = myUberSDR.serverPort;
+        UberSDRSeqWriteEnd(&config.seq);
+        
+        MemoryBarrier();
+        gpSharedStatus->header.magic = UBERSDR_STATUS_MAGIC;
         
         write_text_to_log_file("Shared memory initialized");
         
         // Register instance in registry
         if (RegisterInstance(gProcessID, myUberSDR.serverHost.c_str(),
-                           myUberSDR.serverPort, gpSharedStatus->startTime)) {
+                           myUberSDR.serverPort, gpSharedStatus->header.startTime)) {
             write_text_to_log_file("Instance registered in registry");
         } else {
             write_text_to_log_file("Warning: Failed to register instance in registry (non-fatal)");
@@ -228,8 +264,12 @@ namespace UberSDRIntf
         }
         
         if (gpSharedStatus != NULL) {
-            gpSharedStatus->dllLoaded = false;
-            gpSharedStatus->lastUpdateTime = ::GetCurrentTimeMs();
+            EnterCriticalSection(&gConfigLock);
+            UberSDRSeqWriteBegin(&gpSharedStatus->config.seq);
+            gpSharedStatus->config.dllLoaded = false;
+            gpSharedStatus->config.lastUpdateTime = ::GetCurrentTimeMs();
+            UberSDRSeqWriteEnd(&gpSharedStatus->config.seq);
+            LeaveCriticalSection(&gConfigLock);
             UnmapViewOfFile(gpSharedStatus);
             gpSharedStatus = NULL;
         }
@@ -242,6 +282,10 @@ namespace UberSDRIntf
         // Cleanup critical section
         if (gCriticalSectionInitialized) {
             DeleteCriticalSection(&gDataCriticalSection);
+            DeleteCriticalSection(&gConfigLock);
+            for (int i = 0; i < MAX_RX_COUNT; i++) {
+                DeleteCriticalSection(&gTuneLock[i]);
+            }
             gCriticalSectionInitialized = false;
         }
     }
@@ -252,14 +296,19 @@ namespace UberSDRIntf
     {
         if (gpSharedStatus == NULL) return;
         
-        gpSharedStatus->connected = myUberSDR.activeReceivers > 0;
-        gpSharedStatus->sampleRate = gSampleRate;
-        strncpy_s(gpSharedStatus->mode, sizeof(gpSharedStatus->mode),
+        UberSDRSharedStatusV2::Config& config = gpSharedStatus->config;
+        EnterCriticalSection(&gConfigLock);
+        UberSDRSeqWriteBegin(&config.seq);
+        config.connected = myUberSDR.activeReceivers > 0;
+        config.sampleRate = gSampleRate;
+        strncpy_s(config.mode, sizeof(config.mode),
                   myUberSDR.iqMode.c_str(), _TRUNCATE);
-        gpSharedStatus->blockSize = gBlockInSamples;
-        gpSharedStatus->rxStarted = (gSet.RecvCount > 0);
-        gpSharedStatus->activeReceiverCount = myUberSDR.activeReceivers;
-        gpSharedStatus->lastUpdateTime = ::GetCurrentTimeMs();
+        config.blockSize = gBlockInSamples;
+        config.rxStarted = (gSet.RecvCount > 0);
+        config.activeReceiverCount = myUberSDR.activeReceivers;
+        config.lastUpdateTime = ::GetCurrentTimeMs();
+        UberSDRSeqWriteEnd(&config.seq);
+        LeaveCriticalSection(&gConfigLock);
     }
     
     ///////////////////////////////////////////////////////////////////////////////
@@ -350,6 +399,127 @@ namespace UberSDRIntf
         return 0;
     }
     
+    ///////////////////////////////////////////////////////////////////////////////
+    // Startup thread for each receiver, started by StartRx. All receivers
+    // connect in parallel, so StartRx costs the slowest connection rather
+    // than the sum of them, and each one connects on the first frequency the
+    // Skimmer asks for instead of 14.074 MHz followed by a retune.
+    static DWORD StartReceiverOnce(int receiverID)
+    {
+        ReceiverInfo& rxInfo = myUberSDR.receivers[receiverID];
+        
+        // The Skimmer tunes each receiver right after StartRx (or already did,
+        // before it); give it a moment so the WebSocket URL carries the real
+        // frequency
+        int waited = 0;
+        while (rxInfo.requestedFrequency.load() == 0 && waited < myUberSDR.startTuneWaitMs && !gStopFlag) {
+            Sleep(10);
+            waited += 10;
+        }
+        if (gStopFlag) {
+            return 0;
+        }
+        
+        int frequency = rxInfo.requestedFrequency.load();
+        if (frequency == 0) {
+            frequency = 14074000;  // Not tuned yet: default, retuned by SetRxFrequency
+        }
+        
+        int result = myUberSDR.StartReceiver(receiverID, frequency, myUberSDR.iqMode);
+        if (result != 0)
+        {
+            std::stringstream ss;
+            ss << "Failed to start receiver " << receiverID;
+            rt_exception(ss.str());
+            return 1;
+        }
+        
+        // A SetRxFrequency that arrived while connecting may not have reached
+        // the server: tune to the latest request now the socket is open.
+        // SetRxFrequency tunes and publishes under the same lock once the
+        // receiver is active, so whichever of the two runs last also holds
+        // the newest frequency, and the tuning group has one writer at a time.
+        EnterCriticalSection(&gTuneLock[receiverID]);
+        int latest = rxInfo.requestedFrequency.load();
+        if (latest != 0 && latest != frequency) {
+            myUberSDR.SetFrequency(receiverID, latest);
+            frequency = latest;
+        }
+        
+        // Initialize phase increment for software frequency shift
+        // Use INI global offset as initial offset
+        // NEGATE phase increment: positive offset shifts spectrum DOWN
+        double totalOffset = (double)myUberSDR.frequencyOffset;
+        double phaseInc = -2.0 * 3.14159265358979323846 * totalOffset / (double)gSampleRate;
+        
+        rxInfo.phaseIncrement.store(phaseInc, std::memory_order_release);
+        
+        // Update shared memory for this receiver
+        if (gpSharedStatus != NULL) {
+            UberSDRSharedStatusV2::ReceiverStatus& rx = gpSharedStatus->receivers[receiverID];
+            rx.offsets.frequencyOffset = 0;  // Initialize per-receiver offset
+            rx.offsets.globalFrequencyOffset = myUberSDR.frequencyOffset;  // INI offset
+            rx.offsets.totalFrequencyOffset = myUberSDR.frequencyOffset;  // INI offset (software shift)
+            rx.offsets.requestedOffset = 0;
+            rx.offsets.offsetApplied = 0;
+            
+            UberSDRSeqWriteBegin(&rx.tuning.seq);
+            rx.tuning.active = true;
+            rx.tuning.frequency = frequency;
+            strncpy_s(rx.tuning.sessionId, sizeof(rx.tuning.sessionId),
+                      rxInfo.sessionId.c_str(), _TRUNCATE);
+            UberSDRSeqWriteEnd(&rx.tuning.seq);
+        }
+        LeaveCriticalSection(&gTuneLock[receiverID]);
+        
+        // StopRx arrived while this receiver connected: it is waiting for this
+        // thread and stops the receiver itself, so start no worker for it
+        if (gStopFlag) {
+            return 0;
+        }
+        
+        // Start worker thread
+        ghWrk[receiverID] = CreateThread(NULL, 0, Worker, (LPVOID)(INT_PTR)receiverID, 0, &gidWrk[receiverID]);
+        if (ghWrk[receiverID] == NULL)
+        {
+            std::stringstream ss;
+            ss << "Failed to start worker thread for receiver " << receiverID;
+            rt_exception(ss.str());
+        }
+        
+        return 0;
+    }
+    
+    DWORD WINAPI StartupThread(LPVOID lpParameter)
+    {
+        myUberSDR.ApplyNetworkAffinity();
+        DWORD result = StartReceiverOnce((int)(INT_PTR)lpParameter);
+        
+        // Last one out publishes the connected count (one writer at a time)
+        if (InterlockedDecrement(&gStartupPending) == 0) {
+            UpdateSharedStatus();
+        }
+        return result;
+    }
+    
+    // Wait for any startup threads still connecting (StopRx, StartRx again,
+    // or replay_bench before it feeds the receivers). No timeout: a thread
+    // given up on could still start or tune a receiver being torn down, and
+    // an attempt is bounded anyway (the connection check's HTTP timeout plus
+    // the 5 s handshake wait).
+    void WaitStartupThreads(void)
+    {
+        for (int i = 0; i < MAX_RX_COUNT; i++)
+        {
+            if (ghStart[i] != NULL)
+            {
+                WaitForSingleObject(ghStart[i], INFINITE);
+                CloseHandle(ghStart[i]);
+                ghStart[i] = NULL;
+            }
+        }
+    }
+    
     ///////////////////////////////////////////////////////////////////////////////
     // Write WAV header
     void WriteWavHeader(FILE* file, int sampleRate, int numChannels)
@@ -426,8 +596,11 @@ void TrackCompressedBytes(int receiverID, size_t compressedBytes)
             float elapsed = (float)(now - lastCompressedThroughputUpdate[receiverID]) / 1000.0f;
             
             // Store compressed throughput in bytesReceived field (repurposing for network bandwidth)
-            gpSharedStatus->receivers[receiverID].bytesReceived = compressedBytesReceived[receiverID];
-            gpSharedStatus->receivers[receiverID].throughputKBps = (float)bytesDelta / 1024.0f / elapsed;
+            UberSDRSharedStatusV2::ReceiverStatus::Stream& stream = gpSharedStatus->receivers[receiverID].stream;
+            UberSDRSeqWriteBegin(&stream.seq);
+            stream.bytesReceived = compressedBytesReceived[receiverID];
+            stream.throughputKBps = (float)bytesDelta / 1024.0f / elapsed;
+            UberSDRSeqWriteEnd(&stream.seq);
             
             lastCompressedBytesReceived[receiverID] = compressedBytesReceived[receiverID];
         }
@@ -435,10 +608,31 @@ void TrackCompressedBytes(int receiverID, size_t compressedBytes)
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Record frame inter-arrival and zstd decode time (called from UberSDR.cpp on
+// the receiver's WebSocket thread, the only writer of netTiming)
+void TrackFrameTiming(int receiverID, int64_t arrivalUs, int64_t decodeUs)
+{
+    using namespace UberSDRIntf;
+    
+    if (receiverID < 0 || receiverID >= MAX_RX_COUNT || gpSharedStatus == NULL) {
+        return;
+    }
+    
+    static int64_t lastArrivalUs[MAX_RX_COUNT] = {0};
+    
+    UberSDRSharedStatusV2::ReceiverStatus::NetTiming& timing = gpSharedStatus->receivers[receiverID].netTiming;
+    if (lastArrivalUs[receiverID] != 0) {
+        UberSDRHistRecord(&timing.frameInterval, arrivalUs - lastArrivalUs[receiverID]);
+    }
+    lastArrivalUs[receiverID] = arrivalUs;
+    UberSDRHistRecord(&timing.decodeTime, decodeUs);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Process IQ data from WebSocket (called from UberSDR.cpp)
 // This must be outside the namespace to be accessible
-void ProcessIQData(int receiverID, const std::vector<uint8_t>& iqBytes)
+void ProcessIQData(int receiverID, const uint8_t* iqBytes, size_t numBytes)
 {
     using namespace UberSDRIntf;
     
@@ -461,8 +655,11 @@ void ProcessIQData(int receiverID, const std::vector<uint8_t>& iqBytes)
     if (now - lastPeakUpdate[receiverID] >= 100) {
         // Update peak levels in shared memory
         if (gpSharedStatus != NULL && receiverID < MAX_RX_COUNT) {
-            gpSharedStatus->receivers[receiverID].peakLevelI = peakI[receiverID];
-            gpSharedStatus->receivers[receiverID].peakLevelQ = peakQ[receiverID];
+            UberSDRSharedStatusV2::ReceiverStatus::Stream& stream = gpSharedStatus->receivers[receiverID].stream;
+            UberSDRSeqWriteBegin(&stream.seq);
+            stream.peakLevelI = peakI[receiverID];
+            stream.peakLevelQ = peakQ[receiverID];
+            UberSDRSeqWriteEnd(&stream.seq);
         }
         
         // Decay peaks for next period
@@ -473,92 +670,172 @@ void ProcessIQData(int receiverID, const std::vector<uint8_t>& iqBytes)
     
     // IQ data format: interleaved I/Q samples, big-endian int16
     // Each sample: 2 bytes I + 2 bytes Q = 4 bytes total
-    int numSamples = iqBytes.size() / 4;
+    int numSamples = (int)(numBytes / 4);
     
-    for (int i = 0; i < numSamples; i++)
-    {
-        // Extract big-endian int16 I and Q
-        int16_t I = (int16_t)((iqBytes[i*4] << 8) | iqBytes[i*4+1]);
-        int16_t Q = (int16_t)((iqBytes[i*4+2] << 8) | iqBytes[i*4+3]);
-        
-        // Track peak levels (normalize to 0.0-1.0 range)
-        float absI = (float)abs(I) / 32768.0f;
-        float absQ = (float)abs(Q) / 32768.0f;
-        if (absI > peakI[receiverID]) peakI[receiverID] = absI;
-        if (absQ > peakQ[receiverID]) peakQ[receiverID] = absQ;
-        
-        // Store in circular buffer for recording (outside critical section)
-        if (gpSharedStatus != NULL) {
-            int32_t writePos = gpSharedStatus->receivers[receiverID].iqBufferWritePos;
-            gpSharedStatus->receivers[receiverID].iqBuffer[writePos] = I;
-            gpSharedStatus->receivers[receiverID].iqBuffer[writePos + 1] = Q;
-            writePos = (writePos + 2) % IQ_BUFFER_SIZE;
-            gpSharedStatus->receivers[receiverID].iqBufferWritePos = writePos;
+    // Per-receiver staging buffer so the whole frame goes into the ring with one
+    // writeBlock() call (only the receiver's WebSocket thread touches its slot)
+    static std::vector<float> frameIQ[MAX_RX_COUNT];
+    if (frameIQ[receiverID].size() < (size_t)numSamples * 2) {
+        frameIQ[receiverID].resize((size_t)numSamples * 2);
+    }
+    float* pFrameIQ = frameIQ[receiverID].data();
+    
+    // Stage 1: convert the whole frame in one vectorized pass. The ±1.0 scaling
+    // is the same as the old Hermes-style [31:16] build divided by 2^31, swapIQ
+    // selects sideband orientation and Q is negated to match Hermes (Im = -Q)
+    iq_be16_to_float(iqBytes, pFrameIQ, (size_t)numSamples,
+                     1.0f / 32768.0f, myUberSDR.swapIQ ? 1 : 0, 1);
+    
+    // Stage 2: peak levels from the converted frame. Output Re/Im map back to
+    // the wire I/Q channels depending on swapIQ (abs() undoes the Q negation)
+    float peakRe = 0.0f, peakIm = 0.0f;
+    for (int i = 0; i < numSamples; i++) {
+        float absRe = fabsf(pFrameIQ[i * 2]);
+        float absIm = fabsf(pFrameIQ[i * 2 + 1]);
+        if (absRe > peakRe) peakRe = absRe;
+        if (absIm > peakIm) peakIm = absIm;
+    }
+    float framePeakI = myUberSDR.swapIQ ? peakIm : peakRe;
+    float framePeakQ = myUberSDR.swapIQ ? peakRe : peakIm;
+    if (framePeakI > peakI[receiverID]) peakI[receiverID] = framePeakI;
+    if (framePeakQ > peakQ[receiverID]) peakQ[receiverID] = framePeakQ;
+    
+    // Stage 3: copy the frame into the shared IQ ring for the Monitor's
+    // recorder/spectrum in at most two spans, then publish the write position,
+    // sample count and timestamp once per frame. These are cross-process writes,
+    // so keeping them out of the per-sample path avoids cache-line ping-pong
+    if (gpSharedStatus != NULL && numSamples > 0) {
+        int32_t values = numSamples * 2;
+        const uint8_t* src = iqBytes;
+        if (values > IQ_BUFFER_SIZE) {
+            // Frame larger than the ring: only the newest IQ_BUFFER_SIZE values survive
+            src += (size_t)(values - IQ_BUFFER_SIZE) * 2;
+            values = IQ_BUFFER_SIZE;
         }
         
-        // Build 32-bit values directly from bytes (like Hermes does)
-        // This avoids sign extension issues when shifting int16_t values
-        // Hermes puts 24-bit samples in bits [31:8], we put 16-bit samples in bits [31:16]
-        
-        int32_t I_32, Q_32;
-        
-        if (myUberSDR.swapIQ) {
-            // Swap I and Q for correct sideband orientation in CW Skimmer (default behavior)
-            I_32 = ((int32_t)iqBytes[i*4+2] << 24) | ((int32_t)iqBytes[i*4+3] << 16);  // Read Q as I, bits [31:16]
-            Q_32 = ((int32_t)iqBytes[i*4] << 24) | ((int32_t)iqBytes[i*4+1] << 16);    // Read I as Q, bits [31:16]
-        } else {
-            // No swap - read I as I, Q as Q
-            I_32 = ((int32_t)iqBytes[i*4] << 24) | ((int32_t)iqBytes[i*4+1] << 16);    // Read I as I, bits [31:16]
-            Q_32 = ((int32_t)iqBytes[i*4+2] << 24) | ((int32_t)iqBytes[i*4+3] << 16);  // Read Q as Q, bits [31:16]
-        }
+        UberSDRSharedStatusV2::ReceiverStatus& rx = gpSharedStatus->receivers[receiverID];
         
-        // Normalize to proper range and negate Q to match Hermes (Im = -Q)
-        // Divide by 2^31 to get ±1.0 range (same as WAV file normalization)
-        float I_float = (float)I_32 / 2147483648.0f;
-        float Q_float = (float)-Q_32 / 2147483648.0f;
+        // Only this thread writes the producer position, so a plain read is
+        // current. Values dropped from an oversized frame count as written
+        // (and overwritten), so readers see them as lost
+        int64_t producerPos = rx.iqProducerPos + ((int64_t)numSamples * 2 - values);
+        int32_t writePos = (int32_t)(producerPos % IQ_BUFFER_SIZE);
+        int32_t firstSpan = IQ_BUFFER_SIZE - writePos;
+        if (firstSpan > values) firstSpan = values;
         
-        // RING BUFFER: Write to ring buffer instead of directly to gInPtr
-        // This decouples async WebSocket reception from sync processing
-        if (!myUberSDR.receivers[receiverID].ringBuffer.write(I_float, Q_float)) {
-            // Buffer overrun - silently drop samples
-            // (Logging removed to reduce log verbosity)
-        }
+        iq_be16_to_s16(src, rx.iqBuffer + writePos, (size_t)firstSpan);
+        iq_be16_to_s16(src + (size_t)firstSpan * 2, rx.iqBuffer, (size_t)(values - firstSpan));
         
-        // Write to WAV file if recording (first 10 seconds)
-        if (gWavFile[receiverID] != NULL && gWavSamplesWritten[receiverID] < (gSampleRate * WAV_RECORD_SECONDS))
-        {
-            // Write as stereo float: I (left), Q (right)
-            // Values are already normalized to ±1.0 range
-            fwrite(&I_float, sizeof(float), 1, gWavFile[receiverID]);
-            fwrite(&Q_float, sizeof(float), 1, gWavFile[receiverID]);
-            gWavSamplesWritten[receiverID]++;
-            
-            // Close file after 10 seconds
-            if (gWavSamplesWritten[receiverID] >= (gSampleRate * WAV_RECORD_SECONDS))
-            {
-                UpdateWavHeader(gWavFile[receiverID], gWavSamplesWritten[receiverID], 2);
-                fclose(gWavFile[receiverID]);
-                gWavFile[receiverID] = NULL;
-                
-                std::stringstream ss;
-                ss << "WAV recording completed for receiver " << receiverID
-                   << " (" << gWavSamplesWritten[receiverID] << " samples)";
-                write_text_to_log_file(ss.str());
-            }
-        }
+        // Samples must be visible before the new position (the store is a full barrier)
+        UberSDRStore64(&rx.iqProducerPos, producerPos + values);
         
         // Update shared memory sample count (for received samples, not processed)
-        if (gpSharedStatus != NULL && receiverID < MAX_RX_COUNT) {
-            gpSharedStatus->receivers[receiverID].samplesReceived++;
-            gpSharedStatus->receivers[receiverID].lastUpdateTime = ::GetCurrentTimeMs();
-        }
+        UberSDRSeqWriteBegin(&rx.stream.seq);
+        rx.stream.samplesReceived += numSamples;
+        rx.stream.lastUpdateTime = now;
+        UberSDRSeqWriteEnd(&rx.stream.seq);
     }
+    
+    // Debug WAV recording is written block-wise by ConsumeRingBuffers(), the
+    // single writer for gWavFile[]
+    
+    // RING BUFFER: Write to ring buffer instead of directly to gInPtr
+    // This decouples async WebSocket reception from sync processing
+    // Samples that don't fit are dropped and counted as overruns by the ring
+    myUberSDR.receivers[receiverID].ringBuffer.writeBlock(pFrameIQ, (size_t)numSamples);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // Ring buffer consumer - reads from ring buffers and fills processing buffers
 // This runs in a separate thread to provide consistent timing
-// HIGH-RESOLUTION TIMING: Uses QueryPerformanceCounter for precise sample timing
+// BLOCK PACING: wakes once per gBlockInSamples (BLOCKS_PER_SEC times a second)
+// on a high-resolution waitable timer, moves a whole block out of every
+// receiver's ring in one pass and fires pIQProc. Block deadlines are derived
+// from QueryPerformanceCounter so timer jitter never accumulates into drift.
+
+// ADAPTIVE RATE: with [Buffer] AdaptiveRate=1 each receiver's ring is held at
+// its target depth instead of drifting with the difference between radiod's
+// sample clock and QueryPerformanceCounter. The consumer primes the ring to
+// the target, then a PI loop on the smoothed fill level sets a small ratio
+// correction for a cubic resampler between the ring and gInPtr.
+#define DRIFT_FILL_SMOOTH_S   1.0      // Fill level low-pass time constant
+#define DRIFT_KP_PPM          20000.0  // ppm per second of fill error
+#define DRIFT_INTEGRAL_S      200.0    // Integral time (critically damped with DRIFT_KP_PPM)
+#define DRIFT_MAX_PPM         1000.0   // Correction limit
+
+struct DriftControl {
+    bool running;       // Set up for the receiver's current stream
+    bool primed;        // Ring reached the target depth since start / the last underrun
+    double fill;        // Smoothed ring fill, samples
+    double integral;    // Integral of the fill error, seconds * seconds
+    double ppm;         // Current rate correction
+    iq_resample resampler;
+    std::vector<float> scratch;  // Ring samples for one block
+};
+
+// Update the correction from the ring fill seen at this block and return the
+// resampler ratio (input samples per output sample)
+static double UpdateDriftControl(DriftControl* dc, size_t available, size_t target,
+                                 double blockSeconds, int sampleRate)
+{
+    double alpha = blockSeconds / DRIFT_FILL_SMOOTH_S;
+    if (alpha > 1.0) alpha = 1.0;
+    dc->fill += alpha * ((double)available - dc->fill);
+    
+    double error = (dc->fill - (double)target) / sampleRate;  // Seconds, + = ring too full
+    double ppm = DRIFT_KP_PPM * (error + dc->integral / DRIFT_INTEGRAL_S);
+    if (ppm > DRIFT_MAX_PPM) {
+        ppm = DRIFT_MAX_PPM;
+    } else if (ppm < -DRIFT_MAX_PPM) {
+        ppm = -DRIFT_MAX_PPM;
+    } else {
+        dc->integral += error * blockSeconds;  // Only while unclamped (anti-windup)
+    }
+    dc->ppm = ppm;
+    return 1.0 + ppm * 1e-6;
+}
+
+// Outage accounting: zeros handed to the Skimmer per WebSocket drop. Zeros
+// accumulate until the ring delivers a full block again; if a drop happened
+// and the receiver has reconnected by then, the run is recorded as an outage.
+struct OutageTrack {
+    bool running;          // Set up for the receiver's current stream
+    LONG accounted;        // Disconnects already recorded
+    int64_t zeroSamples;   // Zero-filled samples since the last full block
+};
+
+static void RecordOutage(int receiverID, int64_t zeroSamples)
+{
+    using namespace UberSDRIntf;
+    
+    if (gpSharedStatus == NULL) {
+        return;
+    }
+    
+    ReceiverInfo& rx = myUberSDR.receivers[receiverID];
+    UberSDRSharedStatusV2::ReceiverStatus::Outages& out = gpSharedStatus->receivers[receiverID].outages;
+    UberSDRSeqWriteBegin(&out.seq);
+    UberSDRSharedStatusV2::ReceiverStatus::Outages::Entry& e =
+        out.history[out.count % UBERSDR_OUTAGE_HISTORY];
+    e.endTime = GetCurrentTimeMs();
+    e.zeroSamples = zeroSamples;
+    e.reconnectMs = rx.lastReconnectMs.load();
+    e.attempts = rx.lastReconnectAttempts.load();
+    out.count++;
+    out.totalZeroSamples += zeroSamples;
+    UberSDRSeqWriteEnd(&out.seq);
+    
+    std::stringstream ss;
+    ss << "Receiver " << receiverID << " outage: reconnected in " << e.reconnectMs
+       << " ms after " << e.attempts << " attempt(s), " << zeroSamples << " samples zero-filled ("
+       << (zeroSamples * 1000 / gSampleRate) << " ms)";
+    write_text_to_log_file(ss.str());
+}
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
 void ConsumeRingBuffers()
 {
     using namespace UberSDRIntf;
@@ -566,12 +843,76 @@ void ConsumeRingBuffers()
     // High-resolution timing setup
     LARGE_INTEGER frequency, startTime, currentTime;
     QueryPerformanceFrequency(&frequency);
-    int64_t samplesProcessed = 0;
+    int64_t blocksProcessed = 0;
     bool timingInitialized = false;
     
+    // Adaptive rate and outage state, owned by this thread
+    static DriftControl drift[MAX_RX_COUNT];
+    static OutageTrack outage[MAX_RX_COUNT];
+    
+    // Outage history covers this run of the consumer (StartRx to StopRx)
+    if (gpSharedStatus != NULL) {
+        for (int i = 0; i < MAX_RX_COUNT; i++) {
+            UberSDRSharedStatusV2::ReceiverStatus::Outages& out = gpSharedStatus->receivers[i].outages;
+            UberSDRSeqWriteBegin(&out.seq);
+            out.count = 0;
+            out.totalZeroSamples = 0;
+            memset(out.history, 0, sizeof(out.history));
+            UberSDRSeqWriteEnd(&out.seq);
+        }
+    }
+    
+    // Scheduling ([Scheduling] in the INI): MMCSS "Pro Audio" lifts this
+    // thread above Skimmer Server's decoder threads while it waits on the
+    // timer, so it is on time without spinning; without the MMCSS service it
+    // falls back to the highest normal priority. An affinity mask can keep
+    // it on cores the network threads (NetworkAffinity) stay off.
+    HANDLE hMmcss = NULL;
+    if (myUberSDR.mmcss) {
+        DWORD mmcssTask = 0;
+        hMmcss = AvSetMmThreadCharacteristicsW(L"Pro Audio", &mmcssTask);
+        if (hMmcss != NULL) {
+            AvSetMmThreadPriority(hMmcss, AVRT_PRIORITY_HIGH);
+        } else {
+            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+        }
+    }
+    if (myUberSDR.consumerAffinity != 0 &&
+        SetThreadAffinityMask(GetCurrentThread(), myUberSDR.consumerAffinity) == 0) {
+        std::stringstream ss;
+        ss << "Ring buffer consumer: Failed to set affinity 0x" << std::hex << myUberSDR.consumerAffinity
+           << std::dec << " (error " << GetLastError() << ")";
+        write_text_to_log_file(ss.str());
+    }
+    
+    // High-resolution waitable timer (Windows 10 1803+); fall back to a normal
+    // waitable timer, which is coarser but still keeps the long-term rate exact.
+    // The normal timer fires on the system timer tick, so raise its resolution
+    // (TimerResolutionMs) for as long as the consumer runs.
+    HANDLE hTimer = CreateWaitableTimerExW(NULL, NULL,
+        CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    bool highResTimer = (hTimer != NULL);
+    if (hTimer == NULL) {
+        hTimer = CreateWaitableTimerW(NULL, TRUE, NULL);
+    }
+    UINT timerPeriod = 0;
+    if (!highResTimer && myUberSDR.timerResolutionMs > 0 &&
+        timeBeginPeriod((UINT)myUberSDR.timerResolutionMs) == TIMERR_NOERROR) {
+        timerPeriod = (UINT)myUberSDR.timerResolutionMs;
+    }
+    
     std::stringstream ss;
-    ss << "Ring buffer consumer: High-resolution timing enabled (frequency: "
-       << frequency.QuadPart << " Hz)";
+    ss << "Ring buffer consumer: Block pacing enabled (frequency: "
+       << frequency.QuadPart << " Hz, "
+       << (highResTimer ? "high-resolution" : "standard") << " waitable timer";
+    if (timerPeriod != 0) {
+        ss << " at " << timerPeriod << " ms";
+    }
+    ss << ", " << (hMmcss != NULL ? "MMCSS Pro Audio" : (myUberSDR.mmcss ? "high priority" : "normal priority"));
+    if (myUberSDR.consumerAffinity != 0) {
+        ss << ", affinity 0x" << std::hex << myUberSDR.consumerAffinity << std::dec;
+    }
+    ss << ")";
     write_text_to_log_file(ss.str());
     
     while (!gStopFlag)
@@ -580,91 +921,164 @@ void ConsumeRingBuffers()
         if (gActiveReceivers == 0) {
             Sleep(10);
             timingInitialized = false;
-            samplesProcessed = 0;
+            blocksProcessed = 0;
             continue;
         }
         
-        // Initialize timing on first sample
+        // Initialize timing on first block
         if (!timingInitialized) {
             QueryPerformanceCounter(&startTime);
-            samplesProcessed = 0;
+            blocksProcessed = 0;
             timingInitialized = true;
             
             ss.str("");
-            ss << "Ring buffer consumer: Timing initialized at sample rate " << gSampleRate << " Hz";
+            ss << "Ring buffer consumer: Timing initialized at sample rate " << gSampleRate
+               << " Hz, " << gBlockInSamples << " samples per block";
             write_text_to_log_file(ss.str());
         }
         
-        // Calculate target time for this sample (in performance counter ticks)
-        // Target = startTime + (samplesProcessed * ticksPerSecond / sampleRate)
+        // Deadline for the END of this block (in performance counter ticks):
+        // the block is only complete once all of its samples have "arrived"
+        // Target = startTime + ((blocksProcessed + 1) * blockSize * ticksPerSecond / sampleRate)
         int64_t targetTicks = startTime.QuadPart +
-            ((samplesProcessed * frequency.QuadPart) / gSampleRate);
+            (((blocksProcessed + 1) * (int64_t)gBlockInSamples * frequency.QuadPart) / gSampleRate);
         
-        // Try to read one sample from each active receiver's ring buffer
-        bool anyBufferEmpty = false;
+        // Wait until the block is due
+        QueryPerformanceCounter(&currentTime);
+        int64_t ticksRemaining = targetTicks - currentTime.QuadPart;
         
+        if (ticksRemaining > 0) {
+            if (hTimer != NULL) {
+                // Relative due time in 100ns units (negative = relative)
+                LARGE_INTEGER dueTime;
+                dueTime.QuadPart = -((ticksRemaining * 10000000) / frequency.QuadPart);
+                if (dueTime.QuadPart == 0) dueTime.QuadPart = -1;
+                if (SetWaitableTimer(hTimer, &dueTime, 0, NULL, NULL, FALSE)) {
+                    WaitForSingleObject(hTimer, INFINITE);
+                } else {
+                    Sleep((DWORD)((ticksRemaining * 1000) / frequency.QuadPart));
+                }
+            } else {
+                Sleep((DWORD)((ticksRemaining * 1000) / frequency.QuadPart));
+            }
+        } else if (ticksRemaining < -frequency.QuadPart / 100) {
+            // More than 10ms behind - we're falling behind, log warning once per second
+            static int64_t lastWarning = 0;
+            int64_t now = GetCurrentTimeMs();
+            if (now - lastWarning > 1000) {
+                int64_t usBehind = (-ticksRemaining * 1000000) / frequency.QuadPart;
+                std::stringstream ss;
+                ss << "WARNING: Ring buffer consumer falling behind by " << usBehind << " us";
+                write_text_to_log_file(ss.str());
+                lastWarning = now;
+            }
+        }
+        
+        if (gStopFlag) {
+            break;
+        }
+        
+        // Move one full block from each active receiver's ring buffer into gInPtr
         for (int receiverID = 0; receiverID < gSet.RecvCount; receiverID++)
         {
             if (!myUberSDR.receivers[receiverID].active) {
+                drift[receiverID].running = false;
+                outage[receiverID].running = false;
                 continue;
             }
             
-            float I_float, Q_float;
-            if (!myUberSDR.receivers[receiverID].ringBuffer.read(I_float, Q_float)) {
-                // Buffer underrun - mark that at least one buffer is empty
-                anyBufferEmpty = true;
-                
-                // Fill with zeros (silence) and continue
-                // This prevents one slow receiver from holding up all others
-                I_float = 0.0f;
-                Q_float = 0.0f;
-                
-                // Buffer underrun - silently fill with zeros
-                // (Logging removed to reduce log verbosity)
+            // Ring residence: what is queued ahead of this read, at the sample rate
+            if (gpSharedStatus != NULL) {
+                size_t queued = myUberSDR.receivers[receiverID].ringBuffer.available();
+                UberSDRHistRecord(&gpSharedStatus->receivers[receiverID].ringTiming.residence,
+                                  (int64_t)queued * 1000000 / gSampleRate);
             }
             
-            // SOFTWARE FREQUENCY SHIFT: Apply frequency offset in IQ domain
-            // This shifts the spectrum without retuning the radio
-            // Complex multiply: (I + jQ) * e^(j*phase) = (I + jQ) * (cos + j*sin)
-            float shifted_I = I_float;
-            float shifted_Q = Q_float;
-            
-            EnterCriticalSection(&myUberSDR.receivers[receiverID].lock);
-            double phaseIncrement = myUberSDR.receivers[receiverID].phaseIncrement;
+            // Cmplx is {float Re, Im}, i.e. the same interleaved layout as the ring
+            float* block = (float*)gInPtr[receiverID];
+            RingBuffer& ring = myUberSDR.receivers[receiverID].ringBuffer;
+            size_t targetDepth = myUberSDR.receivers[receiverID].targetDepth;
+            size_t zeroFilled = 0;
             
-            if (phaseIncrement != 0.0) {
-                // Get current phase
-                double phase = myUberSDR.receivers[receiverID].phaseAccumulator;
-                
-                // Calculate sin/cos for this phase
-                double cosPhase = cos(phase);
-                double sinPhase = sin(phase);
+            if (targetDepth == 0) {
+                size_t got = ring.readBlock(block, (size_t)gBlockInSamples);
+                if (got < (size_t)gBlockInSamples) {
+                    // Buffer underrun - fill the rest with zeros (silence)
+                    // This prevents one slow receiver from holding up all others
+                    memset(block + got * 2, 0, ((size_t)gBlockInSamples - got) * sizeof(Cmplx));
+                    zeroFilled = (size_t)gBlockInSamples - got;
+                }
+            } else {
+                DriftControl& dc = drift[receiverID];
+                if (!dc.running) {
+                    iq_resample_init(&dc.resampler);
+                    dc.primed = false;
+                    dc.fill = 0.0;
+                    dc.integral = 0.0;
+                    dc.ppm = 0.0;
+                    dc.running = true;
+                }
                 
-                // Complex multiply: (I + jQ) * (cos + j*sin)
-                // Real part: I*cos - Q*sin
-                // Imag part: I*sin + Q*cos
-                shifted_I = (float)(I_float * cosPhase - Q_float * sinPhase);
-                shifted_Q = (float)(I_float * sinPhase + Q_float * cosPhase);
+                size_t available = ring.available();
+                if (!dc.primed && available >= targetDepth) {
+                    dc.primed = true;
+                    dc.fill = (double)available;  // Learned integral is kept across re-priming
+                }
                 
-                // Increment phase and wrap to avoid precision loss
-                phase += phaseIncrement;
-                if (phase > 2.0 * 3.14159265358979323846) {
-                    phase -= 2.0 * 3.14159265358979323846;
-                } else if (phase < -2.0 * 3.14159265358979323846) {
-                    phase += 2.0 * 3.14159265358979323846;
+                if (!dc.primed) {
+                    // Filling up to the target depth - silence, not an underrun
+                    memset(block, 0, (size_t)gBlockInSamples * sizeof(Cmplx));
+                    zeroFilled = (size_t)gBlockInSamples;
+                } else {
+                    double ratio = UpdateDriftControl(&dc, available, targetDepth,
+                                                      (double)gBlockInSamples / gSampleRate, gSampleRate);
+                    iq_resample_set_ratio(&dc.resampler, ratio);
+                    
+                    size_t needed = iq_resample_needed(&dc.resampler, (size_t)gBlockInSamples);
+                    if (dc.scratch.size() < needed * 2) {
+                        dc.scratch.resize(needed * 2);
+                    }
+                    size_t got = ring.readBlock(dc.scratch.data(), needed);
+                    if (got < needed) {
+                        // Underrun - pad with silence and prime again
+                        memset(dc.scratch.data() + got * 2, 0, (needed - got) * sizeof(Cmplx));
+                        dc.primed = false;
+                        zeroFilled = needed - got;
+                    }
+                    iq_resample_run(&dc.resampler, dc.scratch.data(), needed, block, (size_t)gBlockInSamples);
+                }
+            }
+            
+            // Outage accounting: on the first full block after a reconnect,
+            // record the zeros sent since the last full block before it
+            OutageTrack& ot = outage[receiverID];
+            if (!ot.running) {
+                ot.accounted = myUberSDR.receivers[receiverID].disconnects.load();
+                ot.zeroSamples = 0;
+                ot.running = true;
+            }
+            if (zeroFilled > 0) {
+                ot.zeroSamples += (int64_t)zeroFilled;
+            } else {
+                LONG drops = myUberSDR.receivers[receiverID].disconnects.load();
+                if (drops != ot.accounted &&
+                    myUberSDR.receivers[receiverID].reconnects.load() == drops) {
+                    RecordOutage(receiverID, ot.zeroSamples);
+                    ot.accounted = drops;
                 }
-                myUberSDR.receivers[receiverID].phaseAccumulator = phase;
+                ot.zeroSamples = 0;
             }
-            LeaveCriticalSection(&myUberSDR.receivers[receiverID].lock);
             
             // Write to WAV file if recording (first 10 seconds)
             // NOTE: WAV file gets ORIGINAL (unshifted) IQ data for debugging
             if (gWavFile[receiverID] != NULL && gWavSamplesWritten[receiverID] < (gSampleRate * WAV_RECORD_SECONDS))
             {
+                int remaining = (gSampleRate * WAV_RECORD_SECONDS) - gWavSamplesWritten[receiverID];
+                int toWrite = (gBlockInSamples < remaining) ? gBlockInSamples : remaining;
+                
                 // Write as stereo float: I (left), Q (right)
-                fwrite(&I_float, sizeof(float), 1, gWavFile[receiverID]);
-                fwrite(&Q_float, sizeof(float), 1, gWavFile[receiverID]);
-                gWavSamplesWritten[receiverID]++;
+                fwrite(block, sizeof(Cmplx), toWrite, gWavFile[receiverID]);
+                gWavSamplesWritten[receiverID] += toWrite;
                 
                 // Close file after 10 seconds
                 if (gWavSamplesWritten[receiverID] >= (gSampleRate * WAV_RECORD_SECONDS))
@@ -680,27 +1094,20 @@ void ConsumeRingBuffers()
                 }
             }
             
-            // Write SHIFTED samples to processing buffer (Skimmer Server gets shifted IQ)
-            gInPtr[receiverID]->Re = shifted_I;
-            gInPtr[receiverID]->Im = shifted_Q;
-            (gInPtr[receiverID])++;
-            
-            gDataSamples[receiverID]++;
-            
-            // Check if THIS receiver's buffer is full
-            if (gDataSamples[receiverID] >= gBlockInSamples)
-        {
-            // Track timing for diagnostics
-            static int64_t lastBufferFillTime[MAX_RX_COUNT] = {0};
-            int64_t bufferFillTime = GetCurrentTimeMs();
-            int64_t timeSinceLastFill = bufferFillTime - lastBufferFillTime[receiverID];
-            lastBufferFillTime[receiverID] = bufferFillTime;
+            // SOFTWARE FREQUENCY SHIFT: Apply frequency offset in IQ domain
+            // This shifts the spectrum without retuning the radio
+            // Complex multiply: (I + jQ) * e^(j*phase), done by a block NCO
+            // (rotating phasor, SIMD) instead of cos/sin per sample.
+            // The increment is snapshotted once per block; a new offset takes
+            // effect at the next block boundary with the phase kept continuous.
+            static iq_nco nco[MAX_RX_COUNT] = {};
+            double phaseIncrement = myUberSDR.receivers[receiverID].phaseIncrement.load(std::memory_order_acquire);
+            iq_nco_set_inc(&nco[receiverID], phaseIncrement);
+            iq_nco_mix(&nco[receiverID], (float*)gInPtr[receiverID], (size_t)gBlockInSamples);
             
             // CRITICAL: Enter critical section for ALL buffer management
             // This ensures atomic buffer switching and prevents race conditions
-            int64_t lockWaitStart = ::GetCurrentTimeMs();
             EnterCriticalSection(&gDataCriticalSection);
-            int64_t lockWaitTime = ::GetCurrentTimeMs() - lockWaitStart;
             
             // MATCH HERMES EXACTLY: Check if not already filled, then mark and toggle
             // This prevents double-toggling when a receiver fills again before callback
@@ -725,104 +1132,98 @@ void ConsumeRingBuffers()
             }
             gDataSamples[receiverID] = 0;
             
-            // Lock wait time tracking (logging removed to reduce verbosity)
+            LeaveCriticalSection(&gDataCriticalSection);
+        }
+        
+        // All receivers were filled in the pass above - make the callback
+        EnterCriticalSection(&gDataCriticalSection);
+        if (gRxFilled == gRxMask)
+        {
+            // Update shared memory callback count
+            if (gpSharedStatus != NULL) {
+                UberSDRSeqWriteBegin(&gpSharedStatus->totals.seq);
+                gpSharedStatus->totals.totalCallbacks++;
+                gpSharedStatus->totals.totalSamples += gBlockInSamples;
+                UberSDRSeqWriteEnd(&gpSharedStatus->totals.seq);
+            }
             
-            // Check if all receivers are ready and make callback if so
-            if (gRxFilled == gRxMask)
-            {
-                // Update shared memory callback count
-                if (gpSharedStatus != NULL) {
-                    gpSharedStatus->totalCallbacks++;
-                    gpSharedStatus->totalSamples += gBlockInSamples;
+            // Log first few callbacks for debugging
+            static int callCount = 0;
+            if (callCount < 10) {
+                std::stringstream ss;
+                ss << "Calling pIQProc #" << callCount << ": " << gBlockInSamples << " samples @ " << gSampleRate << " Hz, "
+                   << gSet.RecvCount << " receivers. Rx0: I=" << gOutPtr[0][0].Re << ", Q=" << gOutPtr[0][0].Im;
+                if (gSet.RecvCount > 1) {
+                    ss << ", Rx1: I=" << gOutPtr[1][0].Re << ", Q=" << gOutPtr[1][0].Im;
                 }
-                
-                // Log first few callbacks for debugging
-                static int callCount = 0;
-                if (callCount < 10) {
-                    std::stringstream ss;
-                    ss << "Calling pIQProc #" << callCount << ": " << gBlockInSamples << " samples @ " << gSampleRate << " Hz, "
-                       << gSet.RecvCount << " receivers. Rx0: I=" << gOutPtr[0][0].Re << ", Q=" << gOutPtr[0][0].Im;
-                    if (gSet.RecvCount > 1) {
-                        ss << ", Rx1: I=" << gOutPtr[1][0].Re << ", Q=" << gOutPtr[1][0].Im;
+                write_text_to_log_file(ss.str());
+                callCount++;
+            }
+            
+            // Periodic status update every 10 seconds (logging removed, metrics still tracked)
+            static int64_t lastStatusLog = 0;
+            int64_t now = GetCurrentTimeMs();
+            if (now - lastStatusLog >= 10000) {
+                // Update ring buffer metrics in shared memory (without logging)
+                for (int i = 0; i < gSet.RecvCount; i++) {
+                    if (myUberSDR.receivers[i].active && gpSharedStatus) {
+                        float fillLevel = myUberSDR.receivers[i].ringBuffer.fillLevel();
+                        int overruns = myUberSDR.receivers[i].ringBuffer.overrunCount;
+                        int underruns = myUberSDR.receivers[i].ringBuffer.underrunCount;
+                        
+                        UberSDRSharedStatusV2::ReceiverStatus::Ring& ring = gpSharedStatus->receivers[i].ring;
+                        UberSDRSeqWriteBegin(&ring.seq);
+                        ring.ringBufferFillLevel = fillLevel;
+                        ring.ringBufferOverruns = overruns;
+                        ring.ringBufferUnderruns = underruns;
+                        ring.ringBufferCapacity = (int)myUberSDR.receivers[i].ringBuffer.capacity;
+                        ring.targetDepthMs = (int)((int64_t)myUberSDR.receivers[i].targetDepth * 1000 / gSampleRate);
+                        ring.rateCorrectionPpm = (float)drift[i].ppm;
+                        UberSDRSeqWriteEnd(&ring.seq);
                     }
-                    write_text_to_log_file(ss.str());
-                    callCount++;
                 }
+                lastStatusLog = now;
+            }
+            
+            // Pass output pointers (like Hermes Protocol 2), timing the call
+            // and the start-to-start interval for the shared histograms
+            if (gSet.pIQProc != NULL) {
+                static int64_t lastCallbackUs = 0;
+                int64_t callbackStartUs = GetTimeUs();
                 
-                // Periodic status update every 10 seconds (logging removed, metrics still tracked)
-                static int64_t lastStatusLog = 0;
-                int64_t now = GetCurrentTimeMs();
-                if (now - lastStatusLog >= 10000) {
-                    // Update ring buffer metrics in shared memory (without logging)
-                    for (int i = 0; i < gSet.RecvCount; i++) {
-                        if (myUberSDR.receivers[i].active && gpSharedStatus) {
-                            float fillLevel = myUberSDR.receivers[i].ringBuffer.fillLevel();
-                            int overruns = myUberSDR.receivers[i].ringBuffer.overrunCount;
-                            int underruns = myUberSDR.receivers[i].ringBuffer.underrunCount;
-                            
-                            gpSharedStatus->receivers[i].ringBufferFillLevel = fillLevel;
-                            gpSharedStatus->receivers[i].ringBufferOverruns = overruns;
-                            gpSharedStatus->receivers[i].ringBufferUnderruns = underruns;
-                            gpSharedStatus->receivers[i].ringBufferCapacity = (int)myUberSDR.receivers[i].ringBuffer.capacity;
-                        }
-                    }
-                    lastStatusLog = now;
-                }
+                (*gSet.pIQProc)(gSet.THandle, gOutPtr);
                 
-                // Pass output pointers (like Hermes Protocol 2)
-                if (gSet.pIQProc != NULL) {
-                    (*gSet.pIQProc)(gSet.THandle, gOutPtr);
+                if (gpSharedStatus != NULL) {
+                    UberSDRSharedStatusV2::CallbackTiming& timing = gpSharedStatus->callbackTiming;
+                    UberSDRHistRecord(&timing.duration, GetTimeUs() - callbackStartUs);
+                    if (lastCallbackUs != 0) {
+                        UberSDRHistRecord(&timing.interval, callbackStartUs - lastCallbackUs);
+                    }
                 }
-                
-                // Reset filled mask for next round
-                gRxFilled = 0;
+                lastCallbackUs = callbackStartUs;
             }
-            // Receiver waiting for others (logging removed to reduce verbosity)
             
-            LeaveCriticalSection(&gDataCriticalSection);
-        }
+            // Reset filled mask for next round
+            gRxFilled = 0;
         }
+        // Receiver waiting for others (logging removed to reduce verbosity)
+        LeaveCriticalSection(&gDataCriticalSection);
         
-        // Increment sample counter
-        samplesProcessed++;
-        
-        // HIGH-RESOLUTION TIMING: Wait until target time for this sample
-        // This ensures precise sample rate regardless of processing variations
-        QueryPerformanceCounter(&currentTime);
-        int64_t ticksRemaining = targetTicks - currentTime.QuadPart;
-        
-        if (ticksRemaining > 0) {
-            // Calculate microseconds remaining
-            int64_t usRemaining = (ticksRemaining * 1000000) / frequency.QuadPart;
-            
-            // If more than 1ms away, sleep to yield CPU
-            if (usRemaining > 1000) {
-                Sleep(1);
-            }
-            
-            // Busy-wait for final precision (last ~1ms)
-            while (currentTime.QuadPart < targetTicks) {
-                // Yield CPU if still >100us away
-                if ((targetTicks - currentTime.QuadPart) * 1000000 / frequency.QuadPart > 100) {
-                    Sleep(0);  // Yield to other threads
-                }
-                QueryPerformanceCounter(&currentTime);
-            }
-        } else if (ticksRemaining < -frequency.QuadPart / 100) {
-            // More than 10ms behind - we're falling behind, log warning once per second
-            static int64_t lastWarning = 0;
-            int64_t now = GetCurrentTimeMs();
-            if (now - lastWarning > 1000) {
-                int64_t usBehind = (-ticksRemaining * 1000000) / frequency.QuadPart;
-                std::stringstream ss;
-                ss << "WARNING: Ring buffer consumer falling behind by " << usBehind << " us";
-                write_text_to_log_file(ss.str());
-                lastWarning = now;
-            }
-        }
+        // Increment block counter
+        blocksProcessed++;
     }
     
-    write_text_to_log_file("Ring buffer consumer: High-resolution timing stopped");
+    if (hTimer != NULL) {
+        CloseHandle(hTimer);
+    }
+    if (timerPeriod != 0) {
+        timeEndPeriod(timerPeriod);
+    }
+    if (hMmcss != NULL) {
+        AvRevertMmThreadCharacteristics(hMmcss);
+    }
+    
+    write_text_to_log_file("Ring buffer consumer: Block pacing stopped");
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1049,55 +1450,8 @@ namespace UberSDRIntf
                 ss << "Using IQ mode: " << iqMode;
                 write_text_to_log_file(ss.str());
                 
-                // Start worker threads for each receiver
-                for (int i = 0; i < gSet.RecvCount; i++)
-                {
-                    // Start receiver with default frequency (will be set by SetRxFrequency)
-                    int result = myUberSDR.StartReceiver(i, 14074000, iqMode);
-                    if (result != 0)
-                    {
-                        ss.str("");
-                        ss << "Failed to start receiver " << i;
-                        rt_exception(ss.str());
-                        continue;
-                    }
-                    
-                    // Initialize phase increment for software frequency shift
-                    // Use INI global offset as initial offset
-                    // NEGATE phase increment: positive offset shifts spectrum DOWN
-                    double totalOffset = (double)myUberSDR.frequencyOffset;
-                    double phaseInc = -2.0 * 3.14159265358979323846 * totalOffset / (double)gSampleRate;
-                    
-                    EnterCriticalSection(&myUberSDR.receivers[i].lock);
-                    myUberSDR.receivers[i].phaseIncrement = phaseInc;
-                    myUberSDR.receivers[i].phaseAccumulator = 0.0;
-                    LeaveCriticalSection(&myUberSDR.receivers[i].lock);
-                    
-                    // Update shared memory for this receiver
-                    if (gpSharedStatus != NULL) {
-                        gpSharedStatus->receivers[i].active = true;
-                        gpSharedStatus->receivers[i].frequency = 14074000;
-                        gpSharedStatus->receivers[i].frequencyOffset = 0;  // Initialize per-receiver offset
-                        gpSharedStatus->receivers[i].globalFrequencyOffset = myUberSDR.frequencyOffset;  // INI offset
-                        gpSharedStatus->receivers[i].totalFrequencyOffset = myUberSDR.frequencyOffset;  // INI offset (software shift)
-                        gpSharedStatus->receivers[i].requestedOffset = 0;
-                        gpSharedStatus->receivers[i].offsetApplied = 0;
-                        strncpy_s(gpSharedStatus->receivers[i].sessionId,
-                                  sizeof(gpSharedStatus->receivers[i].sessionId),
-                                  myUberSDR.receivers[i].sessionId.c_str(), _TRUNCATE);
-                    }
-                    
-                    // Start worker thread
-                    ghWrk[i] = CreateThread(NULL, 0, Worker, (LPVOID)(INT_PTR)i, 0, &gidWrk[i]);
-                    if (ghWrk[i] == NULL)
-                    {
-                        ss.str("");
-                        ss << "Failed to start worker thread for receiver " << i;
-                        rt_exception(ss.str());
-                    }
-                }
-                
-                // Start ring buffer consumer thread
+                // Start ring buffer consumer thread (it skips receivers that
+                // are not connected yet)
                 write_text_to_log_file("Starting ring buffer consumer thread...");
                 ghRingBufferConsumer = CreateThread(NULL, 0, RingBufferConsumerThread, NULL, 0, &gidRingBufferConsumer);
                 if (ghRingBufferConsumer == NULL)
@@ -1109,8 +1463,27 @@ namespace UberSDRIntf
                     write_text_to_log_file("Ring buffer consumer thread started successfully");
                 }
                 
-                write_text_to_log_file("All receivers started");
                 UpdateSharedStatus();
+                
+                // Start each receiver on its own thread: the connection
+                // checks and WebSocket handshakes run in parallel, and StartRx
+                // returns straight away so the Skimmer's SetRxFrequency calls
+                // reach the receivers before they connect
+                WaitStartupThreads();
+                gStartupPending = gSet.RecvCount;
+                for (int i = 0; i < gSet.RecvCount; i++)
+                {
+                    ghStart[i] = CreateThread(NULL, 0, StartupThread, (LPVOID)(INT_PTR)i, 0, NULL);
+                    if (ghStart[i] == NULL)
+                    {
+                        InterlockedDecrement(&gStartupPending);
+                        ss.str("");
+                        ss << "Failed to start startup thread for receiver " << i;
+                        rt_exception(ss.str());
+                    }
+                }
+                
+                write_text_to_log_file("All receivers starting");
             }
             else
             {
@@ -1146,6 +1519,11 @@ namespace UberSDRIntf
                     write_text_to_log_file("Ring buffer consumer thread stopped");
                 }
                 
+                // Let receivers still connecting finish. One that connects
+                // after gStopFlag starts no worker and is left active, so the
+                // loops below see, and stop, every started receiver
+                WaitStartupThreads();
+                
                 // Wait for and close worker threads (only up to RecvCount)
                 for (int i = 0; i < receiversToStop; i++)
                 {
@@ -1165,6 +1543,12 @@ namespace UberSDRIntf
                     }
                 }
                 
+                // The next StartRx connects on the first frequency requested after it
+                for (int i = 0; i < MAX_RX_COUNT; i++)
+                {
+                    myUberSDR.receivers[i].requestedFrequency.store(0);
+                }
+                
                 write_text_to_log_file("StopRx completed");
             }
             catch (const std::exception& e) {
@@ -1195,6 +1579,10 @@ namespace UberSDRIntf
                 // Store frequency for WAV filename
                 gWavFrequency[Receiver] = Frequency;
                 
+                // Remember it for a receiver that is still starting: its
+                // startup thread connects on this frequency
+                myUberSDR.receivers[Receiver].requestedFrequency.store(Frequency);
+                
                 // Start WAV recording if debug_rec is enabled and not already recording
                 if (myUberSDR.debugRec && gWavFile[Receiver] == NULL && gSampleRate > 0)
                 {
@@ -1223,13 +1611,27 @@ namespace UberSDRIntf
                     return;
                 }
                 
-                // Receiver is active, just change frequency
+                // Receiver is active, just change frequency. Tune and publish
+                // under the tune lock: its startup thread may be doing the
+                // same for an older request (see StartReceiverOnce)
+                EnterCriticalSection(&gTuneLock[Receiver]);
                 myUberSDR.SetFrequency(Receiver, Frequency);
                 
                 // Update shared memory
                 if (gpSharedStatus != NULL && Receiver < MAX_RX_COUNT) {
-                    gpSharedStatus->receivers[Receiver].frequency = Frequency;
-                    gpSharedStatus->lastUpdateTime = ::GetCurrentTimeMs();
+                    UberSDRSharedStatusV2::ReceiverStatus::Tuning& tuning = gpSharedStatus->receivers[Receiver].tuning;
+                    UberSDRSeqWriteBegin(&tuning.seq);
+                    tuning.frequency = Frequency;
+                    UberSDRSeqWriteEnd(&tuning.seq);
+                }
+                LeaveCriticalSection(&gTuneLock[Receiver]);
+                
+                if (gpSharedStatus != NULL) {
+                    EnterCriticalSection(&gConfigLock);
+                    UberSDRSeqWriteBegin(&gpSharedStatus->config.seq);
+                    gpSharedStatus->config.lastUpdateTime = ::GetCurrentTimeMs();
+                    UberSDRSeqWriteEnd(&gpSharedStatus->config.seq);
+                    LeaveCriticalSection(&gConfigLock);
                 }
             }
             catch (const std::exception& e) {
@@ -19,6 +19,20 @@ int64_t GetCurrentTimeMs()
     return (int64_t)(uli.QuadPart / 10000ULL - 11644473600000ULL);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Get monotonic time in microseconds
+int64_t GetTimeUs()
+{
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);  // Fixed at boot - racing threads store the same value
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (int64_t)((counter.QuadPart / frequency.QuadPart) * 1000000 +
+                     ((counter.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Build shared memory name for a given process ID
 void BuildSharedMemoryName(DWORD processID, wchar_t* buffer, size_t bufferSize)
@@ -334,15 +348,15 @@ void CleanupStaleInstances()
 
 ///////////////////////////////////////////////////////////////////////////////
 // Send frequency offset command to DLL
-BOOL SendFrequencyOffsetCommand(UberSDRSharedStatus* pStatus, int receiverID, int frequencyOffset, BOOL applyImmediately)
+BOOL SendFrequencyOffsetCommand(UberSDRCommandQueue* pQueue, int receiverID, int frequencyOffset, BOOL applyImmediately)
 {
-    if (pStatus == NULL || receiverID < 0 || receiverID >= MAX_RX_COUNT) {
+    if (pQueue == NULL || receiverID < 0 || receiverID >= MAX_RX_COUNT) {
         return FALSE;
     }
     
     // Get next write position
-    int32_t writePos = pStatus->commandWritePos;
-    int32_t readPos = pStatus->commandReadPos;
+    int32_t writePos = pQueue->commandWritePos;
+    int32_t readPos = pQueue->commandReadPos;
     
     // Check if queue is full (leave one slot empty to distinguish full from empty)
     if (((writePos + 1) % 16) == readPos) {
@@ -354,7 +368,7 @@ BOOL SendFrequencyOffsetCommand(UberSDRSharedStatus* pStatus, int receiverID, in
     int32_t seqNum = InterlockedIncrement((volatile LONG*)&sequenceCounter);
     
     // Fill command structure
-    UberSDRCommand* cmd = &pStatus->commandQueue[writePos % 16];
+    UberSDRCommand* cmd = &pQueue->commandQueue[writePos % 16];
     cmd->commandType = applyImmediately ? CMD_APPLY_OFFSET : CMD_SET_FREQUENCY_OFFSET;
     cmd->receiverID = receiverID;
     cmd->frequencyOffset = frequencyOffset;
@@ -363,16 +377,16 @@ BOOL SendFrequencyOffsetCommand(UberSDRSharedStatus* pStatus, int receiverID, in
     cmd->timestamp = GetCurrentTimeMs();
     
     // Advance write position (atomic)
-    InterlockedExchange((volatile LONG*)&pStatus->commandWritePos, (writePos + 1) % 16);
+    InterlockedExchange((volatile LONG*)&pQueue->commandWritePos, (writePos + 1) % 16);
     
     return TRUE;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // Wait for command acknowledgment
-BOOL WaitForCommandAck(UberSDRSharedStatus* pStatus, int32_t sequenceNumber, int timeoutMs)
+BOOL WaitForCommandAck(UberSDRCommandQueue* pQueue, int32_t sequenceNumber, int timeoutMs)
 {
-    if (pStatus == NULL) {
+    if (pQueue == NULL) {
         return FALSE;
     }
     
@@ -382,7 +396,7 @@ BOOL WaitForCommandAck(UberSDRSharedStatus* pStatus, int32_t sequenceNumber, int
     while ((GetCurrentTimeMs() - startTime) < timeoutMs) {
         // Search command queue for our sequence number
         for (int i = 0; i < 16; i++) {
-            UberSDRCommand* cmd = &pStatus->commandQueue[i];
+            UberSDRCommand* cmd = &pQueue->commandQueue[i];
             if (cmd->sequenceNumber == sequenceNumber && cmd->acknowledged == sequenceNumber) {
                 return TRUE;  // Command acknowledged
             }
@@ -3,10 +3,13 @@
 #define UBERSDR_SHARED_H
 
 #include <stdint.h>
+#include <string.h>
 
 // Multi-instance support: Each DLL instance creates unique shared memory
-// Format: UberSDRIntf_Status_v1_{ProcessID}
-#define UBERSDR_SHARED_MEMORY_PREFIX L"UberSDRIntf_Status_v1"
+// Format: UberSDRIntf_Status_v2_{ProcessID} (UberSDRSharedStatusV2). Older
+// DLLs create UberSDRIntf_Status_v1_{ProcessID} (UberSDRSharedStatus).
+#define UBERSDR_SHARED_MEMORY_PREFIX L"UberSDRIntf_Status_v2"
+#define UBERSDR_SHARED_MEMORY_PREFIX_V1 L"UberSDRIntf_Status_v1"
 #define UBERSDR_SHARED_MEMORY_NAME L"UberSDRIntf_Status_v1"  // Legacy name for backward compatibility
 
 // Registry paths for instance tracking
@@ -37,7 +40,15 @@ struct UberSDRCommand {
     volatile int64_t timestamp;        // Command timestamp
 };
 
-// Shared status structure - updated by DLL, read by monitor
+// Command queue for monitor-to-DLL communication (same layout in v1 and v2)
+struct UberSDRCommandQueue {
+    UberSDRCommand commandQueue[16];  // Ring buffer of commands
+    volatile int32_t commandWritePos;  // Write position (monitor writes here)
+    volatile int32_t commandReadPos;   // Read position (DLL reads here)
+};
+
+// Shared status structure, version 1 - written by older DLLs, still read by
+// the monitor. New DLLs publish UberSDRSharedStatusV2 below.
 struct UberSDRSharedStatus {
     // Server information
     char serverHost[64];
@@ -100,11 +111,230 @@ struct UberSDRSharedStatus {
     DWORD processID;  // Process ID of the DLL instance
     
     // Command queue for monitor-to-DLL communication
-    UberSDRCommand commandQueue[16];  // Ring buffer of commands
-    volatile int32_t commandWritePos;  // Write position (monitor writes here)
-    volatile int32_t commandReadPos;   // Read position (DLL reads here)
+    UberSDRCommandQueue commands;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Shared status structure, version 2
+//
+// Fields are grouped by the DLL thread that writes them and every group
+// starts on its own cache line, so the per-frame IQ writes don't drag the
+// monitor's reads of configuration (or each other's receivers) along. A
+// group with more than one field carries a seqlock: the writer makes seq odd
+// while it updates the group, readers copy the group with UberSDRSeqRead()
+// and retry if seq was odd or changed. Each group has a single writer.
+#define UBERSDR_STATUS_MAGIC   0x32524455  // "UDR2"
+#define UBERSDR_STATUS_VERSION 2
+#define UBERSDR_CACHE_LINE     64
+
+// Latency histogram - fixed log2 buckets in microseconds. Bucket 0 counts
+// values below 2 us, bucket k values in [2^k, 2^(k+1)) us, and the last
+// bucket everything from 2^(UBERSDR_HIST_BUCKETS-1) us (~0.5 s) up. Each
+// histogram has one writer thread and its counts only grow, so a reader gets
+// a recent window by differencing two snapshots; no seqlock is needed.
+#define UBERSDR_HIST_BUCKETS 20
+
+// Recent connection outages kept per receiver (see ReceiverStatus::Outages)
+#define UBERSDR_OUTAGE_HISTORY 8
+
+struct UberSDRHistogram {
+    volatile LONG count[UBERSDR_HIST_BUCKETS];
+    volatile LONG maxUs;  // Largest value recorded since creation
 };
 
+struct UberSDRSharedStatusV2 {
+    // Fixed at creation - lets a reader check the layout before using it
+    struct alignas(UBERSDR_CACHE_LINE) Header {
+        int32_t magic;          // UBERSDR_STATUS_MAGIC
+        int32_t structVersion;  // UBERSDR_STATUS_VERSION
+        int32_t structSize;     // sizeof(UberSDRSharedStatusV2)
+        int32_t receiverCount;  // MAX_RX_COUNT
+        int32_t iqBufferSize;   // IQ_BUFFER_SIZE
+        DWORD processID;        // Process ID of the DLL instance
+        int64_t startTime;      // Unix timestamp in milliseconds
+    } header;
+    
+    // Server and audio configuration - DLL control thread
+    struct alignas(UBERSDR_CACHE_LINE) Config {
+        volatile LONG seq;
+        char serverHost[64];
+        int serverPort;
+        bool connected;
+        int sampleRate;
+        char mode[16];
+        int blockSize;
+        int activeReceiverCount;
+        bool dllLoaded;
+        bool rxStarted;
+        int lastError;
+        char lastErrorMsg[256];
+        int64_t lastUpdateTime;  // Last time any field was updated
+    } config;
+    
+    // Callback totals - audio callback thread
+    struct alignas(UBERSDR_CACHE_LINE) Totals {
+        volatile LONG seq;
+        int64_t totalCallbacks;
+        int64_t totalSamples;
+    } totals;
+    
+    // pIQProc timing - ring buffer consumer thread. There is no lock-wait
+    // histogram: since block pacing only the consumer thread takes
+    // gDataCriticalSection while streaming, so the wait it would time is
+    // always zero.
+    struct alignas(UBERSDR_CACHE_LINE) CallbackTiming {
+        UberSDRHistogram duration;  // Time spent inside pIQProc
+        UberSDRHistogram interval;  // Start-to-start time between calls
+    } callbackTiming;
+    
+    // Command queue - monitor writes commands, DLL worker thread reads them
+    struct alignas(UBERSDR_CACHE_LINE) Commands {
+        UberSDRCommandQueue queue;
+    } commands;
+    
+    struct ReceiverStatus {
+        // Tuning - StartRx / SetRxFrequency
+        struct alignas(UBERSDR_CACHE_LINE) Tuning {
+            volatile LONG seq;
+            bool active;
+            int frequency;
+            char sessionId[40];
+        } tuning;
+        
+        // Stream counters - the receiver's WebSocket thread
+        struct alignas(UBERSDR_CACHE_LINE) Stream {
+            volatile LONG seq;
+            int64_t samplesReceived;
+            int64_t bytesReceived;   // Compressed network bytes
+            int64_t lastUpdateTime;  // Unix timestamp in milliseconds
+            float throughputKBps;    // Current throughput in KB/s
+            float peakLevelI;        // Peak I level (0.0 to 1.0)
+            float peakLevelQ;        // Peak Q level (0.0 to 1.0)
+        } stream;
+        
+        // Ring buffer metrics - audio callback thread
+        struct alignas(UBERSDR_CACHE_LINE) Ring {
+            volatile LONG seq;
+            float ringBufferFillLevel;  // Fill level (0.0 to 1.0)
+            int ringBufferOverruns;     // Total overrun count
+            int ringBufferUnderruns;    // Total underrun count
+            int ringBufferCapacity;     // Buffer capacity in samples
+            int targetDepthMs;          // Adaptive rate target depth (0 = fixed rate)
+            float rateCorrectionPpm;    // Adaptive rate: + consumes faster than nominal
+        } ring;
+        
+        // Frame timing - the receiver's WebSocket thread
+        struct alignas(UBERSDR_CACHE_LINE) NetTiming {
+            UberSDRHistogram frameInterval;  // WebSocket frame inter-arrival
+            UberSDRHistogram decodeTime;     // zstd decompression of one frame
+        } netTiming;
+        
+        // Ring residence - ring buffer consumer thread. Samples queued ahead of
+        // each block read, converted to time at the sample rate.
+        struct alignas(UBERSDR_CACHE_LINE) RingTiming {
+            UberSDRHistogram residence;
+        } ringTiming;
+        
+        // Connection outages - ring buffer consumer thread. One entry per
+        // WebSocket drop, recorded once the receiver has reconnected and
+        // its ring delivers a full block again; history[(count - 1) %
+        // UBERSDR_OUTAGE_HISTORY] is the latest.
+        struct alignas(UBERSDR_CACHE_LINE) Outages {
+            volatile LONG seq;
+            int32_t count;             // Outages recorded since StartRx
+            int64_t totalZeroSamples;  // Zero-filled samples over all outages
+            struct Entry {
+                int64_t endTime;       // Unix timestamp in milliseconds
+                int64_t zeroSamples;   // Samples sent to the Skimmer as zeros
+                int32_t reconnectMs;   // Drop to WebSocket open
+                int32_t attempts;      // Reconnection attempts needed
+            } history[UBERSDR_OUTAGE_HISTORY];
+        } outages;
+        
+        // Frequency offset control - independent fields, no seqlock (see
+        // DYNAMIC_OFFSET_API.md for the command/acknowledge protocol)
+        struct alignas(UBERSDR_CACHE_LINE) Offsets {
+            volatile int32_t frequencyOffset;       // Per-receiver frequency offset in Hz (dynamic)
+            volatile int32_t globalFrequencyOffset; // Global offset from INI file (read-only)
+            volatile int32_t totalFrequencyOffset;  // Total offset (INI global + per-receiver)
+            volatile int32_t requestedOffset;       // Requested offset from monitor
+            volatile int32_t offsetApplied;         // Set to 1 when offset is applied
+        } offsets;
+        
+        // IQ ring producer position: int16 values written since creation,
+        // published after the samples. The write index is
+        // iqProducerPos % IQ_BUFFER_SIZE; a reader whose own position falls
+        // more than IQ_BUFFER_SIZE behind it has lost samples. Access with
+        // UberSDRLoad64() / UberSDRStore64() (64-bit, so 32-bit processes too).
+        alignas(UBERSDR_CACHE_LINE) volatile int64_t iqProducerPos;
+        
+        // Circular buffer for IQ recording - interleaved I/Q, host byte order
+        alignas(UBERSDR_CACHE_LINE) int16_t iqBuffer[IQ_BUFFER_SIZE];
+    } receivers[MAX_RX_COUNT];
+};
+
+// Seqlock writer side: bracket every update of a group
+inline void UberSDRSeqWriteBegin(volatile LONG* seq)
+{
+    InterlockedIncrement(seq);  // Odd - readers retry; full barrier
+}
+
+inline void UberSDRSeqWriteEnd(volatile LONG* seq)
+{
+    InterlockedIncrement(seq);  // Even again
+}
+
+// Seqlock reader side: copy a group consistently (group must start with seq)
+template <typename T>
+inline void UberSDRSeqRead(const T& group, T& copy)
+{
+    for (;;) {
+        LONG start = group.seq;
+        if (start & 1) {
+            YieldProcessor();
+            continue;
+        }
+        MemoryBarrier();
+        memcpy(&copy, (const void*)&group, sizeof(T));
+        MemoryBarrier();
+        if (group.seq == start) return;
+    }
+}
+
+// Atomic 64-bit access for the IQ producer position
+inline int64_t UberSDRLoad64(const volatile int64_t* p)
+{
+    return InterlockedCompareExchange64((volatile LONG64*)p, 0, 0);
+}
+
+inline void UberSDRStore64(volatile int64_t* p, int64_t value)
+{
+    InterlockedExchange64((volatile LONG64*)p, value);  // Full barrier
+}
+
+// Histogram writer side (single writer per histogram)
+inline void UberSDRHistRecord(UberSDRHistogram* h, int64_t us)
+{
+    if (us < 0) us = 0;
+    
+    int bucket = 0;
+    for (int64_t v = us >> 1; v != 0 && bucket < UBERSDR_HIST_BUCKETS - 1; v >>= 1) {
+        bucket++;
+    }
+    h->count[bucket]++;
+    
+    LONG clamped = (us > 0x7FFFFFFF) ? 0x7FFFFFFF : (LONG)us;
+    if (clamped > h->maxUs) {
+        h->maxUs = clamped;
+    }
+}
+
+// Lower edge of a histogram bucket in microseconds
+inline int64_t UberSDRHistBucketUs(int bucket)
+{
+    return (bucket == 0) ? 0 : ((int64_t)1 << bucket);
+}
+
 // Instance information structure (for monitor enumeration)
 struct UberSDRInstanceInfo {
     DWORD processID;
@@ -124,6 +354,9 @@ extern "C" {
 // Get current time in milliseconds (Unix timestamp)
 int64_t GetCurrentTimeMs();
 
+// Get monotonic time in microseconds (QueryPerformanceCounter), for intervals
+int64_t GetTimeUs();
+
 // Build shared memory name for a given process ID
 void BuildSharedMemoryName(DWORD processID, wchar_t* buffer, size_t bufferSize);
 
@@ -135,8 +368,9 @@ int EnumerateInstances(UberSDRInstanceInfo* instances, int maxInstances);
 void CleanupStaleInstances();
 
 // Command functions for monitor-to-DLL communication
-BOOL SendFrequencyOffsetCommand(UberSDRSharedStatus* pStatus, int receiverID, int frequencyOffset, BOOL applyImmediately);
-BOOL WaitForCommandAck(UberSDRSharedStatus* pStatus, int32_t sequenceNumber, int timeoutMs);
+// (pass &pStatus->commands for v1, &pStatus->commands.queue for v2)
+BOOL SendFrequencyOffsetCommand(UberSDRCommandQueue* pQueue, int receiverID, int frequencyOffset, BOOL applyImmediately);
+BOOL WaitForCommandAck(UberSDRCommandQueue* pQueue, int32_t sequenceNumber, int timeoutMs);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,501 @@
+// replay_bench.cpp : Offline replay benchmark for the UberSDRIntf pipeline
+//
+// Acts as a fake Skimmer host: calls StartRx with a stub pIQProc, then feeds
+// pcm-zstd frames straight into UberSDR::HandleWebSocketMessage from one
+// thread per receiver (standing in for the IXWebSocket threads), with no
+// server or network involved. Everything downstream - decompression,
+// ProcessIQData, the ring buffers, the block-paced consumer, the NCO and the
+// IQProc callback - is the real DLL code, built with UBERSDR_REPLAY so
+// StartReceiver skips the connection.
+//
+// Frames come from a debug_capture file (capture_rx<N>.bin: uint32 length +
+// frame, repeated) or are synthesised (tone + noise, 20 ms per frame).
+//
+// Usage: UberSDRReplayBench [--rx 1-8] [--rate 48|96|192] [--seconds N]
+//                           [--frames capture.bin] [--flood]
+//
+// --flood feeds frames as fast as the DLL takes them instead of in real time;
+// the ring buffers then overrun, which is the point - it measures decode and
+// conversion throughput rather than pacing.
+//
+// The shared status block is created as in the DLL, so UberSDRMonitor can
+// watch a running benchmark.
+
+#define WIN32_LEAN_AND_MEAN
+#define _WINSOCKAPI_
+
+#include <windows.h>
+#include <winsock2.h>
+#include <mmsystem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "UberSDRIntf.h"
+#include "UberSDR.h"
+#include "UberSDRShared.h"
+
+#include <zstd.h>
+
+#pragma comment(lib, "winmm.lib")
+
+// Defined in UberSDRIntf.cpp
+namespace UberSDRIntf
+{
+    extern UberSDR myUberSDR;
+    extern HANDLE ghRingBufferConsumer;
+    BOOL InitSharedMemory();
+    void CleanupSharedMemory();
+    void WaitStartupThreads(void);
+}
+
+using namespace UberSDRIntf;
+
+// Synthesised frame length and PCM header ("PM" minimal header)
+#define SYNTH_FRAME_MS 20
+#define PCM_MINIMAL_HEADER 13
+
+// Callback interval samples kept for the percentiles (~15 min at 93.75/s)
+#define MAX_CALLBACK_SAMPLES 100000
+
+// Results are measured after this warm-up, once the rings have primed
+#define WARMUP_MS 1000
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmark state
+
+struct FeederState {
+    int receiverID;
+    const std::vector<std::string>* frames;
+    int64_t samplesPerSecond;
+    HANDLE hThread;
+    volatile LONG64 framesFed;
+    volatile LONG64 bytesFed;
+    volatile LONG64 samplesFed;
+};
+
+static volatile LONG gQuit = 0;
+static bool gFlood = false;
+
+static LARGE_INTEGER gQpcFreq;
+static volatile LONG gMeasuring = 0;
+static std::vector<int64_t> gCallbackTicks;   // QPC at each IQProc call while measuring
+static volatile LONG gCallbacks = 0;
+static volatile LONG gErrors = 0;
+
+static int64_t QpcNow()
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+static double TicksToUs(int64_t ticks)
+{
+    return (double)ticks * 1e6 / (double)gQpcFreq.QuadPart;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stub host callbacks
+
+static void __stdcall BenchIQProc(int RxHandle, CmplxAA Data)
+{
+    // Only the consumer thread calls this, so the vector needs no lock
+    if (gMeasuring && gCallbackTicks.size() < MAX_CALLBACK_SAMPLES) {
+        gCallbackTicks.push_back(QpcNow());
+    }
+    gCallbacks++;
+}
+
+static void __stdcall BenchErrorProc(int RxHandle, char* ErrText)
+{
+    fprintf(stderr, "Error from DLL: %s\n", ErrText);
+    InterlockedIncrement(&gErrors);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Frame sources
+
+// Build one pcm-zstd frame as the server sends it: "PM" header, big-endian
+// int16 interleaved I/Q, zstd compressed
+static std::string MakeFrame(ZSTD_CCtx* cctx, const std::vector<int16_t>& iq, uint64_t timestamp)
+{
+    std::vector<uint8_t> pcm(PCM_MINIMAL_HEADER + iq.size() * 2);
+    pcm[0] = 0x4D;  // "PM" read as little-endian 0x504D
+    pcm[1] = 0x50;
+    pcm[2] = 1;     // version
+    for (int i = 0; i < 8; i++) {
+        pcm[3 + i] = (uint8_t)(timestamp >> (8 * i));
+    }
+    pcm[11] = 0;
+    pcm[12] = 0;
+    for (size_t i = 0; i < iq.size(); i++) {
+        pcm[PCM_MINIMAL_HEADER + 2 * i] = (uint8_t)((uint16_t)iq[i] >> 8);
+        pcm[PCM_MINIMAL_HEADER + 2 * i + 1] = (uint8_t)((uint16_t)iq[i] & 0xFF);
+    }
+
+    std::string frame(ZSTD_compressBound(pcm.size()), '\0');
+    size_t size = ZSTD_compressCCtx(cctx, &frame[0], frame.size(), pcm.data(), pcm.size(), 1);
+    if (ZSTD_isError(size)) {
+        return std::string();
+    }
+    frame.resize(size);
+    return frame;
+}
+
+// One second of synthesised frames: a tone at +1 kHz per receiver index plus
+// noise, at roughly the level of a busy band
+static bool SynthesiseFrames(int sampleRate, int receiverID, std::vector<std::string>& frames)
+{
+    ZSTD_CCtx* cctx = ZSTD_createCCtx();
+    if (cctx == NULL) {
+        return false;
+    }
+
+    const int samplesPerFrame = sampleRate * SYNTH_FRAME_MS / 1000;
+    const double toneHz = 1000.0 * (receiverID + 1);
+    double phase = 0.0;
+    uint32_t noise = 0x12345678u + (uint32_t)receiverID;
+    std::vector<int16_t> iq(samplesPerFrame * 2);
+
+    frames.clear();
+    for (int f = 0; f < 1000 / SYNTH_FRAME_MS; f++) {
+        for (int i = 0; i < samplesPerFrame; i++) {
+            noise = noise * 1664525u + 1013904223u;
+            int n1 = (int)((noise >> 16) & 0x3FF) - 512;
+            noise = noise * 1664525u + 1013904223u;
+            int n2 = (int)((noise >> 16) & 0x3FF) - 512;
+            iq[2 * i] = (int16_t)(8000.0 * cos(phase) + n1);
+            iq[2 * i + 1] = (int16_t)(8000.0 * sin(phase) + n2);
+            phase += 2.0 * 3.14159265358979323846 * toneHz / sampleRate;
+            if (phase > 2.0 * 3.14159265358979323846) {
+                phase -= 2.0 * 3.14159265358979323846;
+            }
+        }
+        std::string frame = MakeFrame(cctx, iq, (uint64_t)f * samplesPerFrame);
+        if (frame.empty()) {
+            ZSTD_freeCCtx(cctx);
+            return false;
+        }
+        frames.push_back(frame);
+    }
+
+    ZSTD_freeCCtx(cctx);
+    return true;
+}
+
+// Read a debug_capture file
+static bool LoadCapture(const char* path, std::vector<std::string>& frames)
+{
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "rb") != 0 || file == NULL) {
+        return false;
+    }
+
+    frames.clear();
+    uint32_t length;
+    while (fread(&length, sizeof(length), 1, file) == 1) {
+        if (length == 0 || length > 16 * 1024 * 1024) {
+            break;
+        }
+        std::string frame(length, '\0');
+        if (fread(&frame[0], 1, length, file) != length) {
+            break;
+        }
+        frames.push_back(frame);
+    }
+    fclose(file);
+    return !frames.empty();
+}
+
+// IQ samples a frame decodes to, for real-time pacing
+static int64_t FrameSamples(const std::string& frame, std::vector<uint8_t>& scratch)
+{
+    unsigned long long size = ZSTD_getFrameContentSize(frame.data(), frame.size());
+    if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN) {
+        return 0;
+    }
+    scratch.resize((size_t)size);
+    size_t actual = ZSTD_decompress(scratch.data(), scratch.size(), frame.data(), frame.size());
+    if (ZSTD_isError(actual) || actual < PCM_MINIMAL_HEADER) {
+        return 0;
+    }
+    size_t header = (scratch[0] == 0x43 && scratch[1] == 0x50) ? 29 : PCM_MINIMAL_HEADER;
+    return (actual > header) ? (int64_t)((actual - header) / 4) : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Feeder thread - one per receiver, in place of the WebSocket thread
+
+static DWORD WINAPI FeederThread(LPVOID lpParameter)
+{
+    FeederState* state = (FeederState*)lpParameter;
+    const std::vector<std::string>& frames = *state->frames;
+
+    std::vector<uint8_t> scratch;
+    std::vector<int64_t> frameSamples(frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        frameSamples[i] = FrameSamples(frames[i], scratch);
+    }
+
+    // Real time: each frame is due once the samples before it have played out
+    int64_t start = QpcNow();
+    int64_t samplesDue = 0;
+    size_t index = 0;
+
+    while (!gQuit) {
+        if (!gFlood) {
+            int64_t due = start + samplesDue * gQpcFreq.QuadPart / state->samplesPerSecond;
+            int64_t now = QpcNow();
+            if (now < due) {
+                DWORD waitMs = (DWORD)((due - now) * 1000 / gQpcFreq.QuadPart);
+                Sleep(waitMs > 0 ? waitMs : 0);
+                continue;
+            }
+        }
+
+        const std::string& frame = frames[index];
+        myUberSDR.HandleWebSocketMessage(state->receiverID, frame);
+
+        InterlockedIncrement64(&state->framesFed);
+        InterlockedExchangeAdd64(&state->bytesFed, (LONG64)frame.size());
+        InterlockedExchangeAdd64(&state->samplesFed, frameSamples[index]);
+        samplesDue += frameSamples[index];
+
+        if (++index == frames.size()) {
+            index = 0;
+        }
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reporting
+
+static double ThreadCpuMs(HANDLE hThread)
+{
+    FILETIME created, exited, kernel, user;
+    if (hThread == NULL || !GetThreadTimes(hThread, &created, &exited, &kernel, &user)) {
+        return 0.0;
+    }
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (double)(k.QuadPart + u.QuadPart) / 10000.0;  // 100 ns units
+}
+
+static void ReportCallbackJitter()
+{
+    const double idealUs = 1e6 / BLOCKS_PER_SEC;
+
+    if (gCallbackTicks.size() < 2) {
+        printf("Callback:   no intervals measured\n");
+        return;
+    }
+
+    std::vector<double> intervals;
+    intervals.reserve(gCallbackTicks.size() - 1);
+    double sum = 0.0;
+    for (size_t i = 1; i < gCallbackTicks.size(); i++) {
+        double us = TicksToUs(gCallbackTicks[i] - gCallbackTicks[i - 1]);
+        intervals.push_back(us);
+        sum += us;
+    }
+    double mean = sum / intervals.size();
+    double var = 0.0;
+    for (size_t i = 0; i < intervals.size(); i++) {
+        var += (intervals[i] - mean) * (intervals[i] - mean);
+    }
+    double stddev = sqrt(var / intervals.size());
+
+    std::sort(intervals.begin(), intervals.end());
+    double p50 = intervals[intervals.size() / 2];
+    double p99 = intervals[(intervals.size() * 99) / 100];
+    double maxUs = intervals.back();
+
+    printf("Callback:   %zu intervals, ideal %.0f us\n", intervals.size(), idealUs);
+    printf("            mean %.0f us, stddev %.0f us, p50 %.0f us, p99 %.0f us, max %.0f us\n",
+           mean, stddev, p50, p99, maxUs);
+}
+
+static void Usage()
+{
+    printf("Usage: UberSDRReplayBench [--rx 1-8] [--rate 48|96|192] [--seconds N]\n"
+           "                          [--frames capture.bin] [--flood]\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Main
+
+int main(int argc, char* argv[])
+{
+    int receiverCount = 1;
+    int rateKHz = 192;
+    int seconds = 10;
+    const char* framesPath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--rx") == 0 && i + 1 < argc) {
+            receiverCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            rateKHz = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            framesPath = argv[++i];
+        } else if (strcmp(argv[i], "--flood") == 0) {
+            gFlood = true;
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+
+    int rateID;
+    if (rateKHz == 48) rateID = RATE_48KHZ;
+    else if (rateKHz == 96) rateID = RATE_96KHZ;
+    else if (rateKHz == 192) rateID = RATE_192KHZ;
+    else {
+        Usage();
+        return 1;
+    }
+    if (receiverCount < 1 || receiverCount > MAX_RX_COUNT || seconds < 1) {
+        Usage();
+        return 1;
+    }
+
+    QueryPerformanceFrequency(&gQpcFreq);
+    gCallbackTicks.reserve(MAX_CALLBACK_SAMPLES);
+
+    // Frames for each receiver: one capture shared by all, or a tone each
+    const int sampleRate = rateKHz * 1000;
+    std::vector<std::vector<std::string>> frames(receiverCount);
+    for (int i = 0; i < receiverCount; i++) {
+        bool ok = framesPath ? LoadCapture(framesPath, frames[i])
+                             : SynthesiseFrames(sampleRate, i, frames[i]);
+        if (!ok) {
+            fprintf(stderr, "Failed to %s frames\n", framesPath ? "load" : "synthesise");
+            return 1;
+        }
+    }
+
+    printf("Replaying %zu %s frames into %d receiver(s) at iq%d, %d s%s\n",
+           frames[0].size(), framesPath ? "captured" : "synthesised",
+           receiverCount, rateKHz, seconds, gFlood ? ", flood" : "");
+
+    // Sleep(1) granularity for the feeders, as the WebSocket threads get
+    // from the socket wakeups
+    timeBeginPeriod(1);
+
+    // DllMain does this when the DLL loads
+    InitSharedMemory();
+
+    SdrSettings settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.RecvCount = receiverCount;
+    settings.RateID = rateID;
+    settings.pIQProc = BenchIQProc;
+    settings.pErrorProc = BenchErrorProc;
+    StartRx(&settings);
+
+    // StartRx returns before the receivers have started; feeding one while
+    // StartReceiver is still initialising its ring buffer would race it
+    WaitStartupThreads();
+    for (int i = 0; i < receiverCount; i++) {
+        if (!myUberSDR.receivers[i].active) {
+            fprintf(stderr, "Receiver %d did not start\n", i);
+            return 1;
+        }
+    }
+
+    std::vector<FeederState> feeders(receiverCount);
+    for (int i = 0; i < receiverCount; i++) {
+        feeders[i].receiverID = i;
+        feeders[i].frames = &frames[i];
+        feeders[i].samplesPerSecond = sampleRate;
+        feeders[i].framesFed = 0;
+        feeders[i].bytesFed = 0;
+        feeders[i].samplesFed = 0;
+        feeders[i].hThread = CreateThread(NULL, 0, FeederThread, &feeders[i], 0, NULL);
+    }
+
+    // Warm up, then take the baseline for every delta
+    Sleep(WARMUP_MS);
+
+    std::vector<int> overrunBase(receiverCount), underrunBase(receiverCount);
+    std::vector<LONG64> framesBase(receiverCount), bytesBase(receiverCount), samplesBase(receiverCount);
+    std::vector<double> feederCpuBase(receiverCount);
+    for (int i = 0; i < receiverCount; i++) {
+        RingBuffer& ring = myUberSDR.receivers[i].ringBuffer;
+        overrunBase[i] = ring.overrunCount.load();
+        underrunBase[i] = ring.underrunCount.load();
+        framesBase[i] = feeders[i].framesFed;
+        bytesBase[i] = feeders[i].bytesFed;
+        samplesBase[i] = feeders[i].samplesFed;
+        feederCpuBase[i] = ThreadCpuMs(feeders[i].hThread);
+    }
+    double consumerCpuBase = ThreadCpuMs(ghRingBufferConsumer);
+    int64_t measureStart = QpcNow();
+    InterlockedExchange(&gMeasuring, 1);
+
+    Sleep(seconds * 1000);
+
+    InterlockedExchange(&gMeasuring, 0);
+    double elapsedS = TicksToUs(QpcNow() - measureStart) / 1e6;
+
+    // Read everything before StopRx closes the consumer handle
+    double consumerCpuMs = ThreadCpuMs(ghRingBufferConsumer) - consumerCpuBase;
+    std::vector<int> overruns(receiverCount), underruns(receiverCount);
+    std::vector<double> feederCpuMs(receiverCount);
+    for (int i = 0; i < receiverCount; i++) {
+        RingBuffer& ring = myUberSDR.receivers[i].ringBuffer;
+        overruns[i] = ring.overrunCount.load() - overrunBase[i];
+        underruns[i] = ring.underrunCount.load() - underrunBase[i];
+        feederCpuMs[i] = ThreadCpuMs(feeders[i].hThread) - feederCpuBase[i];
+    }
+
+    InterlockedExchange(&gQuit, 1);
+    for (int i = 0; i < receiverCount; i++) {
+        if (feeders[i].hThread != NULL) {
+            WaitForSingleObject(feeders[i].hThread, 5000);
+        }
+    }
+    StopRx();
+
+    // Report
+    printf("\nMeasured over %.2f s\n\n", elapsedS);
+    printf("Rx  Frames/s   MS/s    MB/s in  CPU%%   Overruns  Underruns\n");
+    double totalMsps = 0.0;
+    for (int i = 0; i < receiverCount; i++) {
+        double framesPerS = (feeders[i].framesFed - framesBase[i]) / elapsedS;
+        double msps = (feeders[i].samplesFed - samplesBase[i]) / elapsedS / 1e6;
+        double mbps = (feeders[i].bytesFed - bytesBase[i]) / elapsedS / 1e6;
+        double cpu = feederCpuMs[i] / (elapsedS * 10.0);  // ms per s -> percent of a core
+        totalMsps += msps;
+        printf("%-3d %8.1f  %6.3f  %8.3f  %5.1f  %9d  %9d\n",
+               i, framesPerS, msps, mbps, cpu, overruns[i], underruns[i]);
+    }
+    printf("\nTotal:      %.3f MS/s (real time %.3f MS/s)\n", totalMsps,
+           receiverCount * sampleRate / 1e6);
+    printf("Consumer:   %.1f%% CPU, %ld callbacks\n", consumerCpuMs / (elapsedS * 10.0), gCallbacks);
+    ReportCallbackJitter();
+    if (gErrors > 0) {
+        printf("Errors:     %ld reported through pErrorProc (see UberSDRIntf_log_file.txt)\n", gErrors);
+    }
+
+    for (int i = 0; i < receiverCount; i++) {
+        if (feeders[i].hThread != NULL) {
+            CloseHandle(feeders[i].hThread);
+        }
+    }
+    CleanupSharedMemory();
+    timeEndPeriod(1);
+
+    return 0;
+}
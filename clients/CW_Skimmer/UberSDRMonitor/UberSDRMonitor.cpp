@@ -10,7 +10,16 @@
 #include <stdlib.h>
 #include <time.h>
 #include <math.h>
+#include <limits.h>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "../UberSDRIntf/UberSDRShared.h"
+#include "../../common/iq_convert.h"
+#include "../../common/spectrum_fft.h"
 #include "resource.h"
 
 #pragma comment(lib, "comctl32.lib")
@@ -22,6 +31,11 @@
 #define FFT_SIZE 16384
 #define PI 3.14159265358979323846
 
+// Spectrum averaging - time constant of the per-bin power average, and the
+// gap after which it restarts from the next FFT instead of blending in
+#define SPECTRUM_AVERAGE_MS       250
+#define SPECTRUM_AVERAGE_RESET_MS 2000
+
 // Complex number structure
 struct Complex {
     float real;
@@ -39,17 +53,35 @@ struct MarkerLine {
 };
 
 // DX Cluster spot structure
-#define MAX_DX_SPOTS 50
-#define MAX_MEASUREMENTS 10  // Maximum measurements to average per spot
+#define MAX_DX_SPOTS 5000       // Live spots kept; beyond this the least recently spotted is dropped
+#define MAX_MEASUREMENTS 10     // Maximum measurements to average per spot
+#define DX_SPOT_BUCKET_HZ 1000  // Re-spots of a callsign within this are the same spot
 struct DXSpot {
     char callsign[16];
     int reportedFrequency;  // Frequency reported by DX cluster in Hz
     int actualFrequency;    // Averaged measured peak frequency in Hz (0 if not yet measured)
-    DWORD timestamp;        // Time when spot was received
+    DWORD timestamp;        // Time when spot was received (or last re-spotted)
     bool active;
     bool measured;          // True if we've completed measurement (success or timeout)
     int measurementFreqs[MAX_MEASUREMENTS];  // Array of measured frequencies
     int measurementCount;   // Number of valid measurements collected
+    std::multimap<int, int>::iterator freqEntry;  // This spot in g_dxSpotsByFreq
+    std::list<int>::iterator ageEntry;            // This spot in g_dxSpotsByAge
+};
+
+// Spot counts and median offset (reported - measured) over a frequency range
+struct DXSpotStats {
+    int uniqueCount;     // Distinct callsigns
+    int totalCount;
+    int measuredCount;   // Spots with a measured frequency
+    float medianOffset;  // Hz, valid if measuredCount > 0
+};
+
+// One computed spectrum, as published by a spectrum worker
+struct SpectrumFrame {
+    float magnitudeDB[FFT_SIZE];  // Averaged power in dB
+    float noiseFloor;  // 10th percentile in dB
+    float maxDB;       // Largest bin in dB
 };
 
 // Spectrum window state
@@ -58,9 +90,19 @@ struct SpectrumWindow {
     HWND hSpotsWnd;  // Associated spots list window
     int receiverID;
     bool active;
-    Complex fftBuffer[FFT_SIZE];
-    float magnitudeDB[FFT_SIZE];
-    float window[FFT_SIZE];  // Hanning window
+    Complex fftBuffer[FFT_SIZE];  // Spectrum worker scratch
+    float powerAverage[FFT_SIZE];  // Exponentially averaged linear power, worker only
+    DWORD averageTick;             // GetTickCount() of the last averaged FFT (0 = none)
+    // A worker computes into frames[computeSlot] and swaps it with readySlot;
+    // the UI thread swaps readySlot with displaySlot when it adopts it. The
+    // slot indices, frameReady and computeQueued are guarded by g_spectrumLock.
+    SpectrumFrame frames[3];
+    int computeSlot;
+    int readySlot;
+    int displaySlot;
+    bool frameReady;     // readySlot holds a frame the UI has not adopted
+    bool computeQueued;  // Queued for or being computed by a worker
+    float* magnitudeDB;  // frames[displaySlot].magnitudeDB, UI thread only
     UINT_PTR timerId;
     float noiseFloor;  // Calculated noise floor in dB
     int lastMouseX;
@@ -95,14 +137,92 @@ struct WAVHeader {
 };
 #pragma pack(pop)
 
+// Status fields the monitor reads, copied once per UI tick from whichever
+// shared layout the DLL instance publishes (v1 directly, v2 under its
+// seqlocks) - see RefreshStatus()
+struct MonitorStatus {
+    char serverHost[64];
+    int serverPort;
+    bool connected;
+    int sampleRate;
+    char mode[16];
+    int blockSize;
+    int64_t totalCallbacks;
+    int64_t totalSamples;
+    int64_t startTime;  // Unix timestamp in milliseconds
+    int activeReceiverCount;
+    
+    struct ReceiverStatus {
+        bool active;
+        int frequency;
+        float throughputKBps;
+        float peakLevelI;
+        float peakLevelQ;
+        float ringBufferFillLevel;
+        int ringBufferOverruns;
+        int ringBufferUnderruns;
+        int32_t frequencyOffset;
+        int32_t globalFrequencyOffset;
+        int32_t totalFrequencyOffset;
+        UberSDRHistogram frameInterval;  // v2 only (see hasTiming)
+        UberSDRHistogram decodeTime;
+        UberSDRHistogram ringResidence;
+        int targetDepthMs;        // Adaptive rate target, 0 = fixed rate (v2 only)
+        float rateCorrectionPpm;
+    } receivers[MAX_RX_COUNT];
+    
+    bool hasTiming;  // Timing histograms are published (v2)
+    UberSDRHistogram callbackDuration;
+    UberSDRHistogram callbackInterval;
+};
+
+// Window for the timing histograms: the display differences the live counts
+// against a base snapshot that is replaced every TIMING_WINDOW_MS, so it
+// always covers the last one to two windows
+#define TIMING_WINDOW_MS 5000
+
+struct TimingWindow {
+    MonitorStatus base;     // Counts at the start of the displayed window
+    MonitorStatus pending;  // Counts one window later - becomes the next base
+    DWORD pendingTick;
+    bool valid;
+};
+
+// A receiver's shared IQ ring, fixed while the mapping is open. The recorder
+// and spectrum workers read the ring through this, never through g_pStatus.
+struct IqRingView {
+    const int16_t* buffer;                // NULL when not connected
+    const volatile int32_t* writeIndex;   // v1: write index only
+    const volatile int64_t* producerPos;  // v2: values written since creation
+};
+
+// Recording - the recorder thread drains each receiver's IQ ring into one of
+// two aligned buffers and writes each full buffer with unbuffered overlapped
+// I/O while it fills the other
+#define RECORD_BUFFER_SIZE (4 * 1024 * 1024)  // Bytes per write (~5 s at 192 kHz)
+#define RECORD_SECTOR_SIZE 4096               // FILE_FLAG_NO_BUFFERING write alignment
+#define RECORD_POLL_MS     50                 // Recorder thread wakeup interval
+
 // Recording state
 struct RecordingState {
     bool recording;
-    HANDLE hFile;
-    int32_t lastReadPos;
-    uint32_t samplesWritten;
+    HANDLE hFile;               // Opened FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED
+    int64_t readPos;            // Ring position, in IQ_BUFFER_SIZE-wrapping values (see IqProducerPos)
+    uint64_t bytesWritten;      // IQ data bytes taken from the ring
     DWORD recordingStartTime;  // GetTickCount() when recording started
     int durationSeconds;        // Duration in seconds (0 = hold-to-record mode)
+    char filename[MAX_PATH];
+    bool failed;                // A write failed, UpdateDisplay stops the recording
+    
+    // Guards the fields above and the buffers below between the UI thread
+    // (start/stop) and the recorder thread (drain)
+    CRITICAL_SECTION lock;
+    uint8_t* buffers[2];        // RECORD_BUFFER_SIZE each, page aligned
+    OVERLAPPED overlapped[2];
+    bool writePending[2];
+    int activeBuffer;           // Buffer being filled
+    uint32_t bufferFill;        // Bytes in the active buffer
+    uint64_t fileOffset;        // File offset of the active buffer
 };
 
 // Global variables
@@ -110,10 +230,17 @@ HINSTANCE g_hInst = NULL;
 HWND g_hDlg = NULL;
 HWND g_hInstanceList = NULL;  // Instance listbox control
 HANDLE g_hSharedMemory = NULL;
-const UberSDRSharedStatus* g_pStatus = NULL;
+const void* g_pMapping = NULL;       // Mapped view of the instance's shared status
+int g_statusVersion = 0;             // Layout of g_pMapping: 1 or UBERSDR_STATUS_VERSION
+MonitorStatus g_status;              // UI-thread copy, refreshed by RefreshStatus()
+const MonitorStatus* g_pStatus = NULL;  // &g_status while connected
+IqRingView g_iqRings[MAX_RX_COUNT] = {0};
+TimingWindow g_timing = {0};
 UINT_PTR g_timerId = 0;
 UINT_PTR g_instanceTimerId = 0;
 RecordingState g_recording[MAX_RX_COUNT] = {0};
+HANDLE g_recorderThread = NULL;
+HANDLE g_recorderStopEvent = NULL;
 WNDPROC g_originalButtonProc[MAX_RX_COUNT] = {0};
 
 // Record button handles for color changes
@@ -127,9 +254,16 @@ UberSDRInstanceInfo g_instances[16];  // Support up to 16 instances
 int g_instanceCount = 0;
 int g_selectedInstance = -1;
 
-// DX Cluster spots
-DXSpot g_dxSpots[MAX_DX_SPOTS] = {0};
-int g_dxSpotCount = 0;
+// DX Cluster spots - a slot pool indexed three ways: by callsign and 1 kHz
+// frequency bucket for de-duplication, by reported frequency so a
+// receiver's passband is a range query, and by age for expiry. Slots are
+// recycled through g_dxFreeSlots; all of it is UI thread only.
+std::vector<DXSpot> g_dxSpots;
+std::vector<int> g_dxFreeSlots;
+std::unordered_map<std::string, int> g_dxSpotsByCall;  // "CALL/bucket" -> slot
+std::multimap<int, int> g_dxSpotsByFreq;               // Reported frequency -> slot
+std::list<int> g_dxSpotsByAge;                         // Slots, least recently spotted first
+std::vector<int> g_dxSpotsPending;                     // Slots still being measured
 #define DX_SPOT_TIMEOUT 1800000  // 30 minutes in milliseconds
 
 // Telnet connection state
@@ -140,6 +274,22 @@ char g_telnetBuffer[4096] = {0};
 int g_telnetBufferLen = 0;
 DWORD g_lastReconnectAttempt = 0;
 
+// Spectrum worker pool - one task per receiver, so a receiver is never
+// queued twice and the queue never holds more than MAX_RX_COUNT entries
+#define MAX_SPECTRUM_WORKERS MAX_RX_COUNT
+CRITICAL_SECTION g_spectrumLock;
+HANDLE g_spectrumWorkSemaphore = NULL;  // One count per queued receiver
+HANDLE g_spectrumIdleEvent = NULL;      // Set while no receiver is queued or computing
+HANDLE g_spectrumWorkers[MAX_SPECTRUM_WORKERS] = {0};
+int g_spectrumWorkerCount = 0;
+int g_spectrumQueue[MAX_RX_COUNT] = {0};
+int g_spectrumQueueHead = 0;
+int g_spectrumQueueCount = 0;
+int g_spectrumPending = 0;  // Receivers queued or computing
+bool g_spectrumStopping = false;
+struct spectrum_fft g_spectrumFFT;     // FFT_SIZE plan shared by all workers
+float g_hannWindow[FFT_SIZE];
+
 // Timer IDs
 #define TIMER_UPDATE         1
 #define TIMER_INSTANCE_CHECK 2
@@ -147,26 +297,39 @@ DWORD g_lastReconnectAttempt = 0;
 // Function prototypes
 BOOL InitSharedMemory();
 void CleanupSharedMemory();
+BOOL AttachSharedStatus();
+void RefreshStatus();
+int64_t IqProducerPos(int receiverID, int64_t readerPos);
+void UpdateTimingDisplay();
 void UpdateDisplay();
 void UpdateInstanceList();
 void FormatUptime(int64_t startTime, char* buffer, size_t bufferSize);
 void FormatFrequency(int frequency, char* buffer, size_t bufferSize);
 bool StartRecording(int receiverID);
 void StopRecording(int receiverID);
-void ProcessRecording(int receiverID);
+void InitRecorder();
+void ShutdownRecorder();
+void DrainRecording(RecordingState* rec, int receiverID);
+void SubmitRecordBuffer(RecordingState* rec);
+bool WaitRecordBuffer(RecordingState* rec, int index);
+DWORD WINAPI RecorderThread(LPVOID param);
 LRESULT CALLBACK RecordButtonProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam, UINT_PTR uIdSubclass, DWORD_PTR dwRefData);
 INT_PTR CALLBACK DialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam);
 
 // Spectrum display function prototypes
 void InitHanningWindow(float* window, int size);
-void PerformFFT(Complex* data, int size);
-void ComputeSpectrum(int receiverID);
+bool ComputeSpectrum(int receiverID, SpectrumFrame* frame);
+void InitSpectrumWorkers();
+void ShutdownSpectrumWorkers();
+void WaitSpectrumWorkers();
+void RequestSpectrum(int receiverID);
+bool AcquireSpectrum(int receiverID);
+DWORD WINAPI SpectrumWorkerThread(LPVOID param);
 void ShowSpectrumWindow(int receiverID);
 void CloseSpectrumWindow(int receiverID);
 LRESULT CALLBACK SpectrumWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 void DrawSpectrum(HWND hwnd, HDC hdc, int receiverID);
-float CalculateNoiseFloor(const float* magnitudeDB, int size);
-int CompareFloat(const void* a, const void* b);
+float CalculateNoiseFloor(const float* magnitudeDB, int size, float* scratch);
 
 // Spots list window function prototypes
 void ShowSpotsWindow(int receiverID);
@@ -185,7 +348,11 @@ void AppendTelnetText(const char* text);
 // DX Cluster spot function prototypes
 void ParseDXSpotLine(const char* line);
 void AddDXSpot(const char* callsign, int frequency);
+std::string DXSpotKey(const char* callsign, int bucket);
+int FindDXSpot(const char* callsign, int frequency);
+void RemoveDXSpot(int slot);
 void CleanupOldSpots();
+void GetDXSpotStats(int minFreq, int maxFreq, DXSpotStats* stats);
 void DrawDXSpots(HDC hdc, int receiverID, int marginLeft, int marginTop, int plotWidth, int plotHeight, int minFreq, int maxFreq);
 void CountSpotsForReceiver(int receiverID, int* uniqueCount, int* totalCount);
 void UpdateSpotCounts();
@@ -207,9 +374,16 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     icex.dwICC = ICC_WIN95_CLASSES;
     InitCommonControlsEx(&icex);
     
+    // Start spectrum workers and the recorder
+    InitSpectrumWorkers();
+    InitRecorder();
+    
     // Create dialog
     DialogBox(hInstance, MAKEINTRESOURCE(IDD_MAIN), NULL, DialogProc);
     
+    ShutdownRecorder();
+    ShutdownSpectrumWorkers();
+    
     // Cleanup Winsock
     CleanupTelnet();
     
@@ -244,13 +418,7 @@ BOOL InitSharedMemory()
             return FALSE;
         }
         
-        g_pStatus = (const UberSDRSharedStatus*)MapViewOfFile(
-            g_hSharedMemory,
-            FILE_MAP_ALL_ACCESS,
-            0, 0,
-            sizeof(UberSDRSharedStatus));
-        
-        if (g_pStatus == NULL) {
+        if (!AttachSharedStatus()) {
             CloseHandle(g_hSharedMemory);
             g_hSharedMemory = NULL;
             return FALSE;
@@ -269,9 +437,19 @@ BOOL InitSharedMemory()
 // Cleanup shared memory
 void CleanupSharedMemory()
 {
-    if (g_pStatus != NULL) {
-        UnmapViewOfFile((LPVOID)g_pStatus);
-        g_pStatus = NULL;
+    // The recorder and spectrum workers read the mapping, let them finish first
+    for (int i = 0; i < MAX_RX_COUNT; i++) {
+        StopRecording(i);
+    }
+    WaitSpectrumWorkers();
+    
+    g_pStatus = NULL;
+    memset(g_iqRings, 0, sizeof(g_iqRings));
+    g_statusVersion = 0;
+    
+    if (g_pMapping != NULL) {
+        UnmapViewOfFile((LPVOID)g_pMapping);
+        g_pMapping = NULL;
     }
     
     if (g_hSharedMemory != NULL) {
@@ -280,6 +458,217 @@ void CleanupSharedMemory()
     }
 }
 
+// Map g_hSharedMemory and work out which layout it holds. v2 instances carry
+// a header with a magic number; anything else large enough is taken as v1.
+BOOL AttachSharedStatus()
+{
+    g_pMapping = MapViewOfFile(g_hSharedMemory, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (g_pMapping == NULL) {
+        return FALSE;
+    }
+    
+    MEMORY_BASIC_INFORMATION mbi;
+    SIZE_T mappedSize = 0;
+    if (VirtualQuery(g_pMapping, &mbi, sizeof(mbi)) == sizeof(mbi)) {
+        mappedSize = mbi.RegionSize;
+    }
+    
+    const UberSDRSharedStatusV2* v2 = (const UberSDRSharedStatusV2*)g_pMapping;
+    if (mappedSize >= sizeof(UberSDRSharedStatusV2) &&
+        v2->header.magic == UBERSDR_STATUS_MAGIC &&
+        v2->header.structVersion == UBERSDR_STATUS_VERSION &&
+        v2->header.structSize == (int32_t)sizeof(UberSDRSharedStatusV2) &&
+        v2->header.receiverCount == MAX_RX_COUNT &&
+        v2->header.iqBufferSize == IQ_BUFFER_SIZE) {
+        g_statusVersion = UBERSDR_STATUS_VERSION;
+        for (int i = 0; i < MAX_RX_COUNT; i++) {
+            g_iqRings[i].buffer = v2->receivers[i].iqBuffer;
+            g_iqRings[i].writeIndex = NULL;
+            g_iqRings[i].producerPos = &v2->receivers[i].iqProducerPos;
+        }
+    } else if (mappedSize >= sizeof(UberSDRSharedStatus) &&
+               (mappedSize < sizeof(v2->header) || v2->header.magic != UBERSDR_STATUS_MAGIC)) {
+        // No v2 magic - a v1 DLL (a v2 header that failed the checks above
+        // is a layout this monitor doesn't know, and is rejected)
+        const UberSDRSharedStatus* v1 = (const UberSDRSharedStatus*)g_pMapping;
+        g_statusVersion = 1;
+        for (int i = 0; i < MAX_RX_COUNT; i++) {
+            g_iqRings[i].buffer = v1->receivers[i].iqBuffer;
+            g_iqRings[i].writeIndex = &v1->receivers[i].iqBufferWritePos;
+            g_iqRings[i].producerPos = NULL;
+        }
+    } else {
+        UnmapViewOfFile((LPVOID)g_pMapping);
+        g_pMapping = NULL;
+        return FALSE;
+    }
+    
+    g_timing.valid = false;
+    RefreshStatus();
+    g_pStatus = &g_status;
+    return TRUE;
+}
+
+// Copy the status of the attached instance into g_status (UI thread)
+void RefreshStatus()
+{
+    MonitorStatus* st = &g_status;
+    
+    if (g_statusVersion == UBERSDR_STATUS_VERSION) {
+        const UberSDRSharedStatusV2* v2 = (const UberSDRSharedStatusV2*)g_pMapping;
+        
+        UberSDRSharedStatusV2::Config config;
+        UberSDRSharedStatusV2::Totals totals;
+        UberSDRSeqRead(v2->config, config);
+        UberSDRSeqRead(v2->totals, totals);
+        
+        memcpy(st->serverHost, config.serverHost, sizeof(st->serverHost));
+        st->serverHost[sizeof(st->serverHost) - 1] = '\0';
+        st->serverPort = config.serverPort;
+        st->connected = config.connected;
+        st->sampleRate = config.sampleRate;
+        memcpy(st->mode, config.mode, sizeof(st->mode));
+        st->mode[sizeof(st->mode) - 1] = '\0';
+        st->blockSize = config.blockSize;
+        st->activeReceiverCount = config.activeReceiverCount;
+        st->totalCallbacks = totals.totalCallbacks;
+        st->totalSamples = totals.totalSamples;
+        st->startTime = v2->header.startTime;
+        
+        for (int i = 0; i < MAX_RX_COUNT; i++) {
+            const UberSDRSharedStatusV2::ReceiverStatus* src = &v2->receivers[i];
+            MonitorStatus::ReceiverStatus* dst = &st->receivers[i];
+            
+            UberSDRSharedStatusV2::ReceiverStatus::Tuning tuning;
+            UberSDRSharedStatusV2::ReceiverStatus::Stream stream;
+            UberSDRSharedStatusV2::ReceiverStatus::Ring ring;
+            UberSDRSeqRead(src->tuning, tuning);
+            UberSDRSeqRead(src->stream, stream);
+            UberSDRSeqRead(src->ring, ring);
+            
+            dst->active = tuning.active;
+            dst->frequency = tuning.frequency;
+            dst->throughputKBps = stream.throughputKBps;
+            dst->peakLevelI = stream.peakLevelI;
+            dst->peakLevelQ = stream.peakLevelQ;
+            dst->ringBufferFillLevel = ring.ringBufferFillLevel;
+            dst->ringBufferOverruns = ring.ringBufferOverruns;
+            dst->ringBufferUnderruns = ring.ringBufferUnderruns;
+            dst->targetDepthMs = ring.targetDepthMs;
+            dst->rateCorrectionPpm = ring.rateCorrectionPpm;
+            dst->frequencyOffset = src->offsets.frequencyOffset;
+            dst->globalFrequencyOffset = src->offsets.globalFrequencyOffset;
+            dst->totalFrequencyOffset = src->offsets.totalFrequencyOffset;
+            
+            memcpy(&dst->frameInterval, (const void*)&src->netTiming.frameInterval, sizeof(UberSDRHistogram));
+            memcpy(&dst->decodeTime, (const void*)&src->netTiming.decodeTime, sizeof(UberSDRHistogram));
+            memcpy(&dst->ringResidence, (const void*)&src->ringTiming.residence, sizeof(UberSDRHistogram));
+        }
+        
+        st->hasTiming = true;
+        memcpy(&st->callbackDuration, (const void*)&v2->callbackTiming.duration, sizeof(UberSDRHistogram));
+        memcpy(&st->callbackInterval, (const void*)&v2->callbackTiming.interval, sizeof(UberSDRHistogram));
+    } else if (g_statusVersion == 1) {
+        // v1 has no consistency protocol - fields are copied as they are
+        const UberSDRSharedStatus* v1 = (const UberSDRSharedStatus*)g_pMapping;
+        
+        memcpy(st->serverHost, v1->serverHost, sizeof(st->serverHost));
+        st->serverHost[sizeof(st->serverHost) - 1] = '\0';
+        st->serverPort = v1->serverPort;
+        st->connected = v1->connected;
+        st->sampleRate = v1->sampleRate;
+        memcpy(st->mode, v1->mode, sizeof(st->mode));
+        st->mode[sizeof(st->mode) - 1] = '\0';
+        st->blockSize = v1->blockSize;
+        st->activeReceiverCount = v1->activeReceiverCount;
+        st->totalCallbacks = v1->totalCallbacks;
+        st->totalSamples = v1->totalSamples;
+        st->startTime = v1->startTime;
+        
+        for (int i = 0; i < MAX_RX_COUNT; i++) {
+            const UberSDRSharedStatus::ReceiverStatus* src = &v1->receivers[i];
+            MonitorStatus::ReceiverStatus* dst = &st->receivers[i];
+            
+            dst->active = src->active;
+            dst->frequency = src->frequency;
+            dst->throughputKBps = src->throughputKBps;
+            dst->peakLevelI = src->peakLevelI;
+            dst->peakLevelQ = src->peakLevelQ;
+            dst->ringBufferFillLevel = src->ringBufferFillLevel;
+            dst->ringBufferOverruns = src->ringBufferOverruns;
+            dst->ringBufferUnderruns = src->ringBufferUnderruns;
+            dst->targetDepthMs = 0;
+            dst->rateCorrectionPpm = 0.0f;
+            dst->frequencyOffset = src->frequencyOffset;
+            dst->globalFrequencyOffset = src->globalFrequencyOffset;
+            dst->totalFrequencyOffset = src->totalFrequencyOffset;
+        }
+        
+        st->hasTiming = false;
+    }
+}
+
+// Percentile of the values recorded in h since base, in microseconds: the
+// upper edge of the bucket holding it (the recorded maximum for the top
+// bucket). Returns -1 if nothing was recorded.
+int64_t HistogramPercentileUs(const UberSDRHistogram* h, const UberSDRHistogram* base, float fraction)
+{
+    LONG counts[UBERSDR_HIST_BUCKETS];
+    int64_t total = 0;
+    for (int i = 0; i < UBERSDR_HIST_BUCKETS; i++) {
+        counts[i] = h->count[i] - base->count[i];
+        total += counts[i];
+    }
+    if (total == 0) {
+        return -1;
+    }
+    
+    int64_t rank = (int64_t)(fraction * (float)total + 0.5f);
+    if (rank < 1) rank = 1;
+    
+    int64_t seen = 0;
+    for (int i = 0; i < UBERSDR_HIST_BUCKETS - 1; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return UberSDRHistBucketUs(i + 1);
+        }
+    }
+    return h->maxUs;
+}
+
+// Format "p50/p99 ms" for a histogram window
+void FormatPercentiles(const UberSDRHistogram* h, const UberSDRHistogram* base, char* buffer, size_t bufferSize)
+{
+    int64_t p50 = HistogramPercentileUs(h, base, 0.50f);
+    int64_t p99 = HistogramPercentileUs(h, base, 0.99f);
+    
+    if (p50 < 0) {
+        sprintf_s(buffer, bufferSize, "--");
+    } else if (p99 < 1000) {
+        sprintf_s(buffer, bufferSize, "%.2f/%.2f ms", p50 / 1000.0, p99 / 1000.0);
+    } else {
+        sprintf_s(buffer, bufferSize, "%.1f/%.1f ms", p50 / 1000.0, p99 / 1000.0);
+    }
+}
+
+// Producer position of a receiver's IQ ring, in values (any thread). v2
+// publishes it directly; v1 only has the write index, so the position is
+// rebuilt as the first one at or after readerPos with that index, which
+// assumes the reader is less than a ring behind (v1 can't show overruns).
+int64_t IqProducerPos(int receiverID, int64_t readerPos)
+{
+    const IqRingView* ring = &g_iqRings[receiverID];
+    if (ring->producerPos != NULL) {
+        return UberSDRLoad64(ring->producerPos);
+    }
+    if (ring->writeIndex == NULL) {
+        return readerPos;
+    }
+    
+    int32_t ahead = (*ring->writeIndex - (int32_t)(readerPos % IQ_BUFFER_SIZE) + IQ_BUFFER_SIZE) % IQ_BUFFER_SIZE;
+    return readerPos + ahead;
+}
+
 // Format uptime string
 void FormatUptime(int64_t startTime, char* buffer, size_t bufferSize)
 {
@@ -380,6 +769,8 @@ void UpdateDisplay()
         }
     }
     
+    RefreshStatus();
+    
     char buffer[256];
     
     // Server status
@@ -390,17 +781,8 @@ void UpdateDisplay()
     SetDlgItemTextA(g_hDlg, IDC_SERVER_STATUS, buffer);
     
     // Sample rate and mode - calculate global median offset across all receivers
-    int globalOffsets[MAX_DX_SPOTS];
-    int globalMeasuredCount = 0;
-    
-    for (int i = 0; i < g_dxSpotCount; i++) {
-    if (g_dxSpots[i].active && g_dxSpots[i].measured && g_dxSpots[i].actualFrequency > 0) {
-        // Use 1 Hz precision - don't round to 100 Hz
-        // Median will average out DX cluster's 100 Hz quantization for better accuracy
-        int offset = g_dxSpots[i].reportedFrequency - g_dxSpots[i].actualFrequency;
-        globalOffsets[globalMeasuredCount++] = offset;
-    }
-}
+    DXSpotStats globalStats;
+    GetDXSpotStats(INT_MIN, INT_MAX, &globalStats);
     
     // Get global fixed offset from INI (from first active receiver)
     int globalFixedOffset = 0;
@@ -411,25 +793,8 @@ void UpdateDisplay()
         }
     }
     
-    if (globalMeasuredCount > 0) {
-        // Sort offsets to find median
-        for (int i = 0; i < globalMeasuredCount - 1; i++) {
-            for (int j = i + 1; j < globalMeasuredCount; j++) {
-                if (globalOffsets[j] < globalOffsets[i]) {
-                    int temp = globalOffsets[i];
-                    globalOffsets[i] = globalOffsets[j];
-                    globalOffsets[j] = temp;
-                }
-            }
-        }
-        
-        // Calculate median
-        float globalMedianOffset;
-        if (globalMeasuredCount % 2 == 0) {
-            globalMedianOffset = (globalOffsets[globalMeasuredCount / 2 - 1] + globalOffsets[globalMeasuredCount / 2]) / 2.0f;
-        } else {
-            globalMedianOffset = (float)globalOffsets[globalMeasuredCount / 2];
-        }
+    if (globalStats.measuredCount > 0) {
+        float globalMedianOffset = globalStats.medianOffset;
         
         sprintf_s(buffer, sizeof(buffer), "Sample Rate: %d Hz    Mode: %s    Block Size: %d    INI Offset: %+d Hz    Global Median Offset: %+.0f Hz",
                   g_pStatus->sampleRate,
@@ -521,10 +886,16 @@ void UpdateDisplay()
               g_pStatus->activeReceiverCount);
     SetDlgItemTextA(g_hDlg, IDC_TOTAL_THROUGHPUT, buffer);
     
-    // Process any active recordings and check for duration expiry
+    UpdateTimingDisplay();
+    
+    // Check active recordings for write failures and duration expiry (the
+    // recorder thread does the copying and writing)
     for (int i = 0; i < MAX_RX_COUNT; i++) {
         if (g_recording[i].recording) {
-            ProcessRecording(i);
+            if (g_recording[i].failed) {
+                StopRecording(i);
+                continue;
+            }
             
             // Check if duration has expired (only for timed recordings, duration > 0)
             if (g_recording[i].durationSeconds > 0) {
@@ -537,19 +908,17 @@ void UpdateDisplay()
         }
     }
     
-    // Run FFT and spot measurement for all active receivers in background
+    // Run FFT and spot measurement for all active receivers in background:
+    // pick up whatever spectrum the workers finished, measure spots on it,
+    // and queue the next one
     for (int i = 0; i < MAX_RX_COUNT; i++) {
         if (g_pStatus->receivers[i].active) {
-            // Initialize spectrum window data if not already done
-            if (g_spectrumWindows[i].window[0] == 0.0f) {
-                InitHanningWindow(g_spectrumWindows[i].window, FFT_SIZE);
+            if (AcquireSpectrum(i)) {
+                // Measure spot peak frequencies for this receiver
+                MeasureSpotPeakFrequency(i);
             }
             
-            // Compute spectrum for this receiver
-            ComputeSpectrum(i);
-            
-            // Measure spot peak frequencies for this receiver
-            MeasureSpotPeakFrequency(i);
+            RequestSpectrum(i);
         }
     }
     
@@ -560,6 +929,66 @@ void UpdateDisplay()
     ProcessTelnet();
 }
 
+// Timing histogram lines: network jitter (frame interval), decode cost,
+// ring residence and the Skimmer Server callback side by side
+void UpdateTimingDisplay()
+{
+    char buffer[256];
+    
+    if (!g_pStatus->hasTiming) {
+        SetDlgItemTextA(g_hDlg, IDC_TIMING_CALLBACK, "pIQProc: not published by this DLL version");
+        for (int i = 0; i < MAX_RX_COUNT; i++) {
+            sprintf_s(buffer, sizeof(buffer), "Rx%d: --", i);
+            SetDlgItemTextA(g_hDlg, IDC_RX0_TIMING + i, buffer);
+        }
+        return;
+    }
+    
+    // Rotate the window base
+    DWORD now = GetTickCount();
+    if (!g_timing.valid) {
+        g_timing.base = *g_pStatus;
+        g_timing.pending = *g_pStatus;
+        g_timing.pendingTick = now;
+        g_timing.valid = true;
+    } else if (now - g_timing.pendingTick >= TIMING_WINDOW_MS) {
+        g_timing.base = g_timing.pending;
+        g_timing.pending = *g_pStatus;
+        g_timing.pendingTick = now;
+    }
+    const MonitorStatus* base = &g_timing.base;
+    
+    char interval[48], duration[48];
+    FormatPercentiles(&g_pStatus->callbackInterval, &base->callbackInterval, interval, sizeof(interval));
+    FormatPercentiles(&g_pStatus->callbackDuration, &base->callbackDuration, duration, sizeof(duration));
+    sprintf_s(buffer, sizeof(buffer), "pIQProc: interval %s    duration %s    (max %.1f ms / %.1f ms)",
+              interval, duration,
+              g_pStatus->callbackInterval.maxUs / 1000.0,
+              g_pStatus->callbackDuration.maxUs / 1000.0);
+    SetDlgItemTextA(g_hDlg, IDC_TIMING_CALLBACK, buffer);
+    
+    for (int i = 0; i < MAX_RX_COUNT; i++) {
+        const MonitorStatus::ReceiverStatus* rx = &g_pStatus->receivers[i];
+        const MonitorStatus::ReceiverStatus* rxBase = &base->receivers[i];
+        
+        if (!rx->active) {
+            sprintf_s(buffer, sizeof(buffer), "Rx%d: --", i);
+        } else {
+            char frames[48], decode[48], residence[48];
+            FormatPercentiles(&rx->frameInterval, &rxBase->frameInterval, frames, sizeof(frames));
+            FormatPercentiles(&rx->decodeTime, &rxBase->decodeTime, decode, sizeof(decode));
+            FormatPercentiles(&rx->ringResidence, &rxBase->ringResidence, residence, sizeof(residence));
+            int len = sprintf_s(buffer, sizeof(buffer), "Rx%d: frame interval %s    zstd decode %s    ring residence %s    (max frame gap %.1f ms)",
+                                i, frames, decode, residence, rx->frameInterval.maxUs / 1000.0);
+            if (rx->targetDepthMs > 0 && len > 0) {
+                sprintf_s(buffer + len, sizeof(buffer) - len, "    target %d ms, rate %+.1f ppm",
+                          rx->targetDepthMs, rx->rateCorrectionPpm);
+            }
+        }
+        SetDlgItemTextA(g_hDlg, IDC_RX0_TIMING + i, buffer);
+    }
+}
+
 // Start recording for a receiver
 bool StartRecording(int receiverID)
 {
@@ -567,6 +996,16 @@ bool StartRecording(int receiverID)
     if (g_recording[receiverID].recording) return false;
     if (g_pStatus == NULL || !g_pStatus->receivers[receiverID].active) return false;
     
+    RecordingState* rec = &g_recording[receiverID];
+    
+    // Buffers are allocated on first use and kept until shutdown
+    for (int b = 0; b < 2; b++) {
+        if (rec->buffers[b] == NULL) {
+            rec->buffers[b] = (uint8_t*)VirtualAlloc(NULL, RECORD_BUFFER_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+            if (rec->buffers[b] == NULL) return false;
+        }
+    }
+    
     // Generate filename with timestamp
     char filename[MAX_PATH];
     SYSTEMTIME st;
@@ -575,14 +1014,17 @@ bool StartRecording(int receiverID)
               receiverID, st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond,
               g_pStatus->receivers[receiverID].frequency);
     
-    // Create WAV file
-    g_recording[receiverID].hFile = CreateFileA(filename, GENERIC_WRITE, 0, NULL,
-                                                 CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (g_recording[receiverID].hFile == INVALID_HANDLE_VALUE) {
+    // Create WAV file - unbuffered, so only whole sectors are written and the
+    // header sizes are patched through a normal handle on stop
+    HANDLE hFile = CreateFileA(filename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
         return false;
     }
     
-    // Write WAV header (will update size later)
+    EnterCriticalSection(&rec->lock);
+    
+    // WAV header goes at the start of the first buffer (sizes updated on close)
     WAVHeader header = {0};
     memcpy(header.riff, "RIFF", 4);
     memcpy(header.wave, "WAVE", 4);
@@ -598,13 +1040,20 @@ bool StartRecording(int receiverID)
     header.dataSize = 0;  // Will update on close
     header.fileSize = sizeof(WAVHeader) - 8;  // Will update on close
     
-    DWORD written;
-    WriteFile(g_recording[receiverID].hFile, &header, sizeof(header), &written, NULL);
+    rec->activeBuffer = 0;
+    rec->fileOffset = 0;
+    memcpy(rec->buffers[0], &header, sizeof(header));
+    rec->bufferFill = sizeof(header);
     
     // Initialize recording state
-    g_recording[receiverID].recording = true;
-    g_recording[receiverID].lastReadPos = g_pStatus->receivers[receiverID].iqBufferWritePos;
-    g_recording[receiverID].samplesWritten = 0;
+    strcpy_s(rec->filename, sizeof(rec->filename), filename);
+    rec->hFile = hFile;
+    rec->failed = false;
+    rec->readPos = IqProducerPos(receiverID, 0);
+    rec->bytesWritten = 0;
+    rec->recording = true;
+    
+    LeaveCriticalSection(&rec->lock);
     
     // Change button color to red
     if (g_recordButtons[receiverID] != NULL) {
@@ -625,23 +1074,56 @@ void StopRecording(int receiverID)
     if (receiverID < 0 || receiverID >= MAX_RX_COUNT) return;
     if (!g_recording[receiverID].recording) return;
     
-    // Update WAV header with final sizes
-    if (g_recording[receiverID].hFile != INVALID_HANDLE_VALUE) {
-        uint32_t dataSize = g_recording[receiverID].samplesWritten * 4;  // 2 channels * 2 bytes
+    RecordingState* rec = &g_recording[receiverID];
+    
+    EnterCriticalSection(&rec->lock);
+    
+    // Take whatever is left in the ring, then write the partial buffer
+    // padded to a whole sector
+    if (!rec->failed) {
+        DrainRecording(rec, receiverID);
+    }
+    if (!rec->failed && rec->bufferFill > 0) {
+        uint32_t padded = (rec->bufferFill + RECORD_SECTOR_SIZE - 1) & ~(uint32_t)(RECORD_SECTOR_SIZE - 1);
+        memset(rec->buffers[rec->activeBuffer] + rec->bufferFill, 0, padded - rec->bufferFill);
+        rec->bufferFill = padded;
+        SubmitRecordBuffer(rec);
+    }
+    WaitRecordBuffer(rec, 0);
+    WaitRecordBuffer(rec, 1);
+    
+    CloseHandle(rec->hFile);
+    rec->hFile = INVALID_HANDLE_VALUE;
+    
+    // Trim the sector padding and update WAV header with final sizes
+    HANDLE hFile = CreateFileA(rec->filename, GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile != INVALID_HANDLE_VALUE) {
+        uint64_t dataBytes = rec->bytesWritten;
+        if (dataBytes > 0xFFFFFFFFull - sizeof(WAVHeader)) {
+            dataBytes = 0xFFFFFFFFull - sizeof(WAVHeader);  // WAV sizes are 32-bit
+        }
+        uint32_t dataSize = (uint32_t)dataBytes;
         uint32_t fileSize = dataSize + sizeof(WAVHeader) - 8;
         
-        SetFilePointer(g_recording[receiverID].hFile, 4, NULL, FILE_BEGIN);
+        LARGE_INTEGER end;
+        end.QuadPart = (LONGLONG)(sizeof(WAVHeader) + rec->bytesWritten);
+        SetFilePointerEx(hFile, end, NULL, FILE_BEGIN);
+        SetEndOfFile(hFile);
+        
+        SetFilePointer(hFile, 4, NULL, FILE_BEGIN);
         DWORD written;
-        WriteFile(g_recording[receiverID].hFile, &fileSize, 4, &written, NULL);
+        WriteFile(hFile, &fileSize, 4, &written, NULL);
         
-        SetFilePointer(g_recording[receiverID].hFile, 40, NULL, FILE_BEGIN);
-        WriteFile(g_recording[receiverID].hFile, &dataSize, 4, &written, NULL);
+        SetFilePointer(hFile, 40, NULL, FILE_BEGIN);
+        WriteFile(hFile, &dataSize, 4, &written, NULL);
         
-        CloseHandle(g_recording[receiverID].hFile);
-        g_recording[receiverID].hFile = INVALID_HANDLE_VALUE;
+        CloseHandle(hFile);
     }
     
-    g_recording[receiverID].recording = false;
+    rec->recording = false;
+    
+    LeaveCriticalSection(&rec->lock);
     
     // Restore button to normal color
     if (g_recordButtons[receiverID] != NULL) {
@@ -693,51 +1175,158 @@ LRESULT CALLBACK RecordButtonProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPa
     return DefSubclassProc(hwnd, msg, wParam, lParam);
 }
 
-// Process recording - copy samples from circular buffer to file
-void ProcessRecording(int receiverID)
+// Start the recorder thread
+void InitRecorder()
 {
-    if (receiverID < 0 || receiverID >= MAX_RX_COUNT) return;
-    if (!g_recording[receiverID].recording) return;
-    if (g_pStatus == NULL) return;
+    for (int i = 0; i < MAX_RX_COUNT; i++) {
+        RecordingState* rec = &g_recording[i];
+        InitializeCriticalSection(&rec->lock);
+        rec->hFile = INVALID_HANDLE_VALUE;
+        for (int b = 0; b < 2; b++) {
+            rec->overlapped[b].hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+        }
+    }
     
-    int32_t writePos = g_pStatus->receivers[receiverID].iqBufferWritePos;
-    int32_t readPos = g_recording[receiverID].lastReadPos;
+    g_recorderStopEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (g_recorderStopEvent != NULL) {
+        g_recorderThread = CreateThread(NULL, 0, RecorderThread, NULL, 0, NULL);
+    }
+}
+
+// Stop the recorder thread (recordings must already be stopped)
+void ShutdownRecorder()
+{
+    if (g_recorderThread != NULL) {
+        SetEvent(g_recorderStopEvent);
+        WaitForSingleObject(g_recorderThread, INFINITE);
+        CloseHandle(g_recorderThread);
+        g_recorderThread = NULL;
+    }
+    if (g_recorderStopEvent != NULL) {
+        CloseHandle(g_recorderStopEvent);
+        g_recorderStopEvent = NULL;
+    }
     
-    // Calculate available samples
-    int32_t available;
-    if (writePos >= readPos) {
-        available = writePos - readPos;
-    } else {
-        available = IQ_BUFFER_SIZE - readPos + writePos;
+    for (int i = 0; i < MAX_RX_COUNT; i++) {
+        RecordingState* rec = &g_recording[i];
+        for (int b = 0; b < 2; b++) {
+            if (rec->buffers[b] != NULL) {
+                VirtualFree(rec->buffers[b], 0, MEM_RELEASE);
+                rec->buffers[b] = NULL;
+            }
+            if (rec->overlapped[b].hEvent != NULL) {
+                CloseHandle(rec->overlapped[b].hEvent);
+                rec->overlapped[b].hEvent = NULL;
+            }
+        }
+        DeleteCriticalSection(&rec->lock);
+    }
+}
+
+// Recorder thread - drains every recording receiver's ring every RECORD_POLL_MS
+DWORD WINAPI RecorderThread(LPVOID param)
+{
+    while (WaitForSingleObject(g_recorderStopEvent, RECORD_POLL_MS) == WAIT_TIMEOUT) {
+        for (int i = 0; i < MAX_RX_COUNT; i++) {
+            RecordingState* rec = &g_recording[i];
+            EnterCriticalSection(&rec->lock);
+            if (rec->recording && !rec->failed) {
+                DrainRecording(rec, i);
+            }
+            LeaveCriticalSection(&rec->lock);
+        }
     }
+    return 0;
+}
+
+// Copy new samples from the circular buffer into the record buffers, at most
+// two memcpy spans per buffer fill, submitting each buffer as it fills. Called
+// with rec->lock held.
+void DrainRecording(RecordingState* rec, int receiverID)
+{
+    const int16_t* iqBuffer = g_iqRings[receiverID].buffer;
+    if (iqBuffer == NULL) return;
     
-    if (available < 2) return;  // Need at least one I/Q pair
+    int64_t producerPos = IqProducerPos(receiverID, rec->readPos);
     
-    // Write samples to file in batches for better performance
-    // Use a temporary buffer to batch writes (reduces WriteFile calls dramatically)
-    #define WRITE_BATCH_SIZE 8192  // Write 4KB at a time (2048 I/Q pairs)
-    int16_t batchBuffer[WRITE_BATCH_SIZE];
+    // If the ring lapped us (v2 only), resume half a ring behind the producer
+    // and record the lost stretch as silence so the file keeps its timing
+    int64_t lost = 0;
+    if (producerPos - rec->readPos > IQ_BUFFER_SIZE) {
+        lost = (producerPos - IQ_BUFFER_SIZE / 2) - rec->readPos;
+        lost &= ~(int64_t)1;
+    }
     
-    while (available >= 2) {
-        // Fill batch buffer
-        int batchCount = 0;
-        while (available >= 2 && batchCount < WRITE_BATCH_SIZE) {
-            batchBuffer[batchCount++] = g_pStatus->receivers[receiverID].iqBuffer[readPos];
-            batchBuffer[batchCount++] = g_pStatus->receivers[receiverID].iqBuffer[readPos + 1];
-            
-            g_recording[receiverID].samplesWritten++;
-            readPos = (readPos + 2) % IQ_BUFFER_SIZE;
-            available -= 2;
+    // Calculate available samples, in whole I/Q pairs
+    int64_t available = (producerPos - rec->readPos) & ~(int64_t)1;
+    
+    while (available > 0 && !rec->failed) {
+        uint8_t* dst = rec->buffers[rec->activeBuffer] + rec->bufferFill;
+        int32_t count = (int32_t)((RECORD_BUFFER_SIZE - rec->bufferFill) / sizeof(int16_t)) & ~1;
+        if (count > available) count = (int32_t)available;
+        
+        if (lost > 0) {
+            if (count > lost) count = (int32_t)lost;
+            memset(dst, 0, count * sizeof(int16_t));
+            lost -= count;
+        } else {
+            int32_t readIndex = (int32_t)(rec->readPos % IQ_BUFFER_SIZE);
+            int32_t firstSpan = IQ_BUFFER_SIZE - readIndex;
+            if (firstSpan > count) firstSpan = count;
+            memcpy(dst, iqBuffer + readIndex, firstSpan * sizeof(int16_t));
+            memcpy(dst + firstSpan * sizeof(int16_t), iqBuffer, (count - firstSpan) * sizeof(int16_t));
         }
         
-        // Write batch to file
-        if (batchCount > 0) {
-            DWORD written;
-            WriteFile(g_recording[receiverID].hFile, batchBuffer, batchCount * sizeof(int16_t), &written, NULL);
+        rec->readPos += count;
+        available -= count;
+        rec->bufferFill += count * sizeof(int16_t);
+        rec->bytesWritten += count * sizeof(int16_t);
+        
+        // The 44-byte header keeps the first buffer pair-aligned too, so
+        // every buffer fills exactly
+        if (rec->bufferFill == RECORD_BUFFER_SIZE) {
+            SubmitRecordBuffer(rec);
         }
     }
+}
+
+// Start an overlapped write of the active buffer and switch to the other one,
+// waiting for its previous write first. Called with rec->lock held.
+void SubmitRecordBuffer(RecordingState* rec)
+{
+    int index = rec->activeBuffer;
+    uint32_t bytes = rec->bufferFill;
+    
+    OVERLAPPED* ov = &rec->overlapped[index];
+    ov->Offset = (DWORD)(rec->fileOffset & 0xFFFFFFFF);
+    ov->OffsetHigh = (DWORD)(rec->fileOffset >> 32);
+    ResetEvent(ov->hEvent);
+    
+    if (!WriteFile(rec->hFile, rec->buffers[index], bytes, NULL, ov) &&
+        GetLastError() != ERROR_IO_PENDING) {
+        rec->failed = true;
+    } else {
+        rec->writePending[index] = true;
+    }
+    
+    rec->fileOffset += bytes;
+    rec->activeBuffer = index ^ 1;
+    rec->bufferFill = 0;
+    if (!WaitRecordBuffer(rec, rec->activeBuffer)) {
+        rec->failed = true;
+    }
+}
+
+// Wait for a record buffer's write to complete. Returns false if it failed.
+bool WaitRecordBuffer(RecordingState* rec, int index)
+{
+    if (!rec->writePending[index]) return true;
+    rec->writePending[index] = false;
     
-    g_recording[receiverID].lastReadPos = readPos;
+    DWORD written = 0;
+    OVERLAPPED* ov = &rec->overlapped[index];
+    if (!GetOverlappedResult(rec->hFile, ov, &written, TRUE)) return false;
+    return true;
 }
 
 // Initialize Winsock
@@ -903,70 +1492,147 @@ void AddDXSpot(const char* callsign, int frequency)
 {
     DWORD currentTime = GetTickCount();
     
-    // Check if this spot already exists (same callsign and frequency within 1 kHz)
-    for (int i = 0; i < g_dxSpotCount; i++) {
-        if (g_dxSpots[i].active &&
-            strcmp(g_dxSpots[i].callsign, callsign) == 0 &&
-            abs(g_dxSpots[i].reportedFrequency - frequency) < 1000) {
-            // Update timestamp
-            g_dxSpots[i].timestamp = currentTime;
-            return;
-        }
+    // Same callsign within 1 kHz: this is a re-spot, refresh its age
+    int slot = FindDXSpot(callsign, frequency);
+    if (slot >= 0) {
+        g_dxSpots[slot].timestamp = currentTime;
+        g_dxSpotsByAge.splice(g_dxSpotsByAge.end(), g_dxSpotsByAge, g_dxSpots[slot].ageEntry);
+        return;
     }
     
-    // Find an empty slot or reuse oldest spot
-    int slotIndex = -1;
-    
-    // First try to find an inactive slot
-    for (int i = 0; i < MAX_DX_SPOTS; i++) {
-        if (!g_dxSpots[i].active) {
-            slotIndex = i;
-            break;
-        }
+    // Store full: drop the least recently spotted
+    if ((int)g_dxSpotsByFreq.size() >= MAX_DX_SPOTS) {
+        RemoveDXSpot(g_dxSpotsByAge.front());
     }
     
-    // If no inactive slot, find oldest spot
-    if (slotIndex == -1) {
-        DWORD oldestTime = currentTime;
-        for (int i = 0; i < MAX_DX_SPOTS; i++) {
-            if (g_dxSpots[i].timestamp < oldestTime) {
-                oldestTime = g_dxSpots[i].timestamp;
-                slotIndex = i;
-            }
-        }
+    // Reuse a free slot or grow the pool
+    if (!g_dxFreeSlots.empty()) {
+        slot = g_dxFreeSlots.back();
+        g_dxFreeSlots.pop_back();
+    } else {
+        slot = (int)g_dxSpots.size();
+        g_dxSpots.push_back(DXSpot());
     }
     
     // Add the spot
-    if (slotIndex >= 0) {
-        strcpy_s(g_dxSpots[slotIndex].callsign, sizeof(g_dxSpots[slotIndex].callsign), callsign);
-        g_dxSpots[slotIndex].reportedFrequency = frequency;
-        g_dxSpots[slotIndex].actualFrequency = 0;  // Not yet measured
-        g_dxSpots[slotIndex].timestamp = currentTime;
-        g_dxSpots[slotIndex].active = true;
-        g_dxSpots[slotIndex].measured = false;
-        g_dxSpots[slotIndex].measurementCount = 0;  // No measurements yet
-        for (int i = 0; i < MAX_MEASUREMENTS; i++) {
-            g_dxSpots[slotIndex].measurementFreqs[i] = 0;
+    DXSpot& spot = g_dxSpots[slot];
+    strcpy_s(spot.callsign, sizeof(spot.callsign), callsign);
+    spot.reportedFrequency = frequency;
+    spot.actualFrequency = 0;  // Not yet measured
+    spot.timestamp = currentTime;
+    spot.active = true;
+    spot.measured = false;
+    spot.measurementCount = 0;  // No measurements yet
+    for (int i = 0; i < MAX_MEASUREMENTS; i++) {
+        spot.measurementFreqs[i] = 0;
+    }
+    
+    spot.freqEntry = g_dxSpotsByFreq.insert(std::make_pair(frequency, slot));
+    spot.ageEntry = g_dxSpotsByAge.insert(g_dxSpotsByAge.end(), slot);
+    g_dxSpotsByCall[DXSpotKey(callsign, frequency / DX_SPOT_BUCKET_HZ)] = slot;
+    g_dxSpotsPending.push_back(slot);
+}
+
+// Key of a spot in g_dxSpotsByCall
+std::string DXSpotKey(const char* callsign, int bucket)
+{
+    char key[32];
+    sprintf_s(key, sizeof(key), "%s/%d", callsign, bucket);
+    return key;
+}
+
+// Find the live spot for this callsign within 1 kHz of frequency (-1 if none).
+// Buckets are 1 kHz wide, so only the spot's own bucket and its two
+// neighbours can hold a match.
+int FindDXSpot(const char* callsign, int frequency)
+{
+    int bucket = frequency / DX_SPOT_BUCKET_HZ;
+    for (int b = bucket - 1; b <= bucket + 1; b++) {
+        auto it = g_dxSpotsByCall.find(DXSpotKey(callsign, b));
+        if (it != g_dxSpotsByCall.end() &&
+            abs(g_dxSpots[it->second].reportedFrequency - frequency) < DX_SPOT_BUCKET_HZ) {
+            return it->second;
         }
-        
-        // Update count if needed
-        if (slotIndex >= g_dxSpotCount) {
-            g_dxSpotCount = slotIndex + 1;
+    }
+    return -1;
+}
+
+// Remove a spot from every index and free its slot
+void RemoveDXSpot(int slot)
+{
+    DXSpot& spot = g_dxSpots[slot];
+    g_dxSpotsByCall.erase(DXSpotKey(spot.callsign, spot.reportedFrequency / DX_SPOT_BUCKET_HZ));
+    g_dxSpotsByFreq.erase(spot.freqEntry);
+    g_dxSpotsByAge.erase(spot.ageEntry);
+    if (!spot.measured) {
+        auto pending = std::find(g_dxSpotsPending.begin(), g_dxSpotsPending.end(), slot);
+        if (pending != g_dxSpotsPending.end()) {
+            g_dxSpotsPending.erase(pending);
         }
     }
+    spot.active = false;
+    g_dxFreeSlots.push_back(slot);
 }
 
-// Clean up old spots (older than 5 minutes)
+// Clean up old spots (not re-spotted for 30 minutes), oldest first
 void CleanupOldSpots()
 {
     DWORD currentTime = GetTickCount();
     
-    for (int i = 0; i < g_dxSpotCount; i++) {
-        if (g_dxSpots[i].active) {
-            DWORD age = currentTime - g_dxSpots[i].timestamp;
-            if (age > DX_SPOT_TIMEOUT) {
-                g_dxSpots[i].active = false;
-            }
+    while (!g_dxSpotsByAge.empty()) {
+        int slot = g_dxSpotsByAge.front();
+        DWORD age = currentTime - g_dxSpots[slot].timestamp;
+        if (age <= DX_SPOT_TIMEOUT) {
+            break;
+        }
+        RemoveDXSpot(slot);
+    }
+}
+
+// Spot counts and median offset for the spots reported between minFreq and
+// maxFreq (one range query on the frequency index)
+void GetDXSpotStats(int minFreq, int maxFreq, DXSpotStats* stats)
+{
+    static std::vector<const char*> callsigns;
+    static std::vector<int> offsets;
+    callsigns.clear();
+    offsets.clear();
+    
+    auto end = g_dxSpotsByFreq.upper_bound(maxFreq);
+    for (auto it = g_dxSpotsByFreq.lower_bound(minFreq); it != end; ++it) {
+        const DXSpot& spot = g_dxSpots[it->second];
+        callsigns.push_back(spot.callsign);
+        
+        // Use 1 Hz precision - median will average out DX cluster's 100 Hz quantization
+        if (spot.measured && spot.actualFrequency > 0) {
+            offsets.push_back(spot.reportedFrequency - spot.actualFrequency);
+        }
+    }
+    
+    // Count unique callsigns
+    std::sort(callsigns.begin(), callsigns.end(), [](const char* a, const char* b) {
+        return strcmp(a, b) < 0;
+    });
+    int uniqueCount = 0;
+    for (size_t i = 0; i < callsigns.size(); i++) {
+        if (i == 0 || strcmp(callsigns[i], callsigns[i - 1]) != 0) {
+            uniqueCount++;
+        }
+    }
+    
+    stats->uniqueCount = uniqueCount;
+    stats->totalCount = (int)callsigns.size();
+    stats->measuredCount = (int)offsets.size();
+    stats->medianOffset = 0.0f;
+    
+    // Calculate median
+    int measuredCount = stats->measuredCount;
+    if (measuredCount > 0) {
+        std::sort(offsets.begin(), offsets.end());
+        if (measuredCount % 2 == 0) {
+            stats->medianOffset = (offsets[measuredCount / 2 - 1] + offsets[measuredCount / 2]) / 2.0f;
+        } else {
+            stats->medianOffset = (float)offsets[measuredCount / 2];
         }
     }
 }
@@ -991,21 +1657,18 @@ void DrawDXSpots(HDC hdc, int receiverID, int marginLeft, int marginTop, int plo
         int tier;  // Vertical tier for collision avoidance
     };
     
-    VisibleSpot visibleSpots[MAX_DX_SPOTS];
-    int visibleCount = 0;
+    static std::vector<VisibleSpot> visibleSpots;
+    visibleSpots.clear();
     
-    // First pass: collect all visible spots and calculate their positions
-    for (int i = 0; i < g_dxSpotCount; i++) {
-        if (!g_dxSpots[i].active) continue;
-        
+    // First pass: collect the spots within both the receiver's band and the
+    // visible frequency range (considering zoom) and calculate their positions
+    int rangeMin = (bandMinFreq > minFreq) ? bandMinFreq : minFreq;
+    int rangeMax = (bandMaxFreq < maxFreq) ? bandMaxFreq : maxFreq;
+    auto rangeEnd = g_dxSpotsByFreq.upper_bound(rangeMax);
+    for (auto it = g_dxSpotsByFreq.lower_bound(rangeMin); it != rangeEnd; ++it) {
+        int i = it->second;
         int spotFreq = g_dxSpots[i].reportedFrequency;
         
-        // Check if spot is within the receiver's band
-        if (spotFreq < bandMinFreq || spotFreq > bandMaxFreq) continue;
-        
-        // Check if spot is within the visible frequency range (considering zoom)
-        if (spotFreq < minFreq || spotFreq > maxFreq) continue;
-        
         // Calculate X position for this spot
         int visibleSpan = maxFreq - minFreq;
         float freqToX = (float)plotWidth / (float)visibleSpan;
@@ -1015,24 +1678,17 @@ void DrawDXSpots(HDC hdc, int receiverID, int marginLeft, int marginTop, int plo
         SIZE textSize;
         GetTextExtentPoint32A(hdc, g_dxSpots[i].callsign, (int)strlen(g_dxSpots[i].callsign), &textSize);
         
-        visibleSpots[visibleCount].index = i;
-        visibleSpots[visibleCount].x = x;
-        visibleSpots[visibleCount].textWidth = textSize.cx;
-        visibleSpots[visibleCount].tier = 0;  // Will be assigned later
-        visibleCount++;
+        VisibleSpot visible;
+        visible.index = i;
+        visible.x = x;
+        visible.textWidth = textSize.cx;
+        visible.tier = 0;  // Will be assigned later
+        visibleSpots.push_back(visible);
     }
+    int visibleCount = (int)visibleSpots.size();
     
     // Second pass: assign tiers to avoid collisions
-    // Sort spots by X position for easier collision detection
-    for (int i = 0; i < visibleCount - 1; i++) {
-        for (int j = i + 1; j < visibleCount; j++) {
-            if (visibleSpots[j].x < visibleSpots[i].x) {
-                VisibleSpot temp = visibleSpots[i];
-                visibleSpots[i] = visibleSpots[j];
-                visibleSpots[j] = temp;
-            }
-        }
-    }
+    // (the frequency index returns the spots already sorted by X position)
     
     // Assign tiers based on horizontal overlap
     #define MAX_TIERS 4
@@ -1182,38 +1838,10 @@ void CountSpotsForReceiver(int receiverID, int* uniqueCount, int* totalCount)
     int bandMinFreq = centerFreq - sampleRate / 2;
     int bandMaxFreq = centerFreq + sampleRate / 2;
     
-    // Track unique callsigns
-    char uniqueCallsigns[MAX_DX_SPOTS][16];
-    int uniqueCallsignCount = 0;
-    int total = 0;
-    
-    for (int i = 0; i < g_dxSpotCount; i++) {
-        if (!g_dxSpots[i].active) continue;
-        
-        int spotFreq = g_dxSpots[i].reportedFrequency;
-        
-        // Check if spot is within this receiver's band
-        if (spotFreq < bandMinFreq || spotFreq > bandMaxFreq) continue;
-        
-        total++;
-        
-        // Check if callsign is already in unique list
-        bool found = false;
-        for (int j = 0; j < uniqueCallsignCount; j++) {
-            if (strcmp(uniqueCallsigns[j], g_dxSpots[i].callsign) == 0) {
-                found = true;
-                break;
-            }
-        }
-        
-        if (!found && uniqueCallsignCount < MAX_DX_SPOTS) {
-            strcpy_s(uniqueCallsigns[uniqueCallsignCount], sizeof(uniqueCallsigns[uniqueCallsignCount]), g_dxSpots[i].callsign);
-            uniqueCallsignCount++;
-        }
-    }
-    
-    *uniqueCount = uniqueCallsignCount;
-    *totalCount = total;
+    DXSpotStats stats;
+    GetDXSpotStats(bandMinFreq, bandMaxFreq, &stats);
+    *uniqueCount = stats.uniqueCount;
+    *totalCount = stats.totalCount;
 }
 
 // Update spot count displays for all receivers with median offset
@@ -1233,66 +1861,18 @@ void UpdateSpotCounts()
         int bandMinFreq = centerFreq - sampleRate / 2;
         int bandMaxFreq = centerFreq + sampleRate / 2;
         
-        int uniqueCount = 0;
-        int totalCount = 0;
-        int offsets[MAX_DX_SPOTS];
-        int measuredCount = 0;
-        
-        // Track unique callsigns
-        char uniqueCallsigns[MAX_DX_SPOTS][16];
-        
-        for (int j = 0; j < g_dxSpotCount; j++) {
-            if (!g_dxSpots[j].active) continue;
-            
-            int spotFreq = g_dxSpots[j].reportedFrequency;
-            if (spotFreq < bandMinFreq || spotFreq > bandMaxFreq) continue;
-            
-            totalCount++;
-            
-            // Check if callsign is unique
-            bool found = false;
-            for (int k = 0; k < uniqueCount; k++) {
-                if (strcmp(uniqueCallsigns[k], g_dxSpots[j].callsign) == 0) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found && uniqueCount < MAX_DX_SPOTS) {
-                strcpy_s(uniqueCallsigns[uniqueCount], sizeof(uniqueCallsigns[uniqueCount]), g_dxSpots[j].callsign);
-                uniqueCount++;
-            }
-            
-            // Collect offsets for measured spots
-            // Use 1 Hz precision - median will average out DX cluster's 100 Hz quantization
-            if (g_dxSpots[j].measured && g_dxSpots[j].actualFrequency > 0) {
-                int offset = g_dxSpots[j].reportedFrequency - g_dxSpots[j].actualFrequency;
-                offsets[measuredCount++] = offset;
-            }
-        }
+        DXSpotStats stats;
+        GetDXSpotStats(bandMinFreq, bandMaxFreq, &stats);
+        int uniqueCount = stats.uniqueCount;
+        int totalCount = stats.totalCount;
+        int measuredCount = stats.measuredCount;
         
         char buffer[128];  // Increased buffer size for safety
         char medianBuffer[64];  // Buffer for median offset display
         
         if (totalCount > 0) {
             if (measuredCount > 0) {
-                // Sort offsets to find median
-                for (int j = 0; j < measuredCount - 1; j++) {
-                    for (int k = j + 1; k < measuredCount; k++) {
-                        if (offsets[k] < offsets[j]) {
-                            int temp = offsets[j];
-                            offsets[j] = offsets[k];
-                            offsets[k] = temp;
-                        }
-                    }
-                }
-                
-                // Calculate median
-                float medianOffset;
-                if (measuredCount % 2 == 0) {
-                    medianOffset = (offsets[measuredCount / 2 - 1] + offsets[measuredCount / 2]) / 2.0f;
-                } else {
-                    medianOffset = (float)offsets[measuredCount / 2];
-                }
+                float medianOffset = stats.medianOffset;
                 
                 // Display spot counts without offset
                 sprintf_s(buffer, sizeof(buffer), "%d/%d", uniqueCount, totalCount);
@@ -1335,8 +1915,8 @@ void MeasureSpotPeakFrequency(int receiverID)
     const float MIN_SNR_DB = 10.0f;
     
     // Check each unmeasured spot
-    for (int i = 0; i < g_dxSpotCount; i++) {
-        if (!g_dxSpots[i].active || g_dxSpots[i].measured) continue;
+    for (size_t p = 0; p < g_dxSpotsPending.size(); p++) {
+        int i = g_dxSpotsPending[p];
         
         // Check if spot is within 5 seconds of arrival (extended window for CW keying)
         DWORD age = currentTime - g_dxSpots[i].timestamp;
@@ -1450,6 +2030,11 @@ void MeasureSpotPeakFrequency(int receiverID)
             // Don't mark as measured yet - keep collecting more measurements
         }
     }
+    
+    // Spots that completed measurement leave the pending list
+    g_dxSpotsPending.erase(std::remove_if(g_dxSpotsPending.begin(), g_dxSpotsPending.end(),
+                                          [](int slot) { return g_dxSpots[slot].measured; }),
+                           g_dxSpotsPending.end());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1581,63 +2166,18 @@ void UpdateSpotsListView(int receiverID)
     ListView_DeleteAllItems(hListView);
     
     // Calculate median offset and count spots for this receiver's band
-    int offsets[MAX_DX_SPOTS];
-    int measuredCount = 0;
-    int totalCount = 0;
-    char uniqueCallsigns[MAX_DX_SPOTS][16];
-    int uniqueCount = 0;
-    
-    for (int i = 0; i < g_dxSpotCount; i++) {
-        if (!g_dxSpots[i].active) continue;
-        
-        int spotFreq = g_dxSpots[i].reportedFrequency;
-        if (spotFreq < bandMinFreq || spotFreq > bandMaxFreq) continue;
-        
-        totalCount++;
-        
-        // Track unique callsigns
-        bool found = false;
-        for (int j = 0; j < uniqueCount; j++) {
-            if (strcmp(uniqueCallsigns[j], g_dxSpots[i].callsign) == 0) {
-                found = true;
-                break;
-            }
-        }
-        if (!found && uniqueCount < MAX_DX_SPOTS) {
-            strcpy_s(uniqueCallsigns[uniqueCount], sizeof(uniqueCallsigns[uniqueCount]), g_dxSpots[i].callsign);
-            uniqueCount++;
-        }
-        
-        if (g_dxSpots[i].measured && g_dxSpots[i].actualFrequency > 0) {
-            // Use 1 Hz precision - median will average out DX cluster's 100 Hz quantization
-            int offset = g_dxSpots[i].reportedFrequency - g_dxSpots[i].actualFrequency;
-            offsets[measuredCount++] = offset;
-        }
-    }
+    DXSpotStats stats;
+    GetDXSpotStats(bandMinFreq, bandMaxFreq, &stats);
+    int measuredCount = stats.measuredCount;
+    int totalCount = stats.totalCount;
+    int uniqueCount = stats.uniqueCount;
     
     // Update median offset label with spot counts
     HWND hLabel = GetDlgItem(hSpotsWnd, 2);
     if (hLabel) {
         char labelText[256];
         if (measuredCount > 0) {
-            // Sort offsets to find median
-            for (int i = 0; i < measuredCount - 1; i++) {
-                for (int j = i + 1; j < measuredCount; j++) {
-                    if (offsets[j] < offsets[i]) {
-                        int temp = offsets[i];
-                        offsets[i] = offsets[j];
-                        offsets[j] = temp;
-                    }
-                }
-            }
-            
-            // Calculate median
-            float medianOffset;
-            if (measuredCount % 2 == 0) {
-                medianOffset = (offsets[measuredCount / 2 - 1] + offsets[measuredCount / 2]) / 2.0f;
-            } else {
-                medianOffset = (float)offsets[measuredCount / 2];
-            }
+            float medianOffset = stats.medianOffset;
             
             sprintf_s(labelText, sizeof(labelText), "Median Offset: %+.1f Hz | Spots: %d unique / %d total (%d measured)",
                      medianOffset, uniqueCount, totalCount, measuredCount);
@@ -1648,16 +2188,27 @@ void UpdateSpotsListView(int receiverID)
         SetWindowTextA(hLabel, labelText);
     }
     
-    // Add spots (newest first) - only show spots that were actually measured
+    // Collect this band's spots that were actually measured (actualFrequency > 0)
+    static std::vector<int> bandSpots;
+    bandSpots.clear();
+    auto bandEnd = g_dxSpotsByFreq.upper_bound(bandMaxFreq);
+    for (auto it = g_dxSpotsByFreq.lower_bound(bandMinFreq); it != bandEnd; ++it) {
+        const DXSpot& spot = g_dxSpots[it->second];
+        if (spot.measured && spot.actualFrequency > 0) {
+            bandSpots.push_back(it->second);
+        }
+    }
+    
+    // Newest first
+    DWORD nowTick = GetTickCount();
+    std::sort(bandSpots.begin(), bandSpots.end(), [nowTick](int a, int b) {
+        return nowTick - g_dxSpots[a].timestamp < nowTick - g_dxSpots[b].timestamp;
+    });
+    
+    // Add spots
     int itemIndex = 0;
-    for (int i = g_dxSpotCount - 1; i >= 0; i--) {
-        if (!g_dxSpots[i].active) continue;
-        
-        // Only show spots that were actually measured (actualFrequency > 0)
-        if (!g_dxSpots[i].measured || g_dxSpots[i].actualFrequency == 0) continue;
-        
-        int spotFreq = g_dxSpots[i].reportedFrequency;
-        if (spotFreq < bandMinFreq || spotFreq > bandMaxFreq) continue;
+    for (size_t n = 0; n < bandSpots.size(); n++) {
+        int i = bandSpots[n];
         
         // Convert timestamp to local time
         DWORD timestamp = g_dxSpots[i].timestamp;
@@ -1921,146 +2472,134 @@ void InitHanningWindow(float* window, int size)
     }
 }
 
-// Simple Cooley-Tukey FFT implementation (radix-2, in-place)
-void PerformFFT(Complex* data, int size)
+// Start the spectrum worker pool
+void InitSpectrumWorkers()
 {
-    // Bit-reversal permutation
-    int j = 0;
-    for (int i = 0; i < size - 1; i++) {
-        if (i < j) {
-            Complex temp = data[i];
-            data[i] = data[j];
-            data[j] = temp;
-        }
-        int k = size / 2;
-        while (k <= j) {
-            j -= k;
-            k /= 2;
-        }
-        j += k;
-    }
-    
-    // FFT computation
-    for (int len = 2; len <= size; len *= 2) {
-        float angle = -2.0f * PI / len;
-        Complex wlen = { cosf(angle), sinf(angle) };
-        
-        for (int i = 0; i < size; i += len) {
-            Complex w = { 1.0f, 0.0f };
-            for (int j = 0; j < len / 2; j++) {
-                Complex u = data[i + j];
-                Complex v = {
-                    data[i + j + len / 2].real * w.real - data[i + j + len / 2].imag * w.imag,
-                    data[i + j + len / 2].real * w.imag + data[i + j + len / 2].imag * w.real
-                };
-                
-                data[i + j].real = u.real + v.real;
-                data[i + j].imag = u.imag + v.imag;
-                data[i + j + len / 2].real = u.real - v.real;
-                data[i + j + len / 2].imag = u.imag - v.imag;
-                
-                float w_temp = w.real * wlen.real - w.imag * wlen.imag;
-                w.imag = w.real * wlen.imag + w.imag * wlen.real;
-                w.real = w_temp;
-            }
+    InitializeCriticalSection(&g_spectrumLock);
+    InitHanningWindow(g_hannWindow, FFT_SIZE);
+    
+    for (int i = 0; i < MAX_RX_COUNT; i++) {
+        SpectrumWindow* spec = &g_spectrumWindows[i];
+        spec->computeSlot = 0;
+        spec->readySlot = 1;
+        spec->displaySlot = 2;
+        spec->magnitudeDB = spec->frames[spec->displaySlot].magnitudeDB;
+    }
+    
+    if (spectrum_fft_init(&g_spectrumFFT, FFT_SIZE) != 0) return;
+    
+    g_spectrumWorkSemaphore = CreateSemaphoreA(NULL, 0, MAX_RX_COUNT, NULL);
+    g_spectrumIdleEvent = CreateEventA(NULL, TRUE, TRUE, NULL);
+    if (g_spectrumWorkSemaphore == NULL || g_spectrumIdleEvent == NULL) return;
+    
+    // One worker per CPU, up to one per receiver
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int workers = (int)si.dwNumberOfProcessors;
+    if (workers < 1) workers = 1;
+    if (workers > MAX_SPECTRUM_WORKERS) workers = MAX_SPECTRUM_WORKERS;
+    
+    for (int i = 0; i < workers; i++) {
+        g_spectrumWorkers[g_spectrumWorkerCount] = CreateThread(NULL, 0, SpectrumWorkerThread, NULL, 0, NULL);
+        if (g_spectrumWorkers[g_spectrumWorkerCount] != NULL) {
+            g_spectrumWorkerCount++;
         }
     }
 }
 
-// Compare function for qsort
-int CompareFloat(const void* a, const void* b)
+// Stop the spectrum worker pool
+void ShutdownSpectrumWorkers()
 {
-    float fa = *(const float*)a;
-    float fb = *(const float*)b;
-    if (fa < fb) return -1;
-    if (fa > fb) return 1;
-    return 0;
+    WaitSpectrumWorkers();
+    
+    if (g_spectrumWorkerCount > 0) {
+        EnterCriticalSection(&g_spectrumLock);
+        g_spectrumStopping = true;
+        LeaveCriticalSection(&g_spectrumLock);
+        
+        ReleaseSemaphore(g_spectrumWorkSemaphore, g_spectrumWorkerCount, NULL);
+        WaitForMultipleObjects(g_spectrumWorkerCount, g_spectrumWorkers, TRUE, INFINITE);
+        for (int i = 0; i < g_spectrumWorkerCount; i++) {
+            CloseHandle(g_spectrumWorkers[i]);
+            g_spectrumWorkers[i] = NULL;
+        }
+        g_spectrumWorkerCount = 0;
+    }
+    
+    if (g_spectrumWorkSemaphore != NULL) {
+        CloseHandle(g_spectrumWorkSemaphore);
+        g_spectrumWorkSemaphore = NULL;
+    }
+    if (g_spectrumIdleEvent != NULL) {
+        CloseHandle(g_spectrumIdleEvent);
+        g_spectrumIdleEvent = NULL;
+    }
+    spectrum_fft_free(&g_spectrumFFT);
+    DeleteCriticalSection(&g_spectrumLock);
 }
 
-// Calculate noise floor using 10th percentile method (reliable for signals present)
-float CalculateNoiseFloor(const float* magnitudeDB, int size)
+// Wait until no spectrum is queued or being computed
+void WaitSpectrumWorkers()
 {
-    // Create a copy for sorting
-    float* sorted = (float*)malloc(size * sizeof(float));
-    if (sorted == NULL) return -100.0f;
-    
-    memcpy(sorted, magnitudeDB, size * sizeof(float));
-    
-    // Sort the array
-    qsort(sorted, size, sizeof(float), CompareFloat);
-    
-    // Use 10th percentile as noise floor (robust against signals)
-    int percentileIndex = (int)(size * 0.10f);
-    if (percentileIndex >= size) percentileIndex = size - 1;
-    
-    float noiseFloor = sorted[percentileIndex];
-    
-    free(sorted);
-    return noiseFloor;
+    if (g_spectrumIdleEvent != NULL) {
+        WaitForSingleObject(g_spectrumIdleEvent, INFINITE);
+    }
 }
 
-// Compute spectrum from IQ data
-void ComputeSpectrum(int receiverID)
+// Queue a spectrum computation for a receiver (UI thread). Does nothing if
+// one is already queued or running for it.
+void RequestSpectrum(int receiverID)
 {
     if (receiverID < 0 || receiverID >= MAX_RX_COUNT) return;
-    if (g_pStatus == NULL || !g_pStatus->receivers[receiverID].active) return;
+    if (g_spectrumWorkerCount == 0) return;
     
     SpectrumWindow* spec = &g_spectrumWindows[receiverID];
-    
-    // Read IQ samples from circular buffer
-    int32_t writePos = g_pStatus->receivers[receiverID].iqBufferWritePos;
-    int32_t readPos = (writePos - FFT_SIZE * 2 + IQ_BUFFER_SIZE) % IQ_BUFFER_SIZE;
-    
-    // Ensure we have valid data
-    if (readPos < 0) readPos += IQ_BUFFER_SIZE;
-    
-    // Copy samples and apply window
-    for (int i = 0; i < FFT_SIZE; i++) {
-        int bufIdx = (readPos + i * 2) % IQ_BUFFER_SIZE;
-        
-        // Convert int16 to float and normalize (-1.0 to +1.0)
-        float I = g_pStatus->receivers[receiverID].iqBuffer[bufIdx] / 32768.0f;
-        float Q = g_pStatus->receivers[receiverID].iqBuffer[bufIdx + 1] / 32768.0f;
-        
-        // Apply Hanning window
-        spec->fftBuffer[i].real = I * spec->window[i];
-        spec->fftBuffer[i].imag = Q * spec->window[i];
+    bool queued = false;
+    
+    EnterCriticalSection(&g_spectrumLock);
+    if (!spec->computeQueued && !g_spectrumStopping) {
+        spec->computeQueued = true;
+        g_spectrumQueue[(g_spectrumQueueHead + g_spectrumQueueCount) % MAX_RX_COUNT] = receiverID;
+        g_spectrumQueueCount++;
+        if (g_spectrumPending++ == 0) {
+            ResetEvent(g_spectrumIdleEvent);
+        }
+        queued = true;
     }
+    LeaveCriticalSection(&g_spectrumLock);
     
-    // Perform FFT
-    PerformFFT(spec->fftBuffer, FFT_SIZE);
+    if (queued) {
+        ReleaseSemaphore(g_spectrumWorkSemaphore, 1, NULL);
+    }
+}
+
+// Adopt the latest finished spectrum for a receiver (UI thread). Returns
+// false if nothing new has been published since the last call.
+bool AcquireSpectrum(int receiverID)
+{
+    if (receiverID < 0 || receiverID >= MAX_RX_COUNT) return false;
     
-    // Compute magnitude in dB with proper scaling
-    // FFT output needs to be scaled by 1/N for proper magnitude
-    float scale = 1.0f / FFT_SIZE;
+    SpectrumWindow* spec = &g_spectrumWindows[receiverID];
     
-    for (int i = 0; i < FFT_SIZE; i++) {
-        float real = spec->fftBuffer[i].real * scale;
-        float imag = spec->fftBuffer[i].imag * scale;
-        float magnitude = sqrtf(real * real + imag * imag);
-        
-        // Convert to dBFS (dB relative to full scale)
-        // Add small value to avoid log(0), then convert to dB
-        if (magnitude < 1e-10f) magnitude = 1e-10f;
-        
-        // For IQ data, we want power spectrum, so use 10*log10(mag^2) = 20*log10(mag)
-        // Reference level is 1.0 (full scale), so this gives dBFS
-        spec->magnitudeDB[i] = 20.0f * log10f(magnitude);
+    EnterCriticalSection(&g_spectrumLock);
+    bool fresh = spec->frameReady;
+    if (fresh) {
+        int slot = spec->displaySlot;
+        spec->displaySlot = spec->readySlot;
+        spec->readySlot = slot;
+        spec->frameReady = false;
     }
+    LeaveCriticalSection(&g_spectrumLock);
     
-    // Calculate noise floor using 10th percentile method
-    spec->noiseFloor = CalculateNoiseFloor(spec->magnitudeDB, FFT_SIZE);
+    if (!fresh) return false;
     
-    // Find actual maximum value in spectrum
-    float currentMax = spec->magnitudeDB[0];
-    for (int i = 1; i < FFT_SIZE; i++) {
-        if (spec->magnitudeDB[i] > currentMax) {
-            currentMax = spec->magnitudeDB[i];
-        }
-    }
+    const SpectrumFrame* frame = &spec->frames[spec->displaySlot];
+    spec->magnitudeDB = (float*)frame->magnitudeDB;
+    spec->noiseFloor = frame->noiseFloor;
     
     // Smooth the max/min values with exponential moving average
     // Alpha = 0.05 for very slow, smooth transitions
+    float currentMax = frame->maxDB;
     float alpha = 0.05f;
     if (spec->smoothedMaxDB == 0.0f && spec->smoothedMinDB == 0.0f) {
         // Initialize on first run
@@ -2081,6 +2620,120 @@ void ComputeSpectrum(int receiverID)
         float targetMin = spec->noiseFloor - 3.0f;
         spec->smoothedMinDB = alpha * targetMin + (1.0f - alpha) * spec->smoothedMinDB;
     }
+    
+    return true;
+}
+
+// Spectrum worker thread - computes queued receivers' spectra and publishes them
+DWORD WINAPI SpectrumWorkerThread(LPVOID param)
+{
+    for (;;) {
+        WaitForSingleObject(g_spectrumWorkSemaphore, INFINITE);
+        
+        EnterCriticalSection(&g_spectrumLock);
+        if (g_spectrumQueueCount == 0) {
+            bool stopping = g_spectrumStopping;
+            LeaveCriticalSection(&g_spectrumLock);
+            if (stopping) return 0;
+            continue;
+        }
+        int receiverID = g_spectrumQueue[g_spectrumQueueHead];
+        g_spectrumQueueHead = (g_spectrumQueueHead + 1) % MAX_RX_COUNT;
+        g_spectrumQueueCount--;
+        SpectrumWindow* spec = &g_spectrumWindows[receiverID];
+        SpectrumFrame* frame = &spec->frames[spec->computeSlot];
+        LeaveCriticalSection(&g_spectrumLock);
+        
+        bool computed = ComputeSpectrum(receiverID, frame);
+        
+        EnterCriticalSection(&g_spectrumLock);
+        if (computed) {
+            int slot = spec->readySlot;
+            spec->readySlot = spec->computeSlot;
+            spec->computeSlot = slot;
+            spec->frameReady = true;
+        }
+        spec->computeQueued = false;
+        if (--g_spectrumPending == 0) {
+            SetEvent(g_spectrumIdleEvent);
+        }
+        LeaveCriticalSection(&g_spectrumLock);
+    }
+}
+
+// Calculate noise floor using 10th percentile method (reliable for signals present).
+// scratch must hold size floats; it is reordered by the selection.
+float CalculateNoiseFloor(const float* magnitudeDB, int size, float* scratch)
+{
+    if (size <= 0) return -100.0f;
+    
+    memcpy(scratch, magnitudeDB, size * sizeof(float));
+    
+    // Use 10th percentile as noise floor (robust against signals)
+    int percentileIndex = (int)(size * 0.10f);
+    if (percentileIndex >= size) percentileIndex = size - 1;
+    
+    // Only the element at the percentile needs to be in place, not a full sort
+    std::nth_element(scratch, scratch + percentileIndex, scratch + size);
+    
+    return scratch[percentileIndex];
+}
+
+// Compute spectrum from IQ data into frame (runs on a spectrum worker)
+bool ComputeSpectrum(int receiverID, SpectrumFrame* frame)
+{
+    if (receiverID < 0 || receiverID >= MAX_RX_COUNT) return false;
+    
+    // Only queued for active receivers; the ring stays mapped until the pool drains
+    const int16_t* iqBuffer = g_iqRings[receiverID].buffer;
+    if (iqBuffer == NULL) return false;
+    
+    SpectrumWindow* spec = &g_spectrumWindows[receiverID];
+    
+    // Read IQ samples from circular buffer
+    int32_t writePos = (int32_t)(IqProducerPos(receiverID, 0) % IQ_BUFFER_SIZE);
+    int32_t readPos = (writePos - FFT_SIZE * 2 + IQ_BUFFER_SIZE) % IQ_BUFFER_SIZE;
+    
+    // Ensure we have valid data
+    if (readPos < 0) readPos += IQ_BUFFER_SIZE;
+    
+    // Convert int16 to float and normalize (-1.0 to +1.0) straight into the
+    // FFT buffer, in at most two spans around the end of the circular buffer
+    float* fftValues = &spec->fftBuffer[0].real;
+    int firstSpan = IQ_BUFFER_SIZE - readPos;
+    if (firstSpan > FFT_SIZE * 2) firstSpan = FFT_SIZE * 2;
+    iq_s16_to_float(iqBuffer + readPos, fftValues, firstSpan, 1.0f / 32768.0f);
+    iq_s16_to_float(iqBuffer, fftValues + firstSpan, FFT_SIZE * 2 - firstSpan, 1.0f / 32768.0f);
+    
+    // Apply Hanning window
+    for (int i = 0; i < FFT_SIZE; i++) {
+        spec->fftBuffer[i].real *= g_hannWindow[i];
+        spec->fftBuffer[i].imag *= g_hannWindow[i];
+    }
+    
+    // Perform FFT
+    spectrum_fft_run(&g_spectrumFFT, fftValues);
+    
+    // Blend this FFT into the running power average, weighted by the time
+    // since the last one so the display and spot timers average alike
+    DWORD now = GetTickCount();
+    DWORD elapsed = now - spec->averageTick;
+    float alpha = 1.0f;
+    if (spec->averageTick != 0 && elapsed < SPECTRUM_AVERAGE_RESET_MS) {
+        alpha = 1.0f - expf(-(float)elapsed / SPECTRUM_AVERAGE_MS);
+    }
+    spec->averageTick = (now != 0) ? now : 1;
+    
+    // Magnitude in dBFS (dB relative to full scale), with the FFT output
+    // scaled by 1/N, and its maximum in the same pass
+    frame->maxDB = spectrum_power_avg_db(fftValues, spec->powerAverage, frame->magnitudeDB,
+                                         FFT_SIZE, 1.0f / FFT_SIZE, alpha);
+    
+    // Calculate noise floor using 10th percentile method, selecting in the
+    // FFT buffer now that its contents are spent
+    frame->noiseFloor = CalculateNoiseFloor(frame->magnitudeDB, FFT_SIZE, fftValues);
+    
+    return true;
 }
 
 // FT8 frequencies for HF ham bands (in Hz)
@@ -2482,9 +3135,6 @@ LRESULT CALLBACK SpectrumWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
             receiverID = (int)(INT_PTR)cs->lpCreateParams;
             SetWindowLongPtr(hwnd, GWLP_USERDATA, receiverID);
             
-            // Initialize Hanning window
-            InitHanningWindow(g_spectrumWindows[receiverID].window, FFT_SIZE);
-            
             // Initialize mouse tracking and scaling
             g_spectrumWindows[receiverID].mouseInPlot = false;
             g_spectrumWindows[receiverID].lastMouseX = -1;
@@ -2529,11 +3179,12 @@ LRESULT CALLBACK SpectrumWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM l
         return 0;
         
     case WM_TIMER:
-        // Compute and redraw spectrum
-        ComputeSpectrum(receiverID);
-        
-        // Measure peak frequencies for unmeasured spots
-        MeasureSpotPeakFrequency(receiverID);
+        // Pick up the latest spectrum and queue the next one
+        if (AcquireSpectrum(receiverID)) {
+            // Measure peak frequencies for unmeasured spots
+            MeasureSpotPeakFrequency(receiverID);
+        }
+        RequestSpectrum(receiverID);
         
         // Update marker and tooltip values
         if (g_pStatus != NULL && g_pStatus->receivers[receiverID].active) {
@@ -3235,15 +3886,7 @@ BOOL ConnectToInstance(int instanceIndex)
     }
     
     // Close existing connection if any
-    if (g_pStatus != NULL) {
-        UnmapViewOfFile((LPVOID)g_pStatus);
-        g_pStatus = NULL;
-    }
-    
-    if (g_hSharedMemory != NULL) {
-        CloseHandle(g_hSharedMemory);
-        g_hSharedMemory = NULL;
-    }
+    CleanupSharedMemory();
     
     // Open shared memory for selected instance
     g_hSharedMemory = OpenFileMappingW(
@@ -3255,13 +3898,7 @@ BOOL ConnectToInstance(int instanceIndex)
         return FALSE;
     }
     
-    g_pStatus = (const UberSDRSharedStatus*)MapViewOfFile(
-        g_hSharedMemory,
-        FILE_MAP_ALL_ACCESS,
-        0, 0,
-        sizeof(UberSDRSharedStatus));
-    
-    if (g_pStatus == NULL) {
+    if (!AttachSharedStatus()) {
         CloseHandle(g_hSharedMemory);
         g_hSharedMemory = NULL;
         return FALSE;
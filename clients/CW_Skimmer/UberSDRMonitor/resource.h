@@ -112,6 +112,17 @@
 #define IDC_RX6_MEDIAN                  1126
 #define IDC_RX7_MEDIAN                  1127
 
+// Timing histogram lines (pIQProc and one per receiver)
+#define IDC_RX0_TIMING                  1130
+#define IDC_RX1_TIMING                  1131
+#define IDC_RX2_TIMING                  1132
+#define IDC_RX3_TIMING                  1133
+#define IDC_RX4_TIMING                  1134
+#define IDC_RX5_TIMING                  1135
+#define IDC_RX6_TIMING                  1136
+#define IDC_RX7_TIMING                  1137
+#define IDC_TIMING_CALLBACK             1140
+
 // Spectrum window dialog
 #define IDD_SPECTRUM                    102
 
@@ -0,0 +1,178 @@
+/*
+ * iq_convert.h - int16 IQ -> float conversion kernels shared by the clients
+ *
+ * UberSDR sends PCM IQ as big-endian int16, interleaved I/Q (I=left,
+ * Q=right).  The clients that work in float (CW Skimmer DLL and Monitor,
+ * Soapy driver) have to turn that into interleaved float, so the
+ * conversion lives here once, header-only and usable from C and C++.
+ * (The HPSDR bridge packs the wire samples straight into 24-bit P2
+ * payloads instead; see load_packet.)
+ *
+ * Output is interleaved float pairs (re, im), which is layout-compatible
+ * with `float complex`, `std::complex<float>` and `struct { float Re, Im; }`.
+ *
+ * The SIMD path is chosen at compile time from the target flags:
+ *   AVX2   (__AVX2__, e.g. -mavx2 or /arch:AVX2)
+ *   SSE2   (__SSE2__, x64, or MSVC /arch:SSE2 on x86)
+ *   NEON   (__ARM_NEON, all aarch64 and armv7 with -mfpu=neon)
+ * otherwise the scalar loop is used.  Every path produces bit-identical
+ * results: int16 -> float is exact and the only arithmetic is one multiply.
+ */
+#ifndef UBERSDR_IQ_CONVERT_H
+#define UBERSDR_IQ_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define IQ_CONVERT_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IQ_CONVERT_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IQ_CONVERT_NEON 1
+#endif
+
+/*
+ * Convert n_complex big-endian int16 I/Q pairs at src to interleaved float.
+ *
+ *   swap_iq   non-zero: output (re, im) = (Q, I) instead of (I, Q)
+ *   negate_q  non-zero: negate the output im component (after any swap)
+ *   scale     multiplier applied to both components, e.g. 1.0f / 32768.0f
+ *
+ * src needs no particular alignment.  dst must hold 2 * n_complex floats.
+ * The conversion may run in place: src may lie inside dst as long as it
+ * starts at least 4 * n_complex bytes into it (e.g. a frame decoded into the
+ * upper half of its own output buffer), since the output never overtakes
+ * input that has not been read yet.
+ */
+static inline void iq_be16_to_float(const uint8_t *src, float *dst, size_t n_complex,
+                                    float scale, int swap_iq, int negate_q)
+{
+    size_t i = 0;
+    const float scale_im = negate_q ? -scale : scale;
+
+#if defined(IQ_CONVERT_AVX2)
+    /* One byte shuffle does the 16-bit byte swap and, optionally, the I/Q swap */
+    const __m128i shuf = swap_iq
+        ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+        : _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    const __m256 vscale = _mm256_setr_ps(scale, scale_im, scale, scale_im,
+                                         scale, scale_im, scale, scale_im);
+    for (; i + 8 <= n_complex; i += 8) {
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 4 * i)), shuf);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 4 * i + 16)), shuf);
+        __m256 fa = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a));
+        __m256 fb = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b));
+        _mm256_storeu_ps(dst + 2 * i,     _mm256_mul_ps(fa, vscale));
+        _mm256_storeu_ps(dst + 2 * i + 8, _mm256_mul_ps(fb, vscale));
+    }
+#elif defined(IQ_CONVERT_SSE2)
+    const __m128 vscale = _mm_setr_ps(scale, scale_im, scale, scale_im);
+    for (; i + 4 <= n_complex; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        if (swap_iq) {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        }
+        /* Sign-extend int16 -> int32 by unpacking into the high half */
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst + 2 * i,     _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+        _mm_storeu_ps(dst + 2 * i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+    }
+#elif defined(IQ_CONVERT_NEON)
+    const float scale_pair[4] = { scale, scale_im, scale, scale_im };
+    const float32x4_t vscale = vld1q_f32(scale_pair);
+    for (; i + 4 <= n_complex; i += 4) {
+        int16x8_t v = vreinterpretq_s16_u8(vrev16q_u8(vld1q_u8(src + 4 * i)));
+        if (swap_iq)
+            v = vrev32q_s16(v);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+        vst1q_f32(dst + 2 * i,     vmulq_f32(lo, vscale));
+        vst1q_f32(dst + 2 * i + 4, vmulq_f32(hi, vscale));
+    }
+#endif
+
+    /* Scalar tail (and the whole frame when no SIMD path is available) */
+    for (; i < n_complex; i++) {
+        const uint8_t *s = src + 4 * i;
+        int16_t a = (int16_t)(((uint16_t)s[0] << 8) | s[1]);
+        int16_t b = (int16_t)(((uint16_t)s[2] << 8) | s[3]);
+        dst[2 * i]     = (float)(swap_iq ? b : a) * scale;
+        dst[2 * i + 1] = (float)(swap_iq ? a : b) * scale_im;
+    }
+}
+
+/*
+ * Byte-swap n_values big-endian int16 values at src into host-order int16.
+ * src and dst need no particular alignment.  They must either be the same
+ * buffer (swap in place) or not overlap at all.
+ */
+static inline void iq_be16_to_s16(const uint8_t *src, int16_t *dst, size_t n_values)
+{
+    size_t i = 0;
+
+#if defined(IQ_CONVERT_AVX2)
+    const __m256i shuf = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                          1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    for (; i + 16 <= n_values; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + 2 * i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_shuffle_epi8(v, shuf));
+    }
+#elif defined(IQ_CONVERT_SSE2)
+    for (; i + 8 <= n_values; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+    }
+#elif defined(IQ_CONVERT_NEON)
+    for (; i + 8 <= n_values; i += 8) {
+        vst1q_s16(dst + i, vreinterpretq_s16_u8(vrev16q_u8(vld1q_u8(src + 2 * i))));
+    }
+#endif
+
+    for (; i < n_values; i++)
+        dst[i] = (int16_t)(((uint16_t)src[2 * i] << 8) | src[2 * i + 1]);
+}
+
+/*
+ * Convert n_values host-order int16 values to float, multiplied by scale.
+ * For IQ already stored natively (e.g. the DLL's shared-memory IQ ring).
+ */
+static inline void iq_s16_to_float(const int16_t *src, float *dst, size_t n_values, float scale)
+{
+    size_t i = 0;
+
+#if defined(IQ_CONVERT_AVX2)
+    const __m256 vscale = _mm256_set1_ps(scale);
+    for (; i + 8 <= n_values; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v)), vscale));
+    }
+#elif defined(IQ_CONVERT_SSE2)
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 8 <= n_values; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst + i,     _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+    }
+#elif defined(IQ_CONVERT_NEON)
+    const float32x4_t vscale = vdupq_n_f32(scale);
+    for (; i + 8 <= n_values; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        vst1q_f32(dst + i,     vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), vscale));
+        vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), vscale));
+    }
+#endif
+
+    for (; i < n_values; i++)
+        dst[i] = (float)src[i] * scale;
+}
+
+#endif // UBERSDR_IQ_CONVERT_H
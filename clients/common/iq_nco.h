@@ -0,0 +1,165 @@
+/*
+ * iq_nco.h - block NCO for software frequency shifting of interleaved IQ
+ *
+ * Multiplies a block of interleaved float IQ by e^(j*phase[n]) with
+ * phase[n] = phase + n*inc.  Instead of sin()/cos() per sample, each block
+ * seeds a rotating phasor from the exact (double) start phase and advances
+ * it by complex multiplication; the phasor magnitude is renormalised every
+ * IQ_NCO_RENORM samples.  The phase itself is advanced in double once per
+ * block, so rounding in the float phasor never accumulates across blocks.
+ *
+ * Header-only, usable from C and C++.  The SIMD path is chosen at compile
+ * time: SSE2 (__SSE2__, x64, MSVC /arch:SSE2 on x86), NEON (__ARM_NEON),
+ * otherwise scalar.
+ */
+#ifndef UBERSDR_IQ_NCO_H
+#define UBERSDR_IQ_NCO_H
+
+#include <stddef.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IQ_NCO_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IQ_NCO_NEON 1
+#endif
+
+#define IQ_NCO_TWO_PI 6.28318530717958647692
+
+/* Samples between phasor renormalisations (multiple of 4) */
+#define IQ_NCO_RENORM 256
+
+struct iq_nco {
+    double phase;  /* phase of the next sample, radians, kept in [0, 2*pi) */
+    double inc;    /* phase increment per sample, radians */
+};
+
+static inline void iq_nco_init(struct iq_nco *nco, double inc)
+{
+    nco->phase = 0.0;
+    nco->inc = inc;
+}
+
+/* Change the frequency without a phase discontinuity */
+static inline void iq_nco_set_inc(struct iq_nco *nco, double inc)
+{
+    nco->inc = inc;
+}
+
+/* Rotate n complex samples in place (iq holds 2*n floats, re/im interleaved) */
+static inline void iq_nco_mix(struct iq_nco *nco, float *iq, size_t n)
+{
+    const double phase0 = nco->phase;
+    const double inc = nco->inc;
+    size_t i = 0;
+
+    if (inc == 0.0 || n == 0)
+        return;
+
+#if defined(IQ_NCO_SSE2)
+    {
+        /* Two complex samples per vector: z = (c0, s0, c1, s1) for samples
+         * i and i+1, advanced by w2 = e^(j*2*inc) each step */
+        const __m128 sign = _mm_castsi128_ps(_mm_setr_epi32((int)0x80000000, 0, (int)0x80000000, 0));
+        const __m128 w2 = _mm_setr_ps((float)cos(2.0 * inc), (float)sin(2.0 * inc),
+                                      (float)cos(2.0 * inc), (float)sin(2.0 * inc));
+        const __m128 w2_swap = _mm_shuffle_ps(w2, w2, _MM_SHUFFLE(2, 3, 0, 1));
+        const __m128 half = _mm_set1_ps(0.5f), three_halves = _mm_set1_ps(1.5f);
+        __m128 z = _mm_setr_ps((float)cos(phase0), (float)sin(phase0),
+                               (float)cos(phase0 + inc), (float)sin(phase0 + inc));
+
+        for (; i + 2 <= n; i += 2) {
+            __m128 x = _mm_loadu_ps(iq + 2 * i);
+            __m128 xr = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 2, 0, 0));
+            __m128 xi = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 1, 1));
+            __m128 z_swap = _mm_shuffle_ps(z, z, _MM_SHUFFLE(2, 3, 0, 1));
+            /* (xr*c - xi*s, xr*s + xi*c) */
+            _mm_storeu_ps(iq + 2 * i, _mm_add_ps(_mm_mul_ps(xr, z),
+                                                 _mm_xor_ps(_mm_mul_ps(xi, z_swap), sign)));
+
+            /* z *= w2 */
+            __m128 zr = _mm_shuffle_ps(z, z, _MM_SHUFFLE(2, 2, 0, 0));
+            __m128 zi = _mm_shuffle_ps(z, z, _MM_SHUFFLE(3, 3, 1, 1));
+            z = _mm_add_ps(_mm_mul_ps(zr, w2), _mm_xor_ps(_mm_mul_ps(zi, w2_swap), sign));
+
+            if (((i + 2) % IQ_NCO_RENORM) == 0) {
+                /* One Newton step towards |z| = 1: z *= 1.5 - 0.5*|z|^2 */
+                __m128 m = _mm_mul_ps(z, z);
+                m = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+                z = _mm_mul_ps(z, _mm_sub_ps(three_halves, _mm_mul_ps(half, m)));
+            }
+        }
+    }
+#elif defined(IQ_NCO_NEON)
+    {
+        /* Four complex samples per step, deinterleaved: lanes k = 0..3 hold
+         * the phasor for sample i+k, advanced by w4 = e^(j*4*inc) each step */
+        float c0[4], s0[4];
+        int k;
+        for (k = 0; k < 4; k++) {
+            c0[k] = (float)cos(phase0 + k * inc);
+            s0[k] = (float)sin(phase0 + k * inc);
+        }
+        float32x4_t c = vld1q_f32(c0), s = vld1q_f32(s0);
+        const float32x4_t wc = vdupq_n_f32((float)cos(4.0 * inc));
+        const float32x4_t ws = vdupq_n_f32((float)sin(4.0 * inc));
+        const float32x4_t half = vdupq_n_f32(0.5f), three_halves = vdupq_n_f32(1.5f);
+
+        for (; i + 4 <= n; i += 4) {
+            float32x4x2_t x = vld2q_f32(iq + 2 * i);
+            float32x4x2_t y;
+            y.val[0] = vmlsq_f32(vmulq_f32(x.val[0], c), x.val[1], s);
+            y.val[1] = vmlaq_f32(vmulq_f32(x.val[0], s), x.val[1], c);
+            vst2q_f32(iq + 2 * i, y);
+
+            float32x4_t cn = vmlsq_f32(vmulq_f32(c, wc), s, ws);
+            s = vmlaq_f32(vmulq_f32(c, ws), s, wc);
+            c = cn;
+
+            if (((i + 4) % IQ_NCO_RENORM) == 0) {
+                float32x4_t g = vmlsq_f32(three_halves, half,
+                                          vmlaq_f32(vmulq_f32(c, c), s, s));
+                c = vmulq_f32(c, g);
+                s = vmulq_f32(s, g);
+            }
+        }
+    }
+#else
+    {
+        float c = (float)cos(phase0), s = (float)sin(phase0);
+        const float wc = (float)cos(inc), ws = (float)sin(inc);
+        for (; i < n; i++) {
+            float re = iq[2 * i], im = iq[2 * i + 1];
+            iq[2 * i]     = re * c - im * s;
+            iq[2 * i + 1] = re * s + im * c;
+            float cn = c * wc - s * ws;
+            s = c * ws + s * wc;
+            c = cn;
+            if (((i + 1) % IQ_NCO_RENORM) == 0) {
+                float g = 1.5f - 0.5f * (c * c + s * s);
+                c *= g;
+                s *= g;
+            }
+        }
+    }
+#endif
+
+    /* Tail left over by the SIMD path: exact phasor per sample (at most 3) */
+    for (; i < n; i++) {
+        double ph = phase0 + (double)i * inc;
+        float c = (float)cos(ph), s = (float)sin(ph);
+        float re = iq[2 * i], im = iq[2 * i + 1];
+        iq[2 * i]     = re * c - im * s;
+        iq[2 * i + 1] = re * s + im * c;
+    }
+
+    /* Advance the exact phase once per block and wrap it to [0, 2*pi) */
+    double phase = fmod(phase0 + (double)n * inc, IQ_NCO_TWO_PI);
+    if (phase < 0.0)
+        phase += IQ_NCO_TWO_PI;
+    nco->phase = phase;
+}
+
+#endif // UBERSDR_IQ_NCO_H
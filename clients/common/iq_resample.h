@@ -0,0 +1,128 @@
+/*
+ * iq_resample.h - fractional-rate resampler for interleaved IQ
+ *
+ * Resamples a stream of interleaved float IQ by a ratio close to 1 (input
+ * samples consumed per output sample), for absorbing the small clock
+ * difference between a remote sample clock and the local one.  Each output
+ * is a cubic (Catmull-Rom) interpolation of the four input samples around
+ * its position, evaluated in Farrow form; the ratio may change between
+ * calls without a discontinuity.  At a ratio of exactly 1 with no
+ * fractional offset the input passes through unchanged.
+ *
+ * The caller asks iq_resample_needed() how many input samples the next
+ * n_out outputs take, supplies exactly that many to iq_resample_run(), and
+ * the resampler keeps the last IQ_RESAMPLE_HISTORY inputs for the next call.
+ *
+ * Header-only, usable from C and C++.  Scalar: the work is a handful of
+ * multiply-adds per sample, well below the cost of getting the samples.
+ */
+#ifndef UBERSDR_IQ_RESAMPLE_H
+#define UBERSDR_IQ_RESAMPLE_H
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+/* Input samples kept between calls: the interpolator looks one back and two
+ * ahead, plus one so the next output never falls before the second of them
+ * when the ratio is below 1 */
+#define IQ_RESAMPLE_HISTORY 4
+
+struct iq_resample {
+    double pos;   /* position of the next output, in samples from the oldest history sample (>= 1) */
+    double ratio; /* input samples per output sample */
+    float hist[2 * IQ_RESAMPLE_HISTORY];
+};
+
+static inline void iq_resample_init(struct iq_resample *rs)
+{
+    rs->pos = 1.0;  /* first output lands on hist[1], with one sample of history behind it */
+    rs->ratio = 1.0;
+    memset(rs->hist, 0, sizeof(rs->hist));
+}
+
+/* Change the ratio; takes effect at the next output */
+static inline void iq_resample_set_ratio(struct iq_resample *rs, double ratio)
+{
+    rs->ratio = ratio;
+}
+
+/* Input samples the next n_out outputs consume */
+static inline size_t iq_resample_needed(const struct iq_resample *rs, size_t n_out)
+{
+    if (n_out == 0)
+        return 0;
+    /* The last output interpolates around floor(pos + (n_out-1)*ratio) and
+     * needs two samples after that one; the history covers the first ones */
+    size_t last = (size_t)floor(rs->pos + (double)(n_out - 1) * rs->ratio);
+    return last + 3 - IQ_RESAMPLE_HISTORY;
+}
+
+/* Produce n_out outputs from exactly iq_resample_needed(rs, n_out) inputs.
+ * in and out hold interleaved IQ (2 floats per sample) and must not overlap. */
+static inline void iq_resample_run(struct iq_resample *rs, const float *in, size_t n_in,
+                                   float *out, size_t n_out)
+{
+    double pos = rs->pos;
+    const double ratio = rs->ratio;
+    size_t j;
+
+    if (n_out == 0)
+        return;
+
+    for (j = 0; j < n_out; j++, pos += ratio) {
+        size_t i = (size_t)pos;
+        float f = (float)(pos - (double)i);
+        const float *xm1, *x0, *x1, *x2;
+        float tmp[8];
+
+        if (i - 1 >= IQ_RESAMPLE_HISTORY) {
+            /* Past the history: taps straight from in */
+            xm1 = in + 2 * (i - 1 - IQ_RESAMPLE_HISTORY);
+        } else {
+            /* Taps straddle history and input: gather them */
+            size_t k;
+            for (k = 0; k < 4; k++) {
+                size_t s = i - 1 + k;
+                const float *src = (s < IQ_RESAMPLE_HISTORY) ? rs->hist + 2 * s
+                                                             : in + 2 * (s - IQ_RESAMPLE_HISTORY);
+                tmp[2 * k] = src[0];
+                tmp[2 * k + 1] = src[1];
+            }
+            xm1 = tmp;
+        }
+        x0 = xm1 + 2;
+        x1 = xm1 + 4;
+        x2 = xm1 + 6;
+
+        /* Catmull-Rom in Farrow form, for I and Q */
+        {
+            int c;
+            for (c = 0; c < 2; c++) {
+                float c1 = 0.5f * (x1[c] - xm1[c]);
+                float c2 = xm1[c] - 2.5f * x0[c] + 2.0f * x1[c] - 0.5f * x2[c];
+                float c3 = 0.5f * (x2[c] - xm1[c]) + 1.5f * (x0[c] - x1[c]);
+                out[2 * j + c] = ((c3 * f + c2) * f + c1) * f + x0[c];
+            }
+        }
+    }
+
+    /* Keep the last IQ_RESAMPLE_HISTORY samples of history + input and move
+     * the position back by what was consumed */
+    {
+        float keep[2 * IQ_RESAMPLE_HISTORY];
+        size_t total = IQ_RESAMPLE_HISTORY + n_in;
+        size_t k;
+        for (k = 0; k < IQ_RESAMPLE_HISTORY; k++) {
+            size_t s = total - IQ_RESAMPLE_HISTORY + k;
+            const float *src = (s < IQ_RESAMPLE_HISTORY) ? rs->hist + 2 * s
+                                                         : in + 2 * (s - IQ_RESAMPLE_HISTORY);
+            keep[2 * k] = src[0];
+            keep[2 * k + 1] = src[1];
+        }
+        memcpy(rs->hist, keep, sizeof(keep));
+    }
+    rs->pos = pos - (double)n_in;
+}
+
+#endif // UBERSDR_IQ_RESAMPLE_H
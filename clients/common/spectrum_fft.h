@@ -0,0 +1,445 @@
+/*
+ * spectrum_fft.h - planned radix-2 FFT and power-to-dB kernel for spectrum
+ * displays
+ *
+ * spectrum_fft_init() builds everything that depends only on the size - the
+ * bit-reversal permutation and every stage's twiddle factors, laid out
+ * contiguously per stage - so spectrum_fft_run() does no trigonometry and
+ * its butterflies can load the twiddles straight into SIMD registers.
+ *
+ * spectrum_power_db() turns the FFT output into 10*log10(|X|^2 * scale^2)
+ * in one pass, with no sqrt() and a polynomial log instead of log10f(), and
+ * returns the largest value so the caller needs no second scan.
+ * spectrum_power_avg_db() does the same through a per-bin exponential
+ * average of the power, for a steadier display than single FFTs give.
+ *
+ * Data is interleaved complex float (re, im), layout-compatible with
+ * iq_convert.h's output.  Header-only, usable from C and C++.  The SIMD path
+ * is chosen at compile time: SSE2 (__SSE2__, x64, MSVC /arch:SSE2 on x86),
+ * NEON (__ARM_NEON), otherwise scalar.
+ */
+#ifndef UBERSDR_SPECTRUM_FFT_H
+#define UBERSDR_SPECTRUM_FFT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPECTRUM_FFT_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SPECTRUM_FFT_NEON 1
+#endif
+
+/* Power values below this (-200 dB) are clamped, so silence never hits log(0) */
+#define SPECTRUM_POWER_FLOOR 1e-20f
+
+struct spectrum_fft {
+    int n;           /* transform size, a power of two */
+    int *bitrev;     /* bit-reversed index of each input position */
+    float *twiddle;  /* stage with half-size h: h values exp(-i*pi*j/h) at 2*(h - 1) */
+};
+
+/* Returns 0 on success, -1 if n is not a power of two >= 2 or allocation fails */
+static inline int spectrum_fft_init(struct spectrum_fft *fft, int n)
+{
+    int bits = 0;
+    int i, h;
+
+    memset(fft, 0, sizeof(*fft));
+    if (n < 2 || (n & (n - 1)) != 0)
+        return -1;
+    while ((1 << bits) < n)
+        bits++;
+
+    fft->bitrev = (int *)malloc(n * sizeof(int));
+    fft->twiddle = (float *)malloc(2 * (n - 1) * sizeof(float));
+    if (fft->bitrev == NULL || fft->twiddle == NULL) {
+        free(fft->bitrev);
+        free(fft->twiddle);
+        memset(fft, 0, sizeof(*fft));
+        return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+        int r = 0, b;
+        for (b = 0; b < bits; b++) {
+            if (i & (1 << b))
+                r |= 1 << (bits - 1 - b);
+        }
+        fft->bitrev[i] = r;
+    }
+
+    for (h = 1; h < n; h *= 2) {
+        float *w = fft->twiddle + 2 * (h - 1);
+        int j;
+        for (j = 0; j < h; j++) {
+            w[2 * j]     = (float)cos(-3.14159265358979323846 * j / h);
+            w[2 * j + 1] = (float)sin(-3.14159265358979323846 * j / h);
+        }
+    }
+
+    fft->n = n;
+    return 0;
+}
+
+static inline void spectrum_fft_free(struct spectrum_fft *fft)
+{
+    free(fft->bitrev);
+    free(fft->twiddle);
+    memset(fft, 0, sizeof(*fft));
+}
+
+/* In-place forward transform of fft->n interleaved complex values */
+static inline void spectrum_fft_run(const struct spectrum_fft *fft, float *data)
+{
+    const int n = fft->n;
+    int i, h;
+
+    for (i = 0; i < n; i++) {
+        const int j = fft->bitrev[i];
+        if (j > i) {
+            float tr = data[2 * i], ti = data[2 * i + 1];
+            data[2 * i]     = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j]     = tr;
+            data[2 * j + 1] = ti;
+        }
+    }
+
+    /* First stage: the only twiddle is 1 */
+    for (i = 0; i < n; i += 2) {
+        float *a = data + 2 * i;
+        const float br = a[2], bi = a[3];
+        a[2] = a[0] - br;
+        a[3] = a[1] - bi;
+        a[0] += br;
+        a[1] += bi;
+    }
+
+    for (h = 2; h < n; h *= 2) {
+        const float *w = fft->twiddle + 2 * (h - 1);
+        int k;
+
+        for (k = 0; k < n; k += 2 * h) {
+            float *lo = data + 2 * k;
+            float *hi = data + 2 * (k + h);
+            int j = 0;
+
+#if defined(SPECTRUM_FFT_SSE2)
+            /* Two butterflies per iteration; h is even from here on */
+            const __m128 sign = _mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+            for (; j + 2 <= h; j += 2) {
+                __m128 vw = _mm_loadu_ps(w + 2 * j);
+                __m128 vh = _mm_loadu_ps(hi + 2 * j);
+                __m128 vl = _mm_loadu_ps(lo + 2 * j);
+                __m128 wr = _mm_shuffle_ps(vw, vw, _MM_SHUFFLE(2, 2, 0, 0));
+                __m128 wi = _mm_shuffle_ps(vw, vw, _MM_SHUFFLE(3, 3, 1, 1));
+                __m128 sw = _mm_shuffle_ps(vh, vh, _MM_SHUFFLE(2, 3, 0, 1));
+                /* (re*wr - im*wi, im*wr + re*wi) */
+                __m128 t = _mm_add_ps(_mm_mul_ps(vh, wr), _mm_xor_ps(_mm_mul_ps(sw, wi), sign));
+                _mm_storeu_ps(hi + 2 * j, _mm_sub_ps(vl, t));
+                _mm_storeu_ps(lo + 2 * j, _mm_add_ps(vl, t));
+            }
+#elif defined(SPECTRUM_FFT_NEON)
+            /* Four butterflies per iteration once h allows it */
+            for (; j + 4 <= h; j += 4) {
+                float32x4x2_t vw = vld2q_f32(w + 2 * j);
+                float32x4x2_t vh = vld2q_f32(hi + 2 * j);
+                float32x4x2_t vl = vld2q_f32(lo + 2 * j);
+                float32x4_t tr = vsubq_f32(vmulq_f32(vh.val[0], vw.val[0]), vmulq_f32(vh.val[1], vw.val[1]));
+                float32x4_t ti = vaddq_f32(vmulq_f32(vh.val[1], vw.val[0]), vmulq_f32(vh.val[0], vw.val[1]));
+                float32x4x2_t oh, ol;
+                oh.val[0] = vsubq_f32(vl.val[0], tr);
+                oh.val[1] = vsubq_f32(vl.val[1], ti);
+                ol.val[0] = vaddq_f32(vl.val[0], tr);
+                ol.val[1] = vaddq_f32(vl.val[1], ti);
+                vst2q_f32(hi + 2 * j, oh);
+                vst2q_f32(lo + 2 * j, ol);
+            }
+#endif
+
+            for (; j < h; j++) {
+                const float wr = w[2 * j], wi = w[2 * j + 1];
+                const float hr = hi[2 * j], hm = hi[2 * j + 1];
+                const float tr = hr * wr - hm * wi;
+                const float ti = hm * wr + hr * wi;
+                hi[2 * j]     = lo[2 * j] - tr;
+                hi[2 * j + 1] = lo[2 * j + 1] - ti;
+                lo[2 * j]     += tr;
+                lo[2 * j + 1] += ti;
+            }
+        }
+    }
+}
+
+/*
+ * 10*log10(x) for x >= SPECTRUM_POWER_FLOOR: split x into 2^e * m with m in
+ * [sqrt(0.5), sqrt(2)), then ln(m) = 2*atanh(t), t = (m - 1)/(m + 1), from
+ * four terms of its series (|t| < 0.172).  Error is about 2e-5 dB.  The SIMD
+ * paths below evaluate the same steps.
+ */
+#define SPECTRUM_DB_PER_LN  4.34294481903251827651f  /* 10/ln(10) */
+#define SPECTRUM_LN2        0.69314718055994530942f
+#define SPECTRUM_SQRT2      1.41421356237309504880f
+
+static inline float spectrum_db_scalar(float x)
+{
+    uint32_t bits;
+    float m, t, t2, ln_m;
+    int e;
+
+    memcpy(&bits, &x, sizeof(bits));
+    e = (int)(bits >> 23) - 127;
+    bits = (bits & 0x007fffffu) | 0x3f800000u;
+    memcpy(&m, &bits, sizeof(m));
+    if (m > SPECTRUM_SQRT2) {
+        m *= 0.5f;
+        e += 1;
+    }
+
+    t = (m - 1.0f) / (m + 1.0f);
+    t2 = t * t;
+    ln_m = 2.0f * t * (1.0f + t2 * (1.0f / 3.0f + t2 * (1.0f / 5.0f + t2 * (1.0f / 7.0f))));
+    return SPECTRUM_DB_PER_LN * ((float)e * SPECTRUM_LN2 + ln_m);
+}
+
+#if defined(SPECTRUM_FFT_SSE2)
+static inline __m128 spectrum_db_sse2(__m128 p)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 sqrt2 = _mm_set1_ps(SPECTRUM_SQRT2);
+    const __m128i mant_mask = _mm_set1_epi32(0x007fffff);
+    const __m128i exp_one = _mm_set1_epi32(0x3f800000);
+    const __m128i bias = _mm_set1_epi32(127);
+
+    __m128i bits = _mm_castps_si128(p);
+    __m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), bias);
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, mant_mask), exp_one));
+    __m128 big = _mm_cmpgt_ps(m, sqrt2);
+    m = _mm_mul_ps(m, _mm_or_ps(_mm_and_ps(big, half), _mm_andnot_ps(big, one)));
+    e = _mm_sub_epi32(e, _mm_castps_si128(big));  /* all-ones mask is -1 */
+
+    __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 poly = _mm_add_ps(_mm_set1_ps(1.0f / 5.0f), _mm_mul_ps(t2, _mm_set1_ps(1.0f / 7.0f)));
+    poly = _mm_add_ps(_mm_set1_ps(1.0f / 3.0f), _mm_mul_ps(t2, poly));
+    poly = _mm_add_ps(one, _mm_mul_ps(t2, poly));
+    __m128 ln_m = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(2.0f), t), poly);
+    return _mm_mul_ps(_mm_set1_ps(SPECTRUM_DB_PER_LN),
+                      _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(e), _mm_set1_ps(SPECTRUM_LN2)), ln_m));
+}
+#elif defined(SPECTRUM_FFT_NEON)
+static inline float32x4_t spectrum_db_neon(float32x4_t p)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t sqrt2 = vdupq_n_f32(SPECTRUM_SQRT2);
+
+    uint32x4_t bits = vreinterpretq_u32_f32(p);
+    int32x4_t e = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127));
+    float32x4_t m = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007fffff)),
+                                                    vdupq_n_u32(0x3f800000)));
+    uint32x4_t big = vcgtq_f32(m, sqrt2);
+    m = vmulq_f32(m, vbslq_f32(big, vdupq_n_f32(0.5f), one));
+    e = vsubq_s32(e, vreinterpretq_s32_u32(big));
+
+#if defined(__aarch64__)
+    float32x4_t t = vdivq_f32(vsubq_f32(m, one), vaddq_f32(m, one));
+#else
+    /* armv7 NEON has no vector divide */
+    float num[4], den[4];
+    int k;
+    vst1q_f32(num, vsubq_f32(m, one));
+    vst1q_f32(den, vaddq_f32(m, one));
+    for (k = 0; k < 4; k++)
+        num[k] /= den[k];
+    float32x4_t t = vld1q_f32(num);
+#endif
+    float32x4_t t2 = vmulq_f32(t, t);
+    float32x4_t poly = vaddq_f32(vdupq_n_f32(1.0f / 5.0f), vmulq_f32(t2, vdupq_n_f32(1.0f / 7.0f)));
+    poly = vaddq_f32(vdupq_n_f32(1.0f / 3.0f), vmulq_f32(t2, poly));
+    poly = vaddq_f32(one, vmulq_f32(t2, poly));
+    float32x4_t ln_m = vmulq_f32(vmulq_f32(vdupq_n_f32(2.0f), t), poly);
+    return vmulq_f32(vdupq_n_f32(SPECTRUM_DB_PER_LN),
+                     vaddq_f32(vmulq_f32(vcvtq_f32_s32(e), vdupq_n_f32(SPECTRUM_LN2)), ln_m));
+}
+#endif
+
+/*
+ * db[i] = 10*log10(max(|data[i]|^2 * scale^2, SPECTRUM_POWER_FLOOR)) for the
+ * n interleaved complex values at data; e.g. scale = 1/N gives dBFS for an
+ * N-point FFT of full-scale-normalised input.  Returns the largest db[i].
+ */
+static inline float spectrum_power_db(const float *data, float *db, size_t n, float scale)
+{
+    const float scale2 = scale * scale;
+    float peak = -1e30f;
+    size_t i = 0;
+
+#if defined(SPECTRUM_FFT_SSE2)
+    const __m128 vscale2 = _mm_set1_ps(scale2);
+    const __m128 vfloor = _mm_set1_ps(SPECTRUM_POWER_FLOOR);
+    __m128 vpeak = _mm_set1_ps(-1e30f);
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_loadu_ps(data + 2 * i);      /* r0 i0 r1 i1 */
+        __m128 b = _mm_loadu_ps(data + 2 * i + 4);  /* r2 i2 r3 i3 */
+        __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 p = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)), vscale2);
+        p = _mm_max_ps(p, vfloor);
+
+        __m128 v = spectrum_db_sse2(p);
+
+        _mm_storeu_ps(db + i, v);
+        vpeak = _mm_max_ps(vpeak, v);
+    }
+
+    {
+        float lanes[4];
+        int k;
+        _mm_storeu_ps(lanes, vpeak);
+        for (k = 0; k < 4; k++) {
+            if (lanes[k] > peak)
+                peak = lanes[k];
+        }
+    }
+#elif defined(SPECTRUM_FFT_NEON)
+    const float32x4_t vscale2 = vdupq_n_f32(scale2);
+    const float32x4_t vfloor = vdupq_n_f32(SPECTRUM_POWER_FLOOR);
+    float32x4_t vpeak = vdupq_n_f32(-1e30f);
+
+    for (; i + 4 <= n; i += 4) {
+        float32x4x2_t v2 = vld2q_f32(data + 2 * i);
+        float32x4_t p = vmulq_f32(vaddq_f32(vmulq_f32(v2.val[0], v2.val[0]),
+                                            vmulq_f32(v2.val[1], v2.val[1])), vscale2);
+        p = vmaxq_f32(p, vfloor);
+
+        float32x4_t v = spectrum_db_neon(p);
+
+        vst1q_f32(db + i, v);
+        vpeak = vmaxq_f32(vpeak, v);
+    }
+
+    {
+        float lanes[4];
+        int k;
+        vst1q_f32(lanes, vpeak);
+        for (k = 0; k < 4; k++) {
+            if (lanes[k] > peak)
+                peak = lanes[k];
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        const float re = data[2 * i], im = data[2 * i + 1];
+        float p = (re * re + im * im) * scale2;
+        if (p < SPECTRUM_POWER_FLOOR)
+            p = SPECTRUM_POWER_FLOOR;
+        db[i] = spectrum_db_scalar(p);
+        if (db[i] > peak)
+            peak = db[i];
+    }
+
+    return peak;
+}
+
+/*
+ * As spectrum_power_db(), but first folds the power into a running average:
+ * avg[i] += alpha * (|data[i]|^2 * scale^2 - avg[i]), and db[i] is taken from
+ * the updated avg[i].  Averaging power rather than dB keeps the noise floor
+ * unbiased.  alpha = 1 restarts the average from this spectrum.
+ */
+static inline float spectrum_power_avg_db(const float *data, float *avg, float *db, size_t n,
+                                          float scale, float alpha)
+{
+    const float scale2 = scale * scale;
+    float peak = -1e30f;
+    size_t i = 0;
+
+#if defined(SPECTRUM_FFT_SSE2)
+    const __m128 vscale2 = _mm_set1_ps(scale2);
+    const __m128 vfloor = _mm_set1_ps(SPECTRUM_POWER_FLOOR);
+    const __m128 valpha = _mm_set1_ps(alpha);
+    __m128 vpeak = _mm_set1_ps(-1e30f);
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_loadu_ps(data + 2 * i);      /* r0 i0 r1 i1 */
+        __m128 b = _mm_loadu_ps(data + 2 * i + 4);  /* r2 i2 r3 i3 */
+        __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 p = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)), vscale2);
+        __m128 s = _mm_loadu_ps(avg + i);
+        s = _mm_add_ps(s, _mm_mul_ps(valpha, _mm_sub_ps(p, s)));
+        _mm_storeu_ps(avg + i, s);
+        p = _mm_max_ps(s, vfloor);
+
+        __m128 v = spectrum_db_sse2(p);
+
+        _mm_storeu_ps(db + i, v);
+        vpeak = _mm_max_ps(vpeak, v);
+    }
+
+    {
+        float lanes[4];
+        int k;
+        _mm_storeu_ps(lanes, vpeak);
+        for (k = 0; k < 4; k++) {
+            if (lanes[k] > peak)
+                peak = lanes[k];
+        }
+    }
+#elif defined(SPECTRUM_FFT_NEON)
+    const float32x4_t vscale2 = vdupq_n_f32(scale2);
+    const float32x4_t vfloor = vdupq_n_f32(SPECTRUM_POWER_FLOOR);
+    const float32x4_t valpha = vdupq_n_f32(alpha);
+    float32x4_t vpeak = vdupq_n_f32(-1e30f);
+
+    for (; i + 4 <= n; i += 4) {
+        float32x4x2_t v2 = vld2q_f32(data + 2 * i);
+        float32x4_t p = vmulq_f32(vaddq_f32(vmulq_f32(v2.val[0], v2.val[0]),
+                                            vmulq_f32(v2.val[1], v2.val[1])), vscale2);
+        float32x4_t s = vld1q_f32(avg + i);
+        s = vaddq_f32(s, vmulq_f32(valpha, vsubq_f32(p, s)));
+        vst1q_f32(avg + i, s);
+        p = vmaxq_f32(s, vfloor);
+
+        float32x4_t v = spectrum_db_neon(p);
+
+        vst1q_f32(db + i, v);
+        vpeak = vmaxq_f32(vpeak, v);
+    }
+
+    {
+        float lanes[4];
+        int k;
+        vst1q_f32(lanes, vpeak);
+        for (k = 0; k < 4; k++) {
+            if (lanes[k] > peak)
+                peak = lanes[k];
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        const float re = data[2 * i], im = data[2 * i + 1];
+        float p = (re * re + im * im) * scale2;
+        avg[i] += alpha * (p - avg[i]);
+        p = avg[i];
+        if (p < SPECTRUM_POWER_FLOOR)
+            p = SPECTRUM_POWER_FLOOR;
+        db[i] = spectrum_db_scalar(p);
+        if (db[i] > peak)
+            peak = db[i];
+    }
+
+    return peak;
+}
+
+#endif // UBERSDR_SPECTRUM_FFT_H
@@ -0,0 +1,757 @@
+/*
+ * hpsdr_loopback — end-to-end benchmark for ubersdr-hpsdr-bridge.
+ *
+ * Plays both ends of the bridge:
+ *
+ *   - a synthetic UberSDR: an HTTP/WebSocket server that answers the
+ *     /connection check and serves pcm-zstd IQ frames on /ws at the rate
+ *     asked for in the URL (iq48/iq96/iq192), paced in real time;
+ *
+ *   - a minimal Protocol-2 client: sends the General packet, then the
+ *     High Priority and DDC-specific packets a real client sends every
+ *     50 ms, and receives the DDC streams from ports ddc0_port + n.
+ *
+ * For each DDC count × rate it checks DDC sequence gaps, the received
+ * packet rate against the nominal one, the inter-packet interval, and the
+ * end-to-end latency from the source writing a frame to the client
+ * receiving its samples.  Latency is measured with markers: every
+ * LB_MARKER_EVERY frames the source replaces the first LB_MARKER_BITS
+ * samples with a flag on Q and a marker number on I, and the client reads
+ * the number back out of the 24-bit samples.  Both ends run in this
+ * process, so they share one clock; the bridge can be on another host.
+ *
+ *   ubersdr-hpsdr-bridge --url http://<this host>:8073 --interface eth0 --receivers 8
+ *   ubersdr-hpsdr-loopback --bridge <bridge host> --ddcs 1,2,4,8 --rates 48,96,192
+ */
+
+#include "ka9q_hpsdr.h"
+#include <inttypes.h>
+
+#define LB_FRAME_MS        20       /* synthetic pcm-zstd frame length */
+#define LB_MARKER_EVERY    10       /* frames between latency markers (200 ms) */
+#define LB_MARKER_BITS     16
+#define LB_MARKER_LEVEL    30000    /* int16 level of marker samples */
+#define LB_NOISE_LEVEL     2000     /* int16 peak of the background noise */
+#define LB_FLAG_THRESHOLD  1500     /* 24-bit level between noise and marker at any rate's scale */
+#define LB_MAX_LIST        16
+#define LB_BASE_FREQ       7000000  /* DDC n is tuned to LB_BASE_FREQ + n * 10 kHz */
+
+/* P2 ports on the bridge */
+#define P2_GENERAL_PORT    1024
+#define P2_DDC_SPEC_PORT   1025
+#define P2_HIGHPRIO_PORT   1027
+#define P2_DDC0_PORT       1035
+#define P2_CTRL_LEN        1444
+
+static volatile int do_exit = 0;
+static int64_t t0_ns;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void lb_print(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    printf("%10.6f ", (now_ns() - t0_ns) * 1e-9);
+    vprintf(format, args);
+    va_end(args);
+    fflush(stdout);
+}
+
+/* -----------------------------------------------------------------------
+ * Synthetic UberSDR source
+ * ----------------------------------------------------------------------- */
+
+/* Send time of each marker, indexed by marker number; 0 once consumed */
+static _Atomic int64_t marker_sent_ns[1 << LB_MARKER_BITS];
+static atomic_uint marker_next;
+static atomic_int src_sessions;
+static int src_sent_this_pass;
+
+struct src_session {
+    int rate;
+    int samples_per_frame;
+    uint64_t frames_sent;
+    int64_t start_ns;
+    uint32_t noise;
+    ZSTD_CCtx *cctx;
+    uint8_t *raw;               /* PCM header + big-endian int16 I/Q */
+    uint8_t *out;               /* LWS_PRE + compressed frame */
+    size_t raw_len;
+    size_t out_cap;
+};
+
+static int16_t src_noise(struct src_session *s)
+{
+    s->noise = s->noise * 1664525u + 1013904223u;
+    return (int16_t)((int)((s->noise >> 16) % (2 * LB_NOISE_LEVEL + 1)) - LB_NOISE_LEVEL);
+}
+
+static void put_be16(uint8_t *p, int16_t v)
+{
+    p[0] = (uint8_t)((uint16_t)v >> 8);
+    p[1] = (uint8_t)((uint16_t)v & 0xff);
+}
+
+static void put_le(uint8_t *p, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+/*
+ * Build and send the next frame.  The first frame carries the full
+ * header (sample rate, channels); the rest the minimal one, as the real
+ * server does.  Returns -1 if the write failed.
+ */
+static int src_send_frame(struct lws *wsi, struct src_session *s)
+{
+    const uint64_t rtp = s->frames_sent * (uint64_t)s->samples_per_frame;
+    size_t hdr;
+    uint8_t *p = s->raw;
+
+    if (s->frames_sent == 0) {
+        memset(p, 0, PCM_FULL_HEADER_SIZE);
+        put_le(p, PCM_MAGIC_FULL, 2);
+        p[2] = 2;                           /* version */
+        p[3] = 2;                           /* PCM-zstd */
+        put_le(p + 4, rtp, 8);
+        put_le(p + 20, (uint64_t)s->rate, 4);
+        p[24] = 2;                          /* channels */
+        hdr = PCM_FULL_HEADER_SIZE;
+    } else {
+        memset(p, 0, PCM_MINIMAL_HEADER_SIZE);
+        put_le(p, PCM_MAGIC_MINIMAL, 2);
+        p[2] = 2;
+        put_le(p + 3, rtp, 8);
+        hdr = PCM_MINIMAL_HEADER_SIZE;
+    }
+
+    uint8_t *pcm = p + hdr;
+    int first = 0;
+    unsigned int marker = 0;
+
+    if (s->frames_sent % LB_MARKER_EVERY == 0) {
+        marker = atomic_fetch_add(&marker_next, 1) & ((1u << LB_MARKER_BITS) - 1);
+        for (int i = 0; i < LB_MARKER_BITS; i++) {
+            int bit = (marker >> (LB_MARKER_BITS - 1 - i)) & 1;
+            put_be16(pcm + 4 * i, bit ? LB_MARKER_LEVEL : -LB_MARKER_LEVEL);
+            put_be16(pcm + 4 * i + 2, LB_MARKER_LEVEL);
+        }
+        first = LB_MARKER_BITS;
+    }
+    for (int i = first; i < s->samples_per_frame; i++) {
+        put_be16(pcm + 4 * i, src_noise(s));
+        put_be16(pcm + 4 * i + 2, src_noise(s));
+    }
+
+    size_t raw_len = hdr + (size_t)s->samples_per_frame * 4;
+    size_t n = ZSTD_compressCCtx(s->cctx, s->out + LWS_PRE, s->out_cap - LWS_PRE,
+                                 s->raw, raw_len, 1);
+    if (ZSTD_isError(n)) {
+        lb_print("source: ZSTD_compressCCtx: %s\n", ZSTD_getErrorName(n));
+        return -1;
+    }
+
+    if (first)
+        atomic_store(&marker_sent_ns[marker], now_ns());
+
+    if (lws_write(wsi, s->out + LWS_PRE, n, LWS_WRITE_BINARY) < (int)n)
+        return -1;
+
+    s->frames_sent++;
+    src_sent_this_pass = 1;
+    return 0;
+}
+
+static int src_callback(struct lws *wsi, enum lws_callback_reasons reason,
+                        void *user, void *in, size_t len)
+{
+    struct src_session *s = (struct src_session *)user;
+    char arg[32];
+
+    switch (reason) {
+
+    case LWS_CALLBACK_HTTP:
+        /*
+         * The /connection permission check (curl POST from the bridge).
+         * The bridge fails open on an odd or missing reply, so a status
+         * page that contains the JSON is enough.
+         */
+        lws_return_http_status(wsi, HTTP_STATUS_OK, "{\"allowed\":true}");
+        return -1;
+
+    case LWS_CALLBACK_ESTABLISHED:
+        if (lws_get_urlarg_by_name(wsi, "mode=", arg, sizeof(arg)) == NULL ||
+            strncmp(arg, "iq", 2) != 0) {
+            lb_print("source: connection without an iq mode, closing\n");
+            return -1;
+        }
+        s->rate = atoi(arg + 2) * 1000;
+        if (s->rate != 48000 && s->rate != 96000 && s->rate != 192000) {
+            lb_print("source: unsupported mode %s, closing\n", arg);
+            return -1;
+        }
+        s->samples_per_frame = s->rate * LB_FRAME_MS / 1000;
+        s->raw_len = PCM_FULL_HEADER_SIZE + (size_t)s->samples_per_frame * 4;
+        s->out_cap = LWS_PRE + ZSTD_compressBound(s->raw_len);
+        s->raw = malloc(s->raw_len);
+        s->out = malloc(s->out_cap);
+        s->cctx = ZSTD_createCCtx();
+        if (!s->raw || !s->out || !s->cctx)
+            return -1;
+        s->noise = (uint32_t)atomic_load(&src_sessions) * 2654435761u + 1;
+        s->frames_sent = 0;
+        s->start_ns = now_ns();
+        atomic_fetch_add(&src_sessions, 1);
+        lws_callback_on_writable(wsi);
+        break;
+
+    case LWS_CALLBACK_SERVER_WRITEABLE: {
+        if (!s->cctx)
+            break;
+        int64_t frame_ns = (int64_t)LB_FRAME_MS * 1000000;
+        int64_t due = s->start_ns + (int64_t)s->frames_sent * frame_ns;
+        int64_t now = now_ns();
+        if (now < due)
+            break;
+        /* After a stall, carry on from now rather than bursting */
+        if (now - due > 1000000000LL)
+            s->start_ns = now - (int64_t)s->frames_sent * frame_ns;
+        if (src_send_frame(wsi, s) < 0)
+            return -1;
+        break;
+    }
+
+    case LWS_CALLBACK_RECEIVE:
+        /* Tune messages from the bridge: the synthetic signal ignores them */
+        break;
+
+    case LWS_CALLBACK_CLOSED:
+        if (s->cctx) {
+            ZSTD_freeCCtx(s->cctx);
+            atomic_fetch_sub(&src_sessions, 1);
+        }
+        free(s->raw);
+        free(s->out);
+        s->cctx = NULL;
+        s->raw = s->out = NULL;
+        break;
+
+    default:
+        break;
+    }
+    return 0;
+}
+
+static struct lws_protocols src_protocols[] = {
+    {
+        .name                  = "ubersdr",
+        .callback              = src_callback,
+        .per_session_data_size = sizeof(struct src_session),
+        .rx_buffer_size        = 4096,
+    },
+    LWS_PROTOCOL_LIST_TERM
+};
+
+static void *src_thread(void *arg)
+{
+    struct lws_context *ctx = (struct lws_context *)arg;
+
+    while (!do_exit) {
+        /* Frames are paced per session in the writeable callback; ask for
+         * one every pass and sleep when nothing was due */
+        src_sent_this_pass = 0;
+        lws_callback_on_writable_all_protocol(ctx, &src_protocols[0]);
+        if (lws_service(ctx, 0) < 0)
+            break;
+        if (!src_sent_this_pass)
+            usleep(1000);
+    }
+    return NULL;
+}
+
+/* -----------------------------------------------------------------------
+ * Minimal Protocol-2 client
+ * ----------------------------------------------------------------------- */
+
+static int cl_sock = -1;
+static struct sockaddr_in bridge_addr;
+
+/* Wanted bridge state, sent every 50 ms by ctl_thread */
+static atomic_int want_running;
+static atomic_int want_ddcs;
+static atomic_int want_rate_khz;
+
+struct ddc_stats {
+    uint64_t packets;
+    uint64_t lost;              /* from sequence gaps */
+    uint64_t reordered;         /* sequence went backwards */
+    uint32_t last_seq;
+    int have_seq;
+    int64_t last_rx_ns;
+    int marker_state;           /* 0 idle, 1 collecting, 2 complete */
+    int marker_bits;
+    unsigned int marker_value;
+    int32_t *intervals_us;
+    size_t n_intervals, max_intervals;
+    int32_t *latency_us;
+    size_t n_latency, max_latency;
+};
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ddc_stats stats[MAX_RCVRS];
+static int measuring;           /* guarded by stats_lock */
+
+static void send_ctl(uint16_t port, const uint8_t *buf, size_t len)
+{
+    struct sockaddr_in to = bridge_addr;
+    to.sin_port = htons(port);
+    if (sendto(cl_sock, buf, len, 0, (struct sockaddr *)&to, sizeof(to)) < 0)
+        lb_print("client: sendto port %d: %s\n", port, strerror(errno));
+}
+
+/* General packet: default ports, no wideband, frequencies in raw Hz */
+static void send_general(void)
+{
+    uint8_t buf[60] = {0};
+    send_ctl(P2_GENERAL_PORT, buf, sizeof(buf));
+}
+
+static void *ctl_thread(void *arg)
+{
+    uint32_t hp_seq = 0, spec_seq = 0;
+    uint8_t buf[P2_CTRL_LEN];
+    (void)arg;
+
+    while (!do_exit) {
+        int running = atomic_load(&want_running);
+        int ddcs = atomic_load(&want_ddcs);
+        int rate = atomic_load(&want_rate_khz);
+        int i;
+
+        /* High Priority: run bit and DDC frequencies */
+        memset(buf, 0, sizeof(buf));
+        buf[0] = hp_seq >> 24; buf[1] = hp_seq >> 16; buf[2] = hp_seq >> 8; buf[3] = hp_seq;
+        hp_seq++;
+        buf[4] = running ? 0x01 : 0x00;
+        for (i = 0; i < MAX_RCVRS; i++) {
+            uint32_t f = LB_BASE_FREQ + i * 10000;
+            buf[9 + 4 * i]  = f >> 24;
+            buf[10 + 4 * i] = f >> 16;
+            buf[11 + 4 * i] = f >> 8;
+            buf[12 + 4 * i] = f;
+        }
+        send_ctl(P2_HIGHPRIO_PORT, buf, sizeof(buf));
+
+        /* DDC specific: enables and rates (only acted on while running) */
+        memset(buf, 0, sizeof(buf));
+        buf[0] = spec_seq >> 24; buf[1] = spec_seq >> 16; buf[2] = spec_seq >> 8; buf[3] = spec_seq;
+        spec_seq++;
+        for (i = 0; i < ddcs && i < MAX_RCVRS; i++) {
+            buf[7 + i / 8] |= 1 << (i % 8);
+            buf[18 + 6 * i] = rate >> 8;
+            buf[19 + 6 * i] = rate & 0xff;
+        }
+        send_ctl(P2_DDC_SPEC_PORT, buf, sizeof(buf));
+
+        usleep(50000);
+    }
+    return NULL;
+}
+
+static int32_t get_be24(const uint8_t *p)
+{
+    int32_t v = ((int32_t)p[0] << 16) | ((int32_t)p[1] << 8) | p[2];
+    return (v & 0x800000) ? v - 0x1000000 : v;
+}
+
+/* Follow the marker through one packet's samples (Q first on the wire) */
+static void scan_markers(struct ddc_stats *st, const uint8_t *payload, int64_t rx_ns)
+{
+    for (int j = 0; j < DDC_SAMPLES_PER_PKT; j++) {
+        int32_t q = get_be24(payload + 6 * j);
+        int32_t i = get_be24(payload + 6 * j + 3);
+
+        if (q < LB_FLAG_THRESHOLD) {
+            st->marker_state = 0;
+            continue;
+        }
+        if (st->marker_state == 2)
+            continue;
+        if (st->marker_state == 0) {
+            st->marker_state = 1;
+            st->marker_bits = 0;
+            st->marker_value = 0;
+        }
+        st->marker_value = (st->marker_value << 1) | (i > 0);
+        if (++st->marker_bits == LB_MARKER_BITS) {
+            st->marker_state = 2;
+            int64_t sent = atomic_exchange(&marker_sent_ns[st->marker_value], 0);
+            int64_t lat = rx_ns - sent;
+            if (sent != 0 && lat > 0 && lat < 10000000000LL && st->n_latency < st->max_latency)
+                st->latency_us[st->n_latency++] = (int32_t)(lat / 1000);
+        }
+    }
+}
+
+static void *rx_thread(void *arg)
+{
+    uint8_t buf[2048];
+    (void)arg;
+
+    while (!do_exit) {
+        struct sockaddr_in from;
+        socklen_t flen = sizeof(from);
+        ssize_t n = recvfrom(cl_sock, buf, sizeof(buf), 0, (struct sockaddr *)&from, &flen);
+        if (n < 0)
+            continue;                   /* timeout */
+
+        int ddc = (int)ntohs(from.sin_port) - P2_DDC0_PORT;
+        if (n != DDC_PKT_LEN || ddc < 0 || ddc >= MAX_RCVRS)
+            continue;                   /* HP status, mic, ... */
+
+        int64_t rx_ns = now_ns();
+        uint32_t seq = ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) |
+                       ((uint32_t)buf[2] << 8) | buf[3];
+
+        pthread_mutex_lock(&stats_lock);
+        struct ddc_stats *st = &stats[ddc];
+        st->packets++;
+        if (st->have_seq) {
+            uint32_t expect = st->last_seq + 1;
+            if (seq == expect) {
+                /* in order */
+            } else if ((int32_t)(seq - expect) > 0 && seq != 0) {
+                st->lost += seq - expect;
+                st->marker_state = 0;
+            } else if (seq == 0) {
+                /* bridge restarted the stream */
+            } else {
+                st->reordered++;
+            }
+        }
+        st->last_seq = seq;
+        st->have_seq = 1;
+        if (measuring && st->last_rx_ns != 0 && st->n_intervals < st->max_intervals)
+            st->intervals_us[st->n_intervals++] = (int32_t)((rx_ns - st->last_rx_ns) / 1000);
+        st->last_rx_ns = rx_ns;
+        if (measuring)
+            scan_markers(st, buf + DDC_HDR_LEN, rx_ns);
+        pthread_mutex_unlock(&stats_lock);
+    }
+    return NULL;
+}
+
+/* -----------------------------------------------------------------------
+ * Benchmark driver
+ * ----------------------------------------------------------------------- */
+
+static int cmp_i32(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int32_t pct(const int32_t *v, size_t n, double p)
+{
+    if (n == 0) return 0;
+    size_t k = (size_t)ceil(p / 100.0 * n);
+    if (k < 1) k = 1;
+    if (k > n) k = n;
+    return v[k - 1];
+}
+
+static int parse_list(const char *s, int *out, int max)
+{
+    int n = 0;
+    while (*s && n < max) {
+        out[n++] = atoi(s);
+        s = strchr(s, ',');
+        if (!s) break;
+        s++;
+    }
+    return n;
+}
+
+static void stats_reset(int ddcs, double seconds, int rate_khz)
+{
+    size_t pkts = (size_t)(seconds * rate_khz * 1000.0 / DDC_SAMPLES_PER_PKT * 2.0) + 1024;
+    size_t markers = (size_t)(seconds * 1000.0 / (LB_FRAME_MS * LB_MARKER_EVERY) * 2.0) + 64;
+
+    pthread_mutex_lock(&stats_lock);
+    for (int i = 0; i < MAX_RCVRS; i++) {
+        struct ddc_stats *st = &stats[i];
+        free(st->intervals_us);
+        free(st->latency_us);
+        memset(st, 0, sizeof(*st));
+        if (i < ddcs) {
+            st->intervals_us = malloc(pkts * sizeof(int32_t));
+            st->max_intervals = st->intervals_us ? pkts : 0;
+            st->latency_us = malloc(markers * sizeof(int32_t));
+            st->max_latency = st->latency_us ? markers : 0;
+        }
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/* Wait until every enabled DDC is delivering; false on timeout */
+static bool wait_streams(int ddcs, double timeout_s)
+{
+    int64_t deadline = now_ns() + (int64_t)(timeout_s * 1e9);
+    while (!do_exit && now_ns() < deadline) {
+        int live = 0;
+        int64_t now = now_ns();
+        pthread_mutex_lock(&stats_lock);
+        for (int i = 0; i < ddcs; i++)
+            if (stats[i].last_rx_ns != 0 && now - stats[i].last_rx_ns < 200000000LL)
+                live++;
+        pthread_mutex_unlock(&stats_lock);
+        if (live == ddcs)
+            return true;
+        usleep(100000);
+    }
+    return false;
+}
+
+/* Run one DDC count × rate; returns true if the bridge kept up */
+static bool run_config(int ddcs, int rate_khz, double seconds, double settle_s)
+{
+    /* Stop, so the bridge drops its state and reconnects at the new rate */
+    atomic_store(&want_running, 0);
+    usleep(500000);
+    stats_reset(ddcs, seconds, rate_khz);
+
+    atomic_store(&want_ddcs, ddcs);
+    atomic_store(&want_rate_khz, rate_khz);
+    send_general();
+    atomic_store(&want_running, 1);
+
+    if (!wait_streams(ddcs, 30.0)) {
+        lb_print("%d x %d kHz: not every DDC started streaming (bridge --receivers too low?)\n",
+                 ddcs, rate_khz);
+        return false;
+    }
+    usleep((useconds_t)(settle_s * 1e6));
+
+    uint64_t pk0[MAX_RCVRS], lost0[MAX_RCVRS];
+    pthread_mutex_lock(&stats_lock);
+    for (int i = 0; i < ddcs; i++) {
+        pk0[i] = stats[i].packets;
+        lost0[i] = stats[i].lost;
+        stats[i].marker_state = 0;
+    }
+    measuring = 1;
+    pthread_mutex_unlock(&stats_lock);
+    int64_t start = now_ns();
+
+    usleep((useconds_t)(seconds * 1e6));
+
+    pthread_mutex_lock(&stats_lock);
+    measuring = 0;
+    double elapsed = (now_ns() - start) * 1e-9;
+
+    uint64_t packets = 0, lost = 0, reordered = 0;
+    size_t n_int = 0, n_lat = 0;
+    for (int i = 0; i < ddcs; i++) {
+        packets += stats[i].packets - pk0[i];
+        lost += stats[i].lost - lost0[i];
+        reordered += stats[i].reordered;
+        n_int += stats[i].n_intervals;
+        n_lat += stats[i].n_latency;
+    }
+    int32_t *ints = malloc((n_int + 1) * sizeof(int32_t));
+    int32_t *lats = malloc((n_lat + 1) * sizeof(int32_t));
+    size_t ki = 0, kl = 0;
+    for (int i = 0; i < ddcs && ints && lats; i++) {
+        memcpy(ints + ki, stats[i].intervals_us, stats[i].n_intervals * sizeof(int32_t));
+        ki += stats[i].n_intervals;
+        memcpy(lats + kl, stats[i].latency_us, stats[i].n_latency * sizeof(int32_t));
+        kl += stats[i].n_latency;
+    }
+    pthread_mutex_unlock(&stats_lock);
+
+    if (!ints || !lats) {
+        free(ints);
+        free(lats);
+        return false;
+    }
+    qsort(ints, ki, sizeof(int32_t), cmp_i32);
+    qsort(lats, kl, sizeof(int32_t), cmp_i32);
+
+    double expected = ddcs * elapsed * rate_khz * 1000.0 / DDC_SAMPLES_PER_PKT;
+    double delivered = expected > 0 ? packets / expected : 0.0;
+    double loss = (packets + lost) ? (double)lost / (double)(packets + lost) : 0.0;
+    bool ok = delivered >= 0.99 && loss <= 0.001;
+
+    printf("%4d %5d %9.0f %8.2f%% %8.3f%% %6" PRIu64 "  %6d %6d %7d  %7.1f %7.1f %7.1f  %s\n",
+           ddcs, rate_khz, packets / elapsed, 100.0 * delivered, 100.0 * loss, reordered,
+           pct(ints, ki, 50), pct(ints, ki, 99), ki ? ints[ki - 1] : 0,
+           pct(lats, kl, 50) / 1000.0, pct(lats, kl, 99) / 1000.0, kl ? lats[kl - 1] / 1000.0 : 0.0,
+           ok ? "ok" : "FAIL");
+    fflush(stdout);
+
+    free(ints);
+    free(lats);
+    return ok;
+}
+
+static void lb_sighandler(int signum)
+{
+    (void)signum;
+    do_exit = 1;
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [options]\n\n", prog);
+    printf("  --bridge HOST      Host running ubersdr-hpsdr-bridge (default 127.0.0.1)\n");
+    printf("  --listen PORT      Port of the synthetic UberSDR (default 8073)\n");
+    printf("  --ddcs LIST        DDC counts to try (default 1,2,4,8)\n");
+    printf("  --rates LIST       Rates in kHz to try (default 48,96,192)\n");
+    printf("  --seconds N        Measurement time per step (default 10)\n");
+    printf("  --settle N         Time after streams start before measuring (default 2)\n");
+    printf("\n");
+    printf("Start the bridge against this tool first, e.g.\n");
+    printf("  ubersdr-hpsdr-bridge --url http://<this host>:8073 --interface eth0 --receivers 8\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *bridge = "127.0.0.1";
+    int listen_port = 8073;
+    int ddc_list[LB_MAX_LIST] = {1, 2, 4, 8}, n_ddcs = 4;
+    int rate_list[LB_MAX_LIST] = {48, 96, 192}, n_rates = 3;
+    double seconds = 10.0, settle = 2.0;
+    int opt, opt_index = 0, i, r;
+
+    static struct option long_options[] = {
+        {"bridge",  required_argument, 0, 'b'},
+        {"listen",  required_argument, 0, 'l'},
+        {"ddcs",    required_argument, 0, 'n'},
+        {"rates",   required_argument, 0, 'r'},
+        {"seconds", required_argument, 0, 's'},
+        {"settle",  required_argument, 0, 'w'},
+        {"help",    no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    while ((opt = getopt_long(argc, argv, "b:l:n:r:s:w:h", long_options, &opt_index)) != -1) {
+        switch (opt) {
+        case 'b': bridge = optarg; break;
+        case 'l': listen_port = atoi(optarg); break;
+        case 'n': n_ddcs = parse_list(optarg, ddc_list, LB_MAX_LIST); break;
+        case 'r': n_rates = parse_list(optarg, rate_list, LB_MAX_LIST); break;
+        case 's': seconds = atof(optarg); break;
+        case 'w': settle = atof(optarg); break;
+        case 'h':
+        default:
+            usage(basename(argv[0]));
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    for (i = 0; i < n_ddcs; i++) {
+        if (ddc_list[i] < 1 || ddc_list[i] > MAX_RCVRS) {
+            printf("--ddcs: counts must be 1..%d\n", MAX_RCVRS);
+            return EXIT_FAILURE;
+        }
+    }
+    for (i = 0; i < n_rates; i++) {
+        if (rate_list[i] != 48 && rate_list[i] != 96 && rate_list[i] != 192) {
+            printf("--rates: rates must be 48, 96 or 192\n");
+            return EXIT_FAILURE;
+        }
+    }
+    if (seconds <= 0.0 || settle < 0.0) {
+        usage(basename(argv[0]));
+        return EXIT_FAILURE;
+    }
+
+    t0_ns = now_ns();
+    lws_set_log_level(LLL_ERR, NULL);
+    signal(SIGINT, lb_sighandler);
+    signal(SIGTERM, lb_sighandler);
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(&bridge_addr, 0, sizeof(bridge_addr));
+    bridge_addr.sin_family = AF_INET;
+    if (inet_pton(AF_INET, bridge, &bridge_addr.sin_addr) != 1) {
+        struct hostent *he = gethostbyname(bridge);
+        if (!he) {
+            printf("Cannot resolve %s\n", bridge);
+            return EXIT_FAILURE;
+        }
+        memcpy(&bridge_addr.sin_addr, he->h_addr_list[0], sizeof(bridge_addr.sin_addr));
+    }
+
+    /* One socket for everything: the bridge sends the DDC streams back to
+     * the source address of the General packet */
+    cl_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (cl_sock < 0) {
+        perror("socket");
+        return EXIT_FAILURE;
+    }
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(cl_sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct timeval tv = { 0, 100000 };
+    setsockopt(cl_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in any = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_ANY) };
+    if (bind(cl_sock, (struct sockaddr *)&any, sizeof(any)) < 0) {
+        perror("bind");
+        return EXIT_FAILURE;
+    }
+
+    struct lws_context_creation_info info = {0};
+    info.port = listen_port;
+    info.protocols = src_protocols;
+    struct lws_context *ctx = lws_create_context(&info);
+    if (!ctx) {
+        printf("Cannot listen on port %d\n", listen_port);
+        return EXIT_FAILURE;
+    }
+
+    pthread_t src_id, ctl_id, rx_id;
+    pthread_create(&src_id, NULL, src_thread, ctx);
+    pthread_create(&ctl_id, NULL, ctl_thread, NULL);
+    pthread_create(&rx_id, NULL, rx_thread, NULL);
+
+    lb_print("synthetic UberSDR on port %d, P2 client to %s, %.0f s per step\n",
+             listen_port, bridge, seconds);
+
+    printf("\nDDCs   kHz    pkts/s delivered     loss  reord  int p50    p99     max  lat p50     p99     max\n");
+    printf("                                                  (us)                  (ms)\n");
+
+    int best[LB_MAX_LIST] = {0};
+    for (r = 0; r < n_rates && !do_exit; r++) {
+        for (i = 0; i < n_ddcs && !do_exit; i++) {
+            if (run_config(ddc_list[i], rate_list[r], seconds, settle) && ddc_list[i] > best[r])
+                best[r] = ddc_list[i];
+        }
+    }
+
+    atomic_store(&want_running, 0);
+    usleep(200000);
+
+    printf("\nSustained (delivered >= 99%%, loss <= 0.1%%):\n");
+    for (r = 0; r < n_rates; r++) {
+        if (best[r])
+            printf("  %3d kHz: %d DDCs, %d kS/s total\n", rate_list[r], best[r], best[r] * rate_list[r]);
+        else
+            printf("  %3d kHz: none of the tried counts\n", rate_list[r]);
+    }
+
+    do_exit = 1;
+    pthread_join(ctl_id, NULL);
+    pthread_join(rx_id, NULL);
+    lws_cancel_service(ctx);
+    pthread_join(src_id, NULL);
+    lws_context_destroy(ctx);
+    close(cl_sock);
+    return EXIT_SUCCESS;
+}
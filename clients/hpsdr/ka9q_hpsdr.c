@@ -40,10 +40,21 @@
  *   - lws context destroy/recreate on reconnect to avoid TLS teardown delays
  *   - Client disconnect watchdog: if no high-priority packet is received for
  *     5 seconds, streaming is stopped and DDC state is cleared
- *   - zstd decompression of PCM frames received from UberSDR
+ *   - Streaming zstd decompression of PCM frames received from UberSDR,
+ *     packing DDC packets as samples are decoded
+ *   - Per-receiver decoder and packet queue allocated on first connect,
+ *     sized to the receiver's rate
+ *   - Lock-free per-DDC packet queue between ws_thread and rx_thread, so a
+ *     slow DDC sender never blocks the WebSocket or the other DDCs
+ *   - Batched DDC and wideband transmission (sendmmsg, optional UDP GSO)
+ *   - --single-loop: one lws context and thread for all receivers, and
+ *     --pin to keep the WebSocket and UDP sender threads on chosen cores
+ *   - Wideband sweeps read from a seqlock'd shared-memory segment
+ *     (wideband_shm.h) so only fresh, complete sweeps are sent
  */
 
 #include "ka9q_hpsdr.h"
+#include "wideband_shm.h"
 
 static int do_exit = 0;
 struct main_cb mcb;
@@ -52,9 +63,6 @@ static int hp_sock;
 static int ddcspec_sock = -1;   /* bound to port 1025; also the source for HP status sends */
 static int interface_offset = 0;
 
-static u_int send_flags = 0;
-static u_int done_send_flags = 0;
-
 /*
  * Mutex serialising lws_create_context() calls across ws_threads.
  *
@@ -69,10 +77,6 @@ static u_int done_send_flags = 0;
  */
 static pthread_mutex_t lws_ctx_create_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-static pthread_mutex_t send_lock = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t send_cond = PTHREAD_COND_INITIALIZER;
-static pthread_mutex_t done_send_lock = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t done_send_cond = PTHREAD_COND_INITIALIZER;
 static int running = 0;
 static bool gen_rcvd = false;
 static struct timespec last_client_activity = {0};  // updated by any UDP receive from client
@@ -93,7 +97,6 @@ static int ddc_port = 1025;
 static int mic_port = 1026;
 static int hp_port = 1027; // also wb_port
 static int ddc0_port = 1035;
-static unsigned char pbuf[MAX_RCVRS][238*6];
 
 static pthread_t ws_thread_id[MAX_RCVRS];
 static pthread_t highprio_thread_id = 0;
@@ -111,6 +114,11 @@ static void   *hpstat_thread(void *);
 static void   *sink_thread(void *);
 static void   *rx_thread(void *);
 static void   *ws_thread(void *);
+static void   *ws_loop_thread(void *);
+static void    txq_wake(struct rcvr_cb *rcb);
+static void    txq_wake_all(void);
+static int     udp_send_batch(int sock, const unsigned char *base, size_t len,
+                              int count, const struct sockaddr_in *to);
 
 /* Generate a UUID v4 string into buf (must be at least 37 bytes) */
 void generate_uuid(char *buf)
@@ -224,27 +232,65 @@ bool check_ubersdr_connection(const char *url)
 }
 
 /*
- * Per-receiver version of check_ubersdr_connection that uses the receiver's
- * own session_id.
+ * Build the curl command for a per-receiver /connection permission check
+ * using the receiver's own session_id.  http_url receives the endpoint
+ * (for log messages).
  */
-static bool check_ubersdr_connection_rcb(const char *base_url, struct rcvr_cb *rcb)
+static void connection_check_cmd(const char *base_url, struct rcvr_cb *rcb,
+                                 char *cmd, size_t cmd_size,
+                                 char *http_url, size_t url_size)
 {
-    char http_url[512];
     size_t ulen = strlen(base_url);
     if (ulen > 0 && base_url[ulen-1] == '/') ulen--;
-    snprintf(http_url, sizeof(http_url), "%.*s/connection", (int)ulen, base_url);
+    snprintf(http_url, url_size, "%.*s/connection", (int)ulen, base_url);
 
     char json_body[512];
     snprintf(json_body, sizeof(json_body),
              "{\"user_session_id\":\"%s\",\"password\":\"%s\"}",
              rcb->session_id, mcb.ubersdr_password);
 
-    char cmd[2048];
-    snprintf(cmd, sizeof(cmd),
+    snprintf(cmd, cmd_size,
              "curl -s --max-time 3 -A 'UberSDR_HPSDR/1.0' "
              "-X POST -H 'Content-Type: application/json' "
              "-d '%s' '%s' 2>/dev/null",
              json_body, http_url);
+}
+
+/* Interpret the /connection response; fail open when it is missing or odd */
+static bool connection_check_result(struct rcvr_cb *rcb, const char *resp, size_t rlen,
+                                    const char *http_url)
+{
+    if (rlen == 0) {
+        t_print("ws_thread(%d): no response from %s, continuing\n", rcb->rcvr_num, http_url);
+        return true;
+    }
+
+    const char *allowed_ptr = strstr(resp, "\"allowed\"");
+    if (!allowed_ptr) return true;
+
+    const char *colon = strchr(allowed_ptr, ':');
+    if (!colon) return true;
+    colon++;
+    while (*colon == ' ' || *colon == '\t') colon++;
+
+    if (strncmp(colon, "true", 4) == 0) {
+        t_print("ws_thread(%d): connection allowed\n", rcb->rcvr_num);
+        return true;
+    }
+
+    t_print("ws_thread(%d): connection rejected by %s\n", rcb->rcvr_num, http_url);
+    return false;
+}
+
+/*
+ * Per-receiver version of check_ubersdr_connection that uses the receiver's
+ * own session_id.
+ */
+static bool check_ubersdr_connection_rcb(const char *base_url, struct rcvr_cb *rcb)
+{
+    char http_url[512];
+    char cmd[2048];
+    connection_check_cmd(base_url, rcb, cmd, sizeof(cmd), http_url, sizeof(http_url));
 
     FILE *fp = popen(cmd, "r");
     if (!fp) {
@@ -265,30 +311,11 @@ static bool check_ubersdr_connection_rcb(const char *base_url, struct rcvr_cb *r
     resp[rlen] = '\0';
     pclose(fp);
 
-    if (rlen == 0) {
-        t_print("ws_thread(%d): no response from %s, continuing\n", rcb->rcvr_num, http_url);
-        return true;
-    }
-
-    char *allowed_ptr = strstr(resp, "\"allowed\"");
-    if (!allowed_ptr) return true;
-
-    char *colon = strchr(allowed_ptr, ':');
-    if (!colon) return true;
-    colon++;
-    while (*colon == ' ' || *colon == '\t') colon++;
-
-    if (strncmp(colon, "true", 4) == 0) {
-        t_print("ws_thread(%d): connection allowed\n", rcb->rcvr_num);
-        return true;
-    }
-
-    t_print("ws_thread(%d): connection rejected by %s\n", rcb->rcvr_num, http_url);
-    return false;
+    return connection_check_result(rcb, resp, rlen, http_url);
 }
 
 /*
- * Decode a zstd-compressed (or raw) PCM binary frame from ubersdr.
+ * PCM binary frames from ubersdr, one per WebSocket message.
  *
  * Exact header layout (from ubersdr server source / Go client pcm_decoder.go):
  *
@@ -314,105 +341,177 @@ static bool check_ubersdr_connection_rcb(const char *base_url, struct rcvr_cb *r
  *   sample_rate and channels are inherited from the last full header.
  *
  * The entire frame (header + PCM) is zstd-compressed before transmission.
- *
- * On success, fills iq_out[] with complex float samples (scaled to ±1.0),
- * sets *out_count, *out_sample_rate, *out_channels, and returns true.
- * Returns false on any error.
  */
-bool decode_pcm_frame(struct rcvr_cb *rcb,
-                      const uint8_t *compressed, size_t compressed_len,
-                      float complex *iq_out, int max_samples,
-                      int *out_count, int *out_sample_rate, int *out_channels)
-{
-    /* Try zstd decompression first; fall back to treating data as raw if it fails */
-    size_t dec_size = ZSTD_decompressDCtx(rcb->zstd_dctx,
-                                           rcb->ws_rx_buf, WS_RX_BUF_SIZE,
-                                           compressed, compressed_len);
-    const uint8_t *p;
-    size_t p_len;
-
-    if (ZSTD_isError(dec_size)) {
-        /* Not zstd — treat the raw bytes as the decompressed frame */
-        if (compressed_len > WS_RX_BUF_SIZE) {
-            t_print("decode_pcm_frame: raw frame too large (%zu)\n", compressed_len);
-            return false;
-        }
-        memcpy(rcb->ws_rx_buf, compressed, compressed_len);
-        p     = rcb->ws_rx_buf;
-        p_len = compressed_len;
-    } else {
-        p     = rcb->ws_rx_buf;
-        p_len = dec_size;
-    }
 
-    if (p_len < 4) {
-        t_print("decode_pcm_frame: frame too short (%zu bytes)\n", p_len);
-        return false;
-    }
+/* Stream decode states, per WebSocket message */
+enum { DEC_IDLE = 0, DEC_HEADER, DEC_PCM, DEC_SKIP };
 
+/* Header size for the magic in hdr[0..1], 0 if the magic is unknown */
+static size_t pcm_header_size(const uint8_t *hdr)
+{
     /* Magic is little-endian uint16 */
-    uint16_t magic = (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
-    const uint8_t *pcm_data;
-    size_t pcm_len;
-
-    if (magic == PCM_MAGIC_FULL) {
-        /* Full header: 37 bytes */
-        if (p_len < PCM_FULL_HEADER_SIZE) {
-            t_print("decode_pcm_frame: full header too short (%zu)\n", p_len);
-            return false;
-        }
+    uint16_t magic = (uint16_t)(hdr[0] | ((uint16_t)hdr[1] << 8));
+
+    if (magic == PCM_MAGIC_FULL)
+        return PCM_FULL_HEADER_SIZE;
+    if (magic == PCM_MAGIC_MINIMAL)
+        return PCM_MINIMAL_HEADER_SIZE;
+    return 0;
+}
+
+/* Check a complete header in rcb->hdr and pick up its sample rate/channels */
+static bool pcm_parse_header(struct rcvr_cb *rcb)
+{
+    const uint8_t *p = rcb->hdr;
+
+    if (rcb->hdr_len == PCM_FULL_HEADER_SIZE) {
         uint8_t version = p[2];
         if (version != 2) {
-            t_print("decode_pcm_frame: unsupported version %d\n", version);
+            t_print("decode_pcm_chunk: unsupported version %d\n", version);
             return false;
         }
         /* sample_rate at bytes 20-23 (LE uint32) */
         int sr = (int)((uint32_t)p[20] | ((uint32_t)p[21] << 8) |
                        ((uint32_t)p[22] << 16) | ((uint32_t)p[23] << 24));
         int ch = (int)p[24];
-        *out_sample_rate = sr;
-        *out_channels    = ch;
+
+        /* Sample-rate change → need reconnect with new mode */
+        if (rcb->last_sample_rate != 0 && rcb->last_sample_rate != sr) {
+            t_print("ws_callback(%d): sample rate changed %d→%d, reconnecting\n",
+                    rcb->rcvr_num, rcb->last_sample_rate, sr);
+            rcb->reconnect_needed = 1;
+            return false;
+        }
         /* Cache for minimal-header packets */
         rcb->last_sample_rate = sr;
         rcb->last_channels    = ch;
-        pcm_data = p + PCM_FULL_HEADER_SIZE;
-        pcm_len  = p_len - PCM_FULL_HEADER_SIZE;
+    } else if (rcb->last_sample_rate == 0 || rcb->last_channels == 0) {
+        /* Minimal header: sample_rate/channels from last full header */
+        t_print("decode_pcm_chunk: minimal header before full header\n");
+        return false;
+    }
+    return true;
+}
 
-    } else if (magic == PCM_MAGIC_MINIMAL) {
-        /* Minimal header: 13 bytes; sample_rate/channels from last full header */
-        if (p_len < PCM_MINIMAL_HEADER_SIZE) {
-            t_print("decode_pcm_frame: minimal header too short (%zu)\n", p_len);
-            return false;
+/*
+ * Consume decoded frame bytes: gather the header, then pack the PCM data
+ * into DDC packets.  Only whole packets are handed to load_packet(); the
+ * remainder waits in rcb->carry for the next window (or frame).
+ */
+static bool pcm_consume(struct rcvr_cb *rcb, const uint8_t *p, size_t n)
+{
+    while (rcb->dec_state == DEC_HEADER && n > 0) {
+        /* The header size is known once the magic is in */
+        size_t need = 2;
+        if (rcb->hdr_len >= 2) {
+            need = pcm_header_size(rcb->hdr);
+            if (need == 0) {
+                t_print("decode_pcm_chunk: unknown magic 0x%04X\n",
+                        rcb->hdr[0] | (rcb->hdr[1] << 8));
+                return false;
+            }
         }
-        if (rcb->last_sample_rate == 0 || rcb->last_channels == 0) {
-            t_print("decode_pcm_frame: minimal header before full header\n");
-            return false;
+        size_t take = need - rcb->hdr_len;
+        if (take > n) take = n;
+        memcpy(rcb->hdr + rcb->hdr_len, p, take);
+        rcb->hdr_len += take;
+        p += take;
+        n -= take;
+        if (rcb->hdr_len == (int)need && need > 2) {
+            if (!pcm_parse_header(rcb))
+                return false;
+            rcb->dec_state = DEC_PCM;
         }
-        *out_sample_rate = rcb->last_sample_rate;
-        *out_channels    = rcb->last_channels;
-        pcm_data = p + PCM_MINIMAL_HEADER_SIZE;
-        pcm_len  = p_len - PCM_MINIMAL_HEADER_SIZE;
-
-    } else {
-        t_print("decode_pcm_frame: unknown magic 0x%04X\n", magic);
-        return false;
     }
+    if (n == 0)
+        return true;
 
-    /* PCM data is big-endian int16 interleaved stereo: I=left, Q=right */
-    int n_complex = (int)(pcm_len / 4); /* 4 bytes per complex sample (2×int16) */
-    if (n_complex > max_samples)
-        n_complex = max_samples;
+    /* Complete the packet left over from the last window */
+    if (rcb->carry_len > 0) {
+        size_t take = DDC_PCM_LEN - rcb->carry_len;
+        if (take > n) take = n;
+        memcpy(rcb->carry + rcb->carry_len, p, take);
+        rcb->carry_len += take;
+        p += take;
+        n -= take;
+        if (rcb->carry_len < DDC_PCM_LEN)
+            return true;
+        load_packet(rcb, rcb->carry);
+        rcb->carry_len = 0;
+    }
+
+    /* Whole packets straight from the window */
+    while (n >= DDC_PCM_LEN) {
+        load_packet(rcb, p);
+        p += DDC_PCM_LEN;
+        n -= DDC_PCM_LEN;
+    }
+
+    /* Keep the tail (< 1 packet) */
+    memcpy(rcb->carry, p, n);
+    rcb->carry_len = n;
+    return true;
+}
 
-    for (int i = 0; i < n_complex; i++) {
-        int16_t i_raw = (int16_t)(((uint16_t)pcm_data[4*i]   << 8) | pcm_data[4*i+1]);
-        int16_t q_raw = (int16_t)(((uint16_t)pcm_data[4*i+2] << 8) | pcm_data[4*i+3]);
-        float fi = (float)i_raw / 32768.0f;
-        float fq = (float)q_raw / 32768.0f;
-        iq_out[i] = fi + fq * _Complex_I;
+/*
+ * Feed one receive callback's worth of a WebSocket message to the
+ * receiver's stream decoder; final marks the message's last chunk.
+ *
+ * zstd output goes through the small rcb->dec_win window and is packed
+ * into DDC packets as it is decoded, so neither a whole decompressed
+ * frame nor a whole compressed one is ever buffered here.  A message that
+ * does not start with the zstd magic is taken as an uncompressed frame.
+ *
+ * Returns false if the message is bad, or announces a new sample rate
+ * (reconnect_needed is then set); the rest of the message is ignored.
+ */
+bool decode_pcm_chunk(struct rcvr_cb *rcb, const uint8_t *in, size_t len, bool final)
+{
+    bool ok = true;
+
+    if (rcb->dec_state == DEC_IDLE) {
+        if (len == 0)
+            return true;    /* empty message */
+        /* First chunk of a message: a new frame starts.  Its first byte
+         * tells a zstd frame (magic 0xFD2FB528 LE) from a raw PCM header. */
+        rcb->dec_raw = in[0] != (ZSTD_MAGICNUMBER & 0xff);
+        if (!rcb->dec_raw)
+            ZSTD_DCtx_reset(rcb->zstd_dctx, ZSTD_reset_session_only);
+        rcb->hdr_len = 0;
+        rcb->dec_state = DEC_HEADER;
+    }
+
+    if (rcb->dec_state != DEC_SKIP) {
+        if (rcb->dec_raw) {
+            ok = pcm_consume(rcb, in, len);
+        } else {
+            ZSTD_inBuffer zin = { in, len, 0 };
+            while (ok) {
+                ZSTD_outBuffer zout = { rcb->dec_win, sizeof(rcb->dec_win), 0 };
+                size_t rc = ZSTD_decompressStream(rcb->zstd_dctx, &zout, &zin);
+                if (ZSTD_isError(rc)) {
+                    t_print("decode_pcm_chunk: zstd: %s\n", ZSTD_getErrorName(rc));
+                    ok = false;
+                    break;
+                }
+                ok = pcm_consume(rcb, rcb->dec_win, zout.pos);
+                /* A window left short means zstd holds nothing more for now */
+                if (zin.pos == zin.size && zout.pos < zout.size)
+                    break;
+            }
+        }
+        if (!ok)
+            rcb->dec_state = DEC_SKIP;
     }
 
-    *out_count = n_complex;
-    return true;
+    if (final) {
+        if (rcb->dec_state == DEC_HEADER)
+            t_print("decode_pcm_chunk: frame too short (%d header bytes)\n", rcb->hdr_len);
+        /* PCM is whole 4-byte samples; drop a stray partial one */
+        rcb->carry_len -= rcb->carry_len % 4;
+        rcb->dec_state = DEC_IDLE;
+    }
+    return ok;
 }
 
 /*
@@ -781,6 +880,8 @@ static int ws_callback(struct lws *wsi,
     case LWS_CALLBACK_CLIENT_ESTABLISHED:
         t_print("ws_callback(%d): connection established\n",
                 rcb ? rcb->rcvr_num : -1);
+        if (rcb)
+            rcb->ws_retry_ms = 0; /* reset ws_loop_thread backoff */
         break;
 
     case LWS_CALLBACK_CLIENT_RECEIVE:
@@ -796,60 +897,15 @@ static int ws_callback(struct lws *wsi,
                 break;
             }
 
-            int n_samples = 0, sr = 0, ch = 0;
-
-            if (rcb->iqSamples_remaining < 0)
-                rcb->iqSamples_remaining = 0;
-
             /*
-             * Decode directly into the tail of iqSamples[].  The buffer is
-             * sized (IQ_RING_SAMPLES) for the largest possible frame plus
-             * one packet of leftover, so nothing is truncated or overflowed.
+             * Frames larger than WS_RX_CHUNK_SIZE arrive over several
+             * callbacks; each chunk is decoded, and its packets queued,
+             * as it comes in.
              */
-            int space = IQ_RING_SAMPLES - rcb->iqSamples_remaining;
-            bool ok = decode_pcm_frame(rcb,
-                                       (const uint8_t *)in, len,
-                                       &rcb->iqSamples[rcb->iqSamples_remaining],
-                                       space,
-                                       &n_samples, &sr, &ch);
-            if (!ok) break;
-
-            /* Detect sample-rate change → need reconnect with new mode */
-            if (rcb->last_sample_rate != 0 && rcb->last_sample_rate != sr) {
-                t_print("ws_callback(%d): sample rate changed %d→%d, reconnecting\n",
-                        rcb->rcvr_num, rcb->last_sample_rate, sr);
-                rcb->reconnect_needed = 1;
+            bool ok = decode_pcm_chunk(rcb, (const uint8_t *)in, len,
+                                       lws_is_final_fragment(wsi));
+            if (!ok && rcb->reconnect_needed)
                 lws_set_timeout(wsi, PENDING_TIMEOUT_CLOSE_SEND, LWS_TO_KILL_ASYNC);
-                break;
-            }
-            rcb->last_sample_rate = sr;
-            rcb->last_channels    = ch;
-
-            /* Scale in place */
-            for (int i = 0; i < n_samples; i++) {
-                rcb->iqSamples[rcb->iqSamples_remaining + i] *= rcb->scale;
-            }
-
-            rcb->iqSamples_remaining += n_samples;
-
-            int samps_packet = 238;
-            while (rcb->iqSamples_remaining >= samps_packet) {
-                load_packet(rcb);
-                rcb->iqSamples_remaining -= samps_packet;
-                rcb->iqSample_offset     += samps_packet;
-            }
-
-            /* Relocate any leftover to the front and reset the offset —
-             * the offset must also be reset when nothing is left, otherwise
-             * the next load_packet() would read from a stale offset. */
-            if (rcb->iqSample_offset > 0) {
-                if (rcb->iqSamples_remaining > 0) {
-                    memmove(&rcb->iqSamples[0],
-                            &rcb->iqSamples[rcb->iqSample_offset],
-                            rcb->iqSamples_remaining * sizeof(float complex));
-                }
-                rcb->iqSample_offset = 0;
-            }
         }
         break;
 
@@ -901,16 +957,171 @@ static struct lws_protocols ws_protocols[] = {
         .name                  = "ubersdr",
         .callback              = ws_callback,
         .per_session_data_size = 0,
-        .rx_buffer_size        = WS_RX_BUF_SIZE,
+        .rx_buffer_size        = WS_RX_CHUNK_SIZE,
     },
     LWS_PROTOCOL_LIST_TERM
 };
 
+/* Split mcb.ubersdr_url into host, port and TLS flag */
+static void parse_ubersdr_url(char *host, size_t host_size, int *port, int *use_ssl)
+{
+    const char *url = mcb.ubersdr_url;
+
+    *port = 80;
+    *use_ssl = 0;
+    if (strncmp(url, "https://", 8) == 0) {
+        *use_ssl = 1;
+        *port = 443;
+        url += 8;
+    } else if (strncmp(url, "http://", 7) == 0) {
+        url += 7;
+    } else if (strncmp(url, "wss://", 6) == 0) {
+        *use_ssl = 1;
+        *port = 443;
+        url += 6;
+    } else if (strncmp(url, "ws://", 5) == 0) {
+        url += 5;
+    }
+
+    const char *slash = strchr(url, '/');
+    const char *colon = strchr(url, ':');
+    size_t hlen;
+    if (colon && (!slash || colon < slash)) {
+        hlen = colon - url;
+        *port = atoi(colon + 1);
+    } else if (slash) {
+        hlen = slash - url;
+    } else {
+        hlen = strlen(url);
+    }
+    if (hlen >= host_size) hlen = host_size - 1;
+    memcpy(host, url, hlen);
+    host[hlen] = '\0';
+}
+
+/*
+ * Size this receiver's packet queue to its output rate: DDC_TXQ_DEPTH at
+ * 192 kHz, proportionally less at lower rates.  The queue only grows, and
+ * only while it is empty, so rx_thread never sees a slot move under it.
+ */
+static bool txq_alloc(struct rcvr_cb *rcb)
+{
+    struct ddc_txq *q = &rcb->txq;
+    unsigned int depth = DDC_TXQ_MIN;
+
+    while (depth < DDC_TXQ_DEPTH * (unsigned int)rcb->output_rate / 192000u)
+        depth <<= 1;
+    if (q->pkt && depth <= q->mask + 1)
+        return true;
+    if (q->pkt && atomic_load_explicit(&q->head, memory_order_relaxed) !=
+                  atomic_load_explicit(&q->tail, memory_order_acquire))
+        return true;    /* still draining; grow on a later connect */
+
+    unsigned char (*pkt)[DDC_PKT_LEN] = calloc(depth, DDC_PKT_LEN);
+    if (!pkt) {
+        t_print("ws_thread(%d): cannot allocate a %u packet queue\n", rcb->rcvr_num, depth);
+        return q->pkt != NULL;
+    }
+    free(q->pkt);
+    q->pkt  = pkt;
+    q->mask = depth - 1;
+    if (mcb.debug)
+        t_print("ws_thread(%d): packet queue %u deep (rate=%d kHz)\n",
+                rcb->rcvr_num, depth, rcb->output_rate / 1000);
+    return true;
+}
+
+/*
+ * Set up a receiver for a new connection.  Its zstd decoder and packet
+ * queue are allocated here, on first use, so DDCs the client never
+ * enables cost no memory, and the stream decode state starts fresh.
+ */
+static bool rcvr_prepare(struct rcvr_cb *rcb)
+{
+    if (!rcb->zstd_dctx) {
+        rcb->zstd_dctx = ZSTD_createDCtx();
+        if (!rcb->zstd_dctx) {
+            t_print("ws_thread(%d): ZSTD_createDCtx failed\n", rcb->rcvr_num);
+            return false;
+        }
+    }
+    if (!txq_alloc(rcb))
+        return false;
+
+    rcb->dec_state        = DEC_IDLE;
+    rcb->carry_len        = 0;
+    rcb->last_sample_rate = 0;
+    rcb->last_channels    = 0;
+    return true;
+}
+
+/*
+ * Open this receiver's WebSocket on ctx, with the current frequency and
+ * output rate baked into the URL.  rcb is passed as ci.userdata so the
+ * callback can retrieve it via lws_wsi_user() without needing the context
+ * user pointer — which is what lets one context carry all receivers.
+ */
+static struct lws *ws_connect_rcb(struct lws_context *ctx, struct rcvr_cb *rcb,
+                                  const char *host, int port, int use_ssl)
+{
+    char full_path[512];
+    int rate_khz = rcb->output_rate / 1000;
+    if (rate_khz > 192) rate_khz = 192;
+    if (mcb.ubersdr_password[0]) {
+        snprintf(full_path, sizeof(full_path),
+                 "/ws?frequency=%d&mode=iq%d&user_session_id=%s&password=%s&version=2",
+                 rcb->curr_freq, rate_khz, rcb->session_id,
+                 mcb.ubersdr_password);
+    } else {
+        snprintf(full_path, sizeof(full_path),
+                 "/ws?frequency=%d&mode=iq%d&user_session_id=%s&version=2",
+                 rcb->curr_freq, rate_khz, rcb->session_id);
+    }
+
+    struct lws_client_connect_info ci = {0};
+    ci.context        = ctx;
+    ci.address        = host;
+    ci.port           = port;
+    ci.path           = full_path;
+    ci.host           = host;
+    ci.origin         = host;
+    ci.protocol       = ws_protocols[0].name;
+    ci.userdata       = rcb;
+    ci.ssl_connection = use_ssl ? (LCCSCF_USE_SSL |
+                                   LCCSCF_ALLOW_SELFSIGNED |
+                                   LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK) : 0;
+
+    t_print("ws_thread(%d): calling lws_client_connect_via_info (rate=%d kHz, path=%s)\n",
+            rcb->rcvr_num, rcb->output_rate / 1000, full_path);
+    struct lws *wsi = lws_client_connect_via_info(&ci);
+    if (!wsi)
+        t_print("ws_thread(%d): lws_client_connect_via_info failed\n", rcb->rcvr_num);
+    else
+        t_print("ws_thread(%d): lws_client_connect_via_info succeeded\n", rcb->rcvr_num);
+    return wsi;
+}
+
+/* Pin the calling thread to one core (cpu < 0 leaves it unpinned) */
+static void pin_thread(int cpu, const char *name)
+{
+    if (cpu < 0)
+        return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0)
+        t_print("%s: cannot pin to CPU %d: %s\n", name, cpu, strerror(rc));
+    else if (mcb.debug)
+        t_print("%s: pinned to CPU %d\n", name, cpu);
+}
+
 /*
  * ws_thread — one per receiver.
  *
  * Connects to ubersdr via WebSocket, receives PCM-zstd frames,
- * decodes them, and feeds iqSamples[] for rx_thread to consume.
+ * decodes them, and packs DDC packets for rx_thread to send.
  * Handles reconnection when reconnect_needed is set (e.g. rate change).
  *
  * Each thread has its own lws_context so lws_service() is never called
@@ -928,66 +1139,15 @@ void *ws_thread(void *arg)
 {
     struct rcvr_cb *rcb = (struct rcvr_cb *)arg;
 
-    rcb->iqSample_offset = rcb->iqSamples_remaining = 0;
-    rcb->last_sample_rate = 0;
-    rcb->last_channels    = 0;
-    rcb->wsi_closed       = 0;
-
-    /* Allocate a ZSTD decompression context for this receiver */
-    rcb->zstd_dctx = ZSTD_createDCtx();
-    if (!rcb->zstd_dctx) {
-        t_print("ws_thread(%d): ZSTD_createDCtx failed\n", rcb->rcvr_num);
-        pthread_exit(NULL);
-    }
+    rcb->wsi_closed = 0;
 
     t_print("ws_thread(%d): starting, url=%s\n", rcb->rcvr_num, mcb.ubersdr_url);
+    pin_thread(mcb.ws_cpu, "ws_thread");
 
     /* --- Parse host/port/ssl from the URL once (URL never changes) --- */
     char host[256] = {0};
-    int  port = 80;
-    int  use_ssl = 0;
-    {
-        const char *url = mcb.ubersdr_url;
-        if (strncmp(url, "https://", 8) == 0) {
-            use_ssl = 1;
-            port = 443;
-            url += 8;
-        } else if (strncmp(url, "http://", 7) == 0) {
-            url += 7;
-        } else if (strncmp(url, "wss://", 6) == 0) {
-            use_ssl = 1;
-            port = 443;
-            url += 6;
-        } else if (strncmp(url, "ws://", 5) == 0) {
-            url += 5;
-        }
-
-        const char *slash = strchr(url, '/');
-        const char *colon = strchr(url, ':');
-        if (slash && colon && colon < slash) {
-            size_t hlen = colon - url;
-            if (hlen >= sizeof(host)) hlen = sizeof(host) - 1;
-            memcpy(host, url, hlen);
-            host[hlen] = '\0';
-            port = atoi(colon + 1);
-        } else if (colon && (!slash || colon < slash)) {
-            size_t hlen = colon - url;
-            if (hlen >= sizeof(host)) hlen = sizeof(host) - 1;
-            memcpy(host, url, hlen);
-            host[hlen] = '\0';
-            port = atoi(colon + 1);
-        } else if (slash) {
-            size_t hlen = slash - url;
-            if (hlen >= sizeof(host)) hlen = sizeof(host) - 1;
-            memcpy(host, url, hlen);
-            host[hlen] = '\0';
-        } else {
-            size_t ulen = strlen(url);
-            if (ulen >= sizeof(host)) ulen = sizeof(host) - 1;
-            memcpy(host, url, ulen);
-            host[ulen] = '\0';
-        }
-    }
+    int  port, use_ssl;
+    parse_ubersdr_url(host, sizeof(host), &port, &use_ssl);
 
     /* --- Create the lws context once for the lifetime of this thread.
      * Serialise with lws_ctx_create_mutex to prevent concurrent
@@ -1003,8 +1163,6 @@ void *ws_thread(void *arg)
 
     if (!ctx) {
         t_print("ws_thread(%d): lws_create_context failed\n", rcb->rcvr_num);
-        ZSTD_freeDCtx(rcb->zstd_dctx);
-        rcb->zstd_dctx = NULL;
         pthread_exit(NULL);
     }
 
@@ -1048,48 +1206,16 @@ void *ws_thread(void *arg)
             continue;
         }
 
-        /* --- Step 2: build the WebSocket path with query string --- */
-        char full_path[512];
-        {
-            int rate_khz = rcb->output_rate / 1000;
-            if (rate_khz > 192) rate_khz = 192;
-            if (mcb.ubersdr_password[0]) {
-                snprintf(full_path, sizeof(full_path),
-                         "/ws?frequency=%d&mode=iq%d&user_session_id=%s&password=%s&version=2",
-                         rcb->curr_freq, rate_khz, rcb->session_id,
-                         mcb.ubersdr_password);
-            } else {
-                snprintf(full_path, sizeof(full_path),
-                         "/ws?frequency=%d&mode=iq%d&user_session_id=%s&version=2",
-                         rcb->curr_freq, rate_khz, rcb->session_id);
-            }
+        /* --- Step 2: connect via WebSocket with the mode in the URL --- */
+        if (!rcvr_prepare(rcb)) {
+            sleep(2);
+            continue;
         }
-
-        /* --- Step 3: connect via WebSocket.
-         * Pass rcb as ci.userdata so the callback can retrieve it via
-         * lws_wsi_user() without needing the context user pointer. --- */
-        struct lws_client_connect_info ci = {0};
-        ci.context        = ctx;
-        ci.address        = host;
-        ci.port           = port;
-        ci.path           = full_path;
-        ci.host           = host;
-        ci.origin         = host;
-        ci.protocol       = ws_protocols[0].name;
-        ci.userdata       = rcb;
-        ci.ssl_connection = use_ssl ? (LCCSCF_USE_SSL |
-                                       LCCSCF_ALLOW_SELFSIGNED |
-                                       LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK) : 0;
-
-        t_print("ws_thread(%d): calling lws_client_connect_via_info (rate=%d kHz, path=%s)\n",
-                rcb->rcvr_num, rcb->output_rate / 1000, full_path);
-        struct lws *wsi = lws_client_connect_via_info(&ci);
+        struct lws *wsi = ws_connect_rcb(ctx, rcb, host, port, use_ssl);
         if (!wsi) {
-            t_print("ws_thread(%d): lws_client_connect_via_info failed\n", rcb->rcvr_num);
             sleep(2);
             continue;
         }
-        t_print("ws_thread(%d): lws_client_connect_via_info succeeded\n", rcb->rcvr_num);
 
         t_print("ws_thread(%d): entering service loop\n", rcb->rcvr_num);
 
@@ -1166,6 +1292,209 @@ void *ws_thread(void *arg)
     pthread_exit(NULL);
 }
 
+/* Per-receiver connection states for ws_loop_thread */
+enum { WS_IDLE = 0, WS_CHECKING, WS_OPEN, WS_CLOSING };
+
+/* ws_loop_thread retry backoff: doubles on each failed attempt, back to the
+ * minimum once a connection is established */
+#define WS_RETRY_MIN_MS 1000
+#define WS_RETRY_MAX_MS 30000
+
+static void ws_retry_in(struct rcvr_cb *rcb, const struct timespec *now, int ms)
+{
+    rcb->ws_retry_at = *now;
+    rcb->ws_retry_at.tv_sec += ms / 1000;
+    rcb->ws_retry_at.tv_nsec += (ms % 1000) * 1000000L;
+    if (rcb->ws_retry_at.tv_nsec >= 1000000000L) {
+        rcb->ws_retry_at.tv_sec++;
+        rcb->ws_retry_at.tv_nsec -= 1000000000L;
+    }
+}
+
+/* Schedule the next attempt after a failure and grow the backoff */
+static int ws_backoff(struct rcvr_cb *rcb, const struct timespec *now)
+{
+    int ms = rcb->ws_retry_ms ? rcb->ws_retry_ms : WS_RETRY_MIN_MS;
+
+    ws_retry_in(rcb, now, ms);
+    rcb->ws_retry_ms = ms * 2 > WS_RETRY_MAX_MS ? WS_RETRY_MAX_MS : ms * 2;
+    return ms;
+}
+
+static bool ws_retry_due(const struct rcvr_cb *rcb, const struct timespec *now)
+{
+    return now->tv_sec > rcb->ws_retry_at.tv_sec ||
+           (now->tv_sec == rcb->ws_retry_at.tv_sec && now->tv_nsec >= rcb->ws_retry_at.tv_nsec);
+}
+
+/*
+ * ws_loop_thread — --single-loop alternative to one ws_thread per receiver.
+ *
+ * One lws_context and one service loop carry every receiver's WebSocket;
+ * each wsi gets its rcvr_cb as user data, so ws_callback is unchanged.
+ * Each receiver is a small state machine stepped once per lws_service()
+ * pass:
+ *   WS_IDLE      DDC enabled and retry time reached → start permission check
+ *   WS_CHECKING  curl /connection running without blocking (read via poll)
+ *   WS_OPEN      streaming; disable or reconnect_needed → kill the wsi
+ *   WS_CLOSING   waiting for ws_callback to report the wsi closed
+ * A reconnect kills one wsi instead of rebuilding a context, so a
+ * reconnect storm costs one context creation in total, not one per DDC.
+ */
+static void *ws_loop_thread(void *arg)
+{
+    (void)arg;
+    char host[256] = {0};
+    int port, use_ssl, i;
+
+    parse_ubersdr_url(host, sizeof(host), &port, &use_ssl);
+    pin_thread(mcb.ws_cpu, "ws_loop_thread");
+
+    for (i = 0; i < mcb.num_rxs; i++) {
+        struct rcvr_cb *rcb = &mcb.rcb[i];
+        rcb->wsi_closed = 0;
+        rcb->wsi = NULL;
+        rcb->ws_state = WS_IDLE;
+        rcb->ws_retry_ms = 0;
+        rcb->check_fp = NULL;
+    }
+
+    struct lws_context_creation_info ctx_info = {0};
+    ctx_info.port      = CONTEXT_PORT_NO_LISTEN;
+    ctx_info.protocols = ws_protocols;
+    ctx_info.options   = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+
+    struct lws_context *ctx = lws_create_context(&ctx_info);
+    if (!ctx) {
+        t_print("ws_loop_thread: lws_create_context failed\n");
+        return NULL;
+    }
+
+    t_print("ws_loop_thread: starting, %d receivers, url=%s\n", mcb.num_rxs, mcb.ubersdr_url);
+
+    while (!do_exit) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        for (i = 0; i < mcb.num_rxs; i++) {
+            struct rcvr_cb *rcb = &mcb.rcb[i];
+            int enabled = ddcenable[i];
+
+            switch (rcb->ws_state) {
+            case WS_IDLE:
+                if (!enabled || !ws_retry_due(rcb, &now))
+                    break;
+                /* Fresh UUID on every attempt — see ws_thread() */
+                generate_uuid(rcb->session_id);
+                {
+                    char cmd[2048];
+                    connection_check_cmd(mcb.ubersdr_url, rcb, cmd, sizeof(cmd),
+                                         rcb->check_url, sizeof(rcb->check_url));
+                    rcb->check_fp = popen(cmd, "r");
+                }
+                rcb->check_len = 0;
+                if (rcb->check_fp) {
+                    int fd = fileno(rcb->check_fp);
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                    rcb->ws_state = WS_CHECKING;
+                    break;
+                }
+                t_print("ws_loop_thread(%d): connection check popen failed, continuing\n", i);
+                rcb->check_resp[0] = '\0';
+                goto connect;
+
+            case WS_CHECKING: {
+                size_t room = sizeof(rcb->check_resp) - 1 - rcb->check_len;
+                ssize_t n = read(fileno(rcb->check_fp), rcb->check_resp + rcb->check_len,
+                                 room ? room : 1);
+                if (n < 0 && (errno == EAGAIN || errno == EINTR))
+                    break;
+                if (n > 0) {
+                    if (room) rcb->check_len += n;
+                    break;
+                }
+                /* EOF (or error): curl is done */
+                pclose(rcb->check_fp);
+                rcb->check_fp = NULL;
+                rcb->check_resp[rcb->check_len] = '\0';
+                if (!connection_check_result(rcb, rcb->check_resp, rcb->check_len,
+                                             rcb->check_url)) {
+                    rcb->ws_state = WS_IDLE;
+                    t_print("ws_loop_thread(%d): connection not allowed, retrying in %d ms\n",
+                            i, ws_backoff(rcb, &now));
+                    break;
+                }
+            }
+            /* fall through */
+            connect:
+                if (!enabled) {
+                    rcb->ws_state = WS_IDLE;
+                    break;
+                }
+                /* The URL is built from the current output_rate, so any
+                 * reconnect request made before this point is satisfied */
+                rcb->reconnect_needed = 0;
+                rcb->wsi_closed = 0;
+                rcb->wsi = rcvr_prepare(rcb) ?
+                           ws_connect_rcb(ctx, rcb, host, port, use_ssl) : NULL;
+                if (!rcb->wsi) {
+                    rcb->ws_state = WS_IDLE;
+                    ws_backoff(rcb, &now);
+                    break;
+                }
+                rcb->ws_state = WS_OPEN;
+                break;
+
+            case WS_OPEN:
+                if (rcb->wsi_closed) {
+                    rcb->wsi = NULL;
+                    rcb->ws_state = WS_IDLE;
+                    t_print("ws_loop_thread(%d): wsi closed, reconnecting in %d ms\n",
+                            i, ws_backoff(rcb, &now));
+                    break;
+                }
+                if (!enabled || rcb->reconnect_needed) {
+                    t_print("ws_loop_thread(%d): %s, closing wsi (rate=%d kHz)\n", i,
+                            enabled ? "reconnect needed" : "DDC disabled",
+                            rcb->output_rate / 1000);
+                    lws_set_timeout(rcb->wsi, PENDING_TIMEOUT_CLOSE_SEND, LWS_TO_KILL_ASYNC);
+                    rcb->ws_state = WS_CLOSING;
+                    break;
+                }
+                if (rcb->new_freq != 0)
+                    lws_callback_on_writable(rcb->wsi);
+                break;
+
+            case WS_CLOSING:
+                /* Closed on purpose, so no backoff */
+                if (rcb->wsi_closed) {
+                    rcb->wsi = NULL;
+                    rcb->ws_state = WS_IDLE;
+                    ws_retry_in(rcb, &now, WS_RETRY_MIN_MS);
+                }
+                break;
+            }
+        }
+
+        /* Short timeout so permission checks and state changes are picked up
+         * promptly even when no WebSocket is carrying traffic */
+        if (lws_service(ctx, 20) < 0) {
+            t_print("ws_loop_thread: lws_service failed\n");
+            break;
+        }
+    }
+
+    lws_context_destroy(ctx);
+    for (i = 0; i < mcb.num_rxs; i++) {
+        if (mcb.rcb[i].check_fp)
+            pclose(mcb.rcb[i].check_fp);
+        ZSTD_freeDCtx(mcb.rcb[i].zstd_dctx);
+        mcb.rcb[i].zstd_dctx = NULL;
+    }
+    t_print("ws_loop_thread: exiting\n");
+    return NULL;
+}
+
 int find_net(char *find)
 {
     DIR* dir;
@@ -1261,6 +1590,10 @@ int main (int argc, char *argv[])
     mcb.num_rxs = MAX_RCVRS;
     mcb.wideband = false;
     mcb.device_type = HERMES_LITE;
+    mcb.send_batch = 8;
+    mcb.gso = 0;
+    mcb.single_loop = 0;
+    mcb.ws_cpu = mcb.tx_cpu = -1;
     strcpy(mcb.ubersdr_url, "http://localhost:8080");
 
     /* --callsign / --discover state */
@@ -1274,6 +1607,10 @@ int main (int argc, char *argv[])
         {"receivers",  required_argument, 0, 'n'},
         {"device",     required_argument, 0, 'd'},
         {"wideband",   no_argument,       0, 'w'},
+        {"send-batch", required_argument, 0, 'b'},
+        {"gso",        no_argument,       0, 'g'},
+        {"single-loop", no_argument,      0, 'S'},
+        {"pin",        required_argument, 0, 'P'},
         {"debug",      no_argument,       0, 'v'},
         {"discover",   no_argument,       0, 'D'},
         {"callsign",   required_argument, 0, 'c'},
@@ -1282,7 +1619,7 @@ int main (int argc, char *argv[])
     };
 
     int opt_index = 0;
-    while((CmdOption = getopt_long(argc, argv, "u:p:i:n:d:wvDc:h", long_options, &opt_index)) != -1) {
+    while((CmdOption = getopt_long(argc, argv, "u:p:i:n:d:wb:gSP:vDc:h", long_options, &opt_index)) != -1) {
         switch(CmdOption) {
         case 'h':
             printf("Usage: %s [options]\n\n", basename(argv[0]));
@@ -1297,6 +1634,12 @@ int main (int argc, char *argv[])
             printf("  --receivers N      Number of receiver slices (default %d, max %d)\n", MAX_RCVRS, MAX_RCVRS);
             printf("  --device N         Device type: 1=Hermes, 6=HermesLite (default 6)\n");
             printf("  --wideband         Enable wideband data (default disabled)\n");
+            printf("  --send-batch N     Max UDP datagrams per send syscall, 1 = one sendto\n");
+            printf("                     per packet (default 8, max %d)\n", MAX_SEND_BATCH);
+            printf("  --gso              Send batches with UDP GSO (UDP_SEGMENT, Linux >= 4.18)\n");
+            printf("  --single-loop      Serve all receivers' WebSockets from one thread\n");
+            printf("  --pin WS[,TX]      Pin the WebSocket thread(s) to core WS and the UDP\n");
+            printf("                     sender threads to core TX (default TX = WS)\n");
             printf("  --debug            Log per-DDC frequency requests from the client\n");
             printf("\n");
             printf("Examples:\n");
@@ -1326,6 +1669,23 @@ int main (int argc, char *argv[])
         case 'w':
             mcb.wideband = 1;
             break;
+        case 'b':
+            mcb.send_batch = atoi(optarg);
+            if (mcb.send_batch < 1) mcb.send_batch = 1;
+            if (mcb.send_batch > MAX_SEND_BATCH) mcb.send_batch = MAX_SEND_BATCH;
+            break;
+        case 'g':
+            mcb.gso = 1;
+            break;
+        case 'S':
+            mcb.single_loop = 1;
+            break;
+        case 'P': {
+            char *comma = strchr(optarg, ',');
+            mcb.ws_cpu = atoi(optarg);
+            mcb.tx_cpu = comma ? atoi(comma + 1) : mcb.ws_cpu;
+            break;
+        }
         case 'v':
             mcb.debug = 1;
             break;
@@ -1477,11 +1837,6 @@ int main (int argc, char *argv[])
     sigaction (SIGQUIT, &sigact, NULL);
     sigaction (SIGPIPE, &sigact, NULL);
 
-    pthread_mutex_init (&send_lock, NULL);
-    pthread_cond_init (&send_cond, NULL);
-    pthread_mutex_init (&done_send_lock, NULL);
-    pthread_cond_init (&done_send_cond, NULL);
-
     for (i = 0; i < mcb.num_rxs; i++) {
         mcb.rcb[i].mcb = &mcb;
         mcb.rcb[i].new_freq = 0;
@@ -1492,14 +1847,27 @@ int main (int argc, char *argv[])
         mcb.rcb[i].reconnect_needed = 0;
         mcb.rcb[i].rcvr_mask = 1 << i;
 
+        atomic_init(&mcb.rcb[i].txq.head, 0);
+        atomic_init(&mcb.rcb[i].txq.tail, 0);
+        atomic_init(&mcb.rcb[i].txq.waiting, 0);
+        mcb.rcb[i].txq.dropped = 0;
+        pthread_mutex_init(&mcb.rcb[i].txq.wake_lock, NULL);
+        pthread_cond_init(&mcb.rcb[i].txq.wake_cond, NULL);
+
         /* Generate a unique session ID for this receiver */
         generate_uuid(mcb.rcb[i].session_id);
 
-        if (pthread_create(&ws_thread_id[i], NULL, ws_thread, &mcb.rcb[i]) < 0) {
+        if (!mcb.single_loop &&
+            pthread_create(&ws_thread_id[i], NULL, ws_thread, &mcb.rcb[i]) < 0) {
             t_perror("***** ERROR: Create ws_thread");
         }
     }
 
+    if (mcb.single_loop &&
+        pthread_create(&ws_thread_id[0], NULL, ws_loop_thread, NULL) < 0) {
+        t_perror("***** ERROR: Create ws_loop_thread");
+    }
+
     t_print("Waiting on Discovery...\n");
 
     while (!do_exit) {
@@ -1607,19 +1975,154 @@ void t_perror(const char *string)
     t_print("%s: %s\n", string, strerror(errno));
 }
 
-void load_packet (struct rcvr_cb *rcb)
+/* Unpark rx_thread if it is waiting on an empty queue */
+static void txq_wake(struct rcvr_cb *rcb)
 {
-    float complex *out_buf = &rcb->iqSamples[rcb->iqSample_offset];
-    int i, j, IQData;
-    int k = rcb->rcvr_num;
+    if (atomic_load(&rcb->txq.waiting)) {
+        pthread_mutex_lock(&rcb->txq.wake_lock);
+        pthread_cond_signal(&rcb->txq.wake_cond);
+        pthread_mutex_unlock(&rcb->txq.wake_lock);
+    }
+}
 
-    pthread_mutex_lock (&done_send_lock);
-    while (!(done_send_flags & rcb->rcvr_mask) && running
-           && ddcenable[rcb->rcvr_num]) {
-        pthread_cond_wait (&done_send_cond, &done_send_lock);
+static void txq_wake_all(void)
+{
+    for (int i = 0; i < mcb.num_rxs; i++)
+        txq_wake(&mcb.rcb[i]);
+}
+
+/*
+ * Send `count` datagrams of `len` bytes each, laid out back to back at
+ * `base`, using as few syscalls as the send mode allows:
+ *   --gso            one sendmsg() with UDP_SEGMENT per up to send_batch
+ *   --send-batch N   one sendmmsg() per up to N datagrams
+ *   --send-batch 1   one sendto() per datagram
+ * Datagrams go out in order, so sequence numbers stamped by the caller
+ * reach the client unchanged.  If the kernel rejects UDP_SEGMENT, GSO is
+ * switched off for the rest of the run and sendmmsg() is used instead.
+ * Returns the number of datagrams sent, or -1 if the first one failed.
+ */
+static int udp_send_batch(int sock, const unsigned char *base, size_t len,
+                          int count, const struct sockaddr_in *to)
+{
+    static atomic_int gso_failed = 0;
+    int batch = mcb.send_batch;
+    int sent = 0;
+
+    while (sent < count) {
+        int n = count - sent;
+        const unsigned char *p = base + (size_t)sent * len;
+
+        if (batch <= 1) {
+            if (sendto(sock, p, len, 0, (const struct sockaddr *)to, sizeof(*to)) < 0)
+                return sent ? sent : -1;
+            sent++;
+            continue;
+        }
+        if (n > batch) n = batch;
+
+        if (mcb.gso && !atomic_load_explicit(&gso_failed, memory_order_relaxed) && n > 1) {
+            /* a GSO super-datagram must stay below the 64 KiB IP limit */
+            if ((size_t)n * len > 65000) n = (int)(65000 / len);
+            char ctrl[CMSG_SPACE(sizeof(uint16_t))] = {0};
+            struct iovec iov = { .iov_base = (void *)p, .iov_len = (size_t)n * len };
+            struct msghdr msg = {
+                .msg_name = (void *)to, .msg_namelen = sizeof(*to),
+                .msg_iov = &iov, .msg_iovlen = 1,
+                .msg_control = ctrl, .msg_controllen = sizeof(ctrl),
+            };
+            struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+            cm->cmsg_level = IPPROTO_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            *(uint16_t *)CMSG_DATA(cm) = (uint16_t)len;
+
+            if (sendmsg(sock, &msg, 0) >= 0) {
+                sent += n;
+                continue;
+            }
+            if (errno != EINVAL && errno != ENOPROTOOPT && errno != EIO && errno != EOPNOTSUPP)
+                return sent ? sent : -1;
+            t_perror("UDP GSO unavailable, falling back to sendmmsg");
+            atomic_store(&gso_failed, 1);
+        }
+
+        struct mmsghdr msgs[MAX_SEND_BATCH];
+        struct iovec iovs[MAX_SEND_BATCH];
+        memset(msgs, 0, sizeof(msgs[0]) * n);
+        for (int k = 0; k < n; k++) {
+            iovs[k].iov_base = (void *)(p + (size_t)k * len);
+            iovs[k].iov_len = len;
+            msgs[k].msg_hdr.msg_name = (void *)to;
+            msgs[k].msg_hdr.msg_namelen = sizeof(*to);
+            msgs[k].msg_hdr.msg_iov = &iovs[k];
+            msgs[k].msg_hdr.msg_iovlen = 1;
+        }
+        int rc = sendmmsg(sock, msgs, n, 0);
+        if (rc <= 0)
+            return sent ? sent : -1;
+        sent += rc;
+    }
+    return sent;
+}
+
+/*
+ * Scale n wire samples (big-endian int16 I/Q) by k and pack them as P2
+ * 24-bit big-endian pairs, imaginary part first.  Truncates like the
+ * float path it replaces, (int)(x * k), so the output is unchanged.
+ */
+static inline void iq_be16_to_p2_be24(const uint8_t *src, unsigned char *dst, int n, float k)
+{
+    int i;
+
+    for (i = 0; i < n; i++, src += 4, dst += 6) {
+        int re = (int)((float)(int16_t)(((uint16_t)src[0] << 8) | src[1]) * k);
+        int im = (int)((float)(int16_t)(((uint16_t)src[2] << 8) | src[3]) * k);
+        dst[0] = im >> 16;
+        dst[1] = im >> 8;
+        dst[2] = im & 0xff;
+        dst[3] = re >> 16;
+        dst[4] = re >> 8;
+        dst[5] = re & 0xff;
+    }
+}
+
+/*
+ * Build one DDC datagram from 238 wire-format samples at pcm straight
+ * into a free slot of this receiver's packet queue: byte swap, scale and
+ * 24-bit packing happen in one pass.  Runs on the ws_thread and never
+ * blocks: if rx_thread has fallen a whole queue behind, the packet is
+ * dropped (and counted) rather than stalling the WebSocket.
+ */
+void load_packet (struct rcvr_cb *rcb, const uint8_t *pcm)
+{
+    struct ddc_txq *q = &rcb->txq;
+
+    if (!running || !ddcenable[rcb->rcvr_num])
+        return;
+
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (head - tail > q->mask) {
+        if ((q->dropped++ % 1000) == 0)
+            t_print("load_packet(%d): rx_thread behind, %u packets dropped\n",
+                    rcb->rcvr_num, q->dropped);
+        return;
     }
-    done_send_flags &= ~rcb->rcvr_mask;
-    pthread_mutex_unlock (&done_send_lock);
+
+    /*
+     * P2 DDC IQ packet header (16 bytes):
+     *   0-3   sequence number (big-endian, stamped by rx_thread)
+     *   4-11  timestamp (unused, zero)
+     *   12-13 bits per sample (16-bit BE = 24)
+     *   14-15 samples per frame (16-bit BE = 238)
+     */
+    unsigned char *pkt = q->pkt[head & q->mask];
+    memset(pkt, 0, 12);
+    pkt[12] = 0;
+    pkt[13] = 24;
+    pkt[14] = 0;
+    pkt[15] = DDC_SAMPLES_PER_PKT;
 
     /*
      * P2 wire order is I first, then Q (3 bytes each, big-endian).
@@ -1631,21 +2134,13 @@ void load_packet (struct rcvr_cb *rcb)
      * wire is equivalent to conjugation and un-mirrors the spectrum, so
      * the imaginary part deliberately goes first here.
      */
-    for (i = 0, j = 0; i < 238; i++, j+=6) {
-        IQData = (int)cimagf(out_buf[i]);
-        pbuf[k][j] = IQData >> 16;
-        pbuf[k][j+1] = IQData >> 8;
-        pbuf[k][j+2] = IQData & 0xff;
-        IQData = (int)crealf(out_buf[i]);
-        pbuf[k][j+3] = IQData >> 16;
-        pbuf[k][j+4] = IQData >> 8;
-        pbuf[k][j+5] = IQData & 0xff;
-    }
-
-    pthread_mutex_lock (&send_lock);
-    send_flags |= rcb->rcvr_mask;
-    pthread_cond_broadcast (&send_cond);
-    pthread_mutex_unlock (&send_lock);
+    iq_be16_to_p2_be24(pcm, pkt + DDC_HDR_LEN, DDC_SAMPLES_PER_PKT,
+                       rcb->scale / 32768.0f);
+
+    /* seq_cst store pairs with rx_thread's store to `waiting` before it
+     * re-checks the queue, so a wakeup can never be lost */
+    atomic_store(&q->head, head + 1);
+    txq_wake(rcb);
 }
 
 void new_protocol_general_packet(unsigned char *buffer)
@@ -1802,14 +2297,9 @@ void *highprio_thread(void *data)
                         rxrate[i] = 0;
                         rxfreq[i] = 0;
                     }
-                    /* Wake any thread blocked on the send handshake so it
-                     * can observe running == 0 and park itself. */
-                    pthread_mutex_lock (&send_lock);
-                    pthread_cond_broadcast (&send_cond);
-                    pthread_mutex_unlock (&send_lock);
-                    pthread_mutex_lock (&done_send_lock);
-                    pthread_cond_broadcast (&done_send_cond);
-                    pthread_mutex_unlock (&done_send_lock);
+                    /* Wake any parked rx_thread so it can observe
+                     * running == 0 and drop its queued packets. */
+                    txq_wake_all();
                 }
             }
             continue;
@@ -1888,14 +2378,9 @@ void *highprio_thread(void *data)
                     rxrate[i] = 0;
                     rxfreq[i] = 0;
                 }
-                /* Wake any thread blocked on the send handshake so it
-                 * can observe running == 0 and park itself. */
-                pthread_mutex_lock (&send_lock);
-                pthread_cond_broadcast (&send_cond);
-                pthread_mutex_unlock (&send_lock);
-                pthread_mutex_lock (&done_send_lock);
-                pthread_cond_broadcast (&done_send_cond);
-                pthread_mutex_unlock (&done_send_lock);
+                /* Wake any parked rx_thread so it can observe
+                 * running == 0 and drop its queued packets. */
+                txq_wake_all();
             } else {
                 // running just went 1 — reset packet counter, watchdog arms after 100 packets
                 hp_watchdog_armed = 0;
@@ -2049,21 +2534,8 @@ void *ddc_specific_thread(void *data)
                 modified = 1;
                 ddcenable[i] = rc;
                 mcb.rcb[i].rcvr_mask = 1 << i;
-                if (ddcenable[i]) {
-                    pthread_mutex_lock (&send_lock);
-                    send_flags |= 1 << i;
-                    pthread_cond_broadcast (&send_cond);
-                    pthread_mutex_unlock (&send_lock);
-                } else {
-                    /* Disable: wake anything blocked on the handshake so
-                     * neither rx_thread nor load_packet() wedges. */
-                    pthread_mutex_lock (&send_lock);
-                    pthread_cond_broadcast (&send_cond);
-                    pthread_mutex_unlock (&send_lock);
-                    pthread_mutex_lock (&done_send_lock);
-                    pthread_cond_broadcast (&done_send_cond);
-                    pthread_mutex_unlock (&done_send_lock);
-                }
+                /* Either way, let a parked rx_thread re-check its state */
+                txq_wake(&mcb.rcb[i]);
             }
 
             if (modified) {
@@ -2207,19 +2679,19 @@ void *rx_thread(void *data)
     int sock;
     struct sockaddr_in addr;
     unsigned long seqnum;
-    unsigned char rx_buffer[1444];
+    struct ddc_txq *q;
     int myddc;
     int yes = 1;
-    unsigned char *p;
     struct rcvr_cb *rcb;
 
     myddc = (int) (uintptr_t) data;
-    rcb = &mcb.rcb[myddc];
-
     if (myddc < 0 || myddc >= mcb.num_rxs) {
         return NULL;
     }
 
+    rcb = &mcb.rcb[myddc];
+    q = &rcb->txq;
+
     seqnum = 0;
 
     sock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -2242,63 +2714,62 @@ void *rx_thread(void *data)
     }
 
     t_print("Starting rx_thread(%d)\n", myddc);
+    pin_thread(mcb.tx_cpu, "rx_thread");
     while (!do_exit) {
-        if (!gen_rcvd || ddcenable[myddc] <= 0 || rxrate[myddc] == 0 || rxfreq[myddc] == 0
-            || addr_new.sin_port == 0) {
+        unsigned int tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+        if (!gen_rcvd || !running || ddcenable[myddc] <= 0 || rxrate[myddc] == 0
+            || rxfreq[myddc] == 0 || addr_new.sin_port == 0) {
+            /* Idle: discard anything queued so a restart begins fresh */
+            atomic_store_explicit(&q->tail, atomic_load_explicit(&q->head, memory_order_acquire),
+                                  memory_order_release);
             usleep(50000);
             seqnum = 0;
             continue;
         }
 
-        /*
-         * P2 DDC IQ packet header (16 bytes):
-         *   0-3   sequence number (big-endian)
-         *   4-11  timestamp (unused, zero)
-         *   12-13 bits per sample (16-bit BE = 24)
-         *   14-15 samples per frame (16-bit BE = 238)
-         */
-        p = rx_buffer;
-        *(uint32_t*)p = htonl(seqnum++);
-        p += 4;
-
-        memset(p, 0, 8);   // no time stamps
-        p += 8;
-
-        *p++ = 0;          // bits per sample, high byte
-        *p++ = 24;         // bits per sample, low byte
-        *p++ = 0;          // samples per frame, high byte
-        *p++ = 238;        // samples per frame, low byte
-
-        pthread_mutex_lock (&send_lock);
-
-        while (!(send_flags & rcb->rcvr_mask) && running && ddcenable[myddc]) {
-            pthread_cond_wait (&send_cond, &send_lock);
-        }
-        send_flags &= ~rcb->rcvr_mask;
-        pthread_mutex_unlock (&send_lock);
-
-        if (!running || !ddcenable[myddc]) {
-            /* Woken by stop/disable — don't send; release any blocked
-             * load_packet() and go back to the idle check. */
-            pthread_mutex_lock (&done_send_lock);
-            done_send_flags |= rcb->rcvr_mask;
-            pthread_cond_broadcast (&done_send_cond);
-            pthread_mutex_unlock (&done_send_lock);
+        if (atomic_load_explicit(&q->head, memory_order_acquire) == tail) {
+            /* Queue empty: park until load_packet() signals.  The timeout
+             * bounds how long a stop/disable can go unnoticed. */
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += 50 * 1000000L;
+            if (ts.tv_nsec >= 1000000000L) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            pthread_mutex_lock(&q->wake_lock);
+            atomic_store(&q->waiting, 1);
+            while (atomic_load(&q->head) == tail && running && ddcenable[myddc] && !do_exit) {
+                if (pthread_cond_timedwait(&q->wake_cond, &q->wake_lock, &ts) == ETIMEDOUT)
+                    break;
+            }
+            atomic_store(&q->waiting, 0);
+            pthread_mutex_unlock(&q->wake_lock);
             continue;
         }
 
-        memcpy(p, &pbuf[myddc][0], 1428); // I-Q data
+        /*
+         * Send everything queued, up to one batch, as long as it is
+         * contiguous in the queue (a wrap simply ends the batch).  The
+         * packets were produced at the stream rate, so batching only
+         * collapses the syscalls, not the pacing.
+         */
+        int n = (int)(atomic_load_explicit(&q->head, memory_order_acquire) - tail);
+        unsigned int slot = tail & q->mask;     /* pkt/mask read after head */
+        if (n > mcb.send_batch) n = mcb.send_batch;
+        if (n > (int)(q->mask + 1 - slot)) n = q->mask + 1 - slot;
+
+        for (int k = 0; k < n; k++)
+            *(uint32_t*)q->pkt[slot + k] = htonl(seqnum++);
 
-        if (sendto(sock, rx_buffer, 1444, 0, (struct sockaddr * )&addr_new, sizeof(addr_new)) < 0) {
+        if (udp_send_batch(sock, q->pkt[slot], DDC_PKT_LEN, n, &addr_new) < n) {
             /* Transient send errors must not kill the DDC stream — the
              * thread is only respawned on a run 0->1 transition. */
             t_perror("***** ERROR: RX thread sendto");
         }
 
-        pthread_mutex_lock (&done_send_lock);
-        done_send_flags |= rcb->rcvr_mask;
-        pthread_cond_broadcast (&done_send_cond);
-        pthread_mutex_unlock (&done_send_lock);
+        atomic_store_explicit(&q->tail, tail + n, memory_order_release);
 
         if (rcb->new_freq) {
             /* ws_thread picks up new_freq and sends a JSON tune message */
@@ -2316,79 +2787,145 @@ void *rx_thread(void *data)
 
 #define BIN_SAMPLE_CNT 32768
 
+/*
+ * Map the wideband shared-memory segment (layout in wideband_shm.h).
+ * Returns NULL if it does not exist yet or does not look like ours.
+ */
+static struct wb_shm *wb_shm_map(void)
+{
+    struct stat st;
+    struct wb_shm *shm;
+    int fd = shm_open(WB_SHM_NAME, O_RDONLY, 0);
+
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)WB_SHM_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    shm = mmap(NULL, WB_SHM_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED)
+        return NULL;
+
+    if (shm->magic != WB_SHM_MAGIC || shm->version != WB_SHM_VERSION
+        || shm->header_size != WB_SHM_HEADER_SIZE || shm->sweep_bytes != WB_SHM_SWEEP_BYTES) {
+        t_print("wb_thread: /dev/shm%s has an unknown layout, ignoring it\n", WB_SHM_NAME);
+        munmap(shm, WB_SHM_SIZE);
+        return NULL;
+    }
+    t_print("wb_thread: using wideband segment /dev/shm%s\n", WB_SHM_NAME);
+    return shm;
+}
+
+/*
+ * Legacy source: a plain 32768-byte file rewritten by the ka9q-radio
+ * wideband patch.  It has no change notification, so the caller paces
+ * itself and may resend a sweep.
+ */
+static bool wb_read_legacy(uint8_t *samples)
+{
+    FILE *bfile = fopen("/dev/shm/rx888wb.bin", "rb");
+    size_t bytes_read;
+
+    if (bfile == NULL)
+        return false;
+    bytes_read = fread(samples, 1, BIN_SAMPLE_CNT, bfile);
+    fclose(bfile);
+    return bytes_read == BIN_SAMPLE_CNT;
+}
+
 void *wb_thread(void *data)
 {
     // NOTE: this thread reuses the hp_sock socket since two sockets
     //       can't send/recv on the same port/address (1027)
     unsigned long seqnum = 0;
-    unsigned char wb_buffer[1028];
+    /* one sweep of packets, back to back: 4-byte seqnum + up to 512 samples
+     * each, so a whole sweep can go out in a few batched sends */
+    static unsigned char wb_buffer[BIN_SAMPLE_CNT + (16384 / 64) * 4];
     uint8_t samples[BIN_SAMPLE_CNT];
     unsigned char *p;
     int i, j;
-    FILE *bfile;
-    char *filename = "/dev/shm/rx888wb.bin";
-    size_t bytes_read;
+    struct wb_shm *shm = NULL;
+    unsigned int last_seq = 0;
+    struct timespec now, last_fresh = {0}, last_map_try = {0};
+    int wb_warned = 0;
 
     t_print("Starting wb_thread()\n");
+    pin_thread(mcb.tx_cpu, "wb_thread");
     while (!do_exit) {
         if (!gen_rcvd || !running || !wbenable) {
             usleep(50000);
             continue;
         }
 
-        bfile = fopen(filename, "rb");
-        if (bfile != NULL) {
-            bytes_read = fread(samples, 1, BIN_SAMPLE_CNT, bfile);
-            if (bytes_read != 32768) {
-                //t_print("%s, bytes_read:%ld bytes_wanted:%d\n",
-                //       __FUNCTION__, bytes_read, BIN_SAMPLE_CNT);
-                fclose(bfile);
-                continue; // skip it and continue
-            }
-            seqnum = 0; // reset per frame
-            fclose(bfile);
+        clock_gettime(CLOCK_MONOTONIC, &now);
 
-            /*
-             * Honor the wideband packet length negotiated in the General
-             * packet (byte 24-25, samples per packet; default 512).
-             * Clamp to what fits our fixed buffer and divides the sweep.
-             */
-            int wlen = wide_len;
-            if (wlen < 64 || wlen > 512 || (16384 % wlen) != 0) wlen = 512;
-            int npkts = 16384 / wlen;      /* 16384 16-bit samples per sweep */
-            int dbytes = wlen * 2;
-
-            // frame
-            for (i = 0; i < npkts; i++) {
-                // update seq number
-                p = wb_buffer;
-                *(uint32_t*)p = htonl(seqnum++);
-                p += 4;
-
-                // packet
-                for (j = 0; j < dbytes; j+=2) { //swap bytes
-                    wb_buffer[j+5] = samples[j + (i * dbytes)];
-                    wb_buffer[j+4] = samples[j + 1 + (i * dbytes)];
-                }
+        /* (Re)map the segment at most once a second while it is absent */
+        if (shm == NULL && now.tv_sec != last_map_try.tv_sec) {
+            last_map_try = now;
+            shm = wb_shm_map();
+            last_fresh = now;
+        }
 
-                if (sendto(hp_sock, wb_buffer, dbytes + 4, 0,
-                           (struct sockaddr * )&addr_new, sizeof(addr_new)) < 0) {
-                    t_perror("***** ERROR: WB thread sendto");
-                    break;
+        if (shm != NULL) {
+            if (!wb_shm_read(shm, samples, &last_seq)) {
+                /* No new sweep.  If none arrives for 2 s the producer may
+                 * have recreated the segment — drop the mapping and retry. */
+                if (now.tv_sec - last_fresh.tv_sec > 2) {
+                    munmap(shm, WB_SHM_SIZE);
+                    shm = NULL;
+                    last_seq = 0;
                 }
+                usleep(5000);
+                continue;
             }
-            usleep(66000);
-        } else {
-            static int wb_warned = 0;
+            last_fresh = now;
+        } else if (!wb_read_legacy(samples)) {
             if (!wb_warned) {
-                t_print("%s() filename: %s does not exist (will keep retrying)\n",
-                        __FUNCTION__, filename);
+                t_print("%s() no wideband source: /dev/shm%s or /dev/shm/rx888wb.bin (will keep retrying)\n",
+                        __FUNCTION__, WB_SHM_NAME);
                 wb_warned = 1;
             }
             usleep(1000000);
+            continue;
         }
+        seqnum = 0; // reset per frame
+
+        /*
+         * Honor the wideband packet length negotiated in the General
+         * packet (byte 24-25, samples per packet; default 512).
+         * Clamp to what fits our fixed buffer and divides the sweep.
+         */
+        int wlen = wide_len;
+        if (wlen < 64 || wlen > 512 || (16384 % wlen) != 0) wlen = 512;
+        int npkts = 16384 / wlen;      /* 16384 16-bit samples per sweep */
+        int dbytes = wlen * 2;
+
+        // frame
+        for (i = 0; i < npkts; i++) {
+            // update seq number
+            p = wb_buffer + i * (dbytes + 4);
+            *(uint32_t*)p = htonl(seqnum++);
+
+            // packet
+            for (j = 0; j < dbytes; j+=2) { //swap bytes
+                p[j+5] = samples[j + (i * dbytes)];
+                p[j+4] = samples[j + 1 + (i * dbytes)];
+            }
+        }
+
+        if (udp_send_batch(hp_sock, wb_buffer, dbytes + 4, npkts, &addr_new) < npkts) {
+            t_perror("***** ERROR: WB thread sendto");
+        }
+
+        /* The segment paces us via seq, capped so a fast producer cannot
+         * make this loop spin; the legacy file does not pace us at all */
+        usleep(shm != NULL ? WB_SHM_MIN_INTERVAL_MS * 1000 : 66000);
     }
 
+    if (shm != NULL)
+        munmap(shm, WB_SHM_SIZE);
     t_print("Ending wb_thread()\n");
     return NULL;
 }
@@ -2426,6 +2963,7 @@ void *mic_thread(void *data)
         close(sock);
         return NULL;
     }
+    pin_thread(mcb.tx_cpu, "mic_thread");
 
     memset(mic_buffer, 0, 132);
     clock_gettime(CLOCK_MONOTONIC, &delay);
@@ -33,6 +33,7 @@
 #include <fcntl.h>
 #include <math.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <termios.h>
 #include <libgen.h>
 #include <signal.h>
@@ -42,6 +43,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
 #include <net/if.h>
 #include <netdb.h>
@@ -69,23 +71,51 @@
 #define PCM_FULL_HEADER_SIZE    37
 #define PCM_MINIMAL_HEADER_SIZE 13
 
-/* WebSocket receive buffer — large enough for a full iq192 frame */
-#define WS_RX_BUF_SIZE (128 * 1024)
+/*
+ * lws receive buffer per connection.  Frames larger than this arrive in
+ * several callbacks and are decoded as a stream, so it need not hold a
+ * whole iq192 frame.
+ */
+#define WS_RX_CHUNK_SIZE (16 * 1024)
+
+/* P2 DDC IQ datagram: 16-byte header + 238 samples of 24-bit I and Q */
+#define DDC_SAMPLES_PER_PKT 238
+#define DDC_HDR_LEN         16
+#define DDC_PKT_LEN         (DDC_HDR_LEN + DDC_SAMPLES_PER_PKT * 6)
+#define DDC_PCM_LEN         (DDC_SAMPLES_PER_PKT * 4)  /* wire int16 I/Q per packet */
+
+/*
+ * zstd output window: decoded PCM is packed into DDC packets from here,
+ * so a packet goes out as soon as its samples are decoded rather than
+ * after the whole frame.
+ */
+#define PCM_DEC_WIN_SIZE (2 * DDC_PCM_LEN)
 
 /*
- * IQ accumulation buffer, in complex samples.
- * Must hold the largest possible decoded PCM frame (WS_RX_BUF_SIZE / 4
- * bytes-per-complex-sample = 32768 samples) plus up to one HPSDR packet
- * (238 samples) of leftover from the previous frame, so that a frame can
- * be appended at any fill level without overflow or truncation.
+ * Depth of each DDC's packet queue at 192 kHz (power of two).  32 packets
+ * is ~40 ms, enough to ride out a ws_thread burst without blocking it.
+ * Slower rates get a proportionally shorter queue, down to DDC_TXQ_MIN.
  */
-#define IQ_RING_SAMPLES ((WS_RX_BUF_SIZE / 4) + 256)
+#define DDC_TXQ_DEPTH 32
+#define DDC_TXQ_MIN   8
+
+/* Upper bound for --send-batch (datagrams per sendmmsg / GSO send) */
+#define MAX_SEND_BATCH 64
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103         /* linux/udp.h, kernel >= 4.18 */
+#endif
 
 struct main_cb {
     int wideband;
     int debug;
     int num_rxs;
     int device_type;            /* 1=Hermes, 6=HermesLite (default 6) */
+    int send_batch;             /* max datagrams per send syscall (1 = sendto) */
+    int gso;                    /* use UDP_SEGMENT for batched sends */
+    int single_loop;            /* one lws context/thread for all receivers */
+    int ws_cpu;                 /* core for the WebSocket thread(s), -1 = any */
+    int tx_cpu;                 /* core for the UDP sender threads, -1 = any */
     char interface[15];
     char ip[16];
     char ubersdr_url[256];      /* e.g. "http://localhost:8080" */
@@ -104,23 +134,66 @@ struct main_cb {
 
         char session_id[37];    /* UUID v4 string */
 
-        /* zstd decompression context — one per receiver */
+        /* zstd stream decoder — one per receiver, created on first connect */
         ZSTD_DCtx *zstd_dctx;
 
+        /* per-message stream decode state, see decode_pcm_chunk() */
+        int dec_state;              /* DEC_IDLE / DEC_HEADER / DEC_PCM / DEC_SKIP */
+        int dec_raw;                /* message is not zstd-compressed */
+        int hdr_len;                /* bytes gathered in hdr[] */
+        uint8_t hdr[PCM_FULL_HEADER_SIZE];
+        uint8_t dec_win[PCM_DEC_WIN_SIZE];
+
         /* last PCM full-header values (reused for minimal-header packets) */
         int last_sample_rate;
         int last_channels;
 
-        /* raw receive buffer for WebSocket frames */
-        uint8_t ws_rx_buf[WS_RX_BUF_SIZE];
-
-        int iqSample_offset;
-        int iqSamples_remaining;
-        float complex iqSamples[IQ_RING_SAMPLES];
+        /* --single-loop connection state, owned by ws_loop_thread */
+        struct lws *wsi;
+        int ws_state;               /* WS_IDLE / WS_CHECKING / WS_OPEN / WS_CLOSING */
+        struct timespec ws_retry_at;
+        int ws_retry_ms;            /* next failure backoff, 0 = WS_RETRY_MIN_MS */
+        FILE *check_fp;             /* in-flight /connection permission check */
+        char check_url[512];
+        char check_resp[512];
+        size_t check_len;
+
+        /*
+         * Wire-format (big-endian int16 I/Q) bytes left over from the last
+         * decoded window, less than one DDC packet's worth.  The next
+         * window tops this up to a packet; whole packets are packed
+         * straight from the window.
+         */
+        int carry_len;              /* bytes in carry[] */
+        uint8_t carry[DDC_PCM_LEN];
+
+        /*
+         * Packet queue between this receiver's ws_thread (producer, via
+         * load_packet) and its rx_thread (consumer).  Lock-free SPSC: head
+         * and tail are free-running counters, each written by one side only.
+         * Slots hold complete DDC datagrams; rx_thread only stamps the
+         * sequence number.  The mutex/cond are used solely to park an idle
+         * rx_thread — the producer takes them only when `waiting` is set.
+         *
+         * The slots are allocated by the ws thread on connect, sized to the
+         * receiver's rate (see txq_alloc()), so disabled DDCs cost nothing.
+         * pkt and mask are only changed while the queue is empty and before
+         * the next head store, which publishes them to rx_thread.
+         */
+        struct ddc_txq {
+            _Alignas(64) atomic_uint head;  /* next slot to fill (producer) */
+            _Alignas(64) atomic_uint tail;  /* next slot to send (consumer) */
+            atomic_int waiting;             /* rx_thread is parked on wake_cond */
+            unsigned int dropped;           /* producer only: lost to a full queue */
+            pthread_mutex_t wake_lock;
+            pthread_cond_t wake_cond;
+            unsigned int mask;              /* depth - 1 */
+            unsigned char (*pkt)[DDC_PKT_LEN];
+        } txq;
     } rcb[MAX_RCVRS];
 };
 
-void load_packet(struct rcvr_cb* rcb);
+void load_packet(struct rcvr_cb* rcb, const uint8_t *pcm);
 void sdr_sighandler(int signum);
 void new_protocol_general_packet(unsigned char *buffer);
 void generate_uuid(char *buf);
@@ -0,0 +1,97 @@
+#ifndef _WIDEBAND_SHM_H
+#define _WIDEBAND_SHM_H
+
+/*
+ * Wideband sweep shared-memory segment.
+ *
+ * A producer (e.g. the rx888 driver in radiod) publishes raw ADC sweeps
+ * here; the bridge's wb_thread maps it once and sends each new sweep to
+ * the HPSDR client as wideband packets.
+ *
+ * Location: POSIX shm object WB_SHM_NAME, i.e. /dev/shm/rx888wb.shm.
+ * Size:     WB_SHM_SIZE bytes (header + one sweep).
+ *
+ * Layout (all fields host byte order, the segment is host-local):
+ *
+ *   offset  size  field
+ *   0       4     magic        WB_SHM_MAGIC ("WBS1")
+ *   4       4     version      WB_SHM_VERSION
+ *   8       4     header_size  offset of the sweep data (64)
+ *   12      4     sweep_bytes  bytes of sweep data (32768)
+ *   16      4     seq          seqlock counter, see below
+ *   20      4     sample_rate  ADC rate in Hz, informational (0 = unknown)
+ *   24      40    reserved     zero
+ *   64      32768 data         16384 signed 16-bit little-endian ADC samples
+ *
+ * seq is a seqlock: the producer makes it odd before touching data and
+ * even again once the sweep is complete (wb_shm_write_begin/_end below).
+ * A reader copies data only while seq is even and unchanged across the
+ * copy, so it never sends a torn sweep, and sends a sweep only when seq
+ * differs from the last one sent, so it never repeats a stale one.
+ *
+ * The reader sends at most one sweep per WB_SHM_MIN_INTERVAL_MS however
+ * fast seq moves; a producer may publish faster, the extra sweeps are
+ * simply skipped.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define WB_SHM_NAME        "/rx888wb.shm"
+#define WB_SHM_MAGIC       0x31534257u     /* "WBS1" */
+#define WB_SHM_VERSION     1
+#define WB_SHM_HEADER_SIZE 64
+#define WB_SHM_SWEEP_BYTES 32768
+#define WB_SHM_SIZE        (WB_SHM_HEADER_SIZE + WB_SHM_SWEEP_BYTES)
+
+#define WB_SHM_MIN_INTERVAL_MS 20   /* reader's minimum gap between sweeps */
+
+struct wb_shm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t sweep_bytes;
+    atomic_uint seq;
+    uint32_t sample_rate;
+    uint8_t reserved[WB_SHM_HEADER_SIZE - 24];
+    uint8_t data[WB_SHM_SWEEP_BYTES];
+};
+
+_Static_assert(sizeof(struct wb_shm) == WB_SHM_SIZE, "wb_shm layout");
+
+/* Producer: call before writing data[] */
+static inline void wb_shm_write_begin(struct wb_shm *shm)
+{
+    atomic_fetch_add_explicit(&shm->seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/* Producer: call once data[] holds a complete sweep */
+static inline void wb_shm_write_end(struct wb_shm *shm)
+{
+    atomic_fetch_add_explicit(&shm->seq, 1, memory_order_release);
+}
+
+/*
+ * Reader: copy the current sweep into out[WB_SHM_SWEEP_BYTES] if it is
+ * complete and newer than *last_seq.  Returns 1 and updates *last_seq on
+ * success, 0 if there is nothing new or the producer is mid-write.
+ */
+static inline int wb_shm_read(const struct wb_shm *shm, uint8_t *out, unsigned int *last_seq)
+{
+    unsigned int s1 = atomic_load_explicit((atomic_uint *)&shm->seq, memory_order_acquire);
+    if ((s1 & 1) || s1 == *last_seq)
+        return 0;
+
+    memcpy(out, shm->data, WB_SHM_SWEEP_BYTES);
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit((atomic_uint *)&shm->seq, memory_order_relaxed) != s1)
+        return 0;
+
+    *last_seq = s1;
+    return 1;
+}
+
+#endif // _WIDEBAND_SHM_H
@@ -20,7 +20,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <queue>
+#include <future>
 #include <atomic>
 #include <chrono>
 #include <cstring>
@@ -33,6 +33,8 @@
 #include <curl/curl.h>
 #include <zstd.h>
 
+#include "../common/iq_convert.h"
+
 // Base64 decoding
 static const std::string base64_chars = 
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
@@ -113,6 +115,415 @@ typedef websocketpp::config::asio_tls_client::message_type::ptr tls_message_ptr;
 typedef websocketpp::config::asio_client::message_type::ptr plain_message_ptr;
 typedef websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context> context_ptr;
 
+// Little-endian header fields
+static inline uint32_t le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t le64(const uint8_t *p)
+{
+    return (uint64_t)le32(p) | ((uint64_t)le32(p + 4) << 32);
+}
+
+// PCM binary frame headers (see pcm_binary.go and decode_pcm_frame in ka9q_hpsdr.c)
+#define PCM_MAGIC_FULL          0x5043  // "PC"
+#define PCM_MAGIC_MINIMAL       0x504D  // "PM"
+#define PCM_FULL_HEADER_SIZE_V1 29
+#define PCM_FULL_HEADER_SIZE_V2 37      // adds baseband power and noise density
+#define PCM_MINIMAL_HEADER_SIZE 13
+
+// Stream-decompress up to len bytes of the current zstd frame into dst.
+// Returns the number of bytes produced, which is only short of len at the
+// end of the frame or on error; err is set to the zstd error code, or 0.
+static size_t zstdRead(ZSTD_DCtx *dctx, ZSTD_inBuffer &in, void *dst, size_t len, size_t &err)
+{
+    ZSTD_outBuffer out = { dst, len, 0 };
+    err = 0;
+    while (out.pos < out.size) {
+        size_t inPos = in.pos, outPos = out.pos;
+        size_t ret = ZSTD_decompressStream(dctx, &out, &in);
+        if (ZSTD_isError(ret)) {
+            err = ret;
+            break;
+        }
+        if (ret == 0 || (in.pos == inPos && out.pos == outPos))
+            break;  // frame complete, or no input left to make progress with
+    }
+    return out.pos;
+}
+
+/***********************************************************************
+ * Sample pool
+ *
+ * A slab of NUM_SLOTS buffers of SLOT_ELEMS stream elements, allocated once
+ * when the stream is set up and recycled as a single-producer/single-consumer
+ * ring: the WebSocket thread decodes each frame straight into the slot at
+ * _head and publishes it, readStream() or a direct-access client consumes
+ * slots from _readSlot and hands them back, which advances _tail.
+ *
+ * Each slot carries the time of its first element and the duration of one
+ * element, so reads starting mid-slot get an exact timestamp, and a gap
+ * flag marking that data before it was lost.  Reads never cross a gap, so
+ * every buffer handed out is contiguous in time.  Each slot also carries
+ * the rate epoch it was produced in, so slots queued before an in-place
+ * sample rate switch can be dropped instead of read at the wrong rate.
+ *
+ * Slots may be released out of order (SoapySDR allows several acquired
+ * direct-access buffers at once); _tail only moves over released slots.
+ * The consumer only takes the mutex when the ring is empty, and the
+ * producer only takes it when the consumer is actually waiting.
+ *
+ * Only the consumer moves _readSlot and _tail, so a disconnect, which can
+ * race a readStream() on another thread, does not empty the ring itself:
+ * requestDiscard() bumps a counter, and the consumer drops everything
+ * readable the next time it waits for data.
+ **********************************************************************/
+class SampleRing
+{
+public:
+    static const size_t NUM_SLOTS = 64;     // must be a power of two
+    static const size_t SLOT_ELEMS = 8192;  // stream elements per slot
+
+    SampleRing(void) : _elemSize(0), _head(0), _tail(0), _waiting(false),
+                       _discardReq(0), _readSlot(0), _readOffset(0), _discardSeen(0),
+                       _overflows(0) {}
+
+    // (Re)allocate for elements of elemSize bytes; nothing may be running on the ring
+    void allocate(size_t elemSize)
+    {
+        if (elemSize != _elemSize || _slab.empty()) {
+            _elemSize = elemSize;
+            _slab.assign(NUM_SLOTS * SLOT_ELEMS * elemSize, 0);
+        }
+        reset();
+    }
+
+    // Drop everything; the producer must be stopped
+    void reset(void)
+    {
+        for (size_t i = 0; i < NUM_SLOTS; i++) {
+            _slots[i].numElems = 0;
+            _slots[i].timeNs = 0;
+            _slots[i].nsPerElem = 0.0;
+            _slots[i].gap = false;
+            _slots[i].epoch = 0;
+            _slots[i].released = false;
+        }
+        _readSlot = 0;
+        _readOffset = 0;
+        _tail.store(0, std::memory_order_relaxed);
+        _head.store(0, std::memory_order_release);
+    }
+
+    size_t elemSize(void) const { return _elemSize; }
+    size_t overflows(void) const { return _overflows.load(std::memory_order_relaxed); }
+
+    void *slotAddr(size_t handle)
+    {
+        return _slab.data() + (handle & (NUM_SLOTS - 1)) * SLOT_ELEMS * _elemSize;
+    }
+
+    /*******************************************************************
+     * Producer side (WebSocket thread)
+     ******************************************************************/
+
+    // Next free slot to decode into, or nullptr if the consumer has fallen behind
+    void *beginWrite(void)
+    {
+        size_t h = _head.load(std::memory_order_relaxed);
+        if (_slab.empty() || h - _tail.load(std::memory_order_acquire) >= NUM_SLOTS) {
+            _overflows.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return slotAddr(h);
+    }
+
+    // Publish the slot returned by beginWrite() holding numElems elements, the
+    // first at timeNs, each nsPerElem long; gap marks data lost before it and
+    // epoch is the rate epoch the data was produced in
+    void endWrite(size_t numElems, long long timeNs, double nsPerElem, bool gap, unsigned epoch)
+    {
+        size_t h = _head.load(std::memory_order_relaxed);
+        Slot &meta = _slots[h & (NUM_SLOTS - 1)];
+        meta.numElems = numElems;
+        meta.timeNs = timeNs;
+        meta.nsPerElem = nsPerElem;
+        meta.gap = gap;
+        meta.epoch = epoch;
+        _head.store(h + 1, std::memory_order_seq_cst);
+
+        // Pairs with the seq_cst store of _waiting in waitReadable()
+        if (_waiting.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _cv.notify_one();
+        }
+    }
+
+    /*******************************************************************
+     * Consumer side (readStream / direct access)
+     ******************************************************************/
+
+    // Wait until a slot is readable; false on timeout or once running goes false
+    bool waitReadable(long timeoutUs, const std::atomic<bool> &running)
+    {
+        if (_discardReq.load(std::memory_order_acquire) != _discardSeen)
+            discard();
+
+        if (readable())
+            return true;
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeoutUs);
+        std::unique_lock<std::mutex> lock(_mutex);
+        _waiting.store(true, std::memory_order_seq_cst);
+        while (!readable() && running) {
+            if (_cv.wait_until(lock, deadline) == std::cv_status::timeout)
+                break;
+        }
+        _waiting.store(false, std::memory_order_relaxed);
+        return readable();
+    }
+
+    // Have the consumer drop everything readable before its next wait; safe
+    // from any thread, with the consumer running or not
+    void requestDiscard(void)
+    {
+        _discardReq.fetch_add(1, std::memory_order_release);
+    }
+
+    // Kick a blocked waitReadable(), e.g. when the stream is deactivated
+    void wake(void)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _cv.notify_all();
+    }
+
+    // If the next readable slot follows lost data, clear its gap flag and
+    // return true, so the caller reports the loss exactly once
+    bool takeGap(void)
+    {
+        if (!readable())
+            return false;
+        Slot &meta = _slots[_readSlot & (NUM_SLOTS - 1)];
+        if (!meta.gap)
+            return false;
+        meta.gap = false;
+        return true;
+    }
+
+    // Time of the next element to be read (only valid while readable())
+    long long readTimeNs(void) const
+    {
+        const Slot &meta = _slots[_readSlot & (NUM_SLOTS - 1)];
+        return meta.timeNs + (long long)(_readOffset * meta.nsPerElem);
+    }
+
+    // Elements readable right now without crossing a gap, counting no further than max
+    size_t readableElems(size_t max) const
+    {
+        size_t h = _head.load(std::memory_order_acquire);
+        size_t n = 0;
+        for (size_t slot = _readSlot; slot != h && n < max; slot++) {
+            const Slot &meta = _slots[slot & (NUM_SLOTS - 1)];
+            if (slot != _readSlot && meta.gap)
+                break;
+            n += meta.numElems - (slot == _readSlot ? _readOffset : 0);
+        }
+        return std::min(n, max);
+    }
+
+    // Copy up to numElems elements from the readable slots into dst, stopping
+    // early at a gap; atGap is set when the next readable slot follows a gap
+    size_t read(void *dst, size_t numElems, bool &atGap)
+    {
+        uint8_t *out = static_cast<uint8_t *>(dst);
+        size_t copied = 0;
+
+        while (copied < numElems && readable()) {
+            size_t slot = _readSlot;
+            const Slot &meta = _slots[slot & (NUM_SLOTS - 1)];
+            if (copied > 0 && meta.gap)
+                break;
+            size_t n = std::min(numElems - copied, meta.numElems - _readOffset);
+
+            std::memcpy(out + copied * _elemSize,
+                        static_cast<uint8_t *>(slotAddr(slot)) + _readOffset * _elemSize,
+                        n * _elemSize);
+            copied += n;
+            _readOffset += n;
+
+            if (_readOffset >= meta.numElems) {
+                _readSlot++;
+                _readOffset = 0;
+                release(slot);
+            }
+        }
+        atGap = readable() && _readOffset == 0 && _slots[_readSlot & (NUM_SLOTS - 1)].gap;
+        return copied;
+    }
+
+    // Hand out the rest of the next readable slot without copying; returns
+    // its element count, or 0 if nothing is readable
+    size_t acquire(size_t &handle, const void **buff)
+    {
+        if (!readable())
+            return 0;
+
+        size_t slot = _readSlot;
+        size_t n = _slots[slot & (NUM_SLOTS - 1)].numElems - _readOffset;
+        *buff = static_cast<uint8_t *>(slotAddr(slot)) + _readOffset * _elemSize;
+        handle = slot & (NUM_SLOTS - 1);
+
+        _readSlot++;
+        _readOffset = 0;
+        return n;
+    }
+
+    // Return a consumed slot to the producer
+    void release(size_t handle)
+    {
+        _slots[handle & (NUM_SLOTS - 1)].released = true;
+
+        size_t t = _tail.load(std::memory_order_relaxed);
+        while (t != _readSlot && _slots[t & (NUM_SLOTS - 1)].released) {
+            _slots[t & (NUM_SLOTS - 1)].released = false;
+            t++;
+        }
+        _tail.store(t, std::memory_order_release);
+    }
+
+    // Drop readable slots from a rate epoch other than epoch (queued before a
+    // sample rate switch); true if any were dropped
+    bool discardStale(unsigned epoch)
+    {
+        bool dropped = false;
+        while (readable() && _slots[_readSlot & (NUM_SLOTS - 1)].epoch != epoch) {
+            size_t slot = _readSlot++;
+            _readOffset = 0;
+            release(slot);
+            dropped = true;
+        }
+        return dropped;
+    }
+
+    // Drop everything readable while the producer keeps running (consumer
+    // side; from another thread use requestDiscard())
+    void discard(void)
+    {
+        _discardSeen = _discardReq.load(std::memory_order_acquire);
+        size_t h = _head.load(std::memory_order_acquire);
+        for (size_t s = _tail.load(std::memory_order_relaxed); s != h; s++)
+            _slots[s & (NUM_SLOTS - 1)].released = false;
+        _readSlot = h;
+        _readOffset = 0;
+        _tail.store(h, std::memory_order_release);
+    }
+
+private:
+    struct Slot {
+        // Written by the producer before _head is published
+        size_t numElems;
+        long long timeNs;   // time of the first element
+        double nsPerElem;   // duration of one element
+        bool gap;           // data was lost before this slot (cleared by takeGap)
+        unsigned epoch;     // rate epoch the data was produced in
+        bool released;      // consumer only
+    };
+
+    bool readable(void) const
+    {
+        return _readSlot != _head.load(std::memory_order_acquire);
+    }
+
+    std::vector<uint8_t> _slab;
+    size_t _elemSize;
+    Slot _slots[NUM_SLOTS];
+
+    // Producer and consumer indices on separate cache lines (padding rather
+    // than alignas, which C++11 operator new does not honour)
+    char _pad0[64];
+    std::atomic<size_t> _head;  // next slot the producer fills
+    char _pad1[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> _tail;  // oldest slot not yet released
+    char _pad2[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<bool> _waiting;  // consumer is parked on _cv
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::atomic<unsigned> _discardReq;  // bumped by requestDiscard()
+
+    // Consumer only
+    size_t _readSlot;    // next slot to read or acquire
+    size_t _readOffset;  // elements of _readSlot already copied out by read()
+    unsigned _discardSeen;  // last _discardReq acted on
+
+    std::atomic<size_t> _overflows;  // frames (or parts) dropped because the ring was full
+};
+
+const size_t SampleRing::NUM_SLOTS;
+const size_t SampleRing::SLOT_ELEMS;
+
+/***********************************************************************
+ * Channels and streams
+ *
+ * Each RX channel is its own UberSDR session (own user_session_id, own
+ * WebSocket connection, own frequency and mode) decoding into its own
+ * sample pool.  All sessions share the device's single websocketpp
+ * endpoint, so one io thread and one ping thread serve every channel.
+ * A stream owns the channels passed to setupStream; a channel belongs to
+ * at most one stream at a time.
+ **********************************************************************/
+struct UberStream;
+
+struct UberChannel
+{
+    UberChannel(void) : frequency(14074000), sampleRate(96000), stream(nullptr),
+                        cs16(false), active(false), connected(false), readyToConsume(false),
+                        generation(0), headerRate(0), anchored(false), anchorNs(0),
+                        anchorSamples(0), anchorNsPerSample(0.0), dropped(false),
+                        rateEpoch(0), frameEpoch(0), switchRate(0),
+                        zstd(ZSTD_createDCtx()) {}
+    ~UberChannel(void) { ZSTD_freeDCtx(zstd); }
+
+    std::string sessionID;
+    std::string mode;
+    uint64_t frequency;
+    double sampleRate;
+
+    UberStream *stream;                  // owning stream, or nullptr
+    bool cs16;                           // pool holds CS16 rather than CF32
+    SampleRing ring;
+
+    websocketpp::connection_hdl hdl;     // guarded by SoapyUberSDR::_wsMutex
+    std::atomic<bool> active;            // frames are accepted into the pool
+    std::atomic<bool> connected;         // WebSocket open
+    std::atomic<bool> readyToConsume;    // stream activated, overflow is worth a warning
+    std::atomic<unsigned> generation;    // bumped per connection attempt
+
+    // Frame decode state, WebSocket thread only (timeline reset on connect)
+    uint32_t headerRate;                 // sample rate from the last full header
+    bool anchored;                       // anchorNs is valid
+    long long anchorNs;                  // header time the timeline is anchored on
+    uint64_t anchorSamples;              // samples received since the anchor
+    double anchorNsPerSample;
+    bool dropped;                        // samples dropped since the last slot written
+
+    // In-place sample rate switching: setSampleRate() bumps rateEpoch, the
+    // WebSocket thread moves frameEpoch up once frames arrive at switchRate
+    std::atomic<unsigned> rateEpoch;     // rate the consumer wants
+    std::atomic<unsigned> frameEpoch;    // rate the frames being decoded are at
+    std::atomic<uint32_t> switchRate;    // sample rate of the latest switch
+    ZSTD_DCtx *zstd;                     // reused for every frame
+};
+
+struct UberStream
+{
+    UberStream(void) : active(false) {}
+
+    std::vector<size_t> channels;
+    std::string format;
+    std::atomic<bool> active;
+};
+
 /***********************************************************************
  * Device implementation
  **********************************************************************/
@@ -163,6 +574,18 @@ public:
         long long &timeNs,
         const long timeoutUs = 100000);
 
+    // Direct buffer access API
+    size_t getNumDirectAccessBuffers(SoapySDR::Stream *stream);
+    int getDirectAccessBufferAddrs(SoapySDR::Stream *stream, const size_t handle, void **buffs);
+    int acquireReadBuffer(
+        SoapySDR::Stream *stream,
+        size_t &handle,
+        const void **buffs,
+        int &flags,
+        long long &timeNs,
+        const long timeoutUs = 100000);
+    void releaseReadBuffer(SoapySDR::Stream *stream, const size_t handle);
+
     // Antenna API
     std::vector<std::string> listAntennas(const int direction, const size_t channel) const;
     void setAntenna(const int direction, const size_t channel, const std::string &name);
@@ -194,57 +617,61 @@ public:
     std::vector<double> listBandwidths(const int direction, const size_t channel) const;
     SoapySDR::RangeList getBandwidthRange(const int direction, const size_t channel) const;
 
+    // Time API
+    bool hasHardwareTime(const std::string &what = "") const;
+    long long getHardwareTime(const std::string &what = "") const;
+
     // Sensor API
     std::vector<std::string> listSensors(void) const;
     std::string readSensor(const std::string &key) const;
+    std::vector<std::string> listSensors(const int direction, const size_t channel) const;
+    std::string readSensor(const int direction, const size_t channel, const std::string &key) const;
 
 private:
+    static const size_t MAX_CHANNELS = 8;
+
     // Configuration
     std::string _serverURL;
     std::string _password;
-    std::string _userSessionID;
-    std::string _currentMode;
-    uint64_t _currentFrequency;
-    double _sampleRate;
     std::vector<std::string> _allowedIQModes;
     bool _useTLS;
     
-    // WebSocket clients (only one will be used based on protocol)
+    // Per-channel sessions; fixed at construction, so pointers stay valid
+    std::vector<std::unique_ptr<UberChannel>> _channels;
+    
+    // One WebSocket endpoint (only one will be used based on protocol) shared by
+    // every channel's connection and run by a single io thread.
     // Using unique_ptr to allow reconstruction after stop()
     std::unique_ptr<tls_client> _tlsClient;
     std::unique_ptr<plain_client> _plainClient;
-    websocketpp::connection_hdl _wsHandle;
+    std::mutex _wsMutex;  // endpoint calls from API threads and channel handles
     std::thread _wsThread;
     std::thread _pingThread;
-    std::atomic<bool> _streaming;
-    std::atomic<bool> _connected;
-    std::atomic<bool> _readyToConsume;
     std::atomic<bool> _pingStop;
     
-    // I/Q buffer management
-    std::queue<std::vector<std::complex<float>>> _iqBuffers;
-    std::mutex _bufferMutex;
-    std::condition_variable _bufferCV;
-    static const size_t MAX_BUFFER_QUEUE_SIZE = 50; // Limit queue depth to prevent memory bloat
-    
-    // Partial buffer state for handling arbitrary read sizes
-    std::vector<std::complex<float>> _partialBuffer;
-    size_t _partialBufferOffset;
-    
     // Helper functions
+    UberChannel &channel(const size_t channel) const;
     double modeToSampleRate(const std::string &mode) const;
     std::string sampleRateToMode(double rate) const;
-    void handleTLSMessage(websocketpp::connection_hdl hdl, tls_message_ptr msg);
-    void handlePlainMessage(websocketpp::connection_hdl hdl, plain_message_ptr msg);
-    void sendTuneCommand(uint64_t freq, const std::string &mode);
+    void handleMessage(UberChannel &ch, websocketpp::frame::opcode::value opcode, const std::string &payload);
+    void sendText(UberChannel &ch, const std::string &text);
+    void sendTuneCommand(UberChannel &ch);
+    bool switchRateInPlace(UberChannel &ch);
     void sendPingMessage();
     void startPingThread();
     void stopPingThread();
-    bool checkConnectionAllowed();
-    void connectWebSocket();
-    void disconnectWebSocket();
+    bool checkConnectionAllowed(UberChannel &ch);
+    void startWebSocket();
+    void stopWebSocket();
+    void syncWebSocketThread();
+    template <typename Client>
+    void openConnection(Client &client, UberChannel &ch, const std::string &url);
+    void connectWebSocket(UberChannel &ch);
+    void disconnectWebSocket(UberChannel &ch);
 };
 
+const size_t SoapyUberSDR::MAX_CHANNELS;
+
 // Constructor
 SoapyUberSDR::SoapyUberSDR(const SoapySDR::Kwargs &args)
 {
@@ -253,34 +680,53 @@ SoapyUberSDR::SoapyUberSDR(const SoapySDR::Kwargs &args)
     
     _serverURL = args.at("server");
     _password = args.count("password") ? args.at("password") : "";
-    _currentMode = args.count("mode") ? args.at("mode") : "iq96";
-    _currentFrequency = 14074000;
-    _sampleRate = modeToSampleRate(_currentMode);
-    _streaming = false;
-    _connected = false;
-    _readyToConsume = false;
+    std::string mode = args.count("mode") ? args.at("mode") : "iq96";
     _pingStop = false;
-    _userSessionID = generateUUID();
-    _partialBufferOffset = 0;
+    
+    size_t numChannels = 1;
+    if (args.count("channels")) {
+        try {
+            numChannels = std::stoul(args.at("channels"));
+        } catch (const std::exception &) {
+            numChannels = 0;
+        }
+        if (numChannels < 1 || numChannels > MAX_CHANNELS)
+            throw std::runtime_error("SoapyUberSDR: 'channels' must be 1-" + std::to_string(MAX_CHANNELS));
+    }
+    
+    for (size_t i = 0; i < numChannels; i++) {
+        std::unique_ptr<UberChannel> ch(new UberChannel());
+        ch->sessionID = generateUUID();
+        ch->mode = mode;
+        ch->sampleRate = modeToSampleRate(mode);
+        _channels.push_back(std::move(ch));
+    }
     
     // Detect if we should use TLS based on URL protocol
     _useTLS = (_serverURL.find("wss://") == 0);
     
     if (!_password.empty()) {
-        SoapySDR::logf(SOAPY_SDR_INFO, "SoapyUberSDR: Created device for %s mode=%s (with password) [%s]",
-                       _serverURL.c_str(), _currentMode.c_str(), _useTLS ? "TLS" : "Plain");
+        SoapySDR::logf(SOAPY_SDR_INFO, "SoapyUberSDR: Created device for %s mode=%s channels=%zu (with password) [%s]",
+                       _serverURL.c_str(), mode.c_str(), numChannels, _useTLS ? "TLS" : "Plain");
     } else {
-        SoapySDR::logf(SOAPY_SDR_INFO, "SoapyUberSDR: Created device for %s mode=%s [%s]",
-                       _serverURL.c_str(), _currentMode.c_str(), _useTLS ? "TLS" : "Plain");
+        SoapySDR::logf(SOAPY_SDR_INFO, "SoapyUberSDR: Created device for %s mode=%s channels=%zu [%s]",
+                       _serverURL.c_str(), mode.c_str(), numChannels, _useTLS ? "TLS" : "Plain");
     }
 }
 
 // Destructor
 SoapyUberSDR::~SoapyUberSDR()
 {
-    if (_streaming) {
-        deactivateStream(nullptr, 0, 0);
+    // Close any streams the application left open
+    std::set<UberStream *> streams;
+    for (auto &ch : _channels) {
+        if (ch->stream)
+            streams.insert(ch->stream);
     }
+    for (UberStream *stream : streams)
+        closeStream((SoapySDR::Stream *) stream);
+    
+    stopWebSocket();
     SoapySDR::log(SOAPY_SDR_INFO, "SoapyUberSDR: Device destroyed");
 }
 
@@ -293,15 +739,16 @@ SoapySDR::Kwargs SoapyUberSDR::getHardwareInfo(void) const
     SoapySDR::Kwargs info;
     info["origin"] = "https://github.com/madpsy/ka9q_ubersdr";
     info["server"] = _serverURL;
-    info["mode"] = _currentMode;
-    info["bandwidth"] = std::to_string((int)_sampleRate) + " Hz";
+    info["mode"] = _channels[0]->mode;
+    info["bandwidth"] = std::to_string((int)_channels[0]->sampleRate) + " Hz";
+    info["channels"] = std::to_string(_channels.size());
     return info;
 }
 
 // Channels API
 size_t SoapyUberSDR::getNumChannels(const int direction) const
 {
-    return (direction == SOAPY_SDR_RX) ? 1 : 0;
+    return (direction == SOAPY_SDR_RX) ? _channels.size() : 0;
 }
 
 bool SoapyUberSDR::getFullDuplex(const int /*direction*/, const size_t /*channel*/) const
@@ -320,168 +767,250 @@ std::vector<std::string> SoapyUberSDR::getStreamFormats(const int /*direction*/,
 
 std::string SoapyUberSDR::getNativeStreamFormat(const int /*direction*/, const size_t /*channel*/, double &fullScale) const
 {
+    // The server sends 16-bit PCM, so CS16 is passed through without conversion
     fullScale = 32768;
-    return SOAPY_SDR_CF32;
+    return SOAPY_SDR_CS16;
 }
 
 SoapySDR::Stream *SoapyUberSDR::setupStream(
     const int direction,
-    const std::string &/*format*/,
+    const std::string &format,
     const std::vector<size_t> &channels,
     const SoapySDR::Kwargs &/*args*/)
 {
     if (direction != SOAPY_SDR_RX)
         throw std::runtime_error("SoapyUberSDR only supports RX");
     
-    if (channels.size() > 1 || (channels.size() > 0 && channels[0] != 0))
-        throw std::runtime_error("setupStream invalid channel selection");
+    if (format != SOAPY_SDR_CF32 && format != SOAPY_SDR_CS16)
+        throw std::runtime_error("setupStream invalid format '" + format + "' (CF32 or CS16 only)");
+    
+    std::vector<size_t> chans = channels.empty() ? std::vector<size_t>(1, 0) : channels;
+    std::set<size_t> seen;
+    for (size_t c : chans) {
+        if (c >= _channels.size() || !seen.insert(c).second)
+            throw std::runtime_error("setupStream invalid channel selection");
+        if (_channels[c]->stream)
+            throw std::runtime_error("setupStream channel " + std::to_string(c) + " already in use");
+    }
+    
+    UberStream *stream = new UberStream();
+    stream->channels = chans;
+    stream->format = format;
     
-    SoapySDR::log(SOAPY_SDR_INFO, "SoapyUberSDR: Stream setup complete");
-    return (SoapySDR::Stream *) this;
+    // Allocate the sample pools up front so streaming never touches the heap
+    for (size_t c : chans) {
+        UberChannel &ch = *_channels[c];
+        ch.stream = stream;
+        ch.cs16 = (format == SOAPY_SDR_CS16);
+        ch.ring.allocate(ch.cs16 ? sizeof(std::complex<int16_t>) : sizeof(std::complex<float>));
+    }
+    
+    SoapySDR::logf(SOAPY_SDR_INFO, "SoapyUberSDR: Stream setup complete (%s, %zu channel(s))",
+                   format.c_str(), chans.size());
+    return (SoapySDR::Stream *) stream;
 }
 
-void SoapyUberSDR::closeStream(SoapySDR::Stream */*stream*/)
+void SoapyUberSDR::closeStream(SoapySDR::Stream *stream)
 {
+    UberStream *s = (UberStream *) stream;
+    if (s->active)
+        deactivateStream(stream, 0, 0);
+    
+    for (size_t c : s->channels)
+        _channels[c]->stream = nullptr;
+    delete s;
+    
     SoapySDR::log(SOAPY_SDR_INFO, "SoapyUberSDR: Stream closed");
 }
 
 size_t SoapyUberSDR::getStreamMTU(SoapySDR::Stream */*stream*/) const
 {
-    return 2048;
+    return SampleRing::SLOT_ELEMS;
 }
 
 int SoapyUberSDR::activateStream(
-    SoapySDR::Stream */*stream*/,
+    SoapySDR::Stream *stream,
     const int /*flags*/,
     const long long /*timeNs*/,
     const size_t /*numElems*/)
 {
-    if (_streaming)
+    UberStream *s = (UberStream *) stream;
+    if (s->active)
         return SOAPY_SDR_STREAM_ERROR;
     
-    _streaming = true;
-    
     try {
-        connectWebSocket();
+        // Check every session before opening any of them
+        for (size_t c : s->channels) {
+            if (!checkConnectionAllowed(*_channels[c]))
+                throw std::runtime_error("Connection not allowed by server");
+        }
+        
+        startWebSocket();
+        for (size_t c : s->channels)
+            connectWebSocket(*_channels[c]);
+        
+        // Give the sessions a moment to open, as a single connection always had
+        for (int i = 0; i < 50; i++) {
+            bool allConnected = true;
+            for (size_t c : s->channels)
+                allConnected = allConnected && _channels[c]->connected;
+            if (allConnected)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
     } catch (const std::exception &e) {
         SoapySDR::logf(SOAPY_SDR_ERROR, "SoapyUberSDR: Failed to connect: %s", e.what());
-        _streaming = false;
+        for (size_t c : s->channels)
+            disconnectWebSocket(*_channels[c]);
+        stopWebSocket();
         return SOAPY_SDR_STREAM_ERROR;
     }
 
     // Discard any data that arrived during connection setup before the
     // consumer (readStream) was ready, to avoid an immediate buffer overflow.
-    {
-        std::lock_guard<std::mutex> lock(_bufferMutex);
-        while (!_iqBuffers.empty())
-            _iqBuffers.pop();
-        _partialBuffer.clear();
-        _partialBufferOffset = 0;
+    for (size_t c : s->channels) {
+        _channels[c]->ring.discard();
+        _channels[c]->readyToConsume = true;
     }
-    _readyToConsume = true;
+    s->active = true;
 
     SoapySDR::log(SOAPY_SDR_INFO, "SoapyUberSDR: Stream activated");
     return 0;
 }
 
-int SoapyUberSDR::deactivateStream(SoapySDR::Stream */*stream*/, const int /*flags*/, const long long /*timeNs*/)
+int SoapyUberSDR::deactivateStream(SoapySDR::Stream *stream, const int /*flags*/, const long long /*timeNs*/)
 {
-    _streaming = false;
-    _readyToConsume = false;
-    disconnectWebSocket();
-    
-    std::lock_guard<std::mutex> lock(_bufferMutex);
-    while (!_iqBuffers.empty())
-        _iqBuffers.pop();
+    UberStream *s = (UberStream *) stream;
+    s->active = false;
+    for (size_t c : s->channels) {
+        _channels[c]->readyToConsume = false;
+        _channels[c]->ring.wake();
+    }
     
-    // Clear partial buffer state
-    _partialBuffer.clear();
-    _partialBufferOffset = 0;
+    for (size_t c : s->channels)
+        disconnectWebSocket(*_channels[c]);
+    stopWebSocket();
     
     SoapySDR::log(SOAPY_SDR_INFO, "SoapyUberSDR: Stream deactivated");
     return 0;
 }
 
 int SoapyUberSDR::readStream(
-    SoapySDR::Stream */*stream*/,
+    SoapySDR::Stream *stream,
     void * const *buffs,
     const size_t numElems,
     int &flags,
     long long &timeNs,
     const long timeoutUs)
 {
-    std::unique_lock<std::mutex> lock(_bufferMutex);
-    std::complex<float> *outBuff = static_cast<std::complex<float>*>(buffs[0]);
-    size_t totalCopied = 0;
-    
-    auto deadline = std::chrono::steady_clock::now() +
-                   std::chrono::microseconds(timeoutUs);
+    UberStream *s = (UberStream *) stream;
+    flags = 0;
+    timeNs = 0;
     
-    // First, try to consume from partial buffer if available
-    if (_partialBufferOffset < _partialBuffer.size()) {
-        size_t available = _partialBuffer.size() - _partialBufferOffset;
-        size_t toCopy = std::min(numElems, available);
-        
-        std::copy(_partialBuffer.begin() + _partialBufferOffset,
-                  _partialBuffer.begin() + _partialBufferOffset + toCopy,
-                  outBuff);
-        
-        _partialBufferOffset += toCopy;
-        totalCopied += toCopy;
-        
-        // If partial buffer is exhausted, clear it
-        if (_partialBufferOffset >= _partialBuffer.size()) {
-            _partialBuffer.clear();
-            _partialBufferOffset = 0;
-        }
-        
-        // If we've satisfied the request, return now
-        if (totalCopied >= numElems) {
-            flags = 0;
-            timeNs = 0;
-            return totalCopied;
-        }
+    // Wait until every channel has at least one filled slot at its current
+    // rate; slots queued before a sample rate switch are dropped unread
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeoutUs);
+    for (size_t c : s->channels) {
+        SampleRing &ring = _channels[c]->ring;
+        unsigned epoch = _channels[c]->rateEpoch.load(std::memory_order_acquire);
+        do {
+            long remainingUs = (long)std::chrono::duration_cast<std::chrono::microseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (!ring.waitReadable(std::max(remainingUs, 0L), s->active))
+                return s->active ? SOAPY_SDR_TIMEOUT : SOAPY_SDR_STREAM_ERROR;
+        } while (ring.discardStale(epoch));
     }
     
-    // Need more samples - wait for new buffer from queue
-    while (_iqBuffers.empty() && _streaming) {
-        if (_bufferCV.wait_until(lock, deadline) == std::cv_status::timeout) {
-            // Return what we have so far, or timeout if nothing
-            return totalCopied > 0 ? totalCopied : SOAPY_SDR_TIMEOUT;
+    // Report lost data once, before the first samples after it
+    for (size_t c : s->channels) {
+        if (_channels[c]->ring.takeGap()) {
+            SoapySDR::logf(SOAPY_SDR_DEBUG, "SoapyUberSDR: Channel %zu overflow", c);
+            return SOAPY_SDR_OVERFLOW;
         }
     }
     
-    if (!_streaming)
-        return totalCopied > 0 ? totalCopied : SOAPY_SDR_STREAM_ERROR;
+    // Time of the first sample returned, taken from the first channel
+    SampleRing &first = _channels[s->channels[0]]->ring;
+    timeNs = first.readTimeNs();
+    if (timeNs != 0)
+        flags |= SOAPY_SDR_HAS_TIME;
     
-    if (_iqBuffers.empty())
-        return totalCopied > 0 ? totalCopied : SOAPY_SDR_TIMEOUT;
-    
-    // Get next buffer from queue
-    auto &iqData = _iqBuffers.front();
-    size_t remaining = numElems - totalCopied;
-    size_t available = iqData.size();
-    
-    if (remaining >= available) {
-        // Request can consume entire buffer
-        std::copy(iqData.begin(), iqData.end(), outBuff + totalCopied);
-        totalCopied += available;
-        _iqBuffers.pop();
-    } else {
-        // Request needs only part of buffer - save remainder
-        std::copy(iqData.begin(), iqData.begin() + remaining, outBuff + totalCopied);
-        totalCopied += remaining;
-        
-        // Move remaining samples to partial buffer
-        _partialBuffer = std::move(iqData);
-        _partialBufferOffset = remaining;
-        _iqBuffers.pop();
+    // Then copy the same number of samples out of each, so the channel
+    // buffers stay in step; no copy runs past a gap
+    size_t n = numElems;
+    for (size_t c : s->channels)
+        n = _channels[c]->ring.readableElems(n);
+    bool atGap = false;
+    for (size_t i = 0; i < s->channels.size(); i++) {
+        bool chGap;
+        _channels[s->channels[i]]->ring.read(buffs[i], n, chGap);
+        atGap = atGap || chGap;
     }
+    // Data after these samples is missing
+    if (atGap)
+        flags |= SOAPY_SDR_END_ABRUPT;
+    
+    return (int)n;
+}
+
+// Direct buffer access API (single-channel streams only: each channel's
+// pool fills at its own pace, so slots cannot be handed out in step)
+size_t SoapyUberSDR::getNumDirectAccessBuffers(SoapySDR::Stream *stream)
+{
+    UberStream *s = (UberStream *) stream;
+    return s->channels.size() == 1 ? SampleRing::NUM_SLOTS : 0;
+}
+
+int SoapyUberSDR::getDirectAccessBufferAddrs(SoapySDR::Stream *stream, const size_t handle, void **buffs)
+{
+    UberStream *s = (UberStream *) stream;
+    if (s->channels.size() != 1 || handle >= SampleRing::NUM_SLOTS)
+        return SOAPY_SDR_NOT_SUPPORTED;
     
+    buffs[0] = _channels[s->channels[0]]->ring.slotAddr(handle);
+    return 0;
+}
+
+int SoapyUberSDR::acquireReadBuffer(
+    SoapySDR::Stream *stream,
+    size_t &handle,
+    const void **buffs,
+    int &flags,
+    long long &timeNs,
+    const long timeoutUs)
+{
+    UberStream *s = (UberStream *) stream;
     flags = 0;
     timeNs = 0;
     
-    return totalCopied;
+    if (s->channels.size() != 1)
+        return SOAPY_SDR_NOT_SUPPORTED;
+    
+    UberChannel &ch = *_channels[s->channels[0]];
+    SampleRing &ring = ch.ring;
+    unsigned epoch = ch.rateEpoch.load(std::memory_order_acquire);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeoutUs);
+    do {
+        long remainingUs = (long)std::chrono::duration_cast<std::chrono::microseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (!ring.waitReadable(std::max(remainingUs, 0L), s->active))
+            return s->active ? SOAPY_SDR_TIMEOUT : SOAPY_SDR_STREAM_ERROR;
+    } while (ring.discardStale(epoch));
+    
+    if (ring.takeGap())
+        return SOAPY_SDR_OVERFLOW;
+    
+    timeNs = ring.readTimeNs();
+    if (timeNs != 0)
+        flags |= SOAPY_SDR_HAS_TIME;
+    
+    return (int)ring.acquire(handle, buffs);
+}
+
+void SoapyUberSDR::releaseReadBuffer(SoapySDR::Stream *stream, const size_t handle)
+{
+    UberStream *s = (UberStream *) stream;
+    _channels[s->channels[0]]->ring.release(handle);
 }
 
 // Antenna API
@@ -523,22 +1052,24 @@ void SoapyUberSDR::setGainMode(const int /*direction*/, const size_t /*channel*/
 // Frequency API
 void SoapyUberSDR::setFrequency(
     const int /*direction*/,
-    const size_t /*channel*/,
+    const size_t channel,
     const double frequency,
     const SoapySDR::Kwargs &/*args*/)
 {
-    _currentFrequency = (uint64_t)frequency;
+    UberChannel &ch = this->channel(channel);
+    ch.frequency = (uint64_t)frequency;
     
-    if (_streaming && _connected) {
-        sendTuneCommand(_currentFrequency, _currentMode);
+    if (ch.connected) {
+        sendTuneCommand(ch);
     }
     
-    SoapySDR::logf(SOAPY_SDR_DEBUG, "SoapyUberSDR: Frequency set to %llu Hz", _currentFrequency);
+    SoapySDR::logf(SOAPY_SDR_DEBUG, "SoapyUberSDR: Channel %zu frequency set to %llu Hz",
+                   channel, (unsigned long long)ch.frequency);
 }
 
-double SoapyUberSDR::getFrequency(const int /*direction*/, const size_t /*channel*/) const
+double SoapyUberSDR::getFrequency(const int /*direction*/, const size_t channel) const
 {
-    return (double)_currentFrequency;
+    return (double)this->channel(channel).frequency;
 }
 
 std::vector<std::string> SoapyUberSDR::listFrequencies(const int /*direction*/, const size_t /*channel*/) const
@@ -556,27 +1087,33 @@ SoapySDR::RangeList SoapyUberSDR::getFrequencyRange(const int /*direction*/, con
 }
 
 // Sample Rate API
-void SoapyUberSDR::setSampleRate(const int /*direction*/, const size_t /*channel*/, const double rate)
+void SoapyUberSDR::setSampleRate(const int /*direction*/, const size_t channel, const double rate)
 {
+    UberChannel &ch = this->channel(channel);
     std::string newMode = sampleRateToMode(rate);
     
-    if (newMode != _currentMode) {
-        _currentMode = newMode;
-        _sampleRate = modeToSampleRate(newMode);
+    if (newMode != ch.mode) {
+        ch.mode = newMode;
+        ch.sampleRate = modeToSampleRate(newMode);
         
-        if (_streaming) {
-            deactivateStream(nullptr, 0, 0);
-            activateStream(nullptr, 0, 0, 0);
+        // Switch over the existing session; restart the stream this channel
+        // is in only if the server does not confirm the new rate
+        if (ch.stream && ch.stream->active && !switchRateInPlace(ch)) {
+            SoapySDR::logf(SOAPY_SDR_WARNING,
+                "SoapyUberSDR: Channel %zu rate switch not confirmed, restarting stream", channel);
+            SoapySDR::Stream *stream = (SoapySDR::Stream *) ch.stream;
+            deactivateStream(stream, 0, 0);
+            activateStream(stream, 0, 0, 0);
         }
         
-        SoapySDR::logf(SOAPY_SDR_INFO, "SoapyUberSDR: Sample rate set to %.0f Hz (mode=%s)", 
-                       _sampleRate, _currentMode.c_str());
+        SoapySDR::logf(SOAPY_SDR_INFO, "SoapyUberSDR: Channel %zu sample rate set to %.0f Hz (mode=%s)", 
+                       channel, ch.sampleRate, ch.mode.c_str());
     }
 }
 
-double SoapyUberSDR::getSampleRate(const int /*direction*/, const size_t /*channel*/) const
+double SoapyUberSDR::getSampleRate(const int /*direction*/, const size_t channel) const
 {
-    return _sampleRate;
+    return this->channel(channel).sampleRate;
 }
 
 std::vector<double> SoapyUberSDR::listSampleRates(const int /*direction*/, const size_t /*channel*/) const
@@ -600,9 +1137,9 @@ SoapySDR::RangeList SoapyUberSDR::getSampleRateRange(const int /*direction*/, co
 }
 
 // Bandwidth API
-double SoapyUberSDR::getBandwidth(const int /*direction*/, const size_t /*channel*/) const
+double SoapyUberSDR::getBandwidth(const int /*direction*/, const size_t channel) const
 {
-    return _sampleRate;
+    return this->channel(channel).sampleRate;
 }
 
 std::vector<double> SoapyUberSDR::listBandwidths(const int direction, const size_t channel) const
@@ -615,6 +1152,20 @@ SoapySDR::RangeList SoapyUberSDR::getBandwidthRange(const int direction, const s
     return getSampleRateRange(direction, channel);
 }
 
+// Time API
+bool SoapyUberSDR::hasHardwareTime(const std::string &what) const
+{
+    return what.empty();
+}
+
+long long SoapyUberSDR::getHardwareTime(const std::string &/*what*/) const
+{
+    // Stream timestamps are Unix time in ns (GPS-synchronised on the server),
+    // so the local clock is the closest comparable "hardware" time
+    return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
 // Sensor API
 std::vector<std::string> SoapyUberSDR::listSensors(void) const
 {
@@ -627,16 +1178,47 @@ std::vector<std::string> SoapyUberSDR::listSensors(void) const
 
 std::string SoapyUberSDR::readSensor(const std::string &key) const
 {
-    if (key == "connection_status")
-        return _connected ? "connected" : "disconnected";
+    if (key == "connection_status") {
+        // Connected while any channel's session is open
+        for (auto &ch : _channels) {
+            if (ch->connected)
+                return "connected";
+        }
+        return "disconnected";
+    }
     if (key == "server_url")
         return _serverURL;
     if (key == "mode")
-        return _currentMode;
+        return _channels[0]->mode;
+    throw std::runtime_error("Unknown sensor: " + key);
+}
+
+std::vector<std::string> SoapyUberSDR::listSensors(const int /*direction*/, const size_t /*channel*/) const
+{
+    std::vector<std::string> sensors;
+    sensors.push_back("connection_status");
+    sensors.push_back("mode");
+    return sensors;
+}
+
+std::string SoapyUberSDR::readSensor(const int /*direction*/, const size_t channel, const std::string &key) const
+{
+    const UberChannel &ch = this->channel(channel);
+    if (key == "connection_status")
+        return ch.connected ? "connected" : "disconnected";
+    if (key == "mode")
+        return ch.mode;
     throw std::runtime_error("Unknown sensor: " + key);
 }
 
 // Helper functions
+UberChannel &SoapyUberSDR::channel(const size_t channel) const
+{
+    if (channel >= _channels.size())
+        throw std::runtime_error("SoapyUberSDR: invalid channel " + std::to_string(channel));
+    return *_channels[channel];
+}
+
 double SoapyUberSDR::modeToSampleRate(const std::string &mode) const
 {
     if (mode == "iq48") return 48000;
@@ -657,174 +1239,100 @@ std::string SoapyUberSDR::sampleRateToMode(double rate) const
         " Hz. Valid rates: 48000, 96000, 192000, 384000");
 }
 
-void SoapyUberSDR::handleTLSMessage(websocketpp::connection_hdl /*hdl*/, tls_message_ptr msg)
+void SoapyUberSDR::handleMessage(UberChannel &ch, websocketpp::frame::opcode::value opcode, const std::string &payload)
 {
+    // Frames still in flight after disconnectWebSocket() must not touch the pool
+    if (!ch.active)
+        return;
+    
     try {
-        const std::string& payload = msg->get_payload();
         
         // Log message type for debugging
         SoapySDR::logf(SOAPY_SDR_DEBUG, "SoapyUberSDR: Received message, opcode=%d, size=%zu",
-                      (int)msg->get_opcode(), payload.size());
+                      (int)opcode, payload.size());
         
         // Check if this is a binary message (pcm-zstd format)
-        if (msg->get_opcode() == websocketpp::frame::opcode::binary) {
+        if (opcode == websocketpp::frame::opcode::binary) {
             const uint8_t* compressedData = reinterpret_cast<const uint8_t*>(payload.data());
             size_t compressedSize = payload.size();
             
-            // Decompress with zstd
-            size_t decompressedSize = ZSTD_getFrameContentSize(compressedData, compressedSize);
+            // Frame size, from the zstd frame header
+            unsigned long long decompressedSize = ZSTD_getFrameContentSize(compressedData, compressedSize);
             if (decompressedSize == ZSTD_CONTENTSIZE_ERROR || decompressedSize == ZSTD_CONTENTSIZE_UNKNOWN) {
                 SoapySDR::log(SOAPY_SDR_ERROR, "SoapyUberSDR: Invalid zstd frame");
                 return;
             }
             
-            std::vector<uint8_t> decompressed(decompressedSize);
-            size_t actualSize = ZSTD_decompress(decompressed.data(), decompressedSize,
-                                                compressedData, compressedSize);
-            if (ZSTD_isError(actualSize)) {
+            // Stream-decompress with this channel's context: the header into a
+            // small local buffer, the PCM straight into the sample pool below
+            ZSTD_DCtx_reset(ch.zstd, ZSTD_reset_session_only);
+            ZSTD_inBuffer in = { compressedData, compressedSize, 0 };
+            size_t zerr = 0;
+            
+            uint8_t data[PCM_FULL_HEADER_SIZE_V2];
+            size_t got = zstdRead(ch.zstd, in, data, 3, zerr);
+            if (zerr) {
                 SoapySDR::logf(SOAPY_SDR_ERROR, "SoapyUberSDR: Zstd decompression error: %s",
-                              ZSTD_getErrorName(actualSize));
+                              ZSTD_getErrorName(zerr));
                 return;
             }
-            
-            // Parse binary header (little-endian)
-            if (actualSize < 13) {
+            if (got < 3) {
                 SoapySDR::log(SOAPY_SDR_ERROR, "SoapyUberSDR: Packet too small");
                 return;
             }
             
-            const uint8_t* data = decompressed.data();
             uint16_t magic = data[0] | (data[1] << 8);
             
+            // The full header grew from 29 to 37 bytes in version 2
+            // (pcm_binary.go); the version byte says which one this is
             size_t headerSize;
-            size_t dataOffset;
             
-            if (magic == 0x5043) {  // "PC" - Full header
-                headerSize = 29;
-                dataOffset = 29;
-            } else if (magic == 0x504D) {  // "PM" - Minimal header
-                headerSize = 13;
-                dataOffset = 13;
+            if (magic == PCM_MAGIC_FULL) {  // "PC" - Full header
+                headerSize = data[2] >= 2 ? PCM_FULL_HEADER_SIZE_V2 : PCM_FULL_HEADER_SIZE_V1;
+            } else if (magic == PCM_MAGIC_MINIMAL) {  // "PM" - Minimal header
+                headerSize = PCM_MINIMAL_HEADER_SIZE;
             } else {
                 SoapySDR::logf(SOAPY_SDR_ERROR, "SoapyUberSDR: Invalid PCM magic: 0x%04x", magic);
                 return;
             }
             
-            if (actualSize < headerSize) {
-                SoapySDR::log(SOAPY_SDR_ERROR, "SoapyUberSDR: Packet too small for header");
-                return;
-            }
-            
-            // PCM data starts after header
-            const uint8_t* pcmData = data + dataOffset;
-            size_t pcmSize = actualSize - dataOffset;
-            
-            // Calculate sample count from PCM data size
-            // Each sample is 4 bytes (2 channels * 2 bytes per sample)
-            size_t sampleCount = pcmSize / 4;
-            
-            if (pcmSize % 4 != 0) {
-                SoapySDR::logf(SOAPY_SDR_ERROR, "SoapyUberSDR: PCM data size not multiple of 4: %zu", pcmSize);
-                return;
-            }
-            
-            // Convert big-endian PCM to complex float
-            std::vector<std::complex<float>> iqSamples(sampleCount);
-            for (size_t i = 0; i < sampleCount; i++) {
-                int16_t I = (pcmData[i*4] << 8) | pcmData[i*4+1];
-                int16_t Q = (pcmData[i*4+2] << 8) | pcmData[i*4+3];
-                iqSamples[i] = std::complex<float>(I / 32768.0f, Q / 32768.0f);
-            }
-            
-            std::lock_guard<std::mutex> lock(_bufferMutex);
-            
-            // Limit queue depth to prevent memory bloat and excessive latency
-            if (_iqBuffers.size() >= MAX_BUFFER_QUEUE_SIZE) {
-                if (_readyToConsume) {
-                    SoapySDR::logf(SOAPY_SDR_WARNING,
-                        "SoapyUberSDR: Buffer queue full (%zu), dropping oldest buffer",
-                        _iqBuffers.size());
-                }
-                _iqBuffers.pop();
-            }
-            
-            _iqBuffers.push(std::move(iqSamples));
-            _bufferCV.notify_one();
-        } else {
-            // Log first few bytes of non-binary messages for debugging
-            if (payload.size() > 0) {
-                std::string preview = payload.substr(0, std::min(size_t(100), payload.size()));
-                SoapySDR::logf(SOAPY_SDR_DEBUG, "SoapyUberSDR: Non-binary message: %s", preview.c_str());
-            }
-        }
-        
-    } catch (const std::exception &e) {
-        SoapySDR::logf(SOAPY_SDR_ERROR, "SoapyUberSDR: TLS message handling error: %s", e.what());
-    }
-}
-
-void SoapyUberSDR::handlePlainMessage(websocketpp::connection_hdl hdl, plain_message_ptr msg)
-{
-    (void)hdl;  // suppress unused parameter warning
-    try {
-        const std::string& payload = msg->get_payload();
-        
-        // Log message type for debugging
-        SoapySDR::logf(SOAPY_SDR_DEBUG, "SoapyUberSDR: Received message, opcode=%d, size=%zu",
-                      (int)msg->get_opcode(), payload.size());
-        
-        // Check if this is a binary message (pcm-zstd format)
-        if (msg->get_opcode() == websocketpp::frame::opcode::binary) {
-            const uint8_t* compressedData = reinterpret_cast<const uint8_t*>(payload.data());
-            size_t compressedSize = payload.size();
-            
-            // Decompress with zstd
-            size_t decompressedSize = ZSTD_getFrameContentSize(compressedData, compressedSize);
-            if (decompressedSize == ZSTD_CONTENTSIZE_ERROR || decompressedSize == ZSTD_CONTENTSIZE_UNKNOWN) {
-                SoapySDR::log(SOAPY_SDR_ERROR, "SoapyUberSDR: Invalid zstd frame");
-                return;
-            }
-            
-            std::vector<uint8_t> decompressed(decompressedSize);
-            size_t actualSize = ZSTD_decompress(decompressed.data(), decompressedSize,
-                                                compressedData, compressedSize);
-            if (ZSTD_isError(actualSize)) {
+            got += zstdRead(ch.zstd, in, data + 3, headerSize - 3, zerr);
+            if (zerr) {
                 SoapySDR::logf(SOAPY_SDR_ERROR, "SoapyUberSDR: Zstd decompression error: %s",
-                              ZSTD_getErrorName(actualSize));
+                              ZSTD_getErrorName(zerr));
                 return;
             }
-            
-            // Parse binary header (little-endian)
-            if (actualSize < 13) {
-                SoapySDR::log(SOAPY_SDR_ERROR, "SoapyUberSDR: Packet too small");
+            if (got < headerSize || decompressedSize < headerSize) {
+                SoapySDR::log(SOAPY_SDR_ERROR, "SoapyUberSDR: Packet too small for header");
                 return;
             }
             
-            const uint8_t* data = decompressed.data();
-            uint16_t magic = data[0] | (data[1] << 8);
-            
-            size_t headerSize;
-            size_t dataOffset;
-            
-            if (magic == 0x5043) {  // "PC" - Full header
-                headerSize = 29;
-                dataOffset = 29;
-            } else if (magic == 0x504D) {  // "PM" - Minimal header
-                headerSize = 13;
-                dataOffset = 13;
+            // Both headers carry the server's GPS-synchronised Unix time in
+            // nanoseconds (the field ka9q_hpsdr.c calls the RTP timestamp)
+            uint64_t headerTimeNs;
+            if (magic == PCM_MAGIC_FULL) {
+                headerTimeNs = le64(data + 4);
+                uint32_t rate = le32(data + 20);
+                if (rate != 0)
+                    ch.headerRate = rate;
             } else {
-                SoapySDR::logf(SOAPY_SDR_ERROR, "SoapyUberSDR: Invalid PCM magic: 0x%04x", magic);
-                return;
+                headerTimeNs = le64(data + 3);
             }
             
-            if (actualSize < headerSize) {
-                SoapySDR::log(SOAPY_SDR_ERROR, "SoapyUberSDR: Packet too small for header");
-                return;
+            // After an in-place rate switch, frames still at the old rate are
+            // dropped until a full header reports the new one; that frame
+            // starts the new epoch on a fresh timeline, flagged as a gap
+            unsigned epoch = ch.rateEpoch.load(std::memory_order_acquire);
+            if (epoch != ch.frameEpoch.load(std::memory_order_relaxed)) {
+                if (magic != PCM_MAGIC_FULL || ch.headerRate != ch.switchRate.load(std::memory_order_relaxed))
+                    return;
+                ch.frameEpoch.store(epoch, std::memory_order_release);
+                ch.anchored = false;
+                ch.dropped = true;
             }
             
-            // PCM data starts after header
-            const uint8_t* pcmData = data + dataOffset;
-            size_t pcmSize = actualSize - dataOffset;
+            // PCM data follows the header
+            size_t pcmSize = (size_t)decompressedSize - headerSize;
             
             // Calculate sample count from PCM data size
             // Each sample is 4 bytes (2 channels * 2 bytes per sample)
@@ -835,28 +1343,86 @@ void SoapyUberSDR::handlePlainMessage(websocketpp::connection_hdl hdl, plain_mes
                 return;
             }
             
-            // Convert big-endian PCM to complex float
-            std::vector<std::complex<float>> iqSamples(sampleCount);
-            for (size_t i = 0; i < sampleCount; i++) {
-                int16_t I = (pcmData[i*4] << 8) | pcmData[i*4+1];
-                int16_t Q = (pcmData[i*4+2] << 8) | pcmData[i*4+3];
-                iqSamples[i] = std::complex<float>(I / 32768.0f, Q / 32768.0f);
-            }
-            
-            std::lock_guard<std::mutex> lock(_bufferMutex);
+            // Timestamp the frame on a sample-count timeline anchored on the
+            // header time. The server stamps frames as they arrive from radiod,
+            // so header times jitter; the timeline is only re-anchored when the
+            // header runs ahead of it by more than half a frame (samples were
+            // lost upstream, reported as a gap) or falls that far behind.
+            double nsPerSample = 1e9 / (ch.headerRate ? (double)ch.headerRate : ch.sampleRate);
+            bool gap = ch.dropped;
+            ch.dropped = false;
             
-            // Limit queue depth to prevent memory bloat and excessive latency
-            if (_iqBuffers.size() >= MAX_BUFFER_QUEUE_SIZE) {
-                if (_readyToConsume) {
-                    SoapySDR::logf(SOAPY_SDR_WARNING,
-                        "SoapyUberSDR: Buffer queue full (%zu), dropping oldest buffer",
-                        _iqBuffers.size());
+            long long frameTimeNs = 0;
+            if (headerTimeNs != 0) {
+                bool reanchor = !ch.anchored || nsPerSample != ch.anchorNsPerSample;
+                if (!reanchor) {
+                    long long predicted = ch.anchorNs + (long long)(ch.anchorSamples * nsPerSample);
+                    long long tolerance = std::max((long long)(sampleCount * nsPerSample) / 2, 2000000LL);
+                    long long drift = (long long)headerTimeNs - predicted;
+                    if (drift > tolerance) {
+                        gap = true;
+                        reanchor = true;
+                    } else if (drift < -tolerance) {
+                        reanchor = true;
+                    }
+                }
+                if (reanchor) {
+                    ch.anchored = true;
+                    ch.anchorNs = (long long)headerTimeNs;
+                    ch.anchorSamples = 0;
+                    ch.anchorNsPerSample = nsPerSample;
                 }
-                _iqBuffers.pop();
+                frameTimeNs = ch.anchorNs + (long long)(ch.anchorSamples * nsPerSample);
+                ch.anchorSamples += sampleCount;
             }
             
-            _iqBuffers.push(std::move(iqSamples));
-            _bufferCV.notify_one();
+            // Decompress the PCM straight into the pool and convert it there,
+            // splitting frames larger than a slot. CS16 is byte-swapped in
+            // place; for CF32 the PCM lands in the upper half of the slot and is
+            // expanded forwards into float over it.
+            size_t done = 0;
+            while (done < sampleCount) {
+                void *slot = ch.ring.beginWrite();
+                if (!slot) {
+                    // The ring is single-producer/single-consumer, so the newest
+                    // data is dropped rather than the oldest
+                    if (ch.readyToConsume) {
+                        SoapySDR::logf(SOAPY_SDR_WARNING,
+                            "SoapyUberSDR: Sample pool full (%zu slots), dropping %zu samples",
+                            SampleRing::NUM_SLOTS, sampleCount - done);
+                    }
+                    // The timeline still counts them, the next slot reports the gap
+                    ch.dropped = true;
+                    break;
+                }
+                
+                size_t want = std::min(sampleCount - done, SampleRing::SLOT_ELEMS);
+                uint8_t *pcm = static_cast<uint8_t*>(slot) + (ch.cs16 ? 0 : SampleRing::SLOT_ELEMS * 4);
+                size_t bytes = zstdRead(ch.zstd, in, pcm, want * 4, zerr);
+                size_t n = bytes / 4;
+                if (n > 0) {
+                    if (ch.cs16) {
+                        iq_be16_to_s16(pcm, static_cast<int16_t*>(slot), n * 2);
+                    } else {
+                        iq_be16_to_float(pcm, static_cast<float*>(slot), n,
+                                         1.0f / 32768.0f, 0, 0);
+                    }
+                    ch.ring.endWrite(n, frameTimeNs ? frameTimeNs + (long long)(done * nsPerSample) : 0,
+                                     frameTimeNs ? nsPerSample : 0.0, gap, epoch);
+                    gap = false;
+                    done += n;
+                }
+                
+                if (bytes < want * 4) {
+                    if (zerr) {
+                        SoapySDR::logf(SOAPY_SDR_ERROR, "SoapyUberSDR: Zstd decompression error: %s",
+                                      ZSTD_getErrorName(zerr));
+                    } else {
+                        SoapySDR::log(SOAPY_SDR_ERROR, "SoapyUberSDR: Truncated PCM frame");
+                    }
+                    break;
+                }
+            }
         } else {
             // Log first few bytes of non-binary messages for debugging
             if (payload.size() > 0) {
@@ -866,22 +1432,32 @@ void SoapyUberSDR::handlePlainMessage(websocketpp::connection_hdl hdl, plain_mes
         }
         
     } catch (const std::exception &e) {
-        SoapySDR::logf(SOAPY_SDR_ERROR, "SoapyUberSDR: Plain message handling error: %s", e.what());
+        SoapySDR::logf(SOAPY_SDR_ERROR, "SoapyUberSDR: Message handling error: %s", e.what());
+    }
+}
+
+void SoapyUberSDR::sendText(UberChannel &ch, const std::string &text)
+{
+    std::lock_guard<std::mutex> lock(_wsMutex);
+    if (_useTLS && _tlsClient) {
+        _tlsClient->send(ch.hdl, text, websocketpp::frame::opcode::text);
+    } else if (_plainClient) {
+        _plainClient->send(ch.hdl, text, websocketpp::frame::opcode::text);
     }
 }
 
 void SoapyUberSDR::sendPingMessage()
 {
-    try {
-        std::string pingMsg = "{\"type\":\"ping\"}";
-        if (_useTLS && _tlsClient) {
-            _tlsClient->send(_wsHandle, pingMsg, websocketpp::frame::opcode::text);
-        } else if (_plainClient) {
-            _plainClient->send(_wsHandle, pingMsg, websocketpp::frame::opcode::text);
+    for (size_t i = 0; i < _channels.size(); i++) {
+        UberChannel &ch = *_channels[i];
+        if (!ch.connected)
+            continue;
+        try {
+            sendText(ch, "{\"type\":\"ping\"}");
+            SoapySDR::logf(SOAPY_SDR_DEBUG, "SoapyUberSDR: Sent ping (channel %zu)", i);
+        } catch (const std::exception &e) {
+            SoapySDR::logf(SOAPY_SDR_DEBUG, "SoapyUberSDR: Failed to send ping (channel %zu): %s", i, e.what());
         }
-        SoapySDR::log(SOAPY_SDR_DEBUG, "SoapyUberSDR: Sent ping");
-    } catch (const std::exception &e) {
-        SoapySDR::logf(SOAPY_SDR_DEBUG, "SoapyUberSDR: Failed to send ping: %s", e.what());
     }
 }
 
@@ -898,7 +1474,7 @@ void SoapyUberSDR::startPingThread()
             elapsed++;
             if (elapsed >= 30) {
                 elapsed = 0;
-                if (_connected && !_pingStop) {
+                if (!_pingStop) {
                     sendPingMessage();
                 }
             }
@@ -915,17 +1491,13 @@ void SoapyUberSDR::stopPingThread()
     SoapySDR::log(SOAPY_SDR_DEBUG, "SoapyUberSDR: Ping thread stopped");
 }
 
-void SoapyUberSDR::sendTuneCommand(uint64_t freq, const std::string &mode)
+void SoapyUberSDR::sendTuneCommand(UberChannel &ch)
 {
     try {
         std::stringstream ss;
-        ss << "{\"type\":\"tune\",\"frequency\":" << freq << ",\"mode\":\"" << mode << "\"}";
+        ss << "{\"type\":\"tune\",\"frequency\":" << ch.frequency << ",\"mode\":\"" << ch.mode << "\"}";
 
-        if (_useTLS) {
-            _tlsClient->send(_wsHandle, ss.str(), websocketpp::frame::opcode::text);
-        } else {
-            _plainClient->send(_wsHandle, ss.str(), websocketpp::frame::opcode::text);
-        }
+        sendText(ch, ss.str());
 
         SoapySDR::logf(SOAPY_SDR_DEBUG, "SoapyUberSDR: Sent tune command: %s", ss.str().c_str());
     } catch (const std::exception &e) {
@@ -933,6 +1505,28 @@ void SoapyUberSDR::sendTuneCommand(uint64_t freq, const std::string &mode)
     }
 }
 
+// Change a connected channel's mode over its existing session: the tune
+// command carries the new mode, and the WebSocket thread switches epoch at
+// the first full header with the new rate. The server waits for radiod to
+// load the new preset (about half a second); false if no frame at the new
+// rate arrived in time.
+bool SoapyUberSDR::switchRateInPlace(UberChannel &ch)
+{
+    if (!ch.connected)
+        return false;
+    
+    ch.switchRate.store((uint32_t)ch.sampleRate, std::memory_order_relaxed);
+    unsigned epoch = ch.rateEpoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+    sendTuneCommand(ch);
+    
+    for (int i = 0; i < 300 && ch.connected; i++) {
+        if (ch.frameEpoch.load(std::memory_order_acquire) == epoch)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
 // CURL write callback
 static size_t soapy_curl_write_callback(void *contents, size_t size, size_t nmemb, void *userp)
 {
@@ -940,7 +1534,7 @@ static size_t soapy_curl_write_callback(void *contents, size_t size, size_t nmem
     return size * nmemb;
 }
 
-bool SoapyUberSDR::checkConnectionAllowed()
+bool SoapyUberSDR::checkConnectionAllowed(UberChannel &ch)
 {
     // Extract base URL from WebSocket URL
     std::string baseURL = _serverURL;
@@ -963,7 +1557,7 @@ bool SoapyUberSDR::checkConnectionAllowed()
     
     // Build JSON request body
     std::stringstream jsonBody;
-    jsonBody << "{\"user_session_id\":\"" << _userSessionID << "\"";
+    jsonBody << "{\"user_session_id\":\"" << ch.sessionID << "\"";
     if (!_password.empty()) {
         jsonBody << ",\"password\":\"" << _password << "\"";
     }
@@ -1039,10 +1633,10 @@ bool SoapyUberSDR::checkConnectionAllowed()
             }
             
             // Check if current mode is allowed
-            bool modeAllowed = std::find(_allowedIQModes.begin(), _allowedIQModes.end(), _currentMode) != _allowedIQModes.end();
+            bool modeAllowed = std::find(_allowedIQModes.begin(), _allowedIQModes.end(), ch.mode) != _allowedIQModes.end();
             
             if (modeAllowed) {
-                SoapySDR::logf(SOAPY_SDR_INFO, "SoapyUberSDR: Connection allowed - mode '%s' is available", _currentMode.c_str());
+                SoapySDR::logf(SOAPY_SDR_INFO, "SoapyUberSDR: Connection allowed - mode '%s' is available", ch.mode.c_str());
 
                 // Parse and log max_session_time
                 size_t mstPos = response.find("\"max_session_time\"");
@@ -1064,7 +1658,7 @@ bool SoapyUberSDR::checkConnectionAllowed()
 
                 return true;
             } else {
-                SoapySDR::logf(SOAPY_SDR_ERROR, "SoapyUberSDR: Connection allowed but mode '%s' is not in allowed list", _currentMode.c_str());
+                SoapySDR::logf(SOAPY_SDR_ERROR, "SoapyUberSDR: Connection allowed but mode '%s' is not in allowed list", ch.mode.c_str());
                 if (!_allowedIQModes.empty()) {
                     std::string allowedList;
                     for (size_t i = 0; i < _allowedIQModes.size(); i++) {
@@ -1096,41 +1690,12 @@ bool SoapyUberSDR::checkConnectionAllowed()
     return true;
 }
 
-void SoapyUberSDR::connectWebSocket()
+void SoapyUberSDR::startWebSocket()
 {
-    // Check if connection is allowed before attempting WebSocket connection
-    if (!checkConnectionAllowed()) {
-        throw std::runtime_error("Connection not allowed by server");
-    }
-
-    std::stringstream ss;
-    ss << _serverURL;
-    if (_serverURL.find('?') == std::string::npos)
-        ss << "?";
-    else
-        ss << "&";
-    ss << "frequency=" << _currentFrequency;
-    ss << "&mode=" << _currentMode;
-    ss << "&format=pcm-zstd";  // Request binary PCM with zstd compression
-    ss << "&user_session_id=" << _userSessionID;
-    if (!_password.empty()) {
-        // URL encode password (simple implementation for common characters)
-        std::string encodedPassword;
-        for (char c : _password) {
-            if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-                encodedPassword += c;
-            } else {
-                char hex[4];
-                snprintf(hex, sizeof(hex), "%%%02X", (unsigned char)c);
-                encodedPassword += hex;
-            }
-        }
-        ss << "&password=" << encodedPassword;
-    }
+    if (_wsThread.joinable())
+        return;
 
-    std::string wsURL = ss.str();
-
-    SoapySDR::logf(SOAPY_SDR_INFO, "SoapyUberSDR: Connecting to %s [%s]", wsURL.c_str(), _useTLS ? "TLS" : "Plain");
+    std::lock_guard<std::mutex> lock(_wsMutex);
 
     if (_useTLS) {
         // Reconstruct TLS client to ensure clean state after previous stop()
@@ -1162,18 +1727,8 @@ void SoapyUberSDR::connectWebSocket()
 
         _tlsClient->set_user_agent("UberSDR_Soapy/1.0");
 
-        _tlsClient->set_message_handler([this](websocketpp::connection_hdl hdl, tls_message_ptr msg) {
-            handleTLSMessage(hdl, msg);
-        });
-
-        websocketpp::lib::error_code ec;
-        tls_client::connection_ptr con = _tlsClient->get_connection(wsURL, ec);
-        if (ec) {
-            throw std::runtime_error("TLS WebSocket connection failed: " + ec.message());
-        }
-
-        _wsHandle = con->get_handle();
-        _tlsClient->connect(con);
+        // Keep run() alive between connections so channels can come and go
+        _tlsClient->start_perpetual();
 
         _wsThread = std::thread([this]() {
             try {
@@ -1193,18 +1748,8 @@ void SoapyUberSDR::connectWebSocket()
 
         _plainClient->set_user_agent("UberSDR_Soapy/1.0");
 
-        _plainClient->set_message_handler([this](websocketpp::connection_hdl hdl, plain_message_ptr msg) {
-            handlePlainMessage(hdl, msg);
-        });
-
-        websocketpp::lib::error_code ec;
-        plain_client::connection_ptr con = _plainClient->get_connection(wsURL, ec);
-        if (ec) {
-            throw std::runtime_error("Plain WebSocket connection failed: " + ec.message());
-        }
-
-        _wsHandle = con->get_handle();
-        _plainClient->connect(con);
+        // Keep run() alive between connections so channels can come and go
+        _plainClient->start_perpetual();
 
         _wsThread = std::thread([this]() {
             try {
@@ -1215,39 +1760,174 @@ void SoapyUberSDR::connectWebSocket()
         });
     }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    _connected = true;
-
     // Start keepalive ping thread (sends {"type":"ping"} every 30 seconds)
     startPingThread();
 
-    SoapySDR::log(SOAPY_SDR_INFO, "SoapyUberSDR: WebSocket connected");
+    SoapySDR::log(SOAPY_SDR_DEBUG, "SoapyUberSDR: WebSocket thread started");
 }
 
-void SoapyUberSDR::disconnectWebSocket()
+void SoapyUberSDR::stopWebSocket()
 {
-    _connected = false;
+    // The io thread is shared, so it only goes once no channel is streaming
+    for (auto &ch : _channels) {
+        if (ch->active)
+            return;
+    }
+    if (!_wsThread.joinable())
+        return;
 
-    // Stop keepalive ping thread before closing the WebSocket
     stopPingThread();
 
-    try {
-        if (_useTLS && _tlsClient) {
-            _tlsClient->close(_wsHandle, websocketpp::close::status::normal, "");
-            _tlsClient->stop();
-        } else if (_plainClient) {
-            _plainClient->close(_wsHandle, websocketpp::close::status::normal, "");
-            _plainClient->stop();
-        }
-    } catch (...) {}
+    {
+        std::lock_guard<std::mutex> lock(_wsMutex);
+        try {
+            if (_useTLS && _tlsClient) {
+                _tlsClient->stop_perpetual();
+                _tlsClient->stop();
+            } else if (_plainClient) {
+                _plainClient->stop_perpetual();
+                _plainClient->stop();
+            }
+        } catch (...) {}
+    }
 
-    if (_wsThread.joinable())
-        _wsThread.join();
+    _wsThread.join();
 
-    // Note: Client will be reconstructed in connectWebSocket() on next activation
+    // Note: Client will be reconstructed in startWebSocket() on next activation
     // This avoids the "invalid state" error from reusing a stopped client
 
-    SoapySDR::log(SOAPY_SDR_INFO, "SoapyUberSDR: WebSocket disconnected");
+    SoapySDR::log(SOAPY_SDR_DEBUG, "SoapyUberSDR: WebSocket thread stopped");
+}
+
+void SoapyUberSDR::syncWebSocketThread()
+{
+    // Round-trip an empty task through the io thread: once it has run, any
+    // message handler that was in progress has returned, and later ones see
+    // whatever this thread stored before the call
+    if (!_wsThread.joinable())
+        return;
+
+    std::shared_ptr<std::promise<void>> done = std::make_shared<std::promise<void>>();
+    std::future<void> ran = done->get_future();
+    {
+        std::lock_guard<std::mutex> lock(_wsMutex);
+        if (_useTLS && _tlsClient)
+            _tlsClient->get_io_service().post([done]() { done->set_value(); });
+        else if (_plainClient)
+            _plainClient->get_io_service().post([done]() { done->set_value(); });
+        else
+            return;
+    }
+    if (ran.wait_for(std::chrono::seconds(2)) != std::future_status::ready)
+        SoapySDR::log(SOAPY_SDR_WARNING, "SoapyUberSDR: WebSocket thread did not respond");
+}
+
+template <typename Client>
+void SoapyUberSDR::openConnection(Client &client, UberChannel &ch, const std::string &url)
+{
+    websocketpp::lib::error_code ec;
+    typename Client::connection_ptr con = client.get_connection(url, ec);
+    if (ec) {
+        throw std::runtime_error(std::string(_useTLS ? "TLS" : "Plain") +
+                                 " WebSocket connection failed: " + ec.message());
+    }
+
+    // Handlers of a previous connection on this channel may still fire after a
+    // reconnect; the generation tells them apart
+    UberChannel *c = &ch;
+    unsigned generation = ++ch.generation;
+
+    con->set_message_handler([this, c](websocketpp::connection_hdl, typename Client::message_ptr msg) {
+        handleMessage(*c, msg->get_opcode(), msg->get_payload());
+    });
+    con->set_open_handler([c, generation](websocketpp::connection_hdl) {
+        if (c->generation == generation)
+            c->connected = true;
+    });
+    auto closed = [c, generation](websocketpp::connection_hdl) {
+        if (c->generation == generation)
+            c->connected = false;
+    };
+    con->set_close_handler(closed);
+    con->set_fail_handler(closed);
+
+    ch.hdl = con->get_handle();
+    client.connect(con);
+}
+
+void SoapyUberSDR::connectWebSocket(UberChannel &ch)
+{
+    std::stringstream ss;
+    ss << _serverURL;
+    if (_serverURL.find('?') == std::string::npos)
+        ss << "?";
+    else
+        ss << "&";
+    ss << "frequency=" << ch.frequency;
+    ss << "&mode=" << ch.mode;
+    ss << "&format=pcm-zstd";  // Request binary PCM with zstd compression
+    ss << "&user_session_id=" << ch.sessionID;
+    if (!_password.empty()) {
+        // URL encode password (simple implementation for common characters)
+        std::string encodedPassword;
+        for (char c : _password) {
+            if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+                encodedPassword += c;
+            } else {
+                char hex[4];
+                snprintf(hex, sizeof(hex), "%%%02X", (unsigned char)c);
+                encodedPassword += hex;
+            }
+        }
+        ss << "&password=" << encodedPassword;
+    }
+
+    std::string wsURL = ss.str();
+
+    SoapySDR::logf(SOAPY_SDR_INFO, "SoapyUberSDR: Connecting to %s [%s]", wsURL.c_str(), _useTLS ? "TLS" : "Plain");
+
+    // Nothing writes this channel's pool (or timeline) while it is inactive;
+    // a reader may still be in readStream(), so it empties the pool itself
+    ch.ring.requestDiscard();
+    ch.headerRate = 0;
+    ch.anchored = false;
+    ch.dropped = false;
+    ch.frameEpoch.store(ch.rateEpoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    ch.active = true;
+
+    std::lock_guard<std::mutex> lock(_wsMutex);
+    if (_useTLS)
+        openConnection(*_tlsClient, ch, wsURL);
+    else
+        openConnection(*_plainClient, ch, wsURL);
+}
+
+void SoapyUberSDR::disconnectWebSocket(UberChannel &ch)
+{
+    bool wasActive = ch.active.exchange(false);
+    ch.readyToConsume = false;
+
+    {
+        std::lock_guard<std::mutex> lock(_wsMutex);
+        try {
+            if (_useTLS && _tlsClient) {
+                _tlsClient->close(ch.hdl, websocketpp::close::status::normal, "");
+            } else if (_plainClient) {
+                _plainClient->close(ch.hdl, websocketpp::close::status::normal, "");
+            }
+        } catch (...) {}
+        ch.hdl.reset();
+    }
+    ch.connected = false;
+
+    // Wait out any handler still decoding into the pool, then have the
+    // consumer drop what is queued: readStream() may be running on another
+    // thread, and only it may move the read side of the ring
+    syncWebSocketThread();
+    ch.ring.requestDiscard();
+
+    if (wasActive)
+        SoapySDR::log(SOAPY_SDR_INFO, "SoapyUberSDR: WebSocket disconnected");
 }
 
 // Helper function to discover local instances via mDNS